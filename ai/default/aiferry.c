@@ -397,6 +397,7 @@ static unsigned combined_land_sea_move(const struct tile *src_tile,
                                        enum pf_move_scope src_scope,
                                        const struct tile *tgt_tile,
                                        enum pf_move_scope dst_scope,
+                                       enum direction8 dir,
                                        const struct pf_parameter *param)
 {
   unsigned move_cost;
@@ -409,8 +410,8 @@ static unsigned combined_land_sea_move(const struct tile *src_tile,
     move_cost = PF_IMPOSSIBLE_MC;
   } else {
     /* Land-to-Land */
-    move_cost = map_move_cost(&(wld.map), param->owner, param->utype,
-                              src_tile, tgt_tile);
+    move_cost = map_move_cost_dir(&(wld.map), param->owner, param->utype,
+                                  src_tile, tgt_tile, dir);
   }
 
   return move_cost;
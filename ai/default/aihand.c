@@ -485,7 +485,6 @@ static void dai_manage_taxes(struct ai_type *ait, struct player *pplayer)
       struct cm_result *cmr = cm_result_new(pcity);
       struct ai_city *city_data = def_ai_city_data(pcity, ait);
 
-      cm_clear_cache(pcity);
       cm_query_result(pcity, &cmp, cmr, FALSE); /* burn some CPU */
 
       total_cities++;
@@ -746,6 +745,8 @@ static void dai_manage_government(struct ai_type *ait, struct player *pplayer)
 *****************************************************************************/
 void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
 {
+  enum req_profile_caller caller = req_profile_set_caller(RPC_AI);
+
   TIMING_LOG(AIT_ALL, TIMER_START);
   dai_assess_danger_player(ait, pplayer, &(wld.map));
   /* TODO: Make assess_danger save information on what is threatening
@@ -758,6 +759,7 @@ void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
   /* STOP.  Everything else is at end of turn. */
 
   TIMING_LOG(AIT_ALL, TIMER_STOP);
+  req_profile_set_caller(caller);
 
   flush_packets(); /* AIs can be such spammers... */
 }
@@ -772,6 +774,9 @@ void dai_do_first_activities(struct ai_type *ait, struct player *pplayer)
 *****************************************************************************/
 void dai_do_last_activities(struct ai_type *ait, struct player *pplayer)
 {
+  enum cm_caller cmcaller = cm_set_caller(CM_CALLER_AI);
+  enum req_profile_caller caller = req_profile_set_caller(RPC_AI);
+
   TIMING_LOG(AIT_ALL, TIMER_START);
   dai_clear_tech_wants(ait, pplayer);
 
@@ -789,4 +794,6 @@ void dai_do_last_activities(struct ai_type *ait, struct player *pplayer)
   dai_manage_spaceship(pplayer);
 
   TIMING_LOG(AIT_ALL, TIMER_STOP);
+  req_profile_set_caller(caller);
+  cm_set_caller(cmcaller);
 }
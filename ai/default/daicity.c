@@ -24,6 +24,7 @@
 
 /* common */
 #include "actions.h"
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "map.h"
@@ -1501,6 +1502,7 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
   adv_want final_want = 0;
   int wonder_player_id = WONDER_NOT_OWNED;
   int wonder_city_id = WONDER_NOT_BUILT;
+  bool bypassed;
 
   if (adv->impr_calc[improvement_index(pimprove)] == ADV_IMPR_ESTIMATE) {
     return 0; /* Nothing to calculate here. */
@@ -1520,6 +1522,7 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
     wonder_city_id = pplayer->wonders[improvement_index(pimprove)];
   }
   /* Add the improvement */
+  bypassed = effect_cache_bypass(TRUE);
   city_add_improvement(pcity, pimprove);
 
   /* Stir, then compare notes */
@@ -1539,6 +1542,7 @@ static adv_want base_want(struct ai_type *ait, struct player *pplayer,
 
     pplayer->wonders[improvement_index(pimprove)] = wonder_city_id;
   }
+  effect_cache_bypass(bypassed);
 
   return final_want;
 }
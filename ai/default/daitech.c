@@ -21,6 +21,7 @@
 #include "log.h"
 
 /* common */
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "player.h"
@@ -233,6 +234,7 @@ static adv_want dai_tech_base_want(struct ai_type *ait, struct player *pplayer,
   adv_want final_want;
   bool world_knew = game.info.global_advances[tech];
   int world_count = game.info.global_advance_count;
+  bool bypassed = effect_cache_bypass(TRUE);
 
   research_invention_set(pres, tech, TECH_KNOWN);
 
@@ -241,6 +243,7 @@ static adv_want dai_tech_base_want(struct ai_type *ait, struct player *pplayer,
   research_invention_set(pres, tech, old_state);
   game.info.global_advances[tech] = world_knew;
   game.info.global_advance_count = world_count;
+  effect_cache_bypass(bypassed);
 
   return final_want - orig_want;
 }
@@ -402,7 +402,7 @@ bool dai_unit_goto_constrained(struct ai_type *ait, struct unit *punit,
     return TRUE;
   }
 
-  pfm = pf_map_new(parameter);
+  pfm = pf_map_new_goal(parameter, ptile);
   path = pf_map_path(pfm, ptile);
 
   if (path) {
@@ -436,7 +436,7 @@ bool goto_is_sane(struct unit *punit, struct tile *ptile)
     struct pf_map *pfm;
 
     pft_fill_unit_attack_param(&parameter, nmap, punit);
-    pfm = pf_map_new(&parameter);
+    pfm = pf_map_new_goal(&parameter, ptile);
 
     if (pf_map_move_cost(pfm, ptile) != PF_IMPOSSIBLE_MC) {
       can_get_there = TRUE;
@@ -538,7 +538,7 @@ static struct pf_path *find_rampage_target(struct unit *punit,
    * Hence no call ai_avoid_risks()
    */
 
-  tgt_map = pf_map_new(&parameter);
+  tgt_map = pf_map_new_cached(&parameter);
   pf_map_move_costs_iterate(tgt_map, iter_tile, move_cost, FALSE) {
     int want;
     bool move_needed;
@@ -735,7 +735,7 @@ adv_want look_for_charge(struct ai_type *ait, struct player *pplayer,
 
   pft_fill_unit_parameter(&parameter, nmap, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_new_cached(&parameter);
 
   pf_map_move_costs_iterate(pfm, ptile, move_cost, TRUE) {
     if (move_cost > max_move_cost) {
@@ -1287,7 +1287,7 @@ adv_want find_something_to_kill(struct ai_type *ait, struct player *pplayer,
 
   pft_fill_unit_attack_param(&parameter, nmap, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
-  punit_map = pf_map_new(&parameter);
+  punit_map = pf_map_new_cached(&parameter);
 
   if (MOVE_NONE == punit_class->adv.sea_move) {
     /* We need boat to move over sea. */
@@ -1314,7 +1314,7 @@ adv_want find_something_to_kill(struct ai_type *ait, struct player *pplayer,
     boattype = unit_type_get(ferryboat);
     pft_fill_unit_overlap_param(&parameter, nmap, ferryboat);
     parameter.omniscience = !has_handicap(pplayer, H_MAP);
-    ferry_map = pf_map_new(&parameter);
+    ferry_map = pf_map_new_cached(&parameter);
   } else {
     boattype = best_role_unit_for_player(pplayer, L_FERRYBOAT);
     if (NULL == boattype) {
@@ -1326,7 +1326,7 @@ adv_want find_something_to_kill(struct ai_type *ait, struct player *pplayer,
       pft_fill_utype_overlap_param(&parameter, nmap, boattype,
                                    punit_tile, pplayer);
       parameter.omniscience = !has_handicap(pplayer, H_MAP);
-      ferry_map = pf_map_new(&parameter);
+      ferry_map = pf_map_new_cached(&parameter);
     } else {
       ferry_map = NULL;
     }
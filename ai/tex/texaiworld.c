@@ -133,6 +133,7 @@ void texai_tile_info_recv(void *data)
     ptile = index_to_tile(&(texai_world.map), info->index);
     ptile->terrain = info->terrain;
     ptile->extras = info->extras;
+    map_move_costs_tile_changed(&(texai_world.map), ptile);
   }
 
   free(info);
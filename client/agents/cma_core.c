@@ -337,6 +337,8 @@ static bool apply_result_on_server(struct city *pcity,
 ****************************************************************************/
 static void report_stats(void)
 {
+  struct cm_stats cmstats;
+
 #if SHOW_TIME_STATS
   int total, per_mill;
 
@@ -349,6 +351,15 @@ static void report_stats(void)
            (1000 - per_mill) / 10, (1000 - per_mill) % 10,
            stats.apply_result_applied, total);
 #endif /* SHOW_TIME_STATS */
+
+  cm_stats_get(CM_CALLER_CMA, TRUE, &cmstats);
+  if (0 < cmstats.queries) {
+    log_verbose("CMA: %lu queries, %lu cache hits, %lu searches, "
+                "%lu nodes, %.3fs last turn.",
+                cmstats.queries, cmstats.hits, cmstats.searches,
+                cmstats.nodes, cmstats.seconds);
+  }
+  cm_stats_turn_reset();
 }
 
 /************************************************************************//**
@@ -486,6 +497,7 @@ void cma_init(void)
 
   /* reset cache counters */
   memset(&stats, 0, sizeof(stats));
+  cm_set_caller(CM_CALLER_CMA);
 
   /* We used to just use timer_new() here, but apparently cma_init() can be
    * called multiple times per client invocation so that lead to memory
@@ -56,6 +56,7 @@
 #include "netintf.h"
 #include "packets.h"
 #include "player.h"
+#include "requirements.h"
 #include "research.h"
 #include "server_settings.h"
 #include "version.h"
@@ -646,6 +647,10 @@ int client_main(int argc, char *argv[], bool postpone_tileset)
   options_init();
   options_load();
 
+  if (getenv("FREECIV_REQ_PROFILE") != NULL) {
+    req_profile_enable(TRUE);
+  }
+
   script_client_init();
 
   if (sound_set_name[0] == '\0') {
@@ -728,6 +733,10 @@ void fc__noreturn client_exit(int return_value)
     client_remove_all_cli_conn();
   }
 
+  if (req_profile_enabled()) {
+    req_profile_log(30);
+  }
+
   if (gui_options.save_options_on_exit) {
     options_save(log_option_save_msg);
   }
@@ -95,6 +95,13 @@ extern struct civclient {
   /* this is the client's connection to the server */
   struct connection conn;
   struct global_worklist_list *worklists;
+
+  /* How much of the map the server has sent after we joined a running
+   * game. See handle_map_stream_progress(). */
+  struct {
+    int tiles_sent;
+    int tiles_total;
+  } map_stream;
 } client;
 
 void wait_till_request_got_processed(int request_id);
@@ -709,7 +709,7 @@ static int get_connect_road(const struct tile *src_tile, enum direction8 dir,
   }
 
   move_cost = param->get_MC(src_tile, PF_MS_NATIVE, dest_tile, PF_MS_NATIVE,
-                            param);
+                            dir, param);
   if (move_cost == PF_IMPOSSIBLE_MC) {
     return -1;
   }
@@ -822,7 +822,7 @@ static int get_connect_irrig(const struct tile *src_tile,
   }
 
   move_cost = param->get_MC(src_tile, PF_MS_NATIVE, dest_tile, PF_MS_NATIVE,
-                            param);
+                            dir, param);
   if (move_cost == PF_IMPOSSIBLE_MC) {
     return -1;
   }
@@ -1563,7 +1563,7 @@ bool send_goto_tile(struct unit *punit, struct tile *ptile)
   struct pf_path *path;
 
   goto_fill_parameter_base(&parameter, punit);
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_new_goal(&parameter, ptile);
   path = pf_map_path(pfm, ptile);
   pf_map_destroy(pfm);
 
@@ -1604,7 +1604,7 @@ bool send_rally_tile(struct city *pcity, struct tile *ptile, bool persistent)
 
   /* Use the unit to find a path to the destination tile. */
   goto_fill_parameter_base(&parameter, punit);
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_new_goal(&parameter, ptile);
   path = pf_map_path(pfm, ptile);
   pf_map_destroy(pfm);
 
@@ -1386,6 +1386,7 @@ char *helptext_building(char *buf, size_t bufsz, struct player *pplayer,
     .kind = VUT_IMPROVEMENT,
     .value = {.building = pimprove}
   };
+  enum req_profile_caller caller;
 
   fc_assert_ret_val(NULL != buf && 0 < bufsz, NULL);
   buf[0] = '\0';
@@ -1394,6 +1395,8 @@ char *helptext_building(char *buf, size_t bufsz, struct player *pplayer,
     return buf;
   }
 
+  caller = req_profile_set_caller(RPC_HELP);
+
   if (NULL != pimprove->helptext) {
     strvec_iterate(pimprove->helptext, text) {
       cat_snprintf(buf, bufsz, "%s\n\n", _(text));
@@ -1818,6 +1821,8 @@ char *helptext_building(char *buf, size_t bufsz, struct player *pplayer,
   if (user_text && user_text[0] != '\0') {
     cat_snprintf(buf, bufsz, "\n\n%s", user_text);
   }
+  req_profile_set_caller(caller);
+
   return buf;
 }
 
@@ -1869,6 +1874,7 @@ char *helptext_unit(char *buf, size_t bufsz, struct player *pplayer,
   int flagid;
   struct unit_class *pclass;
   int fuel;
+  enum req_profile_caller caller;
 
   fc_assert_ret_val(NULL != buf && 0 < bufsz && NULL != user_text, NULL);
 
@@ -1878,6 +1884,8 @@ char *helptext_unit(char *buf, size_t bufsz, struct player *pplayer,
     return buf;
   }
 
+  caller = req_profile_set_caller(RPC_HELP);
+
   has_vet_levels = utype_veteran_levels(utype) > 1;
 
   buf[0] = '\0';
@@ -3255,6 +3263,7 @@ char *helptext_unit(char *buf, size_t bufsz, struct player *pplayer,
     } strvec_iterate_end;
   }
   CATLSTR(buf, bufsz, "%s", user_text);
+  req_profile_set_caller(caller);
 
   return buf;
 }
@@ -3274,6 +3283,7 @@ void helptext_advance(char *buf, size_t bufsz, struct player *pplayer,
     .value = {.advance = vap}
   };
   int flagid;
+  enum req_profile_caller caller;
 
   fc_assert_ret(NULL != buf && 0 < bufsz && NULL != user_text);
   fc_strlcpy(buf, user_text, bufsz);
@@ -3283,6 +3293,8 @@ void helptext_advance(char *buf, size_t bufsz, struct player *pplayer,
     return;
   }
 
+  caller = req_profile_set_caller(RPC_HELP);
+
   if (game.control.num_tech_classes > 0) {
     if (vap->tclass == NULL) {
       cat_snprintf(buf, bufsz, _("Belongs to the default tech class.\n\n"));
@@ -3480,6 +3492,7 @@ void helptext_advance(char *buf, size_t bufsz, struct player *pplayer,
   }
 
   astr_free(&astr);
+  req_profile_set_caller(caller);
 }
 
 /************************************************************************//**
@@ -4313,9 +4326,11 @@ void helptext_government(char *buf, size_t bufsz, struct player *pplayer,
     .kind = VUT_GOVERNMENT,
     .value = {.govern = gov}
   };
+  enum req_profile_caller caller;
 
   fc_assert_ret(NULL != buf && 0 < bufsz);
   buf[0] = '\0';
+  caller = req_profile_set_caller(RPC_HELP);
 
   if (NULL != gov->helptext) {
     strvec_iterate(gov->helptext, text) {
@@ -4962,6 +4977,7 @@ void helptext_government(char *buf, size_t bufsz, struct player *pplayer,
   if (user_text && user_text[0] != '\0') {
     cat_snprintf(buf, bufsz, "\n%s", user_text);
   }
+  req_profile_set_caller(caller);
 }
 
 /************************************************************************//**
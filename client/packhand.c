@@ -2268,6 +2268,25 @@ void handle_map_info(const struct packet_map_info *packet)
   calculate_overview_dimensions();
 
   packhand_init();
+
+  client.map_stream.tiles_sent = 0;
+  client.map_stream.tiles_total = 0;
+}
+
+/************************************************************************//**
+  Packet map_stream_progress handler. The server tells how much of the
+  map it has sent since we joined the running game.
+****************************************************************************/
+void handle_map_stream_progress(int tiles_sent, int tiles_total)
+{
+  client.map_stream.tiles_sent = tiles_sent;
+  client.map_stream.tiles_total = tiles_total;
+
+  if (tiles_sent >= tiles_total) {
+    log_verbose("Received the whole map.");
+  }
+
+  update_info_label();
 }
 
 /************************************************************************//**
@@ -3112,9 +3131,11 @@ void handle_spaceship_info(const struct packet_spaceship_info *p)
 }
 
 /************************************************************************//**
-  Packet tile_info handler.
+  Update the tile from the tile info. Returns whether the tile needs to
+  be redrawn. Sets *update_menus if the menus need to be updated.
 ****************************************************************************/
-void handle_tile_info(const struct packet_tile_info *packet)
+static bool update_tile_from_info(const struct packet_tile_info *packet,
+                                  bool *update_menus)
 {
   enum known_type new_known;
   enum known_type old_known;
@@ -3126,7 +3147,8 @@ void handle_tile_info(const struct packet_tile_info *packet)
   struct terrain *pterrain = terrain_by_number(packet->terrain);
   struct tile *ptile = index_to_tile(&(wld.map), packet->tile);
 
-  fc_assert_ret_msg(NULL != ptile, "Invalid tile index %d.", packet->tile);
+  fc_assert_ret_val_msg(NULL != ptile, FALSE,
+                        "Invalid tile index %d.", packet->tile);
   old_known = client_tile_get_known(ptile);
 
   if (packet->resource != MAX_EXTRA_TYPES) {
@@ -3154,6 +3176,7 @@ void handle_tile_info(const struct packet_tile_info *packet)
 
   if (!BV_ARE_EQUAL(ptile->extras, packet->extras)) {
     ptile->extras = packet->extras;
+    map_move_costs_tile_changed(&(wld.map), ptile);
     tile_changed = TRUE;
   }
 
@@ -3347,18 +3370,10 @@ void handle_tile_info(const struct packet_tile_info *packet)
     editgui_notify_object_changed(OBJTYPE_TILE, tile_index(ptile), FALSE);
   }
 
-  /* refresh tiles */
-  if (can_client_change_view()) {
-    /* the tile itself (including the necessary parts of adjacent tiles) */
-    if (tile_changed || old_known != new_known) {
-      refresh_tile_mapcanvas(ptile, TRUE, FALSE);
-    }
-  }
-
   /* update menus if the focus unit is on the tile. */
   if (tile_changed) {
     if (get_focus_unit_on_tile(ptile)) {
-      menus_update();
+      *update_menus = TRUE;
     }
   }
 
@@ -3366,6 +3381,56 @@ void handle_tile_info(const struct packet_tile_info *packet)
    * whose radii include this tile, to update the city map display.
    * But that would be expensive. We deal with the (common) special
    * case of changes in worked tiles above. */
+
+  return tile_changed || old_known != new_known;
+}
+
+/************************************************************************//**
+  Packet tile_info handler.
+****************************************************************************/
+void handle_tile_info(const struct packet_tile_info *packet)
+{
+  bool update_menus = FALSE;
+
+  /* refresh tiles */
+  if (update_tile_from_info(packet, &update_menus)
+      && can_client_change_view()) {
+    /* the tile itself (including the necessary parts of adjacent tiles) */
+    refresh_tile_mapcanvas(index_to_tile(&(wld.map), packet->tile),
+                           TRUE, FALSE);
+  }
+
+  if (update_menus) {
+    menus_update();
+  }
+}
+
+/************************************************************************//**
+  Packet tile_info_batch handler. The tiles are updated one by one as if
+  they came in separate tile infos, but the map canvas and the menus are
+  refreshed only once for the whole run.
+****************************************************************************/
+void handle_tile_info_batch(const struct packet_tile_info_batch *packet)
+{
+  struct packet_tile_info info;
+  bool redraw = FALSE;
+  bool update_menus = FALSE;
+  int i;
+
+  for (i = 0; i < packet->count; i++) {
+    tile_info_batch_get(packet, i, &info);
+    if (update_tile_from_info(&info, &update_menus)) {
+      redraw = TRUE;
+    }
+  }
+
+  if (redraw && can_client_change_view()) {
+    update_map_canvas_visible();
+  }
+
+  if (update_menus) {
+    menus_update();
+  }
 }
 
 /************************************************************************//**
@@ -3570,6 +3635,10 @@ void handle_rulesets_ready(void)
   /* Cache what city production can receive help from caravans. */
   city_production_caravan_shields_init();
 
+  /* Compile the requirements evaluated the most often. */
+  ruleset_cache_compile();
+  action_enablers_compile();
+
   /* Adjust editor for changed ruleset. */
   editor_ruleset_changed();
 
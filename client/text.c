@@ -940,6 +940,12 @@ const char *get_info_label_text(bool moreinfo)
   astr_add_line(&str, _("Year: %s (T%d)"),
                 calendar_text(), game.info.turn);
 
+  if (client.map_stream.tiles_sent < client.map_stream.tiles_total) {
+    astr_add_line(&str, _("Receiving map: %d%%"),
+                  client.map_stream.tiles_sent * 100
+                  / client.map_stream.tiles_total);
+  }
+
   if (NULL != client.conn.playing) {
     astr_add_line(&str, _("Gold: %d (%+d)"),
                   client.conn.playing->economic.gold,
@@ -61,6 +61,13 @@ static bool actions_initialized = FALSE;
 
 static struct action_enabler_list *action_enablers_by_action[MAX_NUM_ACTIONS];
 
+/* The enum action_utype_feasibility of each unit type for each action
+ * performed by units, by action_enablers_compile(). */
+static struct {
+  bool compiled;
+  unsigned char utypes[U_LAST];
+} utype_feasibility[MAX_NUM_ACTIONS];
+
 static struct astring ui_name_str = ASTRING_INIT;
 
 static struct action *
@@ -74,6 +81,7 @@ unit_action_new(action_id id,
                 bool actor_consuming_always);
 
 static bool is_enabler_active(const struct action_enabler *enabler,
+                              const struct unit_type *actor_utype,
                               const struct req_context *actor,
                               const struct req_context *target);
 
@@ -861,6 +869,122 @@ void actions_rs_pre_san_gen(void)
   hard_code_oblig_hard_reqs_ruleset();
 }
 
+/**********************************************************************//**
+  Returns whether the requirement only depends on the unit type of the
+  target, and so can be evaluated once for each unit type.
+**************************************************************************/
+static bool req_is_unit_type_static(const struct requirement *preq)
+{
+  switch (preq->source.kind) {
+  case VUT_NONE:
+    return TRUE;
+  case VUT_UTYPE:
+  case VUT_UTFLAG:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+    return REQ_RANGE_LOCAL == preq->range;
+  default:
+    return FALSE;
+  }
+}
+
+/**********************************************************************//**
+  Find the unit types of the actors that may, or always do, fulfill the
+  actor requirements of the enabler.
+**************************************************************************/
+static void action_enabler_utypes_compile(struct action_enabler *enabler)
+{
+  if (AAK_UNIT != action_id_get_actor_kind(enabler_get_action_id(enabler))) {
+    BV_SET_ALL(enabler->actor_utypes);
+    BV_CLR_ALL(enabler->actor_utypes_always);
+    return;
+  }
+
+  BV_CLR_ALL(enabler->actor_utypes);
+  BV_CLR_ALL(enabler->actor_utypes_always);
+
+  unit_type_iterate(putype) {
+    const struct req_context context = { .unittype = putype };
+    bool possible = TRUE;
+    bool always = TRUE;
+
+    requirement_vector_iterate(&enabler->actor_reqs, preq) {
+      if (!req_is_unit_type_static(preq)) {
+        always = FALSE;
+      } else if (!is_req_active(&context, NULL, preq, RPT_CERTAIN)) {
+        possible = FALSE;
+        break;
+      }
+    } requirement_vector_iterate_end;
+
+    if (possible) {
+      BV_SET(enabler->actor_utypes, utype_index(putype));
+      if (always) {
+        BV_SET(enabler->actor_utypes_always, utype_index(putype));
+      }
+    }
+  } unit_type_iterate_end;
+}
+
+/**********************************************************************//**
+  Compile the requirements of all the action enablers, once the ruleset
+  is fully loaded, compatibility updates included. Enablers changed
+  afterwards must be compiled again.
+**************************************************************************/
+void action_enablers_compile(void)
+{
+  action_iterate(act) {
+    action_enabler_list_iterate(action_enablers_for_action(act), enabler) {
+      if (enabler->actor_reqs_program != NULL) {
+        req_program_destroy(enabler->actor_reqs_program);
+      }
+      if (enabler->target_reqs_program != NULL) {
+        req_program_destroy(enabler->target_reqs_program);
+      }
+      enabler->actor_reqs_program = req_program_new(&enabler->actor_reqs);
+      enabler->target_reqs_program = req_program_new(&enabler->target_reqs);
+      action_enabler_utypes_compile(enabler);
+    } action_enabler_list_iterate_end;
+
+    utype_feasibility[act].compiled
+      = (AAK_UNIT == action_id_get_actor_kind(act));
+    unit_type_iterate(putype) {
+      int uidx = utype_index(putype);
+      enum action_utype_feasibility feasibility = AUF_NEVER;
+
+      action_enabler_list_iterate(action_enablers_for_action(act),
+                                  enabler) {
+        if (BV_ISSET(enabler->actor_utypes_always, uidx)) {
+          feasibility = AUF_IF_TARGET_OK;
+          break;
+        } else if (BV_ISSET(enabler->actor_utypes, uidx)) {
+          feasibility = AUF_FULL_EVAL;
+        }
+      } action_enabler_list_iterate_end;
+
+      utype_feasibility[act].utypes[uidx] = feasibility;
+    } unit_type_iterate_end;
+  } action_iterate_end;
+}
+
+/**********************************************************************//**
+  Returns what the unit type of the actor alone tells about the action
+  enablers of the action. AUF_IF_TARGET_OK means that an enabler only has
+  actor requirements the unit type fulfills; its target requirements, and
+  the hard requirements of the action, still count.
+**************************************************************************/
+enum action_utype_feasibility
+action_utype_feasibility(action_id act_id, const struct unit_type *putype)
+{
+  fc_assert_ret_val(action_id_exists(act_id), AUF_NEVER);
+
+  if (!utype_feasibility[act_id].compiled) {
+    return AUF_FULL_EVAL;
+  }
+
+  return utype_feasibility[act_id].utypes[utype_index(putype)];
+}
+
 /**********************************************************************//**
   Free the actions and the action enablers.
 **************************************************************************/
@@ -1433,6 +1557,10 @@ struct action_enabler *action_enabler_new(void)
   enabler->ruledit_disabled = FALSE;
   requirement_vector_init(&enabler->actor_reqs);
   requirement_vector_init(&enabler->target_reqs);
+  enabler->actor_reqs_program = NULL;
+  enabler->target_reqs_program = NULL;
+  BV_SET_ALL(enabler->actor_utypes);
+  BV_CLR_ALL(enabler->actor_utypes_always);
 
   /* Make sure that action doesn't end up as a random value that happens to
    * be a valid action id. */
@@ -1448,6 +1576,12 @@ void action_enabler_free(struct action_enabler *enabler)
 {
   requirement_vector_free(&enabler->actor_reqs);
   requirement_vector_free(&enabler->target_reqs);
+  if (enabler->actor_reqs_program != NULL) {
+    req_program_destroy(enabler->actor_reqs_program);
+  }
+  if (enabler->target_reqs_program != NULL) {
+    req_program_destroy(enabler->target_reqs_program);
+  }
 
   free(enabler);
 }
@@ -1478,6 +1612,7 @@ void action_enabler_add(struct action_enabler *enabler)
   /* Sanity check: a non existing action doesn't have enablers. */
   fc_assert_ret(action_id_exists(enabler_get_action_id(enabler)));
 
+  utype_feasibility[enabler_get_action_id(enabler)].compiled = FALSE;
   action_enabler_list_append(
         action_enablers_for_action(enabler_get_action_id(enabler)),
         enabler);
@@ -1495,6 +1630,7 @@ bool action_enabler_remove(struct action_enabler *enabler)
   /* Sanity check: a non existing action doesn't have enablers. */
   fc_assert_ret_val(action_id_exists(enabler_get_action_id(enabler)), FALSE);
 
+  utype_feasibility[enabler_get_action_id(enabler)].compiled = FALSE;
   return action_enabler_list_remove(
         action_enablers_for_action(enabler_get_action_id(enabler)),
         enabler);
@@ -2900,15 +3036,51 @@ is_action_possible(const action_id wanted_action,
 
   actor may be NULL. This is equivalent to passing an empty context.
   target may be NULL. This is equivalent to passing an empty context.
+  actor_utype is the unit type of the actor unit, or NULL to evaluate
+  all the actor requirements.
 **************************************************************************/
 static bool is_enabler_active(const struct action_enabler *enabler,
+                              const struct unit_type *actor_utype,
                               const struct req_context *actor,
                               const struct req_context *target)
 {
-  return are_reqs_active(actor, target != NULL ? target->player : NULL,
-                         &enabler->actor_reqs, RPT_CERTAIN)
-      && are_reqs_active(target, actor != NULL ? actor->player : NULL,
-                         &enabler->target_reqs, RPT_CERTAIN);
+  if (actor_utype != NULL) {
+    if (!BV_ISSET(enabler->actor_utypes, utype_index(actor_utype))) {
+      return FALSE;
+    }
+    if (BV_ISSET(enabler->actor_utypes_always, utype_index(actor_utype))) {
+      return are_reqs_active_program(target,
+                                     actor != NULL ? actor->player : NULL,
+                                     &enabler->target_reqs,
+                                     enabler->target_reqs_program,
+                                     RPT_CERTAIN);
+    }
+  }
+
+  return are_reqs_active_program(actor,
+                                 target != NULL ? target->player : NULL,
+                                 &enabler->actor_reqs,
+                                 enabler->actor_reqs_program, RPT_CERTAIN)
+      && are_reqs_active_program(target,
+                                 actor != NULL ? actor->player : NULL,
+                                 &enabler->target_reqs,
+                                 enabler->target_reqs_program, RPT_CERTAIN);
+}
+
+/**********************************************************************//**
+  Returns the unit type of the actor if the action is performed by units
+  and its enablers can be filtered by it, else NULL.
+**************************************************************************/
+static inline const struct unit_type *
+action_actor_utype(const action_id wanted_action,
+                   const struct req_context *actor)
+{
+  if (actor == NULL || actor->unittype == NULL
+      || AAK_UNIT != action_id_get_actor_kind(wanted_action)) {
+    return NULL;
+  }
+
+  return actor->unittype;
 }
 
 /**********************************************************************//**
@@ -2926,7 +3098,18 @@ static bool is_action_enabled(const action_id wanted_action,
                               const struct extra_type *target_extra,
                               const struct city *actor_home)
 {
+  const struct unit_type *actor_utype = action_actor_utype(wanted_action,
+                                                           actor);
   enum fc_tristate possible;
+  enum req_profile_caller caller;
+  bool enabled = FALSE;
+
+  if (actor_utype != NULL
+      && AUF_NEVER == action_utype_feasibility(wanted_action,
+                                               actor_utype)) {
+    /* No action enabler accepts the unit type. */
+    return FALSE;
+  }
 
   possible = is_action_possible(wanted_action, actor, target, target_extra,
                                 TRUE, actor_home);
@@ -2941,14 +3124,17 @@ static bool is_action_enabled(const action_id wanted_action,
     return FALSE;
   }
 
+  caller = req_profile_set_caller(RPC_ACTIONS);
   action_enabler_list_iterate(action_enablers_for_action(wanted_action),
                               enabler) {
-    if (is_enabler_active(enabler, actor, target)) {
-      return TRUE;
+    if (is_enabler_active(enabler, actor_utype, actor, target)) {
+      enabled = TRUE;
+      break;
     }
   } action_enabler_list_iterate_end;
+  req_profile_set_caller(caller);
 
-  return FALSE;
+  return enabled;
 }
 
 /**********************************************************************//**
@@ -3433,8 +3619,10 @@ action_enabled_local(const action_id wanted_action,
                      const struct req_context *actor,
                      const struct req_context *target)
 {
+  const struct unit_type *actor_utype;
   enum fc_tristate current;
   enum fc_tristate result;
+  enum req_profile_caller caller;
 
   if (actor == NULL || actor->player == NULL) {
     /* Need actor->player for point of view */
@@ -3445,23 +3633,37 @@ action_enabled_local(const action_id wanted_action,
     target = req_context_empty();
   }
 
+  actor_utype = action_actor_utype(wanted_action, actor);
+
+  caller = req_profile_set_caller(RPC_ACTIONS);
   result = TRI_NO;
   action_enabler_list_iterate(action_enablers_for_action(wanted_action),
                               enabler) {
-    current = fc_tristate_and(mke_eval_reqs(actor->player, actor,
-                                            target->player,
-                                            &enabler->actor_reqs,
-                                            RPT_CERTAIN),
+    if (actor_utype == NULL) {
+      current = mke_eval_reqs(actor->player, actor, target->player,
+                              &enabler->actor_reqs, RPT_CERTAIN);
+    } else if (!BV_ISSET(enabler->actor_utypes, utype_index(actor_utype))) {
+      continue;
+    } else if (BV_ISSET(enabler->actor_utypes_always,
+                        utype_index(actor_utype))) {
+      current = TRI_YES;
+    } else {
+      current = mke_eval_reqs(actor->player, actor, target->player,
+                              &enabler->actor_reqs, RPT_CERTAIN);
+    }
+    current = fc_tristate_and(current,
                               mke_eval_reqs(actor->player, target,
                                             actor->player,
                                             &enabler->target_reqs,
                                             RPT_CERTAIN));
     if (current == TRI_YES) {
-      return TRI_YES;
+      result = TRI_YES;
+      break;
     } else if (current == TRI_MAYBE) {
       result = TRI_MAYBE;
     }
   } action_enabler_list_iterate_end;
+  req_profile_set_caller(caller);
 
   return result;
 }
@@ -5359,8 +5561,9 @@ static bool is_target_possible(const action_id wanted_action,
 {
   action_enabler_list_iterate(action_enablers_for_action(wanted_action),
                               enabler) {
-    if (are_reqs_active(target, actor_player,
-                        &enabler->target_reqs, RPT_POSSIBLE)) {
+    if (are_reqs_active_program(target, actor_player, &enabler->target_reqs,
+                                enabler->target_reqs_program,
+                                RPT_POSSIBLE)) {
       return TRUE;
     }
   } action_enabler_list_iterate_end;
@@ -5427,7 +5630,19 @@ bool action_maybe_possible_actor_unit(const struct civ_map *nmap,
 
   action_enabler_list_iterate(action_enablers_for_action(act_id),
                               enabler) {
-    const enum fc_tristate current
+    enum fc_tristate current;
+
+    if (!BV_ISSET(enabler->actor_utypes, utype_index(actor_unit->utype))) {
+      /* Not for this unit type. */
+      continue;
+    }
+    if (BV_ISSET(enabler->actor_utypes_always,
+                 utype_index(actor_unit->utype))) {
+      /* The unit type is all that is required of the actor. */
+      return TRUE;
+    }
+
+    current
         = mke_eval_reqs(actor_player, &actor_ctxt, NULL,
                         &enabler->actor_reqs,
                         /* Needed since no player to evaluate DiplRel
@@ -19,6 +19,7 @@
 #include "fc_types.h"
 #include "map_types.h"
 #include "requirements.h"
+#include "unittype.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -167,11 +168,28 @@ struct action_enabler
   struct requirement_vector actor_reqs;
   struct requirement_vector target_reqs;
 
+  /* The requirements compiled by action_enablers_compile(), or NULL. */
+  struct req_program *actor_reqs_program;
+  struct req_program *target_reqs_program;
+
+  /* The unit types of the actors that may fulfill the actor requirements,
+   * and of those that always do, by action_enablers_compile(). */
+  bv_unit_types actor_utypes;
+  bv_unit_types actor_utypes_always;
+
   /* Only relevant for ruledit and other rulesave users. Indicates that
    * this action enabler is deleted and shouldn't be saved. */
   bool ruledit_disabled;
 };
 
+/* What the unit type of the actor alone tells about the action enablers
+ * of an action. */
+enum action_utype_feasibility {
+  AUF_NEVER,            /* No enabler accepts the unit type. */
+  AUF_IF_TARGET_OK,     /* An enabler accepts every actor of the type. */
+  AUF_FULL_EVAL         /* The actor requirements must be evaluated. */
+};
+
 #define action_has_result(_act_, _res_) ((_act_)->result == (_res_))
 
 #define enabler_get_action(_enabler_) action_by_number(_enabler_->action)
@@ -375,6 +393,9 @@ action_auto_perf_iterate(_act_perf_) {                                    \
 /* Initialization */
 void actions_init(void);
 void actions_rs_pre_san_gen(void);
+void action_enablers_compile(void);
+enum action_utype_feasibility
+action_utype_feasibility(action_id act_id, const struct unit_type *putype);
 void actions_free(void);
 
 bool actions_are_ready(void);
@@ -20,6 +20,7 @@
 
 /* utility */
 #include "fcintl.h"
+#include "fcthreadpool.h"
 #include "log.h"
 #include "mem.h"
 #include "shared.h"
@@ -28,6 +29,7 @@
 
 /* common */
 #include "city.h"
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "map.h"
@@ -81,17 +83,10 @@
 
 #define CPUHOG_CM_MAX_LOOP (CM_MAX_LOOP * 4)
 
-#ifdef DEBUG_TIMERS
-#define GATHER_TIME_STATS
-#endif
 #ifdef FREECIV_DEBUG
 #define CM_DEBUG
 #endif
 
-/* Whether to print every query, or just at cm_free ; matters only
-   if GATHER_TIME_STATS is on */
-#define PRINT_TIME_STATS_EVERY_QUERY
-
 #define LOG_TIME_STATS                                  LOG_DEBUG
 #define LOG_CM_STATE                                    LOG_DEBUG
 #define LOG_LATTICE                                     LOG_DEBUG
@@ -99,20 +94,94 @@
 #define LOG_BETTER_LEAF                                 LOG_DEBUG
 #define LOG_PRUNE_BRANCH                                LOG_DEBUG
 
-#ifdef GATHER_TIME_STATS
+/* The production, surplus and weights handled by the search are packed
+ * in vectors of CM_OUTPUT_VEC ints, the outputs followed by zeroes. The
+ * loops over them have a fixed width, so the compiler turns them into a
+ * few vector instructions. */
+#define CM_OUTPUT_VEC 8
+FC_STATIC_ASSERT(O_LAST <= CM_OUTPUT_VEC, cm_output_vec_too_small);
+
+/* The statistics of the queries, by caller. A search counts in its state,
+ * from whatever thread runs it, and the calling thread adds it to the
+ * statistics once it is over. */
 static struct {
-  struct one_perf {
-    struct timer *wall_timer;
-    int query_count;
-    int apply_count;
-    const char *name;
-  } greedy, opt;
+  enum cm_caller caller;
+  struct cm_stats turn[CM_CALLER_COUNT];
+  struct cm_stats game[CM_CALLER_COUNT];
+} stats;
+
+struct cm_search_stats {
+  unsigned long nodes;
+  unsigned long applies;
+  int lattice;
+  bool aborted;
+  double seconds;
+};
 
-  struct one_perf *current;
-} performance;
+/* The results of the queries are kept from turn to turn, together with a
+ * fingerprint of what the search depends on: the parameter, the tax rates,
+ * the size, usage, bonuses, waste and happiness effects of the city, and
+ * the outputs of the tiles and specialists available to it. A query with
+ * the fingerprint of a kept result only checks that the kept arrangement
+ * still gives the kept surplus and mood, which catches the other changes
+ * of the effects, and doesn't search again. Up to CM_CACHE_CITY_ENTRIES
+ * results are kept per city, as the callers try several parameters, tax
+ * rates or governments in a row. */
+#define CM_CACHE_CITY_ENTRIES 16
+
+struct cm_fingerprint {
+  int *data;
+  int len;
+  int size;
+};
 
-static void print_performance(struct one_perf *counts);
-#endif /* GATHER_TIME_STATS */
+struct cm_cache_entry {
+  struct cm_fingerprint key;    /* 'key.data' is NULL if unused. */
+  unsigned int last_use;
+  bool complete;                /* Else only 'aborted' and 'found_a_valid'
+                                 * of 'result' were set by the search. */
+  struct cm_result result;
+};
+
+struct cm_city_cache {
+  struct cm_cache_entry entries[CM_CACHE_CITY_ENTRIES];
+};
+
+static void cm_city_cache_destroy(struct cm_city_cache *pcache);
+
+#define SPECHASH_TAG cm_city_cache
+#define SPECHASH_INT_KEY_TYPE
+#define SPECHASH_IDATA_TYPE struct cm_city_cache *
+#define SPECHASH_IDATA_FREE cm_city_cache_destroy
+#include "spechash.h"
+
+static struct {
+  struct cm_city_cache_hash *cities;    /* Indexed by city id. */
+  unsigned int clock;                   /* For replacement. */
+  int enabled;                          /* -1 until initialized. */
+} cache = { NULL, 0, -1 };
+
+/* A search of cm_query_result_batch(). */
+struct cm_batch_query {
+  struct city *pcity;
+  const struct cm_parameter *param;
+  struct cm_fingerprint key;
+  struct cm_result *result;
+  bool complete;
+  struct cm_search_stats stats;
+};
+
+/* The searches of cm_query_result_batch() run in any thread of the pool.
+ * The result cache is only accessed before and after them, from the
+ * calling thread. Magic -1 for the number of threads means not
+ * initialized, see cm_get_batch_threads(). */
+struct cm_batch {
+  struct cm_batch_query *queries;
+  bool negative_ok;
+};
+
+static struct fc_threadpool *batch_pool = NULL;
+static int batch_threads = -1;
 
 /* Fitness of a solution.  */
 struct cm_fitness {
@@ -166,8 +235,9 @@ struct cm_tile {
  * vector is empty.  We can never run out of specialists.
  */
 struct cm_tile_type {
-  int production[O_LAST];
+  int production[CM_OUTPUT_VEC];
   double estimated_fitness; /* weighted sum of production */
+  double stat_value; /* key of compare_tile_type_by_stat() */
   bool is_specialist;
   Specialist_type_id spec; /* valid only if is_specialist */
   struct tile_vector tiles;  /* valid only if !is_specialist */
@@ -188,7 +258,8 @@ struct partial_solution {
   int *worker_counts;   /* number of workers on each type */
   int *prereqs_filled;  /* number of better types filled up */
 
-  int production[O_LAST]; /* raw production, cached for the heuristic */
+  int production[CM_OUTPUT_VEC]; /* raw production, cached for the
+                                  * heuristic */
   int idle;             /* number of idle workers */
 };
 
@@ -214,7 +285,17 @@ struct cm_state {
    * this fails to satisfy the constraints, so we can stop investigating
    * this branch.  A solution with more production than this may still
    * fail (for being unhappy, for instance). */
-  int min_production[O_LAST];
+  int min_production[CM_OUTPUT_VEC];
+
+  /* The parameter weights and minimal surplus as vectors. */
+  int factor[CM_OUTPUT_VEC];
+  int minimal_surplus[CM_OUTPUT_VEC];
+
+  /* Whether choice_is_promising() can bound the fitness of a branch, and
+   * what to subtract from the weighted production to get that bound: the
+   * weighted usage, minus the best happy bonus. */
+  bool fitness_bound;
+  int fitness_bound_offset;
 
   /* needed luxury to be content, this includes effects by specialists */
   int min_luxury;
@@ -232,6 +313,10 @@ struct cm_state {
   } choice;
 
   bool *workers_map; /* placement of the workers within the city map */
+
+  /* What the search did, see cm_stats_add_search(). */
+  struct cm_search_stats stats;
+  struct timer *timer;
 };
 
 
@@ -284,6 +369,11 @@ static double estimate_fitness(const struct cm_state *state,
 			       const int production[]);
 static bool choice_is_promising(struct cm_state *state, int newchoice,
                                 bool negative_ok);
+static void cm_stats_add_query(enum cm_caller caller, bool hit);
+static void cm_stats_add_search(enum cm_caller caller,
+                                const struct city *pcity,
+                                const struct cm_search_stats *psearch);
+static void print_performance(void);
 
 /************************************************************************//**
   Initialize the CM data at the start of each game.  Note the citymap
@@ -293,17 +383,7 @@ static bool choice_is_promising(struct cm_state *state, int newchoice,
 void cm_init(void)
 {
   /* In the B&B algorithm there's not really anything to initialize. */
-#ifdef GATHER_TIME_STATS
-  memset(&performance, 0, sizeof(performance));
-
-  performance.greedy.wall_timer = timer_new(TIMER_USER, TIMER_ACTIVE,
-                                            "cm.greedy");
-  performance.greedy.name = "greedy";
-
-  performance.opt.wall_timer = timer_new(TIMER_USER, TIMER_ACTIVE,
-                                         "cm.opt");
-  performance.opt.name = "opt";
-#endif /* GATHER_TIME_STATS */
+  cm_stats_reset();
 }
 
 /************************************************************************//**
@@ -321,7 +401,9 @@ void cm_init_citymap(void)
 ****************************************************************************/
 void cm_clear_cache(struct city *pcity)
 {
-  /* The B&B algorithm doesn't have city caches so there's nothing to do. */
+  if (NULL != cache.cities) {
+    cm_city_cache_hash_remove(cache.cities, pcity->id);
+  }
 }
 
 /************************************************************************//**
@@ -329,14 +411,16 @@ void cm_clear_cache(struct city *pcity)
 ****************************************************************************/
 void cm_free(void)
 {
-#ifdef GATHER_TIME_STATS
-  print_performance(&performance.greedy);
-  print_performance(&performance.opt);
+  if (NULL != cache.cities) {
+    cm_city_cache_hash_destroy(cache.cities);
+    cache.cities = NULL;
+  }
+  if (NULL != batch_pool) {
+    fc_threadpool_destroy(batch_pool);
+    batch_pool = NULL;
+  }
 
-  timer_destroy(performance.greedy.wall_timer);
-  timer_destroy(performance.opt.wall_timer);
-  memset(&performance, 0, sizeof(performance));
-#endif /* GATHER_TIME_STATS */
+  print_performance();
 }
 
 /************************************************************************//**
@@ -606,24 +690,58 @@ static struct cm_fitness worst_fitness(void)
 }
 
 /************************************************************************//**
-  Compute the fitness of the given surplus (and disorder/happy status)
-  according to the weights and minimums given in the parameter.
+  Add 'times' times the output vector 'src' to 'dst'.
 ****************************************************************************/
-static struct cm_fitness compute_fitness(const int surplus[],
-                                         bool disorder, bool happy,
-                                         const struct cm_parameter *parameter)
+static inline void outputs_add(int *dst, const int *src, int times)
 {
-  struct cm_fitness fitness;
+  int i;
 
-  fitness.sufficient = TRUE;
-  fitness.weighted = 0;
+  for (i = 0; i < CM_OUTPUT_VEC; i++) {
+    dst[i] += times * src[i];
+  }
+}
 
-  output_type_iterate(stat_index) {
-    fitness.weighted += surplus[stat_index] * parameter->factor[stat_index];
-    if (surplus[stat_index] < parameter->minimal_surplus[stat_index]) {
-      fitness.sufficient = FALSE;
-    }
-  } output_type_iterate_end;
+/************************************************************************//**
+  Return the dot product of two output vectors.
+****************************************************************************/
+static inline int outputs_dot(const int *a, const int *b)
+{
+  int i, sum = 0;
+
+  for (i = 0; i < CM_OUTPUT_VEC; i++) {
+    sum += a[i] * b[i];
+  }
+
+  return sum;
+}
+
+/************************************************************************//**
+  Return whether any output of 'a' is less than the one of 'b'.
+****************************************************************************/
+static inline bool outputs_any_less(const int *a, const int *b)
+{
+  int i, less = 0;
+
+  for (i = 0; i < CM_OUTPUT_VEC; i++) {
+    less |= (a[i] < b[i]);
+  }
+
+  return 0 != less;
+}
+
+/************************************************************************//**
+  Compute the fitness of the given surplus vector (and disorder/happy
+  status) according to the weights and minimums of the search.
+****************************************************************************/
+static struct cm_fitness compute_fitness(const struct cm_state *state,
+                                         const int surplus[],
+                                         bool disorder, bool happy)
+{
+  const struct cm_parameter *parameter = &state->parameter;
+  struct cm_fitness fitness;
+
+  fitness.weighted = outputs_dot(surplus, state->factor);
+  fitness.sufficient = !outputs_any_less(surplus, state->minimal_surplus);
 
   if (happy) {
     fitness.weighted += parameter->happy_factor;
@@ -653,12 +771,11 @@ static void init_partial_solution(struct partial_solution *into,
 {
   into->worker_counts = fc_calloc(ntypes, sizeof(*into->worker_counts));
   into->prereqs_filled = fc_calloc(ntypes, sizeof(*into->prereqs_filled));
+  memset(into->production, 0, sizeof(into->production));
   if (negative_ok) {
     output_type_iterate(otype) {
       into->production[otype] = -FC_INFINITY;
     } output_type_iterate_end;
-  } else {
-    memset(into->production, 0, sizeof(into->production));
   }
   into->idle = idle;
 }
@@ -706,9 +823,7 @@ static void apply_solution(struct cm_state *state,
   int citizen_count = 0;
 #endif
 
-#ifdef GATHER_TIME_STATS
-  performance.current->apply_count++;
-#endif
+  state->stats.applies++;
 
   fc_assert_ret(0 == soln->idle);
 
@@ -785,7 +900,7 @@ static struct cm_fitness evaluate_solution(struct cm_state *state,
     const struct partial_solution *soln)
 {
   struct city *pcity = state->pcity;
-  int surplus[O_LAST];
+  int surplus[CM_OUTPUT_VEC] = { 0 };
   bool disorder, happy;
 
   /* apply and evaluate the solution, backup is done in find_best_solution */
@@ -813,7 +928,7 @@ static struct cm_fitness evaluate_solution(struct cm_state *state,
       + 1;
   }
 
-  return compute_fitness(surplus, disorder, happy, &state->parameter);
+  return compute_fitness(state, surplus, disorder, happy);
 }
 
 /************************************************************************//**
@@ -825,6 +940,7 @@ static void convert_solution_to_result(struct cm_state *state,
                                        struct cm_result *result)
 {
   struct cm_fitness fitness;
+  int surplus[CM_OUTPUT_VEC] = { 0 };
 
   if (soln->idle != 0) {
     /* If there are unplaced citizens it's not a real solution, so the
@@ -839,8 +955,9 @@ static void convert_solution_to_result(struct cm_state *state,
 
   /* result->found_a_valid should be only true if it matches the
    *  parameter; figure out if it does */
-  fitness = compute_fitness(result->surplus, result->disorder,
-                            result->happy, &state->parameter);
+  memcpy(surplus, result->surplus, sizeof(result->surplus));
+  fitness = compute_fitness(state, surplus, result->disorder,
+                            result->happy);
   result->found_a_valid = fitness.sufficient;
 }
 
@@ -908,11 +1025,9 @@ static int compare_tile_type_by_fitness(const void *va, const void *vb)
   return compare_tile_type_by_lattice_order(*a, *b);
 }
 
-static Output_type_id compare_key;
-static double compare_key_trade_bonus;
-
 /************************************************************************//**
-  Compare by the production of type compare_key.
+  Compare by the 'stat_value' set by cm_state_init(), the production of
+  one output type, including what the trade gives of it.
   If a produces more food than b, then a cannot be a child of b, so
   this respects the partial order -- unless a and b produce equal food.
   In that case, use compare_tile_type_by_lattice_order.
@@ -930,14 +1045,12 @@ static int compare_tile_type_by_stat(const void *va, const void *vb)
      for compute_max_stats_heuristics, which uses these sorted arrays,
      it is essential, that the sorting is correct, else promising
      branches get pruned */
-  double valuea = (*a)->production[compare_key] +
-                    compare_key_trade_bonus * (*a)->production[O_TRADE];
-  double valueb = (*b)->production[compare_key] +
-                    compare_key_trade_bonus * (*b)->production[O_TRADE];
+  double valuea = (*a)->stat_value;
+  double valueb = (*b)->stat_value;
 
   /* Most production of what we care about goes first */
   /* Double compare is ok, both values are calculated in the same way
-     and should only be considered equal, if equal in compare_key
+     and should only be considered equal, if equal in the sorted output
      and O_TRADE */
   if (valuea != valueb) {
     /* b-a so we sort big numbers first */
@@ -952,17 +1065,14 @@ static int compare_tile_type_by_stat(const void *va, const void *vb)
 ****************************************************************************/
 
 /************************************************************************//**
-  Compute the production of tile [x,y] and stuff it into the tile type.
-  Doesn't touch the other fields.
+  Compute the production of the city tile 'ctindex' and stuff it into the
+  tile type. Doesn't touch the other fields. The city must be refreshed.
 ****************************************************************************/
-static void compute_tile_production(const struct city *pcity,
-                                    const struct tile *ptile,
+static void compute_tile_production(const struct city *pcity, int ctindex,
                                     struct cm_tile_type *out)
 {
-  bool is_celebrating = base_city_celebrating(pcity);
-
   output_type_iterate(o) {
-    out->production[o] = city_tile_output(pcity, ptile, is_celebrating, o);
+    out->production[o] = city_tile_output_cached(pcity, ctindex, o);
   } output_type_iterate_end;
 }
 
@@ -1248,7 +1358,7 @@ static void init_tile_lattice(struct city *pcity,
     if (is_free_worked(pcity, ptile)) {
       continue;
     } else if (city_can_work_tile(pcity, ptile)) {
-      compute_tile_production(pcity, ptile, &type); /* clobbers type */
+      compute_tile_production(pcity, ctindex, &type); /* clobbers type */
       tile_type_lattice_add(lattice, &type, ctindex); /* copy type if needed */
     }
   } city_tile_iterate_index_end;
@@ -1348,10 +1458,7 @@ static void add_workers(struct partial_solution *soln,
   }
 
   /* update production */
-  output_type_iterate(stat_index) {
-    newcount = soln->production[stat_index] + number * ptype->production[stat_index];
-    soln->production[stat_index] = newcount;
-  } output_type_iterate_end;
+  outputs_add(soln->production, ptype->production, number);
 }
 
 /************************************************************************//**
@@ -1579,7 +1686,8 @@ static int specialists_in_solution(const struct cm_state *state,
   If we take the max along each production, and it's not better than the
   best in at least one stat, the partial solution isn't worth anything.
 
-  This function computes the max-stats produced by a partial solution.
+  This function computes the max-stats produced by a partial solution, as
+  an output vector.
 ****************************************************************************/
 static void compute_max_stats_heuristic(const struct cm_state *state,
                                         const struct partial_solution *soln,
@@ -1598,9 +1706,7 @@ static void compute_max_stats_heuristic(const struct cm_state *state,
     const struct cm_tile_type *ptype = tile_type_get(state, check_choice);
 
     memcpy(production, soln->production, sizeof(soln->production));
-    output_type_iterate(stat_index) {
-      production[stat_index] += ptype->production[stat_index];
-    } output_type_iterate_end;
+    outputs_add(production, ptype->production, 1);
 
   } else {
 
@@ -1629,16 +1735,16 @@ static void compute_max_stats_heuristic(const struct cm_state *state,
 
   struct city *pcity = state->pcity;
   struct tile *pcenter = city_tile(pcity);
-  bool is_celebrating = base_city_celebrating(pcity);
 
   output_type_iterate(stat_index) {
     int base = production[stat_index];
 
-    city_tile_iterate(city_map_radius_sq_get(pcity), pcenter, ptile) {
+    city_tile_iterate_index(city_map_radius_sq_get(pcity), pcenter, ptile,
+                            ctindex) {
       if (is_free_worked(pcity, ptile)) {
-        base += city_tile_output(pcity, ptile, is_celebrating, stat_index);
+        base += city_tile_output_cached(pcity, ctindex, stat_index);
       }
-    } city_tile_iterate_end;
+    } city_tile_iterate_index_end;
     pcity->citizen_base[stat_index] = base;
   } output_type_iterate_end;
 
@@ -1655,8 +1761,9 @@ static void compute_max_stats_heuristic(const struct cm_state *state,
 static bool choice_is_promising(struct cm_state *state, int newchoice,
                                 bool negative_ok)
 {
-  int production[O_LAST];
+  int production[CM_OUTPUT_VEC] = { 0 };
   bool beats_best = FALSE;
+  int i;
 
   /* this computes an upper bound (componentwise) for the current branch,
      if it is worse in every component than the best, or still unsufficient,
@@ -1664,20 +1771,38 @@ static bool choice_is_promising(struct cm_state *state, int newchoice,
   compute_max_stats_heuristic(state, &state->current, production, newchoice,
                               negative_ok);
 
-  output_type_iterate(stat_index) {
-    if (production[stat_index] < state->min_production[stat_index]) {
-      log_base(LOG_PRUNE_BRANCH, "--- pruning: insufficient %s (%d < %d)",
-               get_output_name(stat_index), production[stat_index],
-               state->min_production[stat_index]);
-      return FALSE;
-    }
-    if (production[stat_index] > state->best.production[stat_index]
-        && state->parameter.factor[stat_index] > 0 ) {
-      beats_best = TRUE;
-      /* may still fail to meet min at another production type, so
-       * don't short-circuit */
-    }
-  } output_type_iterate_end;
+  if (outputs_any_less(production, state->min_production)) {
+    output_type_iterate(stat_index) {
+      if (production[stat_index] < state->min_production[stat_index]) {
+        log_base(LOG_PRUNE_BRANCH, "--- pruning: insufficient %s (%d < %d)",
+                 get_output_name(stat_index), production[stat_index],
+                 state->min_production[stat_index]);
+        break;
+      }
+    } output_type_iterate_end;
+    return FALSE;
+  }
+
+  for (i = 0; i < CM_OUTPUT_VEC; i++) {
+    /* may still fail to meet min at another production type, so
+     * don't short-circuit */
+    beats_best |= (production[i] > state->best.production[i]
+                   && state->factor[i] > 0);
+  }
+
+  /* The relaxation of the search where each output is maximized on its
+   * own also bounds the weighted sum of the outputs. Since the surplus
+   * is the production minus the usage, no solution of the branch has a
+   * better fitness than this bound. Once a sufficient solution is known,
+   * the branches not able to strictly beat it can't change the result. */
+  if (state->fitness_bound && state->best_value.sufficient
+      && (outputs_dot(production, state->factor)
+          - state->fitness_bound_offset) <= state->best_value.weighted) {
+    log_base(LOG_PRUNE_BRANCH, "--- pruning: fitness bound (%d <= %d)",
+             outputs_dot(production, state->factor)
+             - state->fitness_bound_offset, state->best_value.weighted);
+    return FALSE;
+  }
 
   /* If we don't get the city content, we assume using every idle worker
      as specialist and the maximum producible luxury already computed.
@@ -1719,11 +1844,28 @@ static bool choice_is_promising(struct cm_state *state, int newchoice,
 static void init_min_production(struct cm_state *state)
 {
   struct city *pcity = state->pcity;
+  int usage[CM_OUTPUT_VEC] = { 0 };
+
+  memset(state->min_production, 0, sizeof(state->min_production));
+  memset(state->factor, 0, sizeof(state->factor));
+  memset(state->minimal_surplus, 0, sizeof(state->minimal_surplus));
+  state->fitness_bound = TRUE;
 
   output_type_iterate(o) {
     state->min_production[o] = pcity->usage[o] + state->parameter.minimal_surplus[o];
+    state->factor[o] = state->parameter.factor[o];
+    state->minimal_surplus[o] = state->parameter.minimal_surplus[o];
+    usage[o] = pcity->usage[o];
+    if (0 > state->factor[o]) {
+      /* Would need a lower bound of this output. */
+      state->fitness_bound = FALSE;
+    }
   } output_type_iterate_end;
 
+  /* The usage only grows while the solutions are applied. */
+  state->fitness_bound_offset = outputs_dot(usage, state->factor)
+                                - MAX(state->parameter.happy_factor, 0);
+
   /* We could get a minimum on luxury if we knew how many luxuries were
    * needed to make us content. */
 }
@@ -1818,6 +1960,8 @@ static double estimate_fitness(const struct cm_state *state,
 ****************************************************************************/
 static bool bb_next(struct cm_state *state, bool negative_ok)
 {
+  state->stats.nodes++;
+
   /* if no idle workers, then look at our solution. */
   if (state->current.idle == 0) {
     struct cm_fitness value = evaluate_solution(state, &state->current);
@@ -1868,10 +2012,16 @@ static struct cm_state *cm_state_init(struct city *pcity, bool negative_ok)
   /* copy the arguments */
   state->pcity = pcity;
 
+  /* The time of the search includes building the lattice. */
+  memset(&state->stats, 0, sizeof(state->stats));
+  state->timer = timer_new(TIMER_USER, TIMER_ACTIVE, "cm.search");
+  timer_start(state->timer);
+
   /* create the lattice */
   tile_type_vector_init(&state->lattice);
   init_tile_lattice(pcity, &state->lattice);
   numtypes = tile_type_vector_size(&state->lattice);
+  state->stats.lattice = numtypes;
 
   get_tax_rates(pplayer, rates);
 
@@ -1880,24 +2030,32 @@ static struct cm_state *cm_state_init(struct city *pcity, bool negative_ok)
     int lsize = tile_type_vector_size(&state->lattice);
 
     if (lsize > 0) {
+      double trade_bonus;
+
       tile_type_vector_init(&state->lattice_by_prod[stat_index]);
       tile_type_vector_copy(&state->lattice_by_prod[stat_index], &state->lattice);
-      compare_key = stat_index;
       /* Calculate effect of 1 trade production on interesting production */
       switch (stat_index) {
       case O_SCIENCE:
-        compare_key_trade_bonus = rates[SCIENCE] * pcity->bonus[O_TRADE] / 100.0;
+        trade_bonus = rates[SCIENCE] * pcity->bonus[O_TRADE] / 100.0;
         break;
       case O_LUXURY:
-        compare_key_trade_bonus = rates[LUXURY] * pcity->bonus[O_TRADE] / 100.0;
+        trade_bonus = rates[LUXURY] * pcity->bonus[O_TRADE] / 100.0;
         break;
       case O_GOLD:
-        compare_key_trade_bonus = rates[TAX] * pcity->bonus[O_TRADE] / 100.0;
+        trade_bonus = rates[TAX] * pcity->bonus[O_TRADE] / 100.0;
         break;
       default:
-        compare_key_trade_bonus = 0.0;
+        trade_bonus = 0.0;
         break;
       }
+      /* The sort key is kept in the types, not in a static, so that
+       * several cities can be searched at once, see
+       * cm_query_result_batch(). */
+      tile_type_vector_iterate(&state->lattice, ptype) {
+        ptype->stat_value = ptype->production[stat_index]
+                            + trade_bonus * ptype->production[O_TRADE];
+      } tile_type_vector_iterate_end;
       qsort(state->lattice_by_prod[stat_index].p, lsize,
             sizeof(*state->lattice_by_prod[stat_index].p),
             compare_tile_type_by_stat);
@@ -1931,7 +2089,6 @@ static int min_food_surplus_for_fastest_growth(struct cm_state *state)
   int city_radius_sq = city_map_radius_sq_get(pcity);
   citizens city_size = city_size_get(pcity);
   int max_surplus = -game.info.food_cost * city_size;
-  bool is_celebrating = base_city_celebrating(pcity);
   citizens workers = city_size;
   int food_needed = city_granary_size(city_size) - pcity->food_stock;
   int min_turns;
@@ -1942,7 +2099,7 @@ static int min_food_surplus_for_fastest_growth(struct cm_state *state)
       continue;
     }
     if (is_free_worked_index(cindex)) {
-      max_surplus += city_tile_output(pcity, ptile, is_celebrating, O_FOOD);
+      max_surplus += city_tile_output_cached(pcity, cindex, O_FOOD);
     }
   } city_map_iterate_end;
 
@@ -1980,11 +2137,6 @@ static void begin_search(struct cm_state *state,
                          const struct cm_parameter *parameter,
                          bool negative_ok)
 {
-#ifdef GATHER_TIME_STATS
-  timer_start(performance.current->wall_timer);
-  performance.current->query_count++;
-#endif /* GATHER_TIME_STATS */
-
   /* copy the parameter and sort the main lattice by it */
   cm_copy_parameter(&state->parameter, parameter);
   sort_lattice_by_fitness(state, &state->lattice);
@@ -1995,6 +2147,9 @@ static void begin_search(struct cm_state *state,
   }
 
   init_min_production(state);
+  /* With negative_ok, the production starts at -FC_INFINITY and the
+   * weighted bound would overflow. */
+  state->fitness_bound = state->fitness_bound && !negative_ok;
 
   /* Clear out the old solution */
   state->best_value = worst_fitness();
@@ -2007,19 +2162,12 @@ static void begin_search(struct cm_state *state,
 
 /************************************************************************//**
   Clean up after a search.
-  Currently, does nothing except stop the timer and output.
+  Currently, does nothing except stop the timer and record the time.
 ****************************************************************************/
 static void end_search(struct cm_state *state)
 {
-#ifdef GATHER_TIME_STATS
-  timer_stop(performance.current->wall_timer);
-
-#ifdef PRINT_TIME_STATS_EVERY_QUERY
-  print_performance(performance.current);
-#endif /* PRINT_TIME_STATS_EVERY_QUERY */
-
-  performance.current = NULL;
-#endif /* GATHER_TIME_STATS */
+  timer_stop(state->timer);
+  state->stats.seconds = timer_read_seconds(state->timer);
 }
 
 /************************************************************************//**
@@ -2036,6 +2184,7 @@ static void cm_state_free(struct cm_state *state)
 
   FC_FREE(state->choice.stack);
   FC_FREE(state->workers_map);
+  timer_destroy(state->timer);
   FC_FREE(state);
 }
 
@@ -2050,10 +2199,6 @@ static void cm_find_best_solution(struct cm_state *state,
   int max_count;
   struct city backup;
 
-#ifdef GATHER_TIME_STATS
-  performance.current = &performance.opt;
-#endif
-
   begin_search(state, parameter, negative_ok);
 
   /* Make a backup of the city to restore at the very end */
@@ -2104,12 +2249,267 @@ static void cm_find_best_solution(struct cm_state *state,
 
   /* convert to the caller's format */
   convert_solution_to_result(state, &state->best, result);
+  state->stats.aborted = result->aborted;
 
   memcpy(state->pcity, &backup, sizeof(backup));
 
   end_search(state);
 }
 
+/************************************************************************//**
+  Append a value to the fingerprint.
+****************************************************************************/
+static void cm_fingerprint_add(struct cm_fingerprint *fp, int value)
+{
+  if (fp->len == fp->size) {
+    fp->size = MAX(2 * fp->size, 128);
+    fp->data = fc_realloc(fp->data, fp->size * sizeof(*fp->data));
+  }
+  fp->data[fp->len++] = value;
+}
+
+/************************************************************************//**
+  Fill the fingerprint of a query about the refreshed city, see the
+  comment of CM_CACHE_CITY_ENTRIES.
+****************************************************************************/
+static void cm_fingerprint_init(struct cm_fingerprint *fp,
+                                const struct city *pcity,
+                                const struct cm_parameter *param,
+                                const struct cm_result *result,
+                                bool negative_ok)
+{
+  const struct player *pplayer = city_owner(pcity);
+  int city_radius_sq = city_map_radius_sq_get(pcity);
+  bool is_celebrating = base_city_celebrating(pcity);
+  int rates[3];
+
+  memset(fp, 0, sizeof(*fp));
+
+  /* The query. */
+  output_type_iterate(o) {
+    cm_fingerprint_add(fp, param->minimal_surplus[o]);
+    cm_fingerprint_add(fp, param->factor[o]);
+  } output_type_iterate_end;
+  cm_fingerprint_add(fp, param->max_growth);
+  cm_fingerprint_add(fp, param->require_happy);
+  cm_fingerprint_add(fp, param->allow_disorder);
+  cm_fingerprint_add(fp, param->allow_specialists);
+  cm_fingerprint_add(fp, param->happy_factor);
+  cm_fingerprint_add(fp, negative_ok);
+  cm_fingerprint_add(fp, result->city_radius_sq);
+
+  /* The owner. */
+  get_tax_rates(pplayer, rates);
+  cm_fingerprint_add(fp, rates[0]);
+  cm_fingerprint_add(fp, rates[1]);
+  cm_fingerprint_add(fp, rates[2]);
+  cm_fingerprint_add(fp, player_content_citizens(pplayer));
+  cm_fingerprint_add(fp, player_angry_citizens(pplayer));
+  cm_fingerprint_add(fp, player_is_cpuhog(pplayer));
+
+  /* The city. The state of its citizens isn't a part of the fingerprint,
+   * as it depends on their current arrangement. */
+  cm_fingerprint_add(fp, city_radius_sq);
+  cm_fingerprint_add(fp, city_size_get(pcity));
+  cm_fingerprint_add(fp, param->max_growth ? pcity->food_stock : 0);
+  cm_fingerprint_add(fp, is_celebrating);
+  cm_fingerprint_add(fp, pcity->martial_law);
+  cm_fingerprint_add(fp, pcity->unit_happy_upkeep);
+  cm_fingerprint_add(fp, get_city_bonus(pcity, EFT_MAKE_CONTENT));
+  cm_fingerprint_add(fp, get_city_bonus(pcity, EFT_MAKE_HAPPY));
+  cm_fingerprint_add(fp, get_city_bonus(pcity, EFT_FORCE_CONTENT));
+  cm_fingerprint_add(fp, get_city_bonus(pcity, EFT_NO_UNHAPPY));
+  cm_fingerprint_add(fp, get_city_bonus(pcity,
+                                        EFT_ENEMY_CITIZEN_UNHAPPY_PCT));
+  output_type_iterate(o) {
+    cm_fingerprint_add(fp, pcity->usage[o]);
+    cm_fingerprint_add(fp, pcity->bonus[o]);
+    cm_fingerprint_add(fp, pcity->abs_bonus[o]);
+    /* The waste rate, sampled at a large production. */
+    cm_fingerprint_add(fp, city_waste(pcity, o, 10000, NULL));
+  } output_type_iterate_end;
+
+  /* The tiles, as init_tile_lattice() and
+   * min_food_surplus_for_fastest_growth() see them. */
+  city_tile_iterate_index(city_radius_sq, city_tile(pcity), ptile, ctindex) {
+    cm_fingerprint_add(fp, ctindex);
+    if (is_free_worked(pcity, ptile)) {
+      cm_fingerprint_add(fp, -1);
+    } else if (city_can_work_tile(pcity, ptile)) {
+      cm_fingerprint_add(fp, 1);
+    } else {
+      cm_fingerprint_add(fp, 0);
+      continue;
+    }
+    output_type_iterate(o) {
+      cm_fingerprint_add(fp, city_tile_output_cached(pcity, ctindex, o));
+    } output_type_iterate_end;
+  } city_tile_iterate_index_end;
+
+  /* The specialists. */
+  specialist_type_iterate(sp) {
+    if (city_can_use_specialist(pcity, sp)) {
+      output_type_iterate(o) {
+        cm_fingerprint_add(fp, get_specialist_output(pcity, sp, o));
+      } output_type_iterate_end;
+    } else {
+      cm_fingerprint_add(fp, -1);
+    }
+  } specialist_type_iterate_end;
+}
+
+/************************************************************************//**
+  Free the results kept for a city.
+****************************************************************************/
+static void cm_city_cache_destroy(struct cm_city_cache *pcache)
+{
+  int i;
+
+  for (i = 0; i < CM_CACHE_CITY_ENTRIES; i++) {
+    free(pcache->entries[i].key.data);
+    free(pcache->entries[i].result.worker_positions);
+  }
+  free(pcache);
+}
+
+/************************************************************************//**
+  Returns whether the kept arrangement still gives the kept surplus and
+  mood to the city. The city is left as it was.
+****************************************************************************/
+static bool cm_cache_entry_check(struct city *pcity,
+                                 const struct cm_cache_entry *entry)
+{
+  struct city backup;
+  bool *workers_map;
+  int surplus[O_LAST];
+  bool disorder, happy, valid;
+  int tiles = MIN(city_map_tiles_from_city(pcity),
+                  city_map_tiles(entry->result.city_radius_sq));
+
+  if (!entry->complete) {
+    return TRUE;
+  }
+
+  memcpy(&backup, pcity, sizeof(backup));
+
+  workers_map = fc_calloc(city_map_tiles_from_city(pcity),
+                          sizeof(*workers_map));
+  memcpy(workers_map, entry->result.worker_positions,
+         tiles * sizeof(*workers_map));
+  memcpy(pcity->specialists, entry->result.specialists,
+         sizeof(pcity->specialists));
+  city_refresh_from_main_map(pcity, workers_map);
+  get_city_surplus(pcity, surplus, &disorder, &happy);
+
+  valid = (0 == memcmp(surplus, entry->result.surplus, sizeof(surplus))
+           && disorder == entry->result.disorder
+           && happy == entry->result.happy);
+
+  memcpy(pcity, &backup, sizeof(backup));
+  free(workers_map);
+
+  return valid;
+}
+
+/************************************************************************//**
+  Return the result kept for the city with this fingerprint, or NULL if
+  there is none or if it is outdated.
+****************************************************************************/
+static const struct cm_cache_entry *
+cm_cache_lookup(struct city *pcity, const struct cm_fingerprint *key)
+{
+  struct cm_city_cache *pcache;
+  int i;
+
+  if (NULL == cache.cities
+      || !cm_city_cache_hash_lookup(cache.cities, pcity->id, &pcache)) {
+    return NULL;
+  }
+
+  for (i = 0; i < CM_CACHE_CITY_ENTRIES; i++) {
+    struct cm_cache_entry *entry = &pcache->entries[i];
+
+    if (NULL != entry->key.data && entry->key.len == key->len
+        && 0 == memcmp(entry->key.data, key->data,
+                       key->len * sizeof(*key->data))) {
+      if (!cm_cache_entry_check(pcity, entry)) {
+        /* Outdated, forget it. */
+        FC_FREE(entry->key.data);
+        entry->last_use = 0;
+        return NULL;
+      }
+      entry->last_use = ++cache.clock;
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+/************************************************************************//**
+  Keep the result of a search for the city, replacing the least recently
+  used one if needed. Takes the ownership of the fingerprint data.
+****************************************************************************/
+static void cm_cache_store(const struct city *pcity,
+                           struct cm_fingerprint *key,
+                           const struct cm_result *result, bool complete)
+{
+  struct cm_city_cache *pcache;
+  struct cm_cache_entry *entry;
+  bool *worker_positions;
+  int tiles = city_map_tiles(result->city_radius_sq);
+  int i;
+
+  if (NULL == cache.cities) {
+    cache.cities = cm_city_cache_hash_new();
+  }
+  if (!cm_city_cache_hash_lookup(cache.cities, pcity->id, &pcache)) {
+    pcache = fc_calloc(1, sizeof(*pcache));
+    cm_city_cache_hash_insert(cache.cities, pcity->id, pcache);
+  }
+
+  entry = &pcache->entries[0];
+  for (i = 1; i < CM_CACHE_CITY_ENTRIES; i++) {
+    if (pcache->entries[i].last_use < entry->last_use) {
+      entry = &pcache->entries[i];
+    }
+  }
+
+  free(entry->key.data);
+  entry->key = *key;
+  entry->last_use = ++cache.clock;
+  entry->complete = complete;
+
+  worker_positions = fc_realloc(entry->result.worker_positions,
+                                tiles * sizeof(*worker_positions));
+  memcpy(worker_positions, result->worker_positions,
+         tiles * sizeof(*worker_positions));
+  entry->result = *result;
+  entry->result.worker_positions = worker_positions;
+}
+
+/************************************************************************//**
+  Copy a kept result to the caller's one, as the search would have set it.
+****************************************************************************/
+static void cm_cache_entry_get(const struct cm_cache_entry *entry,
+                               struct cm_result *result)
+{
+  result->aborted = entry->result.aborted;
+  result->found_a_valid = entry->result.found_a_valid;
+  if (!entry->complete) {
+    return;
+  }
+
+  result->disorder = entry->result.disorder;
+  result->happy = entry->result.happy;
+  memcpy(result->surplus, entry->result.surplus, sizeof(result->surplus));
+  memcpy(result->worker_positions, entry->result.worker_positions,
+         city_map_tiles(result->city_radius_sq)
+         * sizeof(*result->worker_positions));
+  memcpy(result->specialists, entry->result.specialists,
+         sizeof(result->specialists));
+}
+
 /************************************************************************//**
   Wrapper that actually runs the branch & bound, and returns the best
   solution.
@@ -2118,17 +2518,355 @@ void cm_query_result(struct city *pcity,
                      const struct cm_parameter *param,
                      struct cm_result *result, bool negative_ok)
 {
-  struct cm_state *state = cm_state_init(pcity, negative_ok);
+  struct cm_state *state;
+  struct cm_fingerprint key;
+  bool use_cache = (IDENTITY_NUMBER_ZERO != pcity->id
+                    && cm_get_result_cache());
 
   /* Refresh the city.  Otherwise the CM can give wrong results or just be
    * slower than necessary.  Note that cities are often passed in in an
    * unrefreshed state (which should probably be fixed). */
   city_refresh_from_main_map(pcity, NULL);
 
+  if (use_cache) {
+    const struct cm_cache_entry *entry;
+
+    cm_fingerprint_init(&key, pcity, param, result, negative_ok);
+    entry = cm_cache_lookup(pcity, &key);
+    if (NULL != entry) {
+      cm_cache_entry_get(entry, result);
+      free(key.data);
+      cm_stats_add_query(stats.caller, TRUE);
+      return;
+    }
+  }
+  cm_stats_add_query(stats.caller, FALSE);
+
+  state = cm_state_init(pcity, negative_ok);
   cm_find_best_solution(state, param, result, negative_ok);
+  cm_stats_add_search(stats.caller, pcity, &state->stats);
+
+  if (use_cache) {
+    /* cm_find_best_solution() only converted a complete solution. */
+    cm_cache_store(pcity, &key, result, 0 == state->best.idle);
+  }
   cm_state_free(state);
 }
 
+/************************************************************************//**
+  Run a search of cm_query_result_batch(). Called from any thread of the
+  pool: the searches only write to their own city, which they restore.
+****************************************************************************/
+static void cm_batch_task(int task, void *data)
+{
+  struct cm_batch *batch = (struct cm_batch *) data;
+  struct cm_batch_query *query = &batch->queries[task];
+  struct cm_state *state;
+
+  state = cm_state_init(query->pcity, batch->negative_ok);
+  cm_find_best_solution(state, query->param, query->result,
+                        batch->negative_ok);
+  query->complete = (0 == state->best.idle);
+  query->stats = state->stats;
+  cm_state_free(state);
+}
+
+/************************************************************************//**
+  Returns whether the search for the city reads what the search for
+  another city of the batch changes while it runs. This is the case when
+  the trade routes revenue depends on the trade of the partner.
+****************************************************************************/
+static bool cm_batch_city_depends(const struct city *pcity,
+                                  struct city **cities, int num)
+{
+  int i;
+
+  if (TRS_SIMPLE != game.info.trade_revenue_style) {
+    return FALSE;
+  }
+
+  trade_partners_iterate(pcity, partner) {
+    for (i = 0; i < num; i++) {
+      if (cities[i] == partner) {
+        return TRUE;
+      }
+    }
+  } trade_partners_iterate_end;
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Do cm_query_result() for 'num' cities at once: 'params[i]' and
+  'results[i]' are the parameter and the result of 'cities[i]'. The
+  searches missing the result cache are run concurrently by the threads
+  of the pool, against the current state of the world, which must not
+  change meanwhile. A city can only appear once. The results don't depend
+  on the number of threads.
+
+  'results' can be NULL, the results are then only kept in the result
+  cache for the next cm_query_result() calls. A caller applying several
+  of them in a row only gets a search again for the cities the previous
+  ones changed.
+****************************************************************************/
+void cm_query_result_batch(struct city **cities,
+                           const struct cm_parameter *params,
+                           struct cm_result **results, int num,
+                           bool negative_ok)
+{
+  struct cm_batch batch;
+  int i, num_tasks = 0, num_serial = 0;
+  bool use_cache = cm_get_result_cache();
+
+  if (0 >= num || (NULL == results && !use_cache)) {
+    return;
+  }
+
+  /* Refresh the cities and look up the cache first, from this thread. The
+   * searches depending on others are moved to the end of the batch, to
+   * be run once the others are over. */
+  batch.queries = fc_calloc(num, sizeof(*batch.queries));
+  batch.negative_ok = negative_ok;
+  for (i = 0; i < num; i++) {
+    struct city *pcity = cities[i];
+    struct cm_batch_query query;
+
+    if (NULL == results && IDENTITY_NUMBER_ZERO == pcity->id) {
+      /* Nothing to keep it for. */
+      continue;
+    }
+
+    city_refresh_from_main_map(pcity, NULL);
+
+    query.pcity = pcity;
+    query.param = &params[i];
+    query.result = (NULL != results ? results[i] : cm_result_new(pcity));
+    query.key.data = NULL;
+    query.complete = FALSE;
+
+    if (use_cache && IDENTITY_NUMBER_ZERO != pcity->id) {
+      const struct cm_cache_entry *entry;
+
+      cm_fingerprint_init(&query.key, pcity, query.param, query.result,
+                          negative_ok);
+      entry = cm_cache_lookup(pcity, &query.key);
+      if (NULL != entry) {
+        cm_cache_entry_get(entry, query.result);
+        free(query.key.data);
+        if (NULL != results) {
+          cm_stats_add_query(stats.caller, TRUE);
+        } else {
+          /* Counted when the caller gets it. */
+          cm_result_destroy(query.result);
+        }
+        continue;
+      }
+    }
+    if (NULL != results) {
+      cm_stats_add_query(stats.caller, FALSE);
+    }
+
+    if (cm_batch_city_depends(pcity, cities, num)) {
+      batch.queries[num - 1 - num_serial++] = query;
+    } else {
+      batch.queries[num_tasks++] = query;
+    }
+  }
+
+  if (1 < num_tasks) {
+    bool was_frozen;
+
+    if (NULL == batch_pool) {
+      batch_pool = fc_threadpool_new(cm_get_batch_threads());
+    }
+    /* The workers only read the effect caches. */
+    was_frozen = effect_cache_freeze(TRUE);
+    fc_threadpool_run(batch_pool, num_tasks, cm_batch_task, &batch);
+    effect_cache_freeze(was_frozen);
+  } else {
+    for (i = 0; i < num_tasks; i++) {
+      cm_batch_task(i, &batch);
+    }
+  }
+  for (i = num - num_serial; i < num; i++) {
+    cm_batch_task(i, &batch);
+  }
+
+  /* Keep the results, from this thread again. */
+  for (i = 0; i < num; i++) {
+    struct cm_batch_query *query = &batch.queries[i];
+
+    if (NULL == query->pcity) {
+      continue;
+    }
+    cm_stats_add_search(stats.caller, query->pcity, &query->stats);
+    if (NULL != query->key.data) {
+      cm_cache_store(query->pcity, &query->key, query->result,
+                     query->complete);
+    }
+    if (NULL == results) {
+      cm_result_destroy(query->result);
+    }
+  }
+
+  free(batch.queries);
+}
+
+/************************************************************************//**
+  Set the number of threads used by cm_query_result_batch() besides the
+  calling one, overriding the FREECIV_CM_THREADS environment variable.
+  With 0, the batches are searched by the calling thread only.
+****************************************************************************/
+void cm_set_batch_threads(int threads)
+{
+  threads = MAX(threads, 0);
+  if (NULL != batch_pool && threads != batch_threads) {
+    fc_threadpool_destroy(batch_pool);
+    batch_pool = NULL;
+  }
+  batch_threads = threads;
+}
+
+/************************************************************************//**
+  Returns the number of threads used by cm_query_result_batch() besides
+  the calling one. Initialize it from the FREECIV_CM_THREADS environment
+  variable if needed, there are none by default.
+****************************************************************************/
+int cm_get_batch_threads(void)
+{
+  if (-1 == batch_threads) {
+    const char *s = getenv("FREECIV_CM_THREADS");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 0 <= value) {
+      batch_threads = value;
+    } else {
+      batch_threads = 0;
+    }
+  }
+
+  return batch_threads;
+}
+
+/************************************************************************//**
+  Enable or disable the result cache of cm_query_result(), overriding the
+  FREECIV_CM_CACHE environment variable.
+****************************************************************************/
+void cm_set_result_cache(bool enable)
+{
+  cache.enabled = (enable ? 1 : 0);
+  if (!enable && NULL != cache.cities) {
+    cm_city_cache_hash_clear(cache.cities);
+  }
+}
+
+/************************************************************************//**
+  Returns whether cm_query_result() keeps its results. Initialize it from
+  the FREECIV_CM_CACHE environment variable if needed, it is enabled
+  unless it is set to 0.
+****************************************************************************/
+bool cm_get_result_cache(void)
+{
+  if (-1 == cache.enabled) {
+    const char *s = getenv("FREECIV_CM_CACHE");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 0 == value) {
+      cache.enabled = 0;
+    } else {
+      cache.enabled = 1;
+    }
+  }
+
+  return 0 < cache.enabled;
+}
+
+/************************************************************************//**
+  Count a query of 'caller', answered from the result cache if 'hit'.
+****************************************************************************/
+static void cm_stats_add_query(enum cm_caller caller, bool hit)
+{
+  stats.turn[caller].queries++;
+  stats.game[caller].queries++;
+  if (hit) {
+    stats.turn[caller].hits++;
+    stats.game[caller].hits++;
+  }
+}
+
+/************************************************************************//**
+  Add a search of 'caller' for the city to the statistics.
+****************************************************************************/
+static void cm_stats_add_search(enum cm_caller caller,
+                                const struct city *pcity,
+                                const struct cm_search_stats *psearch)
+{
+  struct cm_stats *sets[] = { &stats.turn[caller], &stats.game[caller] };
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(sets); i++) {
+    struct cm_stats *pstats = sets[i];
+
+    pstats->searches++;
+    if (psearch->aborted) {
+      pstats->aborted++;
+    }
+    pstats->nodes += psearch->nodes;
+    pstats->applies += psearch->applies;
+    pstats->lattice += psearch->lattice;
+    pstats->lattice_max = MAX(pstats->lattice_max, psearch->lattice);
+    pstats->seconds += psearch->seconds;
+    if (psearch->seconds > pstats->slowest_seconds) {
+      pstats->slowest_seconds = psearch->seconds;
+      pstats->slowest_city = pcity->id;
+    }
+  }
+}
+
+/************************************************************************//**
+  Set who the following queries are made for, and return who they were
+  made for until now, to restore once done.
+****************************************************************************/
+enum cm_caller cm_set_caller(enum cm_caller caller)
+{
+  enum cm_caller old = stats.caller;
+
+  fc_assert_ret_val(cm_caller_is_valid(caller), old);
+
+  stats.caller = caller;
+
+  return old;
+}
+
+/************************************************************************//**
+  Fill 'pstats' with the statistics of the queries of 'caller', either
+  since the last cm_stats_turn_reset() or for the whole game.
+****************************************************************************/
+void cm_stats_get(enum cm_caller caller, bool turn, struct cm_stats *pstats)
+{
+  fc_assert_ret(NULL != pstats);
+  fc_assert_ret(cm_caller_is_valid(caller));
+
+  *pstats = (turn ? stats.turn[caller] : stats.game[caller]);
+}
+
+/************************************************************************//**
+  Start counting the statistics of a new turn.
+****************************************************************************/
+void cm_stats_turn_reset(void)
+{
+  memset(stats.turn, 0, sizeof(stats.turn));
+}
+
+/************************************************************************//**
+  Reset all the statistics.
+****************************************************************************/
+void cm_stats_reset(void)
+{
+  memset(stats.turn, 0, sizeof(stats.turn));
+  memset(stats.game, 0, sizeof(stats.game));
+}
+
 /************************************************************************//**
   Returns true if the two cm_parameters are equal.
 ****************************************************************************/
@@ -2394,29 +3132,27 @@ static void real_print_partial_solution(enum log_level level,
 
 #endif /* CM_DEBUG */
 
-#ifdef GATHER_TIME_STATS
 /************************************************************************//**
-  Print debugging performance data.
+  Print debugging performance data of the game.
 ****************************************************************************/
-static void print_performance(struct one_perf *counts)
+static void print_performance(void)
 {
-  double s, ms;
-  double q;
-  int queries, applies;
+  enum cm_caller caller;
 
-  s = timer_read_seconds(counts->wall_timer);
-  ms = 1000.0 * s;
+  for (caller = 0; caller < CM_CALLER_COUNT; caller++) {
+    const struct cm_stats *pstats = &stats.game[caller];
 
-  queries = counts->query_count;
-  q = queries;
-
-  applies = counts->apply_count;
-
-  log_base(LOG_TIME_STATS,
-           "CM-%s: overall=%fs queries=%d %fms / query, %d applies",
-           counts->name, s, queries, ms / q, applies);
+    if (0 == pstats->searches) {
+      continue;
+    }
+    log_base(LOG_TIME_STATS,
+             "CM-%s: overall=%fs searches=%lu %fms / search, %lu applies, "
+             "%lu nodes",
+             cm_caller_name(caller), pstats->seconds, pstats->searches,
+             1000.0 * pstats->seconds / pstats->searches,
+             pstats->applies, pstats->nodes);
+  }
 }
-#endif /* GATHER_TIME_STATS */
 
 /************************************************************************//**
   Print debugging information about one city.
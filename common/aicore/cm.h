@@ -78,11 +78,64 @@ void cm_query_result(struct city *pcity,
                      struct cm_result *result, bool negative_ok);
 
 /*
- * Call this function if the city has changed. To be safe call it
- * everytime before you call cm_query_result().
+ * Same for several cities at once, the searches being run concurrently by
+ * a pool of threads (FREECIV_CM_THREADS environment variable or
+ * cm_set_batch_threads(), none by default). With NULL 'results', it only
+ * fills the result cache for the following cm_query_result() calls.
+ */
+void cm_query_result_batch(struct city **cities,
+                           const struct cm_parameter *params,
+                           struct cm_result **results, int num,
+                           bool negative_ok);
+void cm_set_batch_threads(int threads);
+int cm_get_batch_threads(void);
+
+/*
+ * The results of cm_query_result() are kept, and returned again without
+ * searching as long as nothing they depend on changes. Call this function
+ * to drop the results kept for the city anyway.
  */
 void cm_clear_cache(struct city *pcity);
 
+void cm_set_result_cache(bool enable);
+bool cm_get_result_cache(void);
+
+/*
+ * Statistics of the queries, kept by caller. The caller of the following
+ * queries is set with cm_set_caller(), which returns the previous one to
+ * restore. They are counted for the current turn, until
+ * cm_stats_turn_reset(), and for the whole game.
+ */
+#define SPECENUM_NAME cm_caller
+#define SPECENUM_VALUE0 CM_CALLER_ARRANGE
+#define SPECENUM_VALUE0NAME "arrange"
+#define SPECENUM_VALUE1 CM_CALLER_AI
+#define SPECENUM_VALUE1NAME "ai"
+#define SPECENUM_VALUE2 CM_CALLER_CMA
+#define SPECENUM_VALUE2NAME "cma"
+#define SPECENUM_COUNT CM_CALLER_COUNT
+#include "specenum_gen.h"
+
+struct cm_stats {
+  unsigned long queries;        /* Results asked for. */
+  unsigned long hits;           /* Queries answered from the cache. */
+  unsigned long searches;       /* Searches run, including the batches
+                                 * only filling the cache. */
+  unsigned long aborted;        /* Searches stopped at CM_MAX_LOOP. */
+  unsigned long nodes;          /* Branch and bound steps. */
+  unsigned long applies;        /* Solutions applied to a city. */
+  unsigned long lattice;        /* Sum of the tile types of the searches. */
+  int lattice_max;
+  double seconds;               /* Time spent searching. */
+  double slowest_seconds;       /* Slowest search, and its city. */
+  int slowest_city;
+};
+
+enum cm_caller cm_set_caller(enum cm_caller caller);
+void cm_stats_get(enum cm_caller caller, bool turn, struct cm_stats *pstats);
+void cm_stats_turn_reset(void);
+void cm_stats_reset(void);
+
 /***************** utility methods *************************************/
 bool cm_are_parameter_equal(const struct cm_parameter *const p1,
                             const struct cm_parameter *const p2);
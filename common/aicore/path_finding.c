@@ -15,28 +15,36 @@
 #include <fc_config.h>
 #endif
 
+#include <stdlib.h>
+#include <string.h>
+
 /* utility */
 #include "bitvector.h"
+#include "fcthread.h"
+#include "fcthreadpool.h"
+#include "genhash.h"
 #include "log.h"
 #include "mem.h"
+#include "shared.h"
 #include "support.h"
 
 /* common */
+#include "effects.h"
 #include "game.h"
 #include "map.h"
 #include "movement.h"
 
 /* common/aicore */
+#include "pf_cluster.h"
 #include "pf_tools.h"
 
 #include "path_finding.h"
 
 /* For explanations on how to use this module, see "path_finding.h". */
 
-#define SPECPQ_TAG map_index
-#define SPECPQ_DATA_TYPE int
-#define SPECPQ_PRIORITY_TYPE int
-#include "specpq.h"
+#define SPECBQ_TAG map_index
+#define SPECBQ_DATA_TYPE int
+#include "specbq.h"
 #define INITIAL_QUEUE_SIZE 100
 
 #ifdef FREECIV_DEBUG
@@ -51,7 +59,8 @@
 enum pf_mode {
   PF_NORMAL = 1,        /* Usual goto */
   PF_DANGER,            /* Goto with dangerous positions */
-  PF_FUEL               /* Goto for fueled units */
+  PF_FUEL,              /* Goto for fueled units */
+  PF_CACHED             /* Shared map of the cache */
 };
 #endif /* PF_DEBUG */
 
@@ -91,11 +100,40 @@ struct pf_map {
   /* Private data. */
   struct tile *tile;          /* The current position (aka iterator). */
   struct pf_parameter params; /* Initial parameters. */
+  struct pf_cache_entry *centry; /* Set if the map is shared, see
+                                  * pf_map_new_cached(). */
+  size_t memory;              /* Bytes allocated during the iteration. */
+  unsigned long expanded;     /* Nodes processed, see pf_stats_get(). */
 };
 
 /* Down-cast macro. */
 #define PF_MAP(pfm) ((struct pf_map *) (pfm))
 
+/* Node expansion counters, see pf_stats_get(). The maps count their own
+ * expansions and add them when destroyed, so the iterations can run in
+ * other threads, see pf_map_batch_new(). */
+static struct pf_stats stats;
+
+/************************************************************************//**
+  Record the statistics of a map about to be destroyed: the nodes it
+  expanded, and the memory used by its own structure, its lattice, its
+  queues and what it allocated during the iteration.
+****************************************************************************/
+static inline void pf_map_stats_record(struct pf_map_stats *map_stats,
+                                       const struct pf_map *pfm,
+                                       size_t memory)
+{
+  map_stats->expanded += pfm->expanded;
+  memory += pfm->memory;
+  if (memory > map_stats->peak_memory) {
+    map_stats->peak_memory = memory;
+  }
+}
+
+/* Whether pf_map_new_goal() makes goal-directed searches. Magic -1 means
+ * not initialized, see pf_get_goal_directed(). */
+static int goal_directed = -1;
+
 /* ========================== Common functions =========================== */
 
 /************************************************************************//**
@@ -197,6 +235,116 @@ static void pf_position_fill_start_tile(struct pf_position *pos,
                                         const struct pf_parameter *param);
 
 
+/* ============================ Lattice pool ============================= */
+
+/* The lattices of nodes are recycled between the maps instead of
+ * allocating and clearing MAP_INDEX_SIZE nodes for every new map. Each
+ * lattice has a generation counter, increased every time it is reused.
+ * The nodes which don't have the generation of their lattice have been
+ * left by a previous map, and are considered as not initialized (see
+ * pf_normal_map_node() and friends). So the lattice never needs to be
+ * cleared, but when the counter wraps around. */
+struct pf_lattice {
+  void *nodes;                  /* The nodes. */
+  size_t node_size;             /* Size of one node. */
+  int size;                     /* Number of nodes. */
+  unsigned short generation;    /* Current generation of the nodes. */
+  struct pf_lattice *next;      /* Next lattice in the pool. */
+};
+
+/* Maximal number of unused lattices kept in the pool. */
+#define PF_LATTICE_POOL_SIZE 16
+
+static struct {
+  bool initialized;             /* See pf_init(). */
+  fc_mutex mutex;               /* The pool is shared by all threads. */
+  struct pf_lattice *free;      /* The unused lattices. */
+  int free_count;
+} lattice_pool;
+
+/************************************************************************//**
+  Free a lattice and its nodes.
+****************************************************************************/
+static void pf_lattice_destroy(struct pf_lattice *plattice)
+{
+  free(plattice->nodes);
+  free(plattice);
+}
+
+/************************************************************************//**
+  Get a lattice of MAP_INDEX_SIZE nodes of 'node_size' bytes from the pool,
+  or allocate a new one. The nodes are not cleared, but they will have a
+  generation different from the returned lattice one.
+****************************************************************************/
+static struct pf_lattice *pf_lattice_get(size_t node_size)
+{
+  struct pf_lattice *plattice = NULL;
+
+  if (lattice_pool.initialized) {
+    struct pf_lattice **pprev = &lattice_pool.free;
+
+    fc_mutex_allocate(&lattice_pool.mutex);
+    while (NULL != *pprev) {
+      struct pf_lattice *pcurrent = *pprev;
+
+      if (pcurrent->size != MAP_INDEX_SIZE) {
+        /* Made for a previous map. */
+        *pprev = pcurrent->next;
+        lattice_pool.free_count--;
+        pf_lattice_destroy(pcurrent);
+      } else if (pcurrent->node_size == node_size) {
+        *pprev = pcurrent->next;
+        lattice_pool.free_count--;
+        plattice = pcurrent;
+        break;
+      } else {
+        pprev = &pcurrent->next;
+      }
+    }
+    fc_mutex_release(&lattice_pool.mutex);
+  }
+
+  if (NULL == plattice) {
+    plattice = fc_malloc(sizeof(*plattice));
+    plattice->nodes = fc_calloc(MAP_INDEX_SIZE, node_size);
+    plattice->node_size = node_size;
+    plattice->size = MAP_INDEX_SIZE;
+    plattice->generation = 0;
+  }
+  plattice->next = NULL;
+
+  plattice->generation++;
+  if (0 == plattice->generation) {
+    /* Wrapped around, really clear the nodes this time. */
+    memset(plattice->nodes, 0, plattice->size * plattice->node_size);
+    plattice->generation = 1;
+  }
+
+  return plattice;
+}
+
+/************************************************************************//**
+  Give back a lattice obtained with pf_lattice_get() to the pool.
+****************************************************************************/
+static void pf_lattice_release(struct pf_lattice *plattice)
+{
+  if (lattice_pool.initialized && plattice->size == MAP_INDEX_SIZE) {
+    fc_mutex_allocate(&lattice_pool.mutex);
+    if (PF_LATTICE_POOL_SIZE > lattice_pool.free_count) {
+      plattice->next = lattice_pool.free;
+      lattice_pool.free = plattice;
+      lattice_pool.free_count++;
+      plattice = NULL;
+    }
+    fc_mutex_release(&lattice_pool.mutex);
+  }
+
+  if (NULL != plattice) {
+    pf_lattice_destroy(plattice);
+  }
+}
+
+
 /* ================ Specific pf_normal_* mode structures ================= */
 
 /* Normal path-finding maps are used for most of units with standard rules.
@@ -222,16 +370,27 @@ struct pf_normal_node {
   unsigned behavior : 2;        /* 'enum tile_behavior' really. */
   unsigned zoc_number : 2;      /* 'enum pf_zoc_type' really. */
   unsigned short extra_tile;    /* EC */
+  unsigned short generation;    /* See struct pf_lattice. */
 };
 
 /* Derived structure of struct pf_map. */
 struct pf_normal_map {
   struct pf_map base_map;   /* Base structure, must be the first! */
 
-  struct map_index_pq *queue; /* Queue of nodes we have reached but not
+  struct map_index_bq *queue; /* Queue of nodes we have reached but not
                                * processed yet (NS_NEW), sorted by their
                                * total_CC. */
-  struct pf_normal_node *lattice; /* Lattice of nodes. */
+  struct pf_lattice *plattice; /* Lattice of nodes, from the pool. */
+  struct pf_normal_node *lattice; /* Nodes of 'plattice'. */
+
+  struct tile *goal_tile;   /* Destination of a goal-directed search, in
+                             * which case 'queue' is sorted by the lower
+                             * bound of the total_CC at 'goal_tile'.
+                             * Else NULL. */
+  int min_MC;               /* Lower bound of the cost of any step. Only
+                             * used if 'goal_tile' is set. */
+  struct tile *unreachable_tile; /* Goal proven unreachable by the cluster
+                                  * layer, or NULL. */
 };
 
 /* Up-cast macro. */
@@ -251,6 +410,23 @@ pf_normal_map_check(struct pf_map *pfm, const char *file,
 #define PF_NORMAL_MAP(pfm) ((struct pf_normal_map *) (pfm))
 #endif /* PF_DEBUG */
 
+/************************************************************************//**
+  Returns the node at 'tindex'. Nodes left in the lattice by a previous map
+  are cleared first.
+****************************************************************************/
+static inline struct pf_normal_node *
+pf_normal_map_node(const struct pf_normal_map *pfnm, int tindex)
+{
+  struct pf_normal_node *node = pfnm->lattice + tindex;
+
+  if (node->generation != pfnm->plattice->generation) {
+    memset(node, 0, sizeof(*node));
+    node->generation = pfnm->plattice->generation;
+  }
+
+  return node;
+}
+
 /* ================  Specific pf_normal_* mode functions ================= */
 
 /************************************************************************//**
@@ -403,7 +579,7 @@ static void pf_normal_map_fill_position(const struct pf_normal_map *pfnm,
                                         struct pf_position *pos)
 {
   int tindex = tile_index(ptile);
-  struct pf_normal_node *node = pfnm->lattice + tindex;
+  struct pf_normal_node *node = pf_normal_map_node(pfnm, tindex);
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
 
 #ifdef PF_DEBUG
@@ -438,7 +614,7 @@ static struct pf_path *
 pf_normal_map_construct_path(const struct pf_normal_map *pfnm,
                              struct tile *dest_tile)
 {
-  struct pf_normal_node *node = pfnm->lattice + tile_index(dest_tile);
+  struct pf_normal_node *node = pf_normal_map_node(pfnm, tile_index(dest_tile));
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
   enum direction8 dir_next = direction8_invalid();
   struct pf_path *path;
@@ -463,7 +639,7 @@ pf_normal_map_construct_path(const struct pf_normal_map *pfnm,
     }
 
     ptile = mapstep(params->map, ptile, DIR_REVERSE(node->dir_to_here));
-    node = pfnm->lattice + tile_index(ptile);
+    node = pf_normal_map_node(pfnm, tile_index(ptile));
   }
 
   /* 2: Allocate the memory */
@@ -472,7 +648,7 @@ pf_normal_map_construct_path(const struct pf_normal_map *pfnm,
 
   /* 3: Backtrack again and fill the positions this time */
   ptile = dest_tile;
-  node = pfnm->lattice + tile_index(ptile);
+  node = pf_normal_map_node(pfnm, tile_index(ptile));
 
   for (; i >= 0; i--) {
     pf_normal_map_fill_position(pfnm, ptile, &path->positions[i]);
@@ -484,7 +660,7 @@ pf_normal_map_construct_path(const struct pf_normal_map *pfnm,
     if (i > 0) {
       /* Step further back, if we haven't finished yet */
       ptile = mapstep(params->map, ptile, DIR_REVERSE(dir_next));
-      node = pfnm->lattice + tile_index(ptile);
+      node = pf_normal_map_node(pfnm, tile_index(ptile));
     }
   }
 
@@ -499,6 +675,105 @@ static int pf_normal_map_adjust_cost(int cost, int moves_left)
   return MIN(cost, moves_left);
 }
 
+/************************************************************************//**
+  Lower bound of the cost at the goal tile of a goal-directed search, for
+  a node reached with 'cost' and 'steps' steps away from the goal. Every
+  step costs at least 'min_MC', but no more than the moves left (see
+  pf_normal_map_adjust_cost()). This bound never decreases along a path,
+  so the nodes are still processed with their best costs.
+****************************************************************************/
+static inline int pf_goal_lower_cost(const struct pf_parameter *param,
+                                     int cost, int steps, int min_MC)
+{
+  int move_rate = pf_move_rate(param);
+  int moves_left, steps_now, steps_per_turn;
+
+  if (0 == steps) {
+    return cost;
+  }
+
+  /* Steps until the end of the current turn. */
+  moves_left = pf_moves_left(param, cost);
+  steps_now = (moves_left + min_MC - 1) / min_MC;
+  if (steps <= steps_now) {
+    return cost + MIN(steps * min_MC, moves_left);
+  }
+
+  /* Full turns, then the remaining steps. */
+  steps -= steps_now;
+  steps_per_turn = (move_rate + min_MC - 1) / min_MC;
+
+  return (cost + moves_left + (steps / steps_per_turn) * move_rate
+          + (steps % steps_per_turn) * min_MC);
+}
+
+/************************************************************************//**
+  Returns the priority in the queue of a node at 'ptile' reached with
+  'cost' and 'extra'. This is the cost of the path, or its lower bound at
+  the goal tile for goal-directed searches.
+****************************************************************************/
+static inline int pf_normal_map_priority(const struct pf_normal_map *pfnm,
+                                         const struct tile *ptile,
+                                         int cost, unsigned extra)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
+
+  if (NULL != pfnm->goal_tile) {
+    cost = pf_goal_lower_cost(params, cost,
+                              real_map_distance(ptile, pfnm->goal_tile),
+                              pfnm->min_MC);
+  }
+
+  return pf_total_CC(params, cost, extra);
+}
+
+/************************************************************************//**
+  Get the next node (the index with the lowest priority). The queue may
+  contain outdated entries for nodes which have been processed already or
+  reached since by a better route, they are skipped. Returns FALSE if
+  there are no more nodes.
+****************************************************************************/
+static inline bool pf_normal_map_remove(struct pf_normal_map *pfnm,
+                                        int *ptindex)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfnm));
+  const struct pf_normal_node *node;
+  int priority;
+
+  while (map_index_bq_remove(pfnm->queue, ptindex, &priority)) {
+    node = pf_normal_map_node(pfnm, *ptindex);
+    if (NS_NEW == node->status
+        && priority == pf_normal_map_priority(pfnm,
+                                              index_to_tile(params->map,
+                                                            *ptindex),
+                                              node->cost,
+                                              node->extra_cost)) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Returns the lower bound of the cost of any step for a goal-directed
+  search, or 0 if it is unknown.
+****************************************************************************/
+static int pf_normal_map_min_MC(const struct pf_parameter *params)
+{
+  int min_MC = pft_min_move_cost(params);
+
+  if (0 < min_MC && NULL != params->get_action) {
+    /* See pf_normal_map_iterate() for the cost of actions. */
+    min_MC = MIN(min_MC, MIN(SINGLE_MOVE, params->move_rate));
+  }
+  if (0 < min_MC && !params->omniscience) {
+    min_MC = MIN(min_MC, params->utype->unknown_move_cost);
+  }
+
+  return MAX(min_MC, 0);
+}
+
 /************************************************************************//**
   Bare-bones PF iterator. All Freeciv rules logic is hidden in 'get_costs'
   callback (compare to pf_normal_map_iterate function). This function is
@@ -521,7 +796,7 @@ static bool pf_jumbo_map_iterate(struct pf_map *pfm)
   struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
   struct tile *tile = pfm->tile;
   int tindex = tile_index(tile);
-  struct pf_normal_node *node = pfnm->lattice + tindex;
+  struct pf_normal_node *node = pf_normal_map_node(pfnm, tindex);
   const struct pf_parameter *params = pf_map_parameter(pfm);
 
   /* Processing Stage */
@@ -534,7 +809,7 @@ static bool pf_jumbo_map_iterate(struct pf_map *pfm)
     /* Calculate the cost of every adjacent position and set them in the
      * priority queue for next call to pf_jumbo_map_iterate(). */
     int tindex1 = tile_index(tile1);
-    struct pf_normal_node *node1 = pfnm->lattice + tindex1;
+    struct pf_normal_node *node1 = pf_normal_map_node(pfnm, tindex1);
     int priority;
     unsigned cost1;
     unsigned extra_cost1;
@@ -564,12 +839,9 @@ static bool pf_jumbo_map_iterate(struct pf_map *pfm)
                                  &extra_cost1, params);
     if (priority >= 0) {
       /* We found a better route to 'tile1', record it (the costs are
-       * recorded already). Node status step A. to B. */
-      if (NS_NEW == node1->status) {
-        map_index_pq_replace(pfnm->queue, tindex1, -priority);
-      } else {
-        map_index_pq_insert(pfnm->queue, tindex1, -priority);
-      }
+       * recorded already). Node status step A. to B. An outdated entry
+       * may remain in the queue, it will be skipped. */
+      map_index_bq_insert(pfnm->queue, tindex1, priority);
       node1->cost = cost1;
       node1->extra_cost = extra_cost1;
       node1->status = NS_NEW;
@@ -577,19 +849,19 @@ static bool pf_jumbo_map_iterate(struct pf_map *pfm)
     }
   } adjc_dir_iterate_end;
 
-  /* Get the next node (the index with the highest priority). */
-  if (!map_index_pq_remove(pfnm->queue, &tindex)) {
-    /* No more indexes in the priority queue, iteration end. */
-    return FALSE;
-  }
-
-#ifdef PF_DEBUG
-  fc_assert(NS_NEW == pfnm->lattice[tindex].status);
-#endif
+  /* Get the next node (the index with the lowest priority), skipping the
+   * outdated entries of the nodes processed already. */
+  do {
+    if (!map_index_bq_remove(pfnm->queue, &tindex, NULL)) {
+      /* No more indexes in the priority queue, iteration end. */
+      return FALSE;
+    }
+  } while (NS_NEW != pf_normal_map_node(pfnm, tindex)->status);
 
   /* Change the pf_map iterator. Node status step B. to C. */
   pfm->tile = index_to_tile(params->map, tindex);
-  pfnm->lattice[tindex].status = NS_PROCESSED;
+  pf_normal_map_node(pfnm, tindex)->status = NS_PROCESSED;
+  pfm->expanded++;
 
   return TRUE;
 }
@@ -615,7 +887,7 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
   struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
   struct tile *tile = pfm->tile;
   int tindex = tile_index(tile);
-  struct pf_normal_node *node = pfnm->lattice + tindex;
+  struct pf_normal_node *node = pf_normal_map_node(pfnm, tindex);
   const struct pf_parameter *params = pf_map_parameter(pfm);
   int cost_of_path;
   enum pf_move_scope scope = node->move_scope;
@@ -634,7 +906,7 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
       /* Calculate the cost of every adjacent position and set them in the
        * priority queue for next call to pf_normal_map_iterate(). */
       int tindex1 = tile_index(tile1);
-      struct pf_normal_node *node1 = pfnm->lattice + tindex1;
+      struct pf_normal_node *node1 = pf_normal_map_node(pfnm, tindex1);
       int cost;
       unsigned extra = 0;
 
@@ -685,7 +957,8 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
       } else if (node1->node_known_type == TILE_UNKNOWN) {
         cost = params->utype->unknown_move_cost;
       } else {
-        cost = params->get_MC(tile, scope, tile1, node1->move_scope, params);
+        cost = params->get_MC(tile, scope, tile1, node1->move_scope, dir,
+                              params);
       }
       if (cost < 0) {
         /* e.g. PF_IMPOSSIBLE_MC */
@@ -713,8 +986,9 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
         node1->extra_cost = extra;
         node1->cost = cost;
         node1->dir_to_here = dir;
-        /* As we prefer lower costs, let's reverse the cost of the path. */
-        map_index_pq_insert(pfnm->queue, tindex1, -cost_of_path);
+        map_index_bq_insert(pfnm->queue, tindex1,
+                            pf_normal_map_priority(pfnm, tile1,
+                                                   cost, extra));
       } else if (cost_of_path < pf_total_CC(params, node1->cost,
                                             node1->extra_cost)) {
         /* We found a better route to 'tile1'. Let's register 'tindex1' to
@@ -723,25 +997,28 @@ static bool pf_normal_map_iterate(struct pf_map *pfm)
         node1->extra_cost = extra;
         node1->cost = cost;
         node1->dir_to_here = dir;
-        /* As we prefer lower costs, let's reverse the cost of the path. */
-        map_index_pq_replace(pfnm->queue, tindex1, -cost_of_path);
+        /* The outdated entry will be skipped by pf_normal_map_remove(). */
+        map_index_bq_insert(pfnm->queue, tindex1,
+                            pf_normal_map_priority(pfnm, tile1,
+                                                   cost, extra));
       }
     } adjc_dir_iterate_end;
   }
 
-  /* Get the next node (the index with the highest priority). */
-  if (!map_index_pq_remove(pfnm->queue, &tindex)) {
+  /* Get the next node (the index with the lowest priority). */
+  if (!pf_normal_map_remove(pfnm, &tindex)) {
     /* No more indexes in the priority queue, iteration end. */
     return FALSE;
   }
 
 #ifdef PF_DEBUG
-  fc_assert(NS_NEW == pfnm->lattice[tindex].status);
+  fc_assert(NS_NEW == pf_normal_map_node(pfnm, tindex)->status);
 #endif
 
   /* Change the pf_map iterator. Node status step C. to D. */
   pfm->tile = index_to_tile(params->map, tindex);
-  pfnm->lattice[tindex].status = NS_PROCESSED;
+  pf_normal_map_node(pfnm, tindex)->status = NS_PROCESSED;
+  pfm->expanded++;
 
   return TRUE;
 }
@@ -753,8 +1030,14 @@ static inline bool pf_normal_map_iterate_until(struct pf_normal_map *pfnm,
                                                struct tile *ptile)
 {
   struct pf_map *pfm = PF_MAP(pfnm);
-  struct pf_normal_node *node = pfnm->lattice + tile_index(ptile);
+  struct pf_normal_node *node;
 
+  if (ptile == pfnm->unreachable_tile) {
+    /* Don't iterate the whole map to find out. */
+    return FALSE;
+  }
+
+  node = pf_normal_map_node(pfnm, tile_index(ptile));
   if (NULL == pf_map_parameter(pfm)->get_costs) {
     /* Start position is handled in every function calling this function. */
     if (NS_UNINIT == node->status) {
@@ -792,7 +1075,7 @@ static int pf_normal_map_move_cost(struct pf_map *pfm, struct tile *ptile)
   if (ptile == pfm->params.start_tile) {
     return 0;
   } else if (pf_normal_map_iterate_until(pfnm, ptile)) {
-    return (pfnm->lattice[tile_index(ptile)].cost
+    return (pf_normal_map_node(pfnm, tile_index(ptile))->cost
             - pf_move_rate(pf_map_parameter(pfm))
             + pf_moves_left_initially(pf_map_parameter(pfm)));
   } else {
@@ -846,15 +1129,20 @@ static void pf_normal_map_destroy(struct pf_map *pfm)
 {
   struct pf_normal_map *pfnm = PF_NORMAL_MAP(pfm);
 
-  free(pfnm->lattice);
-  map_index_pq_destroy(pfnm->queue);
+  pf_map_stats_record(&stats.normal, pfm, sizeof(*pfnm)
+                      + pfnm->plattice->size * pfnm->plattice->node_size
+                      + map_index_bq_memory(pfnm->queue));
+  pf_lattice_release(pfnm->plattice);
+  map_index_bq_destroy(pfnm->queue);
   free(pfnm);
 }
 
 /************************************************************************//**
-  'pf_normal_map' constructor.
+  'pf_normal_map' constructor. If 'goal_tile' is not NULL, and the
+  parameter permits it, the search will be directed towards it.
 ****************************************************************************/
-static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
+static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter,
+                                        struct tile *goal_tile)
 {
   struct pf_normal_map *pfnm;
   struct pf_map *base_map;
@@ -868,10 +1156,14 @@ static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
   /* Set the mode, used for cast check. */
   base_map->mode = PF_NORMAL;
 #endif /* PF_DEBUG */
+  base_map->centry = NULL;
+  base_map->memory = 0;
+  base_map->expanded = 0;
 
   /* Allocate the map. */
-  pfnm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_normal_node));
-  pfnm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pfnm->plattice = pf_lattice_get(sizeof(struct pf_normal_node));
+  pfnm->lattice = pfnm->plattice->nodes;
+  pfnm->queue = map_index_bq_new(INITIAL_QUEUE_SIZE);
 
   if (NULL == parameter->get_costs) {
     /* 'get_MC' callback must be set. */
@@ -896,7 +1188,7 @@ static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
   }
 
   /* Initialise starting node. */
-  node = pfnm->lattice + tile_index(params->start_tile);
+  node = pf_normal_map_node(pfnm, tile_index(params->start_tile));
   if (NULL == params->get_costs) {
     if (!pf_normal_node_init(pfnm, node, params->start_tile, PF_MS_NONE)) {
       /* Always fails. */
@@ -931,6 +1223,30 @@ static struct pf_map *pf_normal_map_new(const struct pf_parameter *parameter)
   node->dir_to_here = direction8_invalid();
   node->status = NS_PROCESSED;
 
+  /* Set up the goal-directed search. */
+  pfnm->goal_tile = NULL;
+  pfnm->min_MC = 0;
+  pfnm->unreachable_tile = NULL;
+  if (NULL != goal_tile
+      && goal_tile != params->start_tile
+      && NULL == params->get_costs
+      && pft_goal_unreachable(params, goal_tile)) {
+    pfnm->unreachable_tile = goal_tile;
+    stats.normal.rejected++;
+  }
+  if (NULL != goal_tile
+      && goal_tile != params->start_tile
+      && NULL == params->get_costs
+      && 0 < params->move_rate
+      && pf_get_goal_directed()) {
+    pfnm->min_MC = pf_normal_map_min_MC(params);
+    if (0 < pfnm->min_MC) {
+      pfnm->goal_tile = goal_tile;
+      stats.normal.goal_maps++;
+    }
+  }
+  stats.normal.maps++;
+
   return PF_MAP(pfnm);
 }
 
@@ -964,6 +1280,7 @@ struct pf_danger_node {
   bool is_dangerous : 1;        /* Whether we cannot end the turn there. */
   bool waited : 1;              /* TRUE if waited to get there. */
   unsigned short extra_tile;    /* EC */
+  unsigned short generation;    /* See struct pf_lattice. */
 
   /* Segment leading across the danger area back to the nearest safe node:
    * need to remeber costs and stuff. */
@@ -978,11 +1295,12 @@ struct pf_danger_node {
 struct pf_danger_map {
   struct pf_map base_map;       /* Base structure, must be the first! */
 
-  struct map_index_pq *queue;   /* Queue of nodes we have reached but not
+  struct map_index_bq *queue;   /* Queue of nodes we have reached but not
                                  * processed yet (NS_NEW and NS_WAITING),
                                  * sorted by their total_CC. */
-  struct map_index_pq *danger_queue; /* Dangerous positions. */
-  struct pf_danger_node *lattice; /* Lattice of nodes. */
+  struct map_index_bq *danger_queue; /* Dangerous positions. */
+  struct pf_lattice *plattice; /* Lattice of nodes, from the pool. */
+  struct pf_danger_node *lattice; /* Nodes of 'plattice'. */
 };
 
 /* Up-cast macro. */
@@ -1002,6 +1320,23 @@ pf_danger_map_check(struct pf_map *pfm, const char *file,
 #define PF_DANGER_MAP(pfm) ((struct pf_danger_map *) (pfm))
 #endif /* PF_DEBUG */
 
+/************************************************************************//**
+  Returns the node at 'tindex'. Nodes left in the lattice by a previous map
+  are cleared first.
+****************************************************************************/
+static inline struct pf_danger_node *
+pf_danger_map_node(const struct pf_danger_map *pfdm, int tindex)
+{
+  struct pf_danger_node *node = pfdm->lattice + tindex;
+
+  if (node->generation != pfdm->plattice->generation) {
+    memset(node, 0, sizeof(*node));
+    node->generation = pfdm->plattice->generation;
+  }
+
+  return node;
+}
+
 /* ===============  Specific pf_danger_* mode functions ================== */
 
 /************************************************************************//**
@@ -1163,7 +1498,7 @@ static void pf_danger_map_fill_position(const struct pf_danger_map *pfdm,
                                         struct pf_position *pos)
 {
   int tindex = tile_index(ptile);
-  struct pf_danger_node *node = pfdm->lattice + tindex;
+  struct pf_danger_node *node = pf_danger_map_node(pfdm, tindex);
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfdm));
 
 #ifdef PF_DEBUG
@@ -1221,7 +1556,7 @@ pf_danger_map_construct_path(const struct pf_danger_map *pfdm,
   enum direction8 dir_next = direction8_invalid();
   struct pf_danger_pos *danger_seg = NULL;
   bool waited = FALSE;
-  struct pf_danger_node *node = pfdm->lattice + tile_index(ptile);
+  struct pf_danger_node *node = pf_danger_map_node(pfdm, tile_index(ptile));
   unsigned length = 1;
   struct tile *iter_tile = ptile;
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfdm));
@@ -1258,7 +1593,7 @@ pf_danger_map_construct_path(const struct pf_danger_map *pfdm,
 
     /* Step backward. */
     iter_tile = mapstep(params->map, iter_tile, DIR_REVERSE(dir_next));
-    node = pfdm->lattice + tile_index(iter_tile);
+    node = pf_danger_map_node(pfdm, tile_index(iter_tile));
   }
 
   /* Allocate memory for path. */
@@ -1267,7 +1602,7 @@ pf_danger_map_construct_path(const struct pf_danger_map *pfdm,
 
   /* Reset variables for main iteration. */
   iter_tile = ptile;
-  node = pfdm->lattice + tile_index(ptile);
+  node = pf_danger_map_node(pfdm, tile_index(ptile));
   danger_seg = NULL;
   waited = FALSE;
 
@@ -1349,7 +1684,7 @@ pf_danger_map_construct_path(const struct pf_danger_map *pfdm,
 
     /* 5: Step further back. */
     iter_tile = mapstep(params->map, iter_tile, DIR_REVERSE(dir_next));
-    node = pfdm->lattice + tile_index(iter_tile);
+    node = pf_danger_map_node(pfdm, tile_index(iter_tile));
   }
 
   fc_assert_msg(FALSE, "Cannot get to the starting point!");
@@ -1378,7 +1713,7 @@ static void pf_danger_map_create_segment(struct pf_danger_map *pfdm,
                                          struct pf_danger_node *node1)
 {
   struct tile *ptile = PF_MAP(pfdm)->tile;
-  struct pf_danger_node *node = pfdm->lattice + tile_index(ptile);
+  struct pf_danger_node *node = pf_danger_map_node(pfdm, tile_index(ptile));
   struct pf_danger_pos *pos;
   unsigned length = 0;
   unsigned i;
@@ -1394,15 +1729,16 @@ static void pf_danger_map_create_segment(struct pf_danger_map *pfdm,
   while (node->is_dangerous && direction8_is_valid(node->dir_to_here)) {
     length++;
     ptile = mapstep(params->map, ptile, DIR_REVERSE(node->dir_to_here));
-    node = pfdm->lattice + tile_index(ptile);
+    node = pf_danger_map_node(pfdm, tile_index(ptile));
   }
 
   /* Allocate memory for segment */
   node1->danger_segment = fc_malloc(length * sizeof(struct pf_danger_pos));
+  PF_MAP(pfdm)->memory += length * sizeof(struct pf_danger_pos);
 
   /* Reset tile and node pointers for main iteration */
   ptile = PF_MAP(pfdm)->tile;
-  node = pfdm->lattice + tile_index(ptile);
+  node = pf_danger_map_node(pfdm, tile_index(ptile));
 
   /* Now fill the positions */
   for (i = 0, pos = node1->danger_segment; i < length; i++, pos++) {
@@ -1417,7 +1753,7 @@ static void pf_danger_map_create_segment(struct pf_danger_map *pfdm,
 
     /* Step further down the tree */
     ptile = mapstep(params->map, ptile, DIR_REVERSE(node->dir_to_here));
-    node = pfdm->lattice + tile_index(ptile);
+    node = pf_danger_map_node(pfdm, tile_index(ptile));
   }
 
 #ifdef PF_DEBUG
@@ -1450,6 +1786,62 @@ pf_danger_map_adjust_cost(const struct pf_parameter *params,
   }
 }
 
+/************************************************************************//**
+  Get the next dangerous node (the index with the lowest cost). The queue
+  may contain outdated entries for nodes reached since with more moves
+  left, they are skipped. Returns FALSE if there are no more nodes.
+****************************************************************************/
+static inline bool pf_danger_map_remove_dangerous(struct pf_danger_map *pfdm,
+                                                  int *ptindex)
+{
+  const struct pf_danger_node *node;
+  int priority;
+
+  while (map_index_bq_remove(pfdm->danger_queue, ptindex, &priority)) {
+    node = pf_danger_map_node(pfdm, *ptindex);
+    if (NS_NEW == node->status && priority == node->cost) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Get the next safe node (the index with the lowest total cost). The queue
+  may contain outdated entries for nodes which have been processed already
+  or reached since by a better route, they are skipped. Returns FALSE if
+  there are no more nodes.
+****************************************************************************/
+static inline bool pf_danger_map_remove_safe(struct pf_danger_map *pfdm,
+                                             int *ptindex)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pfdm));
+  const struct pf_danger_node *node;
+  int priority;
+
+  while (map_index_bq_remove(pfdm->queue, ptindex, &priority)) {
+    node = pf_danger_map_node(pfdm, *ptindex);
+    if (NS_NEW == node->status) {
+      if (!node->is_dangerous
+          && priority == pf_total_CC(params, node->cost,
+                                     node->extra_cost)) {
+        return TRUE;
+      }
+    } else if (NS_WAITING == node->status) {
+      if (priority
+          == pf_total_CC(params,
+                         pf_danger_map_fill_cost_for_full_moves(params,
+                                                                node->cost),
+                         node->extra_cost)) {
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
 /************************************************************************//**
   Primary method for iterative path-finding in presence of danger
   Notes:
@@ -1494,7 +1886,7 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
   const struct pf_parameter *const params = pf_map_parameter(pfm);
   struct tile *tile = pfm->tile;
   int tindex = tile_index(tile);
-  struct pf_danger_node *node = pfdm->lattice + tindex;
+  struct pf_danger_node *node = pf_danger_map_node(pfdm, tindex);
   enum pf_move_scope scope = node->move_scope;
 
   /* The previous position is defined by 'tile' (tile pointer), 'node'
@@ -1535,7 +1927,7 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
         /* Calculate the cost of every adjacent position and set them in
          * the priority queues for next call to pf_danger_map_iterate(). */
         int tindex1 = tile_index(tile1);
-        struct pf_danger_node *node1 = pfdm->lattice + tindex1;
+        struct pf_danger_node *node1 = pf_danger_map_node(pfdm, tindex1);
         int cost;
         int extra = 0;
 
@@ -1588,7 +1980,7 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
           cost = params->utype->unknown_move_cost;
         } else {
           cost = params->get_MC(tile, scope, tile1, node1->move_scope,
-                                params);
+                                dir, params);
         }
         if (cost == PF_IMPOSSIBLE_MC) {
           continue;
@@ -1637,15 +2029,13 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
               /* Maybe clear previously "waited" status of the node. */
               node1->waited = FALSE;
             }
-            if (NS_INIT == node1->status) {
-              node1->status = NS_NEW;
-              map_index_pq_insert(pfdm->queue, tindex1, -cost_of_path);
-            } else {
 #ifdef PF_DEBUG
-              fc_assert(NS_NEW == node1->status);
+            fc_assert(NS_INIT == node1->status || NS_NEW == node1->status);
 #endif
-              map_index_pq_replace(pfdm->queue, tindex1, -cost_of_path);
-            }
+            /* The outdated entry will be skipped by
+             * pf_danger_map_remove_safe(). */
+            node1->status = NS_NEW;
+            map_index_bq_insert(pfdm->queue, tindex1, cost_of_path);
           }
         } else {
           /* The procedure is slightly different for dangerous nodes.
@@ -1662,7 +2052,7 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
             node1->status = NS_NEW;
             node1->waited = (node->status == NS_WAITING);
             /* Extra costs of all nodes in danger_queue are equal! */
-            map_index_pq_insert(pfdm->danger_queue, tindex1, -cost);
+            map_index_bq_insert(pfdm->danger_queue, tindex1, cost);
           } else if ((pf_moves_left(params, cost)
                       > pf_moves_left(params, node1->cost))
                      || (node1->status == NS_PROCESSED
@@ -1675,8 +2065,10 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
             node1->dir_to_here = dir;
             node1->status = NS_NEW;
             node1->waited = (node->status == NS_WAITING);
-            /* Extra costs of all nodes in danger_queue are equal! */
-            map_index_pq_replace(pfdm->danger_queue, tindex1, -cost);
+            /* Extra costs of all nodes in danger_queue are equal! The
+             * outdated entry will be skipped by
+             * pf_danger_map_remove_dangerous(). */
+            map_index_bq_insert(pfdm->danger_queue, tindex1, cost);
           }
         }
       } adjc_dir_iterate_end;
@@ -1697,31 +2089,29 @@ static bool pf_danger_map_iterate(struct pf_map *pfm)
       fc = pf_danger_map_fill_cost_for_full_moves(params, node->cost);
       cc = pf_total_CC(params, fc, node->extra_cost);
       node->status = NS_WAITING;
-      map_index_pq_insert(pfdm->queue, tindex, -cc);
+      map_index_bq_insert(pfdm->queue, tindex, cc);
     }
 
-    /* Get the next node (the index with the highest priority). First try
+    /* Get the next node (the index with the lowest priority). First try
      * to get it from danger_queue. */
-    if (map_index_pq_remove(pfdm->danger_queue, &tindex)) {
+    if (pf_danger_map_remove_dangerous(pfdm, &tindex)) {
       /* Change the pf_map iterator and reset data. */
       tile = index_to_tile(params->map, tindex);
       pfm->tile = tile;
-      node = pfdm->lattice + tindex;
+      node = pf_danger_map_node(pfdm, tindex);
+      pfm->expanded++;
     } else {
       /* No dangerous nodes to process, go for a safe one. */
-      if (!map_index_pq_remove(pfdm->queue, &tindex)) {
+      if (!pf_danger_map_remove_safe(pfdm, &tindex)) {
         /* No more indexes in the priority queue, iteration end. */
         return FALSE;
       }
-
-#ifdef PF_DEBUG
-      fc_assert(NS_PROCESSED != pfdm->lattice[tindex].status);
-#endif
+      pfm->expanded++;
 
       /* Change the pf_map iterator and reset data. */
       tile = index_to_tile(params->map, tindex);
       pfm->tile = tile;
-      node = pfdm->lattice + tindex;
+      node = pf_danger_map_node(pfdm, tindex);
       if (NS_WAITING != node->status) {
         /* Node status step C. and D. */
 #ifdef PF_DEBUG
@@ -1758,7 +2148,7 @@ static inline bool pf_danger_map_iterate_until(struct pf_danger_map *pfdm,
                                                struct tile *ptile)
 {
   struct pf_map *pfm = PF_MAP(pfdm);
-  struct pf_danger_node *node = pfdm->lattice + tile_index(ptile);
+  struct pf_danger_node *node = pf_danger_map_node(pfdm, tile_index(ptile));
 
   /* Start position is handled in every function calling this function. */
 
@@ -1797,7 +2187,7 @@ static int pf_danger_map_move_cost(struct pf_map *pfm, struct tile *ptile)
   if (ptile == pfm->params.start_tile) {
     return 0;
   } else if (pf_danger_map_iterate_until(pfdm, ptile)) {
-    return (pfdm->lattice[tile_index(ptile)].cost
+    return (pf_danger_map_node(pfdm, tile_index(ptile))->cost
             - pf_move_rate(pf_map_parameter(pfm))
             + pf_moves_left_initially(pf_map_parameter(pfm)));
   } else {
@@ -1855,13 +2245,18 @@ static void pf_danger_map_destroy(struct pf_map *pfm)
 
   /* Need to clean up the dangling danger segments. */
   for (i = 0, node = pfdm->lattice; i < MAP_INDEX_SIZE; i++, node++) {
-    if (node->danger_segment) {
+    if (node->generation == pfdm->plattice->generation
+        && node->danger_segment) {
       free(node->danger_segment);
     }
   }
-  free(pfdm->lattice);
-  map_index_pq_destroy(pfdm->queue);
-  map_index_pq_destroy(pfdm->danger_queue);
+  pf_map_stats_record(&stats.danger, pfm, sizeof(*pfdm)
+                      + pfdm->plattice->size * pfdm->plattice->node_size
+                      + map_index_bq_memory(pfdm->queue)
+                      + map_index_bq_memory(pfdm->danger_queue));
+  pf_lattice_release(pfdm->plattice);
+  map_index_bq_destroy(pfdm->queue);
+  map_index_bq_destroy(pfdm->danger_queue);
   free(pfdm);
 }
 
@@ -1882,11 +2277,15 @@ static struct pf_map *pf_danger_map_new(const struct pf_parameter *parameter)
   /* Set the mode, used for cast check. */
   base_map->mode = PF_DANGER;
 #endif /* PF_DEBUG */
+  base_map->centry = NULL;
+  base_map->memory = 0;
+  base_map->expanded = 0;
 
   /* Allocate the map. */
-  pfdm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_danger_node));
-  pfdm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
-  pfdm->danger_queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pfdm->plattice = pf_lattice_get(sizeof(struct pf_danger_node));
+  pfdm->lattice = pfdm->plattice->nodes;
+  pfdm->queue = map_index_bq_new(INITIAL_QUEUE_SIZE);
+  pfdm->danger_queue = map_index_bq_new(INITIAL_QUEUE_SIZE);
 
   /* 'get_MC' callback must be set. */
   fc_assert_ret_val(parameter->get_MC != NULL, NULL);
@@ -1908,7 +2307,7 @@ static struct pf_map *pf_danger_map_new(const struct pf_parameter *parameter)
   base_map->iterate = pf_danger_map_iterate;
 
   /* Initialise starting node. */
-  node = pfdm->lattice + tile_index(params->start_tile);
+  node = pf_danger_map_node(pfdm, tile_index(params->start_tile));
   if (!pf_danger_node_init(pfdm, node, params->start_tile, PF_MS_NONE)) {
     /* Always fails. */
     fc_assert(pf_danger_node_init(pfdm, node, params->start_tile,
@@ -1931,6 +2330,8 @@ static struct pf_map *pf_danger_map_new(const struct pf_parameter *parameter)
   node->dir_to_here = direction8_invalid();
   node->status = (node->is_dangerous ? NS_NEW : NS_PROCESSED);
 
+  stats.danger.maps++;
+
   return PF_MAP(pfdm);
 }
 
@@ -1973,6 +2374,7 @@ struct pf_fuel_node {
                                  * FIXME: this is right only for units with
                                  * constant move costs! */
   unsigned short extra_tile;    /* EC */
+  unsigned short generation;    /* See struct pf_lattice. */
   unsigned short cost_to_here[DIR8_MAGIC_MAX]; /* Step cost[dir to here] */
 
   /* Segment leading across the danger area back to the nearest safe node:
@@ -1994,16 +2396,30 @@ struct pf_fuel_pos {
   struct pf_fuel_pos *prev;
 };
 
+/* The fuel positions are allocated by blocks, and released all together
+ * with the map. */
+#define PF_FUEL_POS_BLOCK_SIZE 256
+struct pf_fuel_pos_block {
+  struct pf_fuel_pos_block *next;
+  struct pf_fuel_pos pos[PF_FUEL_POS_BLOCK_SIZE];
+};
+
 /* Derived structure of struct pf_map. */
 struct pf_fuel_map {
   struct pf_map base_map;       /* Base structure, must be the first! */
 
-  struct map_index_pq *queue;   /* Queue of nodes we have reached but not
+  struct map_index_bq *queue;   /* Queue of nodes we have reached but not
                                  * processed yet (NS_NEW), sorted by their
                                  * total_CC */
-  struct map_index_pq *waited_queue; /* Queue of nodes to reach farer
+  struct map_index_bq *waited_queue; /* Queue of nodes to reach farer
                                       * positions after having refueled. */
-  struct pf_fuel_node *lattice; /* Lattice of nodes */
+  struct pf_lattice *plattice;  /* Lattice of nodes, from the pool. */
+  struct pf_fuel_node *lattice; /* Nodes of 'plattice'. */
+
+  /* Storage of the fuel positions. */
+  struct pf_fuel_pos_block *pos_blocks; /* Allocated blocks. */
+  int pos_used;                 /* Positions used in the first block. */
+  struct pf_fuel_pos *pos_free; /* Released positions, linked by 'prev'. */
 };
 
 /* Up-cast macro. */
@@ -2023,6 +2439,23 @@ pf_fuel_map_check(struct pf_map *pfm, const char *file,
 #define PF_FUEL_MAP(pfm) ((struct pf_fuel_map *) (pfm))
 #endif /* PF_DEBUG */
 
+/************************************************************************//**
+  Returns the node at 'tindex'. Nodes left in the lattice by a previous map
+  are cleared first.
+****************************************************************************/
+static inline struct pf_fuel_node *
+pf_fuel_map_node(const struct pf_fuel_map *pffm, int tindex)
+{
+  struct pf_fuel_node *node = pffm->lattice + tindex;
+
+  if (node->generation != pffm->plattice->generation) {
+    memset(node, 0, sizeof(*node));
+    node->generation = pffm->plattice->generation;
+  }
+
+  return node;
+}
+
 /* =================  Specific pf_fuel_* mode functions ================== */
 
 /************************************************************************//**
@@ -2242,15 +2675,43 @@ static inline struct pf_fuel_pos *pf_fuel_pos_ref(struct pf_fuel_pos *pos)
 }
 
 /************************************************************************//**
-  Forget how we went to position. Maybe destroy the position, and previous
+  Get a new position from the storage of the map.
+****************************************************************************/
+static inline struct pf_fuel_pos *pf_fuel_pos_new(struct pf_fuel_map *pffm)
+{
+  struct pf_fuel_pos *pos = pffm->pos_free;
+
+  if (NULL != pos) {
+    pffm->pos_free = pos->prev;
+  } else {
+    if (PF_FUEL_POS_BLOCK_SIZE <= pffm->pos_used) {
+      struct pf_fuel_pos_block *pblock = fc_malloc(sizeof(*pblock));
+
+      PF_MAP(pffm)->memory += sizeof(*pblock);
+
+      pblock->next = pffm->pos_blocks;
+      pffm->pos_blocks = pblock;
+      pffm->pos_used = 0;
+    }
+    pos = pffm->pos_blocks->pos + pffm->pos_used++;
+  }
+  pos->ref_count = 1;
+
+  return pos;
+}
+
+/************************************************************************//**
+  Forget how we went to position. Maybe release the position, and previous
   ones.
 ****************************************************************************/
-static inline void pf_fuel_pos_unref(struct pf_fuel_pos *pos)
+static inline void pf_fuel_pos_unref(struct pf_fuel_map *pffm,
+                                     struct pf_fuel_pos *pos)
 {
   while (NULL != pos && 0 == --pos->ref_count) {
     struct pf_fuel_pos *prev = pos->prev;
 
-    free(pos);
+    pos->prev = pffm->pos_free;
+    pffm->pos_free = pos;
     pos = prev;
   }
 }
@@ -2259,23 +2720,22 @@ static inline void pf_fuel_pos_unref(struct pf_fuel_pos *pos)
   Replace the position. Reference count of the old pos is reduced by one,
   but it likely lives on via other references.
   If reference count goes to zero, re-use the memory instead of
-  freeing and allocating again.
+  releasing and getting a new one.
 ****************************************************************************/
 static inline struct pf_fuel_pos *
-pf_fuel_pos_replace(struct pf_fuel_pos *pos, const struct pf_fuel_node *node)
+pf_fuel_pos_replace(struct pf_fuel_map *pffm, struct pf_fuel_pos *pos,
+                    const struct pf_fuel_node *node)
 {
   if (NULL == pos) {
-    pos = fc_malloc(sizeof(*pos));
-    pos->ref_count = 1;
+    pos = pf_fuel_pos_new(pffm);
   } else if (1 < pos->ref_count) {
     pos->ref_count--;
-    pos = fc_malloc(sizeof(*pos));
-    pos->ref_count = 1;
+    pos = pf_fuel_pos_new(pffm);
   } else {
 #ifdef PF_DEBUG
     fc_assert(1 == pos->ref_count);
 #endif
-    pf_fuel_pos_unref(pos->prev);
+    pf_fuel_pos_unref(pffm, pos->prev);
   }
   pos->cost = node->cost;
   pos->extra_cost = node->extra_cost;
@@ -2336,7 +2796,7 @@ static void pf_fuel_map_fill_position(const struct pf_fuel_map *pffm,
                                       struct pf_position *pos)
 {
   int tindex = tile_index(ptile);
-  struct pf_fuel_node *node = pffm->lattice + tindex;
+  struct pf_fuel_node *node = pf_fuel_map_node(pffm, tindex);
   struct pf_fuel_pos *head = node->segment;
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pffm));
 
@@ -2378,7 +2838,7 @@ pf_fuel_map_construct_path(const struct pf_fuel_map *pffm,
 {
   struct pf_path *path = fc_malloc(sizeof(*path));
   enum direction8 dir_next = direction8_invalid();
-  struct pf_fuel_node *node = pffm->lattice + tile_index(ptile);
+  struct pf_fuel_node *node = pf_fuel_map_node(pffm, tile_index(ptile));
   struct pf_fuel_pos *segment = node->segment;
   unsigned length = 1;
   struct tile *iter_tile = ptile;
@@ -2411,7 +2871,7 @@ pf_fuel_map_construct_path(const struct pf_fuel_map *pffm,
     /* Step backward. */
     iter_tile = mapstep(params->map, iter_tile,
                         DIR_REVERSE(segment->dir_to_here));
-    node = pffm->lattice + tile_index(iter_tile);
+    node = pf_fuel_map_node(pffm, tile_index(iter_tile));
     segment = segment->prev;
 #ifdef PF_DEBUG
     fc_assert(NULL != segment);
@@ -2428,7 +2888,7 @@ pf_fuel_map_construct_path(const struct pf_fuel_map *pffm,
 
   /* Reset variables for main iteration. */
   iter_tile = ptile;
-  node = pffm->lattice + tile_index(ptile);
+  node = pf_fuel_map_node(pffm, tile_index(ptile));
   segment = node->segment;
 
   for (i = length - 1; i >= 0; i--) {
@@ -2481,7 +2941,7 @@ pf_fuel_map_construct_path(const struct pf_fuel_map *pffm,
 
     /* 5: Step further back. */
     iter_tile = mapstep(params->map, iter_tile, DIR_REVERSE(dir_next));
-    node = pffm->lattice + tile_index(iter_tile);
+    node = pf_fuel_map_node(pffm, tile_index(iter_tile));
     segment = segment->prev;
 #ifdef PF_DEBUG
     fc_assert(NULL != segment);
@@ -2516,14 +2976,14 @@ static inline void pf_fuel_map_create_segment(struct pf_fuel_map *pffm,
   struct pf_fuel_pos *pos, *next;
   const struct pf_parameter *params = pf_map_parameter(PF_MAP(pffm));
 
-  pos = pf_fuel_pos_replace(node->pos, node);
+  pos = pf_fuel_pos_replace(pffm, node->pos, node);
   node->pos = pos;
 
   /* Iterate until we reach any built segment. */
   do {
     next = pos;
     ptile = mapstep(params->map, ptile, DIR_REVERSE(node->dir_to_here));
-    node = pffm->lattice + tile_index(ptile);
+    node = pf_fuel_map_node(pffm, tile_index(ptile));
     pos = node->pos;
     if (NULL != pos) {
       if (pos->cost == node->cost
@@ -2536,7 +2996,7 @@ static inline void pf_fuel_map_create_segment(struct pf_fuel_map *pffm,
       }
     }
     /* Update position. */
-    pos = pf_fuel_pos_replace(pos, node);
+    pos = pf_fuel_pos_replace(pffm, pos, node);
     node->pos = pos;
     next->prev = pf_fuel_pos_ref(pos);
   } while (0 != node->moves_left_req && direction8_is_valid(node->dir_to_here));
@@ -2593,6 +3053,52 @@ pf_fuel_map_attack_is_possible(const struct pf_parameter *param,
   }
 }
 
+/************************************************************************//**
+  Returns TRUE if the entry of the main queue with 'priority' for 'node' is
+  not outdated.
+****************************************************************************/
+static inline bool pf_fuel_map_entry_valid(const struct pf_parameter *params,
+                                           const struct pf_fuel_node *node,
+                                           int priority)
+{
+  if (NS_NEW == node->status) {
+    return (priority
+            == pf_fuel_total_CC(params, node->cost, node->extra_cost,
+                                node->moves_left - node->moves_left_req));
+  } else if (NS_WAITING == node->status) {
+    return (priority
+            == pf_fuel_waited_total_CC
+                   (pf_fuel_map_fill_cost_for_full_moves(params, node->cost,
+                                                         node->moves_left),
+                    pf_move_rate(params)));
+  }
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Drop the outdated entries at the top of the main queue, and set the
+  priority of the next valid one in 'ppriority'. Returns FALSE if the main
+  queue is empty.
+****************************************************************************/
+static inline bool pf_fuel_map_queue_priority(struct pf_fuel_map *pffm,
+                                              int *ppriority)
+{
+  const struct pf_parameter *params = pf_map_parameter(PF_MAP(pffm));
+  int tindex;
+
+  while (map_index_bq_peek(pffm->queue, &tindex)) {
+    map_index_bq_priority(pffm->queue, ppriority);
+    if (pf_fuel_map_entry_valid(params, pf_fuel_map_node(pffm, tindex),
+                                *ppriority)) {
+      return TRUE;
+    }
+    map_index_bq_remove(pffm->queue, NULL, NULL);
+  }
+
+  return FALSE;
+}
+
 /************************************************************************//**
   Primary method for iterative path-finding for fuel units.
   Notes:
@@ -2601,10 +3107,10 @@ pf_fuel_map_attack_is_possible(const struct pf_parameter *param,
      to register every path to any tile from a refuel point or the start tile
      (see comment for pf_fuel_map_create_segment()).
   2. Waiting is realised by inserting the refuel point back into the main
-     queue with a lower priority P. Because this tile might pop back sooner
-     than P, because there might be several copies of it in the queue already,
-     we *must* delete all these copies, to preserve the priority of the
-     process.
+     queue with a lower priority P. Because there might be several copies
+     of it in the queue already, which would pop back sooner than P, all
+     the outdated entries are skipped (see pf_fuel_map_entry_valid()), to
+     preserve the priority of the process.
   3. For some purposes, NS_WAITING is just another flavour of NS_PROCESSED,
      since the path to a NS_WAITING tile has already been found.
   4. This algorithm cannot guarantee the best safe segments across dangerous
@@ -2634,9 +3140,9 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
   const struct pf_parameter *const params = pf_map_parameter(pfm);
   struct tile *tile = pfm->tile;
   int tindex = tile_index(tile);
-  struct pf_fuel_node *node = pffm->lattice + tindex;
+  struct pf_fuel_node *node = pf_fuel_map_node(pffm, tindex);
   enum pf_move_scope scope = node->move_scope;
-  int priority, waited_priority;
+  int priority = 0, waited_priority;
   bool waited = FALSE;
 
   /* The previous position is defined by 'tile' (tile pointer), 'node'
@@ -2680,7 +3186,7 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
         /* Calculate the cost of every adjacent position and set them in
          * the priority queues for next call to pf_fuel_map_iterate(). */
         int tindex1 = tile_index(tile1);
-        struct pf_fuel_node *node1 = pffm->lattice + tindex1;
+        struct pf_fuel_node *node1 = pf_fuel_map_node(pffm, tindex1);
         int cost, extra = 0;
         int moves_left;
         int cost_of_path, old_cost_of_path;
@@ -2740,7 +3246,7 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
             cost = params->utype->unknown_move_cost;
           } else {
             cost = params->get_MC(tile, scope, tile1, node1->move_scope,
-                                  params);
+                                  dir, params);
           }
 
           if (cost == FC_INFINITY) {
@@ -2830,19 +3336,10 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
           /* Always record the segment, including when it is not dangerous
            * to move there. */
           pf_fuel_map_create_segment(pffm, tile1, node1);
-          if (NS_INIT == node1->status) {
-            /* Node status B. to C. */
-            node1->status = NS_NEW;
-            map_index_pq_insert(pffm->queue, tindex1, -cost_of_path);
-          } else {
-            /* else staying at D. */
-#ifdef PF_DEBUG
-            fc_assert(NS_NEW == node1->status);
-#endif
-            if (cost_of_path < old_cost_of_path) {
-              map_index_pq_replace(pffm->queue, tindex1, -cost_of_path);
-            }
-          }
+          /* Node status B. to C., else staying at C. The outdated entry
+           * will be skipped. */
+          node1->status = NS_NEW;
+          map_index_bq_insert(pffm->queue, tindex1, cost_of_path);
           continue;     /* adjc_dir_iterate() */
         }
 
@@ -2874,8 +3371,8 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
           node1->cost = cost;
           node1->moves_left = moves_left;
           node1->dir_to_here = dir;
-          map_index_pq_insert(pffm->waited_queue, tindex1,
-                              -pf_fuel_waited_total_CC(cost,
+          map_index_bq_insert(pffm->waited_queue, tindex1,
+                              pf_fuel_waited_total_CC(cost,
                                   moves_left - node1->moves_left_req));
         }
       } adjc_dir_iterate_end;
@@ -2901,20 +3398,20 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
       /* The values we use now to calculate waited total_CC
        * will be applied to the node after we get it back from the queue
        * to get passing-by segments before it without waiting */
-      map_index_pq_insert(pffm->queue, tindex,
-                          -pf_fuel_waited_total_CC
+      map_index_bq_insert(pffm->queue, tindex,
+                          pf_fuel_waited_total_CC
                           (pf_fuel_map_fill_cost_for_full_moves(params,
                                                                 node->cost,
                                                                 node->moves_left),
                            pf_move_rate(params)));
     }
 
-    /* Get the next node (the index with the highest priority). First try
+    /* Get the next node (the index with the lowest priority). First try
      * to get it from waited_queue. */
-    if (!map_index_pq_priority(pffm->queue, &priority)
-        || (map_index_pq_priority(pffm->waited_queue, &waited_priority)
-            && priority < waited_priority)) {
-      if (!map_index_pq_remove(pffm->waited_queue, &tindex)) {
+    if (!pf_fuel_map_queue_priority(pffm, &priority)
+        || (map_index_bq_priority(pffm->waited_queue, &waited_priority)
+            && waited_priority < priority)) {
+      if (!map_index_bq_remove(pffm->waited_queue, &tindex, NULL)) {
         /* End of the iteration. */
         return FALSE;
       }
@@ -2922,8 +3419,9 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
       /* Change the pf_map iterator and reset data. */
       tile = index_to_tile(params->map, tindex);
       pfm->tile = tile;
-      node = pffm->lattice + tindex;
+      node = pf_fuel_map_node(pffm, tindex);
       waited = TRUE;
+      pfm->expanded++;
 #ifdef PF_DEBUG
       fc_assert(0 < node->moves_left_req);
       fc_assert(NS_PROCESSED == node->status);
@@ -2933,17 +3431,18 @@ static bool pf_fuel_map_iterate(struct pf_map *pfm)
 #ifndef FREECIV_NDEBUG
       bool success =
 #endif
-        map_index_pq_remove(pffm->queue, &tindex);
+        map_index_bq_remove(pffm->queue, &tindex, NULL);
 
       fc_assert(success);
 #else
-      map_index_pq_remove(pffm->queue, &tindex);
+      map_index_bq_remove(pffm->queue, &tindex, NULL);
 #endif
 
       /* Change the pf_map iterator and reset data. */
       tile = index_to_tile(params->map, tindex);
       pfm->tile = tile;
-      node = pffm->lattice + tindex;
+      node = pf_fuel_map_node(pffm, tindex);
+      pfm->expanded++;
 
 #ifdef PF_DEBUG
       fc_assert(NS_PROCESSED != node->status);
@@ -2992,7 +3491,7 @@ static inline bool pf_fuel_map_iterate_until(struct pf_fuel_map *pffm,
                                              struct tile *ptile)
 {
   struct pf_map *pfm = PF_MAP(pffm);
-  struct pf_fuel_node *node = pffm->lattice + tile_index(ptile);
+  struct pf_fuel_node *node = pf_fuel_map_node(pffm, tile_index(ptile));
 
   /* Start position is handled in every function calling this function. */
 
@@ -3030,7 +3529,7 @@ static int pf_fuel_map_move_cost(struct pf_map *pfm, struct tile *ptile)
   if (ptile == pfm->params.start_tile) {
     return 0;
   } else if (pf_fuel_map_iterate_until(pffm, ptile)) {
-    const struct pf_fuel_node *node = pffm->lattice + tile_index(ptile);
+    const struct pf_fuel_node *node = pf_fuel_map_node(pffm, tile_index(ptile));
 
     return (node->segment->cost
             - pf_move_rate(pf_map_parameter(pfm))
@@ -3085,17 +3584,21 @@ static bool pf_fuel_map_position(struct pf_map *pfm, struct tile *ptile,
 static void pf_fuel_map_destroy(struct pf_map *pfm)
 {
   struct pf_fuel_map *pffm = PF_FUEL_MAP(pfm);
-  struct pf_fuel_node *node;
-  int i;
+  struct pf_fuel_pos_block *pblock;
+
+  pf_map_stats_record(&stats.fuel, pfm, sizeof(*pffm)
+                      + pffm->plattice->size * pffm->plattice->node_size
+                      + map_index_bq_memory(pffm->queue)
+                      + map_index_bq_memory(pffm->waited_queue));
 
-  /* Need to clean up the dangling fuel segments. */
-  for (i = 0, node = pffm->lattice; i < MAP_INDEX_SIZE; i++, node++) {
-    pf_fuel_pos_unref(node->pos);
-    pf_fuel_pos_unref(node->segment);
+  /* The fuel segments are all stored in the position blocks. */
+  while (NULL != (pblock = pffm->pos_blocks)) {
+    pffm->pos_blocks = pblock->next;
+    free(pblock);
   }
-  free(pffm->lattice);
-  map_index_pq_destroy(pffm->queue);
-  map_index_pq_destroy(pffm->waited_queue);
+  pf_lattice_release(pffm->plattice);
+  map_index_bq_destroy(pffm->queue);
+  map_index_bq_destroy(pffm->waited_queue);
   free(pffm);
 }
 
@@ -3116,11 +3619,18 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
   /* Set the mode, used for cast check. */
   base_map->mode = PF_FUEL;
 #endif /* PF_DEBUG */
+  base_map->centry = NULL;
+  base_map->memory = 0;
+  base_map->expanded = 0;
 
   /* Allocate the map. */
-  pffm->lattice = fc_calloc(MAP_INDEX_SIZE, sizeof(struct pf_fuel_node));
-  pffm->queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
-  pffm->waited_queue = map_index_pq_new(INITIAL_QUEUE_SIZE);
+  pffm->plattice = pf_lattice_get(sizeof(struct pf_fuel_node));
+  pffm->lattice = pffm->plattice->nodes;
+  pffm->pos_blocks = NULL;
+  pffm->pos_used = PF_FUEL_POS_BLOCK_SIZE;
+  pffm->pos_free = NULL;
+  pffm->queue = map_index_bq_new(INITIAL_QUEUE_SIZE);
+  pffm->waited_queue = map_index_bq_new(INITIAL_QUEUE_SIZE);
 
   /* 'get_MC' callback must be set. */
   fc_assert_ret_val(parameter->get_MC != NULL, NULL);
@@ -3142,7 +3652,7 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
   base_map->iterate = pf_fuel_map_iterate;
 
   /* Initialise starting node. */
-  node = pffm->lattice + tile_index(params->start_tile);
+  node = pf_fuel_map_node(pffm, tile_index(params->start_tile));
   if (!pf_fuel_node_init(pffm, node, params->start_tile, PF_MS_NONE)) {
     /* Always fails. */
     fc_assert(pf_fuel_node_init(pffm, node, params->start_tile,
@@ -3166,15 +3676,393 @@ static struct pf_map *pf_fuel_map_new(const struct pf_parameter *parameter)
   node->dir_to_here = direction8_invalid();
   /* Record a segment. We need it for correct paths. */
   node->segment
-    = pf_fuel_pos_ref(node->pos = pf_fuel_pos_replace(NULL, node));
+    = pf_fuel_pos_ref(node->pos = pf_fuel_pos_replace(pffm, NULL, node));
   node->status = NS_PROCESSED;
 
+  stats.fuel.maps++;
+
   return PF_MAP(pffm);
 }
 
 
+/* ========================= pf_map cache ================================ */
+
+/* The cache keeps the maps created by pf_map_new_cached(), so the same
+ * parameters get the same map again until pf_map_cache_invalidate() is
+ * called. The users get a light pf_cached_map referencing the shared map,
+ * which replays the iteration order recorded in the cache entry, so every
+ * user iterates the map from the start, as if it was new. */
+
+#define PF_MAP_CACHE_SIZE 16    /* Maximum number of shared maps. */
+
+/* A shared map. */
+struct pf_cache_entry {
+  struct pf_map *pfm;           /* The shared map. */
+  struct pf_parameter key;      /* Parameters the map was created with. */
+  genhash_val_t hash;           /* Hash of 'key'. */
+  struct tile **order;          /* Tiles in the order they were iterated. */
+  int order_num;
+  int order_max;
+  int refs;                     /* Number of pf_cached_map using it. */
+  bool stale;                   /* Not in the cache anymore. */
+  unsigned int last_use;        /* For replacement. */
+};
+
+/* Derived structure of struct pf_map. */
+struct pf_cached_map {
+  struct pf_map base_map;       /* Base structure, must be the first! */
+
+  struct pf_cache_entry *entry; /* The shared map. */
+  int cursor;                   /* Current position in 'entry->order'. */
+};
+
+/* Up-cast macro. */
+#ifdef PF_DEBUG
+static inline struct pf_cached_map *
+pf_cached_map_check(struct pf_map *pfm, const char *file,
+                    const char *function, int line)
+{
+  if (pfm->mode != PF_CACHED) {
+    log_error("%s(): %s:%d: This map isn't a pf_cached_map!",
+              function, file, line);
+  }
+  return (struct pf_cached_map *) pfm;
+}
+#define PF_CACHED_MAP(pfm) \
+  pf_cached_map_check(pfm, __FILE__, __FUNCTION__, __FC_LINE__)
+#else
+#define PF_CACHED_MAP(pfm) ((struct pf_cached_map *) (pfm))
+#endif /* PF_DEBUG */
+
+static struct {
+  struct pf_cache_entry *entries[PF_MAP_CACHE_SIZE];
+  unsigned int clock;           /* Incremented at every access. */
+} map_cache;
+
+/* Whether pf_map_new_cached() shares the maps. Magic -1 means not
+ * initialized, see pf_get_map_cache(). */
+static int map_cache_enabled = -1;
+
+/* ========================= pf_map batches ============================== */
+
+/* Default number of threads of pf_map_batch_new(). */
+#define PF_BATCH_THREADS 3
+
+/* A batch of maps being computed, see pf_map_batch_new(). */
+struct pf_batch {
+  struct pf_cache_entry **entries;
+  int max_move_cost;
+};
+
+/* The threads iterating the maps of the batches, created on first use.
+ * Magic -1 for the number of threads means not initialized, see
+ * pf_get_batch_threads(). */
+static struct fc_threadpool *batch_pool = NULL;
+static int batch_threads = -1;
+
+/************************************************************************//**
+  Hash function for the parameters of the cached maps.
+****************************************************************************/
+static genhash_val_t pf_cache_hash_val(const struct pf_parameter *param)
+{
+  return (tile_index(param->start_tile)
+          + (utype_index(param->utype) << 17)
+          + ((genhash_val_t) param->moves_left_initially << 9)
+          + (NULL != param->owner ? player_index(param->owner) << 25 : 0)
+          + (param->omniscience ? 1u << 31 : 0));
+}
+
+/************************************************************************//**
+  Returns whether the maps of the parameters would be the same. All the
+  fields are considered, except the user data, which is never set for the
+  cached maps.
+****************************************************************************/
+static bool pf_cache_param_equal(const struct pf_parameter *param1,
+                                 const struct pf_parameter *param2)
+{
+  return (param1->map == param2->map
+          && param1->start_tile == param2->start_tile
+          && param1->moves_left_initially == param2->moves_left_initially
+          && param1->fuel_left_initially == param2->fuel_left_initially
+          && param1->transported_by_initially
+             == param2->transported_by_initially
+          && param1->cargo_depth == param2->cargo_depth
+          && BV_ARE_EQUAL(param1->cargo_types, param2->cargo_types)
+          && param1->move_rate == param2->move_rate
+          && param1->fuel == param2->fuel
+          && param1->utype == param2->utype
+          && param1->owner == param2->owner
+          && param1->omniscience == param2->omniscience
+          && param1->get_MC == param2->get_MC
+          && param1->get_move_scope == param2->get_move_scope
+          && param1->ignore_none_scopes == param2->ignore_none_scopes
+          && param1->get_TB == param2->get_TB
+          && param1->get_EC == param2->get_EC
+          && param1->get_action == param2->get_action
+          && param1->actions == param2->actions
+          && param1->is_action_possible == param2->is_action_possible
+          && param1->get_zoc == param2->get_zoc
+          && param1->is_pos_dangerous == param2->is_pos_dangerous
+          && param1->get_moves_left_req == param2->get_moves_left_req
+          && param1->get_costs == param2->get_costs);
+}
+
+/************************************************************************//**
+  Record the tile the shared map just iterated.
+****************************************************************************/
+static void pf_cache_entry_record(struct pf_cache_entry *entry,
+                                  struct tile *ptile)
+{
+  if (entry->order_num == entry->order_max) {
+    entry->order_max *= 2;
+    entry->order = fc_realloc(entry->order,
+                              entry->order_max * sizeof(*entry->order));
+  }
+  entry->order[entry->order_num++] = ptile;
+}
+
+/************************************************************************//**
+  Destroy the cache entry and its map.
+****************************************************************************/
+static void pf_cache_entry_destroy(struct pf_cache_entry *entry)
+{
+  entry->pfm->centry = NULL;
+  pf_map_destroy(entry->pfm);
+  free(entry->order);
+  free(entry);
+}
+
+/************************************************************************//**
+  Remove the entry from the cache. It is destroyed when not used anymore.
+****************************************************************************/
+static void pf_cache_entry_drop(struct pf_cache_entry *entry)
+{
+  if (0 == entry->refs) {
+    pf_cache_entry_destroy(entry);
+  } else {
+    entry->stale = TRUE;
+  }
+}
+
+/************************************************************************//**
+  Allocate a cache entry and its map for the parameter.
+****************************************************************************/
+static struct pf_cache_entry *
+pf_cache_entry_alloc(const struct pf_parameter *parameter,
+                     genhash_val_t hash)
+{
+  struct pf_cache_entry *entry = fc_malloc(sizeof(*entry));
+
+  entry->pfm = pf_map_new(parameter);
+  entry->pfm->centry = entry;
+  entry->key = *parameter;
+  entry->hash = hash;
+  entry->order_max = 64;
+  entry->order = fc_malloc(entry->order_max * sizeof(*entry->order));
+  entry->order_num = 0;
+  pf_cache_entry_record(entry, entry->pfm->tile);
+  entry->refs = 0;
+  entry->stale = FALSE;
+  entry->last_use = 0;
+
+  return entry;
+}
+
+/************************************************************************//**
+  Create a cache entry for the parameter, replacing the least recently
+  used unreferenced one if the cache is full. Returns NULL if all the
+  entries are in use.
+****************************************************************************/
+static struct pf_cache_entry *
+pf_cache_entry_new(const struct pf_parameter *parameter, genhash_val_t hash)
+{
+  struct pf_cache_entry *entry;
+  int i, slot = -1;
+
+  for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+    entry = map_cache.entries[i];
+    if (NULL == entry) {
+      slot = i;
+      break;
+    }
+    if (0 == entry->refs
+        && (-1 == slot
+            || entry->last_use < map_cache.entries[slot]->last_use)) {
+      slot = i;
+    }
+  }
+
+  if (-1 == slot) {
+    return NULL;
+  }
+
+  if (NULL != map_cache.entries[slot]) {
+    pf_cache_entry_drop(map_cache.entries[slot]);
+  }
+
+  entry = pf_cache_entry_alloc(parameter, hash);
+  map_cache.entries[slot] = entry;
+
+  return entry;
+}
+
+/************************************************************************//**
+  Return the move cost at ptile, from the shared map.
+****************************************************************************/
+static int pf_cached_map_get_move_cost(struct pf_map *pfm,
+                                       struct tile *ptile)
+{
+  return pf_map_move_cost(PF_CACHED_MAP(pfm)->entry->pfm, ptile);
+}
+
+/************************************************************************//**
+  Return the path to ptile, from the shared map.
+****************************************************************************/
+static struct pf_path *pf_cached_map_path(struct pf_map *pfm,
+                                          struct tile *ptile)
+{
+  return pf_map_path(PF_CACHED_MAP(pfm)->entry->pfm, ptile);
+}
+
+/************************************************************************//**
+  Get info about position at ptile, from the shared map.
+****************************************************************************/
+static bool pf_cached_map_position(struct pf_map *pfm, struct tile *ptile,
+                                   struct pf_position *pos)
+{
+  return pf_map_position(PF_CACHED_MAP(pfm)->entry->pfm, ptile, pos);
+}
+
+/************************************************************************//**
+  Go to the next tile of the recorded order, iterating the shared map
+  further when the end of the record is reached.
+****************************************************************************/
+static bool pf_cached_map_iterate(struct pf_map *pfm)
+{
+  struct pf_cached_map *pfcm = PF_CACHED_MAP(pfm);
+  struct pf_cache_entry *entry = pfcm->entry;
+
+  if (pfcm->cursor + 1 >= entry->order_num
+      && !pf_map_iterate(entry->pfm)) {
+    return FALSE;
+  }
+
+  pfcm->cursor++;
+  pfm->tile = entry->order[pfcm->cursor];
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  'pf_cached_map' destructor. The shared map is kept in the cache.
+****************************************************************************/
+static void pf_cached_map_destroy(struct pf_map *pfm)
+{
+  struct pf_cache_entry *entry = PF_CACHED_MAP(pfm)->entry;
+
+  entry->refs--;
+  if (entry->stale && 0 == entry->refs) {
+    pf_cache_entry_destroy(entry);
+  }
+  free(pfm);
+}
+
+/************************************************************************//**
+  'pf_cached_map' constructor.
+****************************************************************************/
+static struct pf_map *pf_cached_map_new(struct pf_cache_entry *entry)
+{
+  struct pf_cached_map *pfcm = fc_malloc(sizeof(*pfcm));
+  struct pf_map *base_map = &pfcm->base_map;
+
+#ifdef PF_DEBUG
+  /* Set the mode, used for cast check. */
+  base_map->mode = PF_CACHED;
+#endif /* PF_DEBUG */
+  base_map->centry = NULL;
+  base_map->memory = 0;
+  base_map->expanded = 0;
+
+  base_map->destroy = pf_cached_map_destroy;
+  base_map->get_move_cost = pf_cached_map_get_move_cost;
+  base_map->get_path = pf_cached_map_path;
+  base_map->get_position = pf_cached_map_position;
+  base_map->iterate = pf_cached_map_iterate;
+
+  base_map->params = entry->pfm->params;
+  base_map->tile = entry->order[0];
+
+  pfcm->entry = entry;
+  pfcm->cursor = 0;
+  entry->refs++;
+  entry->last_use = ++map_cache.clock;
+
+  return base_map;
+}
+
+
+/************************************************************************//**
+  Iterate the map of a batch until the move cost limit. Called from any
+  thread of the pool: the map and its record are only accessed from here
+  until the batch is over.
+****************************************************************************/
+static void pf_batch_task(int task, void *data)
+{
+  struct pf_batch *batch = (struct pf_batch *) data;
+  struct pf_map *pfm = batch->entries[task]->pfm;
+
+  while (pf_map_iterate(pfm)) {
+    if (0 <= batch->max_move_cost
+        && pf_map_iter_move_cost(pfm) > batch->max_move_cost) {
+      break;
+    }
+  }
+}
+
+
 /* ====================== pf_map public functions ======================= */
 
+/************************************************************************//**
+  Initialize the path-finding module. Must be called before the maps
+  can share their lattices.
+****************************************************************************/
+void pf_init(void)
+{
+  pf_clusters_init();
+  if (!lattice_pool.initialized) {
+    fc_mutex_init(&lattice_pool.mutex);
+    lattice_pool.free = NULL;
+    lattice_pool.free_count = 0;
+    lattice_pool.initialized = TRUE;
+  }
+}
+
+/************************************************************************//**
+  Free the memory kept by the path-finding module.
+****************************************************************************/
+void pf_free(void)
+{
+  struct pf_lattice *plattice;
+
+  pf_map_cache_invalidate();
+  pf_clusters_free();
+  if (NULL != batch_pool) {
+    fc_threadpool_destroy(batch_pool);
+    batch_pool = NULL;
+  }
+  if (!lattice_pool.initialized) {
+    return;
+  }
+
+  lattice_pool.initialized = FALSE;
+  while (NULL != (plattice = lattice_pool.free)) {
+    lattice_pool.free = plattice->next;
+    pf_lattice_destroy(plattice);
+  }
+  lattice_pool.free_count = 0;
+  fc_mutex_destroy(&lattice_pool.mutex);
+}
+
 /************************************************************************//**
   Factory function to create a new map according to the parameter.
   Does not do any iterations.
@@ -3197,7 +4085,144 @@ struct pf_map *pf_map_new(const struct pf_parameter *parameter)
     return pf_fuel_map_new(parameter);
   }
 
-  return pf_normal_map_new(parameter);
+  return pf_normal_map_new(parameter, NULL);
+}
+
+/************************************************************************//**
+  Factory function to create a new map for finding the path to
+  'goal_tile'. The search is directed towards it when possible, else this
+  is the same as pf_map_new(). Does not do any iterations.
+  The maps can be queried for other tiles too, but pf_map_iterate() does
+  not return the tiles by increasing costs.
+****************************************************************************/
+struct pf_map *pf_map_new_goal(const struct pf_parameter *parameter,
+                               struct tile *goal_tile)
+{
+  if (NULL != parameter->is_pos_dangerous
+      || NULL != parameter->get_moves_left_req) {
+    /* Waiting for full moves or fuel makes costs not monotonic along the
+     * paths, which our lower bound doesn't account for. */
+    return pf_map_new(parameter);
+  }
+
+  return pf_normal_map_new(parameter, goal_tile);
+}
+
+/************************************************************************//**
+  Factory function to get a map shared with the other users of the same
+  parameters, until the next call to pf_map_cache_invalidate(). The map
+  must be destroyed with pf_map_destroy() as usual. Its iteration starts
+  from the start tile, but it is not moved by pf_map_move_cost(),
+  pf_map_path() or pf_map_position() calls. Maps with user data or jumbo
+  callbacks are never shared.
+****************************************************************************/
+struct pf_map *pf_map_new_cached(const struct pf_parameter *parameter)
+{
+  struct pf_cache_entry *entry;
+  genhash_val_t hash;
+  int i;
+
+  if (NULL != parameter->data
+      || NULL != parameter->get_costs
+      || !pf_get_map_cache()) {
+    return pf_map_new(parameter);
+  }
+
+  hash = pf_cache_hash_val(parameter);
+  for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+    entry = map_cache.entries[i];
+    if (NULL != entry && hash == entry->hash
+        && pf_cache_param_equal(parameter, &entry->key)) {
+      stats.cache_hits++;
+      return pf_cached_map_new(entry);
+    }
+  }
+
+  stats.cache_misses++;
+  entry = pf_cache_entry_new(parameter, hash);
+
+  return (NULL != entry ? pf_cached_map_new(entry) : pf_map_new(parameter));
+}
+
+/************************************************************************//**
+  Forget the shared maps. Must be called when anything the maps depend on
+  changes, e.g. units, terrain, borders or diplomatic states. The maps
+  still in use are destroyed when their last user is done.
+****************************************************************************/
+void pf_map_cache_invalidate(void)
+{
+  int i;
+
+  for (i = 0; i < PF_MAP_CACHE_SIZE; i++) {
+    if (NULL != map_cache.entries[i]) {
+      pf_cache_entry_drop(map_cache.entries[i]);
+      map_cache.entries[i] = NULL;
+    }
+  }
+}
+
+/************************************************************************//**
+  Create the maps of all the parameters at once, and iterate them until
+  the move cost exceeds 'max_move_cost' (over the whole map if negative).
+  The maps of the parameters flagged 'thread_safe' are computed
+  concurrently by the threads of the pool. The maps are put in 'maps',
+  and behave like the ones of pf_map_new_cached(), without being shared:
+  their iteration starts from the start tile whatever was precomputed,
+  and they must be destroyed with pf_map_destroy(). Like any map, they are
+  only valid until the game state they were computed from changes.
+****************************************************************************/
+void pf_map_batch_new(const struct pf_parameter *parameters, int num,
+                      int max_move_cost, struct pf_map **maps)
+{
+  struct pf_cache_entry **entries;
+  struct pf_batch batch;
+  int i, num_tasks = 0;
+
+  if (0 >= num) {
+    return;
+  }
+
+  /* The maps are created by the calling thread, only their iterations
+   * are done by the pool. */
+  entries = fc_malloc(num * sizeof(*entries));
+  batch.entries = fc_malloc(num * sizeof(*batch.entries));
+  batch.max_move_cost = max_move_cost;
+  for (i = 0; i < num; i++) {
+    /* Don't let the threads allocate the move cost tables. */
+    map_move_costs_prepare(parameters[i].map);
+    entries[i] = pf_cache_entry_alloc(parameters + i, 0);
+    /* Not in the cache, destroyed with its map. */
+    entries[i]->stale = TRUE;
+    if (parameters[i].thread_safe) {
+      batch.entries[num_tasks++] = entries[i];
+    }
+  }
+
+  if (1 < num_tasks) {
+    bool was_frozen;
+
+    if (NULL == batch_pool) {
+      batch_pool = fc_threadpool_new(pf_get_batch_threads());
+    }
+    /* The workers only read the effect caches. */
+    was_frozen = effect_cache_freeze(TRUE);
+    fc_threadpool_run(batch_pool, num_tasks, pf_batch_task, &batch);
+    effect_cache_freeze(was_frozen);
+  } else if (1 == num_tasks) {
+    pf_batch_task(0, &batch);
+  }
+
+  /* The others. */
+  for (i = 0; i < num; i++) {
+    if (!parameters[i].thread_safe) {
+      batch.entries[0] = entries[i];
+      pf_batch_task(0, &batch);
+    }
+    maps[i] = pf_cached_map_new(entries[i]);
+  }
+
+  free(batch.entries);
+  free(entries);
 }
 
 /************************************************************************//**
@@ -3303,6 +4328,10 @@ bool pf_map_iterate(struct pf_map *pfm)
     return FALSE;
   }
 
+  if (NULL != pfm->centry) {
+    pf_cache_entry_record(pfm->centry, pfm->tile);
+  }
+
   return TRUE;
 }
 
@@ -3370,6 +4399,125 @@ const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm)
   return &pfm->params;
 }
 
+/************************************************************************//**
+  Enable or disable the goal-directed searches of pf_map_new_goal(),
+  overriding the FREECIV_PF_GOAL_DIRECTED environment variable.
+****************************************************************************/
+void pf_set_goal_directed(bool enable)
+{
+  goal_directed = (enable ? 1 : 0);
+}
+
+/************************************************************************//**
+  Returns whether pf_map_new_goal() makes goal-directed searches.
+  Initialize it from the FREECIV_PF_GOAL_DIRECTED environment variable if
+  needed, they are enabled unless it is set to 0.
+****************************************************************************/
+bool pf_get_goal_directed(void)
+{
+  if (-1 == goal_directed) {
+    const char *s = getenv("FREECIV_PF_GOAL_DIRECTED");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 0 == value) {
+      goal_directed = 0;
+    } else {
+      goal_directed = 1;
+    }
+  }
+
+  return 0 < goal_directed;
+}
+
+/************************************************************************//**
+  Enable or disable the sharing of the maps by pf_map_new_cached(),
+  overriding the FREECIV_PF_MAP_CACHE environment variable.
+****************************************************************************/
+void pf_set_map_cache(bool enable)
+{
+  map_cache_enabled = (enable ? 1 : 0);
+  if (!enable) {
+    pf_map_cache_invalidate();
+  }
+}
+
+/************************************************************************//**
+  Returns whether pf_map_new_cached() shares the maps. Initialize it from
+  the FREECIV_PF_MAP_CACHE environment variable if needed, it is enabled
+  unless it is set to 0.
+****************************************************************************/
+bool pf_get_map_cache(void)
+{
+  if (-1 == map_cache_enabled) {
+    const char *s = getenv("FREECIV_PF_MAP_CACHE");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 0 == value) {
+      map_cache_enabled = 0;
+    } else {
+      map_cache_enabled = 1;
+    }
+  }
+
+  return 0 < map_cache_enabled;
+}
+
+/************************************************************************//**
+  Set the number of threads used by pf_map_batch_new() besides the calling
+  one, overriding the FREECIV_PF_THREADS environment variable. With 0, the
+  batches are computed by the calling thread only.
+****************************************************************************/
+void pf_set_batch_threads(int threads)
+{
+  threads = MAX(threads, 0);
+  if (NULL != batch_pool && threads != batch_threads) {
+    fc_threadpool_destroy(batch_pool);
+    batch_pool = NULL;
+  }
+  batch_threads = threads;
+}
+
+/************************************************************************//**
+  Returns the number of threads used by pf_map_batch_new() besides the
+  calling one. Initialize it from the FREECIV_PF_THREADS environment
+  variable if needed.
+****************************************************************************/
+int pf_get_batch_threads(void)
+{
+  if (-1 == batch_threads) {
+    const char *s = getenv("FREECIV_PF_THREADS");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 0 <= value) {
+      batch_threads = value;
+    } else {
+      batch_threads = PF_BATCH_THREADS;
+    }
+  }
+
+  return batch_threads;
+}
+
+/************************************************************************//**
+  Fill 'pstats' with the node expansion and cache counters of all the maps
+  created since the last call to pf_stats_reset(). The nodes expanded by a
+  map and its memory are only counted once it is destroyed.
+****************************************************************************/
+void pf_stats_get(struct pf_stats *pstats)
+{
+  fc_assert_ret(NULL != pstats);
+
+  *pstats = stats;
+}
+
+/************************************************************************//**
+  Reset the node expansion and cache counters.
+****************************************************************************/
+void pf_stats_reset(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
 
 /* ====================== pf_path public functions ======================= */
 
@@ -3744,7 +4892,7 @@ pf_reverse_map_pos(struct pf_reverse_map *pfrm,
   struct pf_map *pfm;
   struct pf_parameter *copy;
   struct tile *target_tile;
-  const struct pf_normal_node *lattice;
+  struct pf_normal_map *pfnm;
   int max_cost;
 
   /* Check if we already processed something similar. */
@@ -3753,13 +4901,14 @@ pf_reverse_map_pos(struct pf_reverse_map *pfrm,
   }
 
   /* We didn't. Build map and iterate. */
-  pfm = pf_normal_map_new(param);
-  lattice = PF_NORMAL_MAP(pfm)->lattice;
+  pfm = pf_normal_map_new(param, NULL);
+  pfnm = PF_NORMAL_MAP(pfm);
   target_tile = pfrm->target_tile;
   if (pfrm->max_turns >= 0) {
     max_cost = param->move_rate * (pfrm->max_turns + 1);
     do {
-      if (lattice[tile_index(pfm->tile)].cost >= max_cost) {
+      if (pf_normal_map_node(pfnm, tile_index(pfm->tile))->cost
+          >= max_cost) {
         break;
       } else if (pfm->tile == target_tile) {
         /* Found our position. Insert in hash, destroy map, and return. */
@@ -194,6 +194,17 @@ extern "C" {
  *
  * You may call pf_map_path() multiple times with the same pfm.
  *
+ * When the map is created for one known destination, use
+ * pf_map_new_goal(&parameter, ptile) instead of pf_map_new(). The search
+ * is then directed towards 'ptile' (A* search), which usually processes
+ * far fewer nodes. The total_CC of the returned paths is the same as with
+ * pf_map_new(), and queries on other tiles remain valid, but iterating such
+ * a map (method B) doesn't visit the tiles by increasing costs. Maps which
+ * cannot use a goal-directed search (danger and fuel maps, jumbo maps...)
+ * silently fall back to the usual search. It can be disabled for all maps
+ * with the FREECIV_PF_GOAL_DIRECTED=0 environment variable or with
+ * pf_set_goal_directed(), and compared with the counters of pf_stats_get().
+ *
  * B) the caller doesn't know the map position of the goal yet (but knows
  * what they are looking for, e.g. a port) and wants to iterate over
  * all paths in order of increasing costs (total_CC):
@@ -243,6 +254,25 @@ extern "C" {
  * The third argument passed to the iteration macros is a condition that
  * controls if the start tile of the pf_parameter should iterated or not.
  *
+ * When the same parameters are likely to be used several times before
+ * anything changes on the map (e.g. during an AI phase), the map can be
+ * created with pf_map_new_cached() instead of pf_map_new(). The users of
+ * the same parameters then share the nodes already processed, until the
+ * server calls pf_map_cache_invalidate(). Both methods A and B can be used
+ * on such maps, but not mixed: point queries don't move the iteration.
+ * The sharing can be disabled with the FREECIV_PF_MAP_CACHE=0 environment
+ * variable or with pf_set_map_cache(), and measured with the counters of
+ * pf_stats_get().
+ *
+ * Many independent maps, e.g. one per city or per unit at the start of a
+ * phase, can be computed at once by pf_map_batch_new(). The maps are
+ * iterated concurrently by a pool of threads (FREECIV_PF_THREADS
+ * environment variable or pf_set_batch_threads(), 0 for none) up to the
+ * given move cost, then returned as if created by pf_map_new_cached(). The
+ * results don't depend on the number of threads. Only the parameters
+ * flagged 'thread_safe' are computed in other threads, the others are
+ * computed by the calling thread.
+ *
  *
  * FILLING the struct pf_parameter:
  * This can either be done by hand or using the pft_* functions from
@@ -383,6 +413,7 @@ struct pf_parameter {
                       enum pf_move_scope src_move_scope,
                       const struct tile *to_tile,
                       enum pf_move_scope dst_move_scope,
+                      enum direction8 dir,
                       const struct pf_parameter *param);
 
   /* Callback which determines if we can move from/to 'ptile'. */
@@ -467,11 +498,31 @@ struct pf_parameter {
                     unsigned *to_cost, unsigned *to_extra,
                     const struct pf_parameter *param);
 
+  /* Whether the callbacks only read the game state and 'data', so the
+   * map can be computed in another thread, see pf_map_batch_new(). Set by
+   * the pft_fill_*() functions, whose callbacks are all read-only. It must
+   * be cleared when installing a callback writing anything shared. */
+  bool thread_safe;
+
   /* User provided data. Can be used to attach arbitrary information
    * to the map. */
   void *data;
 };
 
+/* Node expansion and cache statistics, see pf_stats_get(). */
+struct pf_stats {
+  struct pf_map_stats {
+    unsigned int maps;          /* Number of maps created. */
+    unsigned int goal_maps;     /* Of which doing a goal-directed search. */
+    unsigned int rejected;      /* Goals known unreachable, see
+                                 * "pf_cluster.h". */
+    unsigned long expanded;     /* Number of nodes processed. */
+    size_t peak_memory;         /* Most bytes allocated by a single map. */
+  } normal, danger, fuel;
+  unsigned int cache_hits;      /* Maps shared by pf_map_new_cached(). */
+  unsigned int cache_misses;    /* Maps it had to create. */
+};
+
 /* The map itself. Opaque type. */
 struct pf_map;
 
@@ -482,9 +533,21 @@ struct pf_reverse_map;
 
 /* ========================= Public Interface ============================ */
 
+/* Module initialization. */
+void pf_init(void);
+void pf_free(void);
+
 /* Create and free. */
 struct pf_map *pf_map_new(const struct pf_parameter *parameter)
                fc__warn_unused_result;
+struct pf_map *pf_map_new_goal(const struct pf_parameter *parameter,
+                               struct tile *goal_tile)
+               fc__warn_unused_result;
+struct pf_map *pf_map_new_cached(const struct pf_parameter *parameter)
+               fc__warn_unused_result;
+void pf_map_cache_invalidate(void);
+void pf_map_batch_new(const struct pf_parameter *parameters, int num,
+                      int max_move_cost, struct pf_map **maps);
 void pf_map_destroy(struct pf_map *pfm);
 
 /* Method A) functions. */
@@ -506,6 +569,15 @@ void pf_map_iter_position(struct pf_map *pfm, struct pf_position *pos);
 /* Other related functions. */
 const struct pf_parameter *pf_map_parameter(const struct pf_map *pfm);
 
+void pf_set_goal_directed(bool enable);
+bool pf_get_goal_directed(void);
+void pf_set_map_cache(bool enable);
+bool pf_get_map_cache(void);
+void pf_set_batch_threads(int threads);
+int pf_get_batch_threads(void);
+void pf_stats_get(struct pf_stats *pstats);
+void pf_stats_reset(void);
+
 
 /* Paths functions. */
 void pf_path_destroy(struct pf_path *path);
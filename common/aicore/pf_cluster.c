@@ -0,0 +1,522 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 2003 - The Freeciv Project
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "bitvector.h"
+#include "fcthread.h"
+#include "log.h"
+#include "mem.h"
+#include "shared.h"
+
+/* common */
+#include "city.h"
+#include "game.h"
+#include "map.h"
+#include "movement.h"
+#include "tile.h"
+#include "unittype.h"
+
+#include "pf_cluster.h"
+
+/* For explanations on how to use this module, see "pf_cluster.h". */
+
+/* Side of a cluster, in native tiles. */
+#define PF_CLUSTER_SIZE 8
+#define PF_CLUSTER_TILES (PF_CLUSTER_SIZE * PF_CLUSTER_SIZE)
+
+/* Regions of the tiles. A cluster cannot have more regions than tiles. */
+#define PF_REGION_NONE 0        /* The tile cannot be crossed. */
+#define PF_REGION_UNSET 255     /* Crossable, but region not set yet. */
+FC_STATIC_ASSERT(PF_CLUSTER_TILES < PF_REGION_UNSET, too_many_regions);
+
+/* A link between a region and a tile of another cluster. We don't store
+ * the region of the other tile, which would be outdated when its cluster
+ * is rebuilt. */
+struct pf_cluster_edge {
+  unsigned char region;         /* Region in this cluster. */
+  int tindex;                   /* Tile in another cluster. */
+};
+
+struct pf_cluster {
+  bool dirty;                   /* The regions need to be rebuilt. */
+  int num_edges;
+  int max_edges;
+  struct pf_cluster_edge *edges;
+};
+
+/* The abstract graph for one unit class. */
+struct pf_cluster_class {
+  bool built;                   /* The arrays are allocated. */
+  bool dirty;                   /* Some clusters need to be rebuilt. */
+  unsigned char *tile_region;   /* Region of every tile, in its cluster. */
+  struct pf_cluster *clusters;
+  int *parent;                  /* Union-find of the regions, see
+                                 * pf_region_slot(). */
+};
+
+static struct {
+  bool initialized;             /* See pf_clusters_init(). */
+  fc_mutex mutex;               /* The layer is shared by all threads. */
+
+  int map_size;                 /* MAP_INDEX_SIZE when built. */
+  int width, height;            /* Number of clusters in native coords. */
+
+  bool transporters_known;
+  bv_unit_classes transporters[UCL_LAST]; /* Who can transport a class,
+                                           * maybe through other ones. */
+  struct pf_cluster_class classes[UCL_LAST];
+} clusters;
+
+/* Whether the layer is enabled. Magic -1 means not initialized, see
+ * pf_clusters_enabled(). */
+static int clusters_enabled = -1;
+
+/************************************************************************//**
+  Returns the cluster of the tile.
+****************************************************************************/
+static inline int pf_cluster_index(const struct tile *ptile)
+{
+  int nat_x, nat_y;
+
+  index_to_native_pos(&nat_x, &nat_y, tile_index(ptile));
+
+  return (nat_y / PF_CLUSTER_SIZE) * clusters.width
+         + nat_x / PF_CLUSTER_SIZE;
+}
+
+/************************************************************************//**
+  Returns the index of the region 'region' of the cluster 'cindex' in
+  the union-find array.
+****************************************************************************/
+static inline int pf_region_slot(int cindex, int region)
+{
+  return cindex * PF_CLUSTER_TILES + region - 1;
+}
+
+/************************************************************************//**
+  Returns the representative of the set of the region slot.
+****************************************************************************/
+static int pf_region_find(int *parent, int slot)
+{
+  int root = slot;
+
+  while (parent[root] != root) {
+    root = parent[root];
+  }
+
+  /* Path compression. */
+  while (parent[slot] != root) {
+    int next = parent[slot];
+
+    parent[slot] = root;
+    slot = next;
+  }
+
+  return root;
+}
+
+/************************************************************************//**
+  Compute which unit classes can transport every unit class, directly or
+  not.
+****************************************************************************/
+static void pf_clusters_init_transporters(void)
+{
+  bool changed;
+
+  unit_class_iterate(pcargo) {
+    bv_unit_classes *ptransporters
+      = &clusters.transporters[uclass_index(pcargo)];
+
+    BV_CLR_ALL(*ptransporters);
+    unit_type_iterate(ptype) {
+      if (can_unit_type_transport(ptype, pcargo)) {
+        BV_SET(*ptransporters, uclass_index(utype_class(ptype)));
+      }
+    } unit_type_iterate_end;
+  } unit_class_iterate_end;
+
+  /* Transporters may be transported too. */
+  do {
+    changed = FALSE;
+    unit_class_iterate(pcargo) {
+      bv_unit_classes *ptransporters
+        = &clusters.transporters[uclass_index(pcargo)];
+
+      unit_class_iterate(ptrans) {
+        if (!BV_ISSET(*ptransporters, uclass_index(ptrans))) {
+          continue;
+        }
+        unit_class_iterate(pparent) {
+          if (BV_ISSET(clusters.transporters[uclass_index(ptrans)],
+                       uclass_index(pparent))
+              && !BV_ISSET(*ptransporters, uclass_index(pparent))) {
+            BV_SET(*ptransporters, uclass_index(pparent));
+            changed = TRUE;
+          }
+        } unit_class_iterate_end;
+      } unit_class_iterate_end;
+    } unit_class_iterate_end;
+  } while (changed);
+
+  clusters.transporters_known = TRUE;
+}
+
+/************************************************************************//**
+  Returns whether the units of the class might cross the tile.
+****************************************************************************/
+static bool pf_cluster_tile_open(const struct unit_class *pclass,
+                                 const struct tile *ptile)
+{
+  if (NULL != tile_city(ptile) || is_native_tile_to_class(pclass, ptile)) {
+    return TRUE;
+  }
+
+  unit_class_iterate(ptrans) {
+    if (BV_ISSET(clusters.transporters[uclass_index(pclass)],
+                 uclass_index(ptrans))
+        && is_native_tile_to_class(ptrans, ptile)) {
+      return TRUE;
+    }
+  } unit_class_iterate_end;
+
+  return FALSE;
+}
+
+/************************************************************************//**
+  Group the crossable tiles of the cluster into regions, and record the
+  links to the other clusters.
+****************************************************************************/
+static void pf_cluster_build(struct pf_cluster_class *pcc,
+                             const struct unit_class *pclass, int cindex)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct pf_cluster *pcluster = pcc->clusters + cindex;
+  int x0 = (cindex % clusters.width) * PF_CLUSTER_SIZE;
+  int y0 = (cindex / clusters.width) * PF_CLUSTER_SIZE;
+  int x1 = MIN(x0 + PF_CLUSTER_SIZE, MAP_NATIVE_WIDTH);
+  int y1 = MIN(y0 + PF_CLUSTER_SIZE, MAP_NATIVE_HEIGHT);
+  struct tile *stack[PF_CLUSTER_TILES];
+  unsigned char region = PF_REGION_NONE;
+  int x, y;
+
+  for (y = y0; y < y1; y++) {
+    for (x = x0; x < x1; x++) {
+      struct tile *ptile = native_pos_to_tile(nmap, x, y);
+
+      pcc->tile_region[tile_index(ptile)]
+        = (pf_cluster_tile_open(pclass, ptile)
+           ? PF_REGION_UNSET : PF_REGION_NONE);
+    }
+  }
+
+  /* Flood fill inside the cluster. */
+  for (y = y0; y < y1; y++) {
+    for (x = x0; x < x1; x++) {
+      struct tile *ptile = native_pos_to_tile(nmap, x, y);
+      int depth = 0;
+
+      if (PF_REGION_UNSET != pcc->tile_region[tile_index(ptile)]) {
+        continue;
+      }
+
+      region++;
+      pcc->tile_region[tile_index(ptile)] = region;
+      stack[depth++] = ptile;
+      while (0 < depth) {
+        adjc_iterate(nmap, stack[--depth], adjc_tile) {
+          unsigned char *padjc_region
+            = pcc->tile_region + tile_index(adjc_tile);
+
+          if (PF_REGION_UNSET == *padjc_region
+              && pf_cluster_index(adjc_tile) == cindex) {
+            *padjc_region = region;
+            stack[depth++] = adjc_tile;
+          }
+        } adjc_iterate_end;
+      }
+    }
+  }
+
+  /* Links to the other clusters. */
+  pcluster->num_edges = 0;
+  for (y = y0; y < y1; y++) {
+    for (x = x0; x < x1; x++) {
+      struct tile *ptile = native_pos_to_tile(nmap, x, y);
+      unsigned char tile_region = pcc->tile_region[tile_index(ptile)];
+
+      if (PF_REGION_NONE == tile_region) {
+        continue;
+      }
+
+      adjc_iterate(nmap, ptile, adjc_tile) {
+        if (PF_REGION_NONE != pcc->tile_region[tile_index(adjc_tile)]
+            && pf_cluster_index(adjc_tile) != cindex) {
+          if (pcluster->num_edges == pcluster->max_edges) {
+            pcluster->max_edges = MAX(16, 2 * pcluster->max_edges);
+            pcluster->edges = fc_realloc(pcluster->edges,
+                                         pcluster->max_edges
+                                         * sizeof(*pcluster->edges));
+          }
+          pcluster->edges[pcluster->num_edges].region = tile_region;
+          pcluster->edges[pcluster->num_edges].tindex
+            = tile_index(adjc_tile);
+          pcluster->num_edges++;
+        }
+      } adjc_iterate_end;
+    }
+  }
+
+  pcluster->dirty = FALSE;
+}
+
+/************************************************************************//**
+  Rebuild the outdated clusters of the class, and the connections between
+  the regions.
+****************************************************************************/
+static void pf_cluster_class_update(struct pf_cluster_class *pcc,
+                                    const struct unit_class *pclass)
+{
+  int num_clusters = clusters.width * clusters.height;
+  int num_slots = num_clusters * PF_CLUSTER_TILES;
+  int cindex, i;
+
+  if (!pcc->built) {
+    pcc->tile_region = fc_calloc(MAP_INDEX_SIZE,
+                                 sizeof(*pcc->tile_region));
+    pcc->clusters = fc_calloc(num_clusters, sizeof(*pcc->clusters));
+    pcc->parent = fc_malloc(num_slots * sizeof(*pcc->parent));
+    for (cindex = 0; cindex < num_clusters; cindex++) {
+      pcc->clusters[cindex].dirty = TRUE;
+    }
+    pcc->built = TRUE;
+    pcc->dirty = TRUE;
+  }
+
+  if (!pcc->dirty) {
+    return;
+  }
+
+  for (cindex = 0; cindex < num_clusters; cindex++) {
+    if (pcc->clusters[cindex].dirty) {
+      pf_cluster_build(pcc, pclass, cindex);
+    }
+  }
+
+  for (i = 0; i < num_slots; i++) {
+    pcc->parent[i] = i;
+  }
+  for (cindex = 0; cindex < num_clusters; cindex++) {
+    const struct pf_cluster *pcluster = pcc->clusters + cindex;
+
+    for (i = 0; i < pcluster->num_edges; i++) {
+      int tindex = pcluster->edges[i].tindex;
+      unsigned char other = pcc->tile_region[tindex];
+      int root1, root2;
+
+      if (PF_REGION_NONE == other) {
+        /* Closed since. */
+        continue;
+      }
+
+      root1 = pf_region_find(pcc->parent,
+                             pf_region_slot(cindex,
+                                            pcluster->edges[i].region));
+      root2 = pf_region_find(pcc->parent,
+                             pf_region_slot(pf_cluster_index(
+                                              index_to_tile(&(wld.map),
+                                                            tindex)),
+                                            other));
+      if (root1 != root2) {
+        pcc->parent[root2] = root1;
+      }
+    }
+  }
+
+  pcc->dirty = FALSE;
+}
+
+/************************************************************************//**
+  Free the data of the class.
+****************************************************************************/
+static void pf_cluster_class_free(struct pf_cluster_class *pcc)
+{
+  if (pcc->built) {
+    int num_clusters = clusters.width * clusters.height;
+    int cindex;
+
+    for (cindex = 0; cindex < num_clusters; cindex++) {
+      free(pcc->clusters[cindex].edges);
+    }
+    free(pcc->clusters);
+    free(pcc->tile_region);
+    free(pcc->parent);
+  }
+  memset(pcc, 0, sizeof(*pcc));
+}
+
+/************************************************************************//**
+  Initialize the cluster layer.
+****************************************************************************/
+void pf_clusters_init(void)
+{
+  if (!clusters.initialized) {
+    memset(&clusters, 0, sizeof(clusters));
+    fc_mutex_init(&clusters.mutex);
+    clusters.initialized = TRUE;
+  }
+}
+
+/************************************************************************//**
+  Free the cluster layer.
+****************************************************************************/
+void pf_clusters_free(void)
+{
+  if (!clusters.initialized) {
+    return;
+  }
+
+  unit_class_iterate(pclass) {
+    pf_cluster_class_free(&clusters.classes[uclass_index(pclass)]);
+  } unit_class_iterate_end;
+  fc_mutex_destroy(&clusters.mutex);
+  memset(&clusters, 0, sizeof(clusters));
+}
+
+/************************************************************************//**
+  Enable or disable the cluster layer, overriding the FREECIV_PF_CLUSTERS
+  environment variable.
+****************************************************************************/
+void pf_clusters_set_enabled(bool enable)
+{
+  clusters_enabled = (enable ? 1 : 0);
+}
+
+/************************************************************************//**
+  Returns whether the cluster layer is enabled. Initialize it from the
+  FREECIV_PF_CLUSTERS environment variable if needed, it is disabled unless
+  set to 1.
+****************************************************************************/
+bool pf_clusters_enabled(void)
+{
+  if (-1 == clusters_enabled) {
+    const char *s = getenv("FREECIV_PF_CLUSTERS");
+    int value;
+
+    if (NULL != s && str_to_int(s, &value) && 1 == value) {
+      clusters_enabled = 1;
+    } else {
+      clusters_enabled = 0;
+    }
+  }
+
+  return 0 < clusters_enabled;
+}
+
+/************************************************************************//**
+  The terrain, the extras or the city of the tile changed. Mark its
+  cluster to be rebuilt for all unit classes.
+****************************************************************************/
+void pf_clusters_tile_changed(const struct tile *ptile)
+{
+  int cindex;
+
+  if (!clusters.initialized || !pf_clusters_enabled()) {
+    return;
+  }
+
+  fc_mutex_allocate(&clusters.mutex);
+  if (clusters.map_size == MAP_INDEX_SIZE) {
+    cindex = pf_cluster_index(ptile);
+    unit_class_iterate(pclass) {
+      struct pf_cluster_class *pcc = &clusters.classes[uclass_index(pclass)];
+
+      if (pcc->built) {
+        pcc->clusters[cindex].dirty = TRUE;
+        pcc->dirty = TRUE;
+      }
+    } unit_class_iterate_end;
+  }
+  fc_mutex_release(&clusters.mutex);
+}
+
+/************************************************************************//**
+  Returns FALSE if the units of the class certainly cannot go from
+  'src_tile' to 'dst_tile' or to one of its adjacent tiles. Returns TRUE
+  when they might, or if the layer is disabled.
+****************************************************************************/
+bool pf_clusters_may_reach(const struct unit_class *pclass,
+                           const struct tile *src_tile,
+                           const struct tile *dst_tile)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct pf_cluster_class *pcc;
+  int src_root;
+  bool result = FALSE;
+
+  if (!clusters.initialized || !pf_clusters_enabled()) {
+    return TRUE;
+  }
+
+  fc_mutex_allocate(&clusters.mutex);
+
+  if (clusters.map_size != MAP_INDEX_SIZE) {
+    /* New map. */
+    unit_class_iterate(pother) {
+      pf_cluster_class_free(&clusters.classes[uclass_index(pother)]);
+    } unit_class_iterate_end;
+    clusters.map_size = MAP_INDEX_SIZE;
+    clusters.width = (MAP_NATIVE_WIDTH + PF_CLUSTER_SIZE - 1)
+                     / PF_CLUSTER_SIZE;
+    clusters.height = (MAP_NATIVE_HEIGHT + PF_CLUSTER_SIZE - 1)
+                      / PF_CLUSTER_SIZE;
+  }
+  if (!clusters.transporters_known) {
+    pf_clusters_init_transporters();
+  }
+
+  pcc = &clusters.classes[uclass_index(pclass)];
+  pf_cluster_class_update(pcc, pclass);
+
+  if (PF_REGION_NONE == pcc->tile_region[tile_index(src_tile)]) {
+    /* We don't know where we could go from there. */
+    fc_mutex_release(&clusters.mutex);
+    return TRUE;
+  }
+
+  src_root = pf_region_find(pcc->parent,
+                            pf_region_slot(pf_cluster_index(src_tile),
+                                           pcc->tile_region[tile_index(src_tile)]));
+
+  square_iterate(nmap, dst_tile, 1, ptile) {
+    unsigned char region = pcc->tile_region[tile_index(ptile)];
+
+    if (PF_REGION_NONE != region
+        && src_root == pf_region_find(pcc->parent,
+                                      pf_region_slot(pf_cluster_index(ptile),
+                                                     region))) {
+      result = TRUE;
+      break;
+    }
+  } square_iterate_end;
+
+  fc_mutex_release(&clusters.mutex);
+
+  return result;
+}
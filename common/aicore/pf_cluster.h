@@ -0,0 +1,67 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 2003 - The Freeciv Project
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+#ifndef FC__PF_CLUSTER_H
+#define FC__PF_CLUSTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* utility */
+#include "support.h"            /* bool type */
+
+/* common */
+#include "fc_types.h"
+
+/*
+ * Hierarchical cluster layer for the path-finding.
+ *
+ * The map is cut into square clusters of PF_CLUSTER_SIZE native tiles.
+ * For every unit class, the tiles of a cluster that the units of this
+ * class might cross are grouped into regions, connected inside the
+ * cluster. The regions are then linked with the regions of the
+ * neighbouring clusters, giving an abstract graph far smaller than the
+ * map.
+ *
+ * The tiles are considered as crossable if they are native to the unit
+ * class, or to any unit class which could transport it, or if they have
+ * a city. This is a superset of the tiles a pf map could enter with the
+ * pf_tools callbacks and full knowledge of the map, so when two tiles are
+ * not connected in the abstract graph, no path can exist between them.
+ * This lets pf_map_new_goal() reject unreachable goals without iterating
+ * over the whole continent or ocean.
+ *
+ * The layer is optional. It is only enabled with the
+ * FREECIV_PF_CLUSTERS=1 environment variable or with
+ * pf_clusters_set_enabled(). The server then must call
+ * pf_clusters_tile_changed() every time the terrain, the extras or the
+ * city of a tile changes. The clusters are rebuilt lazily.
+ */
+
+void pf_clusters_init(void);
+void pf_clusters_free(void);
+
+void pf_clusters_set_enabled(bool enable);
+bool pf_clusters_enabled(void);
+
+void pf_clusters_tile_changed(const struct tile *ptile);
+
+bool pf_clusters_may_reach(const struct unit_class *pclass,
+                           const struct tile *src_tile,
+                           const struct tile *dst_tile);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__PF_CLUSTER_H */
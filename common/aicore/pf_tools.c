@@ -27,12 +27,15 @@
 #include "combat.h"
 #include "game.h"
 #include "movement.h"
+#include "road.h"
+#include "terrain.h"
 #include "tile.h"
 #include "unit.h"
 #include "unittype.h"
 
 /* aicore */
 #include "aiactions.h"
+#include "pf_cluster.h"
 
 #include "pf_tools.h"
 
@@ -366,10 +369,12 @@ static unsigned normal_move(const struct tile *src,
                             enum pf_move_scope src_scope,
                             const struct tile *dst,
                             enum pf_move_scope dst_scope,
+                            enum direction8 dir,
                             const struct pf_parameter *param)
 {
   if (pf_move_possible(src, src_scope, dst, dst_scope, param)) {
-    return map_move_cost(param->map, param->owner, param->utype, src, dst);
+    return map_move_cost_dir(param->map, param->owner, param->utype,
+                             src, dst, dir);
   }
 
   return PF_IMPOSSIBLE_MC;
@@ -386,10 +391,12 @@ static unsigned overlap_move(const struct tile *src,
                              enum pf_move_scope src_scope,
                              const struct tile *dst,
                              enum pf_move_scope dst_scope,
+                             enum direction8 dir,
                              const struct pf_parameter *param)
 {
   if (pf_move_possible(src, src_scope, dst, dst_scope, param)) {
-    return map_move_cost(param->map, param->owner, param->utype, src, dst);
+    return map_move_cost_dir(param->map, param->owner, param->utype,
+                             src, dst, dir);
   } else if (!(PF_MS_NATIVE & dst_scope)) {
     /* This should always be the last tile reached. */
     return param->move_rate;
@@ -405,6 +412,7 @@ static unsigned amphibious_move(const struct tile *ptile,
                                 enum pf_move_scope src_scope,
                                 const struct tile *ptile1,
                                 enum pf_move_scope dst_scope,
+                                enum direction8 dir,
                                 const struct pf_parameter *param)
 {
   struct pft_amphibious *amphibious = param->data;
@@ -418,12 +426,12 @@ static unsigned amphibious_move(const struct tile *ptile,
                                     (PF_MS_CITY & src_scope) | PF_MS_NATIVE,
                                     ptile1,
                                     (PF_MS_CITY & dst_scope) | PF_MS_NATIVE,
-                                    &amphibious->sea);
+                                    dir, &amphibious->sea);
       scale = amphibious->sea_scale;
     } else if (PF_MS_NATIVE & dst_scope) {
       /* Disembark; use land movement function to handle non-native attacks. */
       cost = amphibious->land.get_MC(ptile, PF_MS_TRANSPORT, ptile1,
-                                     PF_MS_NATIVE, &amphibious->land);
+                                     PF_MS_NATIVE, dir, &amphibious->land);
       scale = amphibious->land_scale;
     } else {
       /* Neither ferry nor passenger can enter tile. */
@@ -432,7 +440,7 @@ static unsigned amphibious_move(const struct tile *ptile,
   } else if ((PF_MS_NATIVE | PF_MS_CITY) & dst_scope) {
     /* Land move */
     cost = amphibious->land.get_MC(ptile, PF_MS_NATIVE, ptile1,
-                                   PF_MS_NATIVE, &amphibious->land);
+                                   PF_MS_NATIVE, dir, &amphibious->land);
     scale = amphibious->land_scale;
   } else {
     /* Now we have disembarked, our ferry can not help us - we have to
@@ -697,6 +705,8 @@ pft_fill_default_parameter(struct pf_parameter *parameter,
   parameter->get_action = NULL;
   parameter->is_action_possible = NULL;
   parameter->actions = PF_AA_NONE;
+  parameter->thread_safe = TRUE;
+  parameter->data = NULL;
 
   parameter->utype = punittype;
 }
@@ -1029,3 +1039,73 @@ void pft_fill_amphibious_parameter(struct pft_amphibious *parameter)
 
   parameter->combined.data = parameter;
 }
+
+/************************************************************************//**
+  Returns a lower bound of the move cost of any step evaluated by the
+  get_MC callback of 'param', for the goal-directed searches. Returns 0
+  when no useful bound is known, e.g. for callbacks not set by the
+  pft_fill_*() functions, or when some moves are free.
+  See tile_move_cost_ptrs() for the rules this bound follows.
+****************************************************************************/
+int pft_min_move_cost(const struct pf_parameter *param)
+{
+  const struct unit_class *pclass;
+  int min_MC;
+
+  if (normal_move != param->get_MC && overlap_move != param->get_MC) {
+    return 0;
+  }
+
+  pclass = utype_class(param->utype);
+
+  /* Constant cost, or moves from/to non-native tiles. */
+  min_MC = SINGLE_MOVE;
+
+  if (uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+    /* Extras may make any terrain native. */
+    bool any_terrain
+      = (0 < extra_type_list_size(pclass->cache.native_tile_extras));
+
+    terrain_type_iterate(pterrain) {
+      if (any_terrain || is_native_to_class(pclass, pterrain, NULL)) {
+        min_MC = MIN(min_MC, pterrain->movement_cost * SINGLE_MOVE);
+      }
+    } terrain_type_iterate_end;
+
+    extra_type_list_iterate(pclass->cache.bonus_roads, pextra) {
+      min_MC = MIN(min_MC, extra_road_get(pextra)->move_cost);
+    } extra_type_list_iterate_end;
+
+    if (utype_has_flag(param->utype, UTYF_IGTER)) {
+      min_MC = MIN(min_MC, MOVE_COST_IGTER);
+    }
+  }
+
+  if (overlap_move == param->get_MC) {
+    /* Last step into non-native terrain. */
+    min_MC = MIN(min_MC, param->move_rate);
+  }
+
+  return MAX(min_MC, 0);
+}
+
+/************************************************************************//**
+  Returns TRUE if the cluster layer proves that the map of 'param' cannot
+  reach 'ptile', nor attack it. Returns FALSE when it might, or when the
+  layer cannot be used for 'param'. See "pf_cluster.h".
+****************************************************************************/
+bool pft_goal_unreachable(const struct pf_parameter *param,
+                          const struct tile *ptile)
+{
+  if (!pf_clusters_enabled()
+      || !param->omniscience
+      || NULL != param->transported_by_initially
+      || pf_get_move_scope != param->get_move_scope
+      || (normal_move != param->get_MC && overlap_move != param->get_MC)) {
+    /* Unknown tiles or custom callbacks may let the units go anywhere. */
+    return FALSE;
+  }
+
+  return !pf_clusters_may_reach(utype_class(param->utype),
+                                param->start_tile, ptile);
+}
@@ -73,6 +73,9 @@ void pft_fill_reverse_parameter(const struct civ_map *nmap,
                                 struct tile *target_tile);
 
 void pft_fill_amphibious_parameter(struct pft_amphibious *parameter);
+int pft_min_move_cost(const struct pf_parameter *param);
+bool pft_goal_unreachable(const struct pf_parameter *param,
+                          const struct tile *ptile);
 enum tile_behavior no_fights_or_unknown(const struct tile *ptile,
                                         enum known_type known,
                                         const struct pf_parameter *param);
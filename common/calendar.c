@@ -16,6 +16,7 @@
 #endif
 
 /* common */
+#include "effects.h"
 #include "game.h"
 #include "victory.h"
 
@@ -92,6 +93,7 @@ void game_advance_year(void)
 {
   game_next_year(&game.info);
   game.info.turn++;
+  effect_cache_invalidate();
 }
 
 /************************************************************************//**
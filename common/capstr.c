@@ -49,7 +49,9 @@ const char *const our_capability = our_capability_internal;
  * capabilities of the running executable. This is normally initialised
  * with CAPABILITY, but can be changed at run-time by setting the
  * FREECIV_CAPS environment variable, though that is probably mainly
- * useful for testing purposes.
+ * useful for testing purposes. The capabilities of the optional
+ * network compression methods are added to the default string at
+ * run-time, depending on the build and on the data files found.
  *
  * For checking the connections of other executables, each
  * "struct connection" has a capability string, which gives the
@@ -89,8 +91,16 @@ void init_our_capability(void)
   const char *s;
 
   s = getenv("FREECIV_CAPS");
-  if (!s) {
-    s = NETWORK_CAPSTRING;
+  if (s) {
+    sz_strlcpy(our_capability_internal, s);
+  } else {
+    const char *compression = conn_compression_capability();
+
+    if ('\0' != compression[0]) {
+      fc_snprintf(our_capability_internal, sizeof(our_capability_internal),
+                  "%s %s", NETWORK_CAPSTRING, compression);
+    } else {
+      sz_strlcpy(our_capability_internal, NETWORK_CAPSTRING);
+    }
   }
-  sz_strlcpy(our_capability_internal, s);
 }
@@ -149,7 +149,10 @@ void city_map_radius_sq_set(struct city *pcity, int radius_sq)
   fc_assert_ret(radius_sq >= CITY_MAP_MIN_RADIUS_SQ);
   fc_assert_ret(radius_sq <= CITY_MAP_MAX_RADIUS_SQ);
 
-  pcity->city_radius_sq = radius_sq;
+  if (pcity->city_radius_sq != radius_sq) {
+    pcity->city_radius_sq = radius_sq;
+    effect_cache_city_changed(pcity);
+  }
 }
 
 /**********************************************************************//**
@@ -1171,6 +1174,7 @@ void city_size_set(struct city *pcity, citizens size)
 
   /* Set city size. */
   pcity->size = size;
+  effect_cache_city_changed(pcity);
 }
 
 /**********************************************************************//**
@@ -2428,6 +2432,16 @@ static inline int city_tile_cache_get_output(const struct city *pcity,
   return (pcity->tile_cache[city_tile_index]).output[o];
 }
 
+/**********************************************************************//**
+  Return the output of 'o' for the city tile 'city_tile_index' of 'pcity',
+  as computed by the last full refresh of the city.
+**************************************************************************/
+int city_tile_output_cached(const struct city *pcity, int city_tile_index,
+                            enum output_type_id o)
+{
+  return city_tile_cache_get_output(pcity, city_tile_index, o);
+}
+
 /**********************************************************************//**
   Set the final surplus[] array from the prod[] and usage[] values.
 **************************************************************************/
@@ -3337,6 +3351,7 @@ void city_add_improvement(struct city *pcity,
 			  const struct impr_type *pimprove)
 {
   pcity->built[improvement_index(pimprove)].turn = game.info.turn; /*I_ACTIVE*/
+  effect_cache_invalidate();
 
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
@@ -3354,6 +3369,7 @@ void city_remove_improvement(struct city *pcity,
             improvement_rule_name(pimprove), pcity->name);
   
   pcity->built[improvement_index(pimprove)].turn = I_DESTROYED;
+  effect_cache_invalidate();
 
   if (is_server() && is_wonder(pimprove)) {
     /* Client just read the info from the packets. */
@@ -3496,6 +3512,10 @@ void destroy_city_virtual(struct city *pcity)
 {
   CALL_FUNC_EACH_AI(city_free, pcity);
 
+  if (IDENTITY_NUMBER_ZERO != pcity->id) {
+    cm_clear_cache(pcity);
+  }
+
   citizens_free(pcity);
 
   /* Free worker tasks */
@@ -3516,6 +3536,7 @@ void destroy_city_virtual(struct city *pcity)
   if (pcity->tile_cache != NULL) {
     free(pcity->tile_cache);
   }
+  effect_cache_city_free(pcity);
 
   if (pcity->cm_parameter) {
     free(pcity->cm_parameter);
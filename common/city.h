@@ -310,6 +310,8 @@ enum city_needs_arrange {
 
 struct tile_cache; /* defined and only used within city.c */
 
+struct effect_cache; /* defined and only used within effects.c */
+
 struct adv_city; /* defined in ./server/advisors/infracache.h */
 
 struct cm_parameter; /* defined in ./common/aicore/cm.h */
@@ -351,6 +353,9 @@ struct city {
    * radius. */
   int tile_cache_radius_sq;
 
+  /* Effect totals, see get_city_bonus(). */
+  struct effect_cache *effect_cache;
+
   /* The productions */
   int surplus[O_LAST]; /* Final surplus in each category. */
   int waste[O_LAST]; /* Waste/corruption in each category. */
@@ -688,6 +693,8 @@ int city_tile_output(const struct city *pcity, const struct tile *ptile,
                      bool is_celebrating, Output_type_id otype);
 int city_tile_output_now(const struct city *pcity, const struct tile *ptile,
                          Output_type_id otype);
+int city_tile_output_cached(const struct city *pcity, int city_tile_index,
+                            enum output_type_id o);
 
 bool base_city_can_work_tile(const struct player *restriction,
                              const struct city *pcity,
@@ -32,8 +32,10 @@
 #include "government.h"
 #include "improvement.h"
 #include "map.h"
+#include "nation.h"
 #include "packets.h"
 #include "player.h"
+#include "research.h"
 #include "tech.h"
 
 #include "effects.h"
@@ -136,6 +138,90 @@ static struct {
   } reqs;
 } ruleset_cache;
 
+/**************************************************************************
+  Effect index. The effects of each type are bucketed by their most
+  selective positive requirement on a nation, a building, a government
+  or a tech, the "gate". A lookup only evaluates the effects of the
+  buckets whose gate the target has, and the ungated effects.
+  The index is built when the ruleset cache is compiled. Adding or
+  removing effects of a type afterwards makes its lookups go through the
+  full list again.
+**************************************************************************/
+struct effect_bucket {
+  struct universal gate;
+  struct effect_list *effects;
+};
+
+static struct {
+  bool valid;
+  struct effect_list *ungated;
+  int num_buckets;
+  struct effect_bucket *buckets;
+} effect_index[EFT_COUNT];
+
+/* Check every value taken from the effect cache against a fresh
+ * evaluation. */
+#ifdef FREECIV_DEBUG
+#define EFFECT_CACHE_CHECK
+#endif
+
+/**************************************************************************
+  Effect cache. The totals of get_city_bonus(), get_city_output_bonus(),
+  get_player_bonus() and get_player_output_bonus() are kept per city and
+  per player, for the effect types whose requirements can only change
+  through events that invalidate the cache:
+    - buildings, wonders, techs, diplomatic states, living players,
+      nations, continents and the turn invalidate all the caches, and
+      the requirement snapshots (effect_cache_invalidate()),
+    - city size and radius changes invalidate the cache of the city
+      (effect_cache_city_changed()),
+    - terrain and extras changes invalidate the caches of the cities
+      around the tile (effect_cache_tile_changed()),
+    - the city owner and the government of the player are compared on
+      each lookup.
+  The AI evaluates hypothetical techs and buildings with the caches
+  bypassed, see effect_cache_bypass().
+  Entries are valid while their epoch is the one of their cache. Only the
+  server caches anything, the client gets its state from the packets.
+**************************************************************************/
+struct effect_cache {
+  /* Bumped to forget all the entries. */
+  unsigned int epoch;
+  /* What the entries were computed for. */
+  unsigned int global_epoch;
+  const struct player *owner;
+  const struct government *government;
+  struct {
+    int value;
+    unsigned int epoch;
+  } entries[EFT_COUNT * (O_LAST + 1)];
+};
+
+static struct {
+  /* Effect types with only tracked requirements and no multipliers. */
+  bool cacheable[EFT_COUNT];
+  /* Whether any type is cacheable at all. */
+  bool enabled;
+  /* Caches are not written while other threads may read them. */
+  bool frozen;
+  /* Caches are neither used nor invalidated during hypothetical
+   * changes. */
+  bool bypassed;
+  unsigned int epoch;
+  struct effect_cache *players[MAX_NUM_PLAYER_SLOTS];
+} value_cache = { .epoch = 1 };
+
+
+/**********************************************************************//**
+  The effects of the type changed after the ruleset cache was compiled.
+  Its index and effect cache entries can't be trusted any more.
+**************************************************************************/
+static void effect_type_changed(enum effect_type type)
+{
+  effect_index[type].valid = FALSE;
+  value_cache.cacheable[type] = FALSE;
+  effect_cache_invalidate();
+}
 
 /**********************************************************************//**
   Get a list of effects of this type.
@@ -195,10 +281,12 @@ struct effect *effect_new(enum effect_type type, int value,
   peffect->multiplier = pmul;
 
   requirement_vector_init(&peffect->reqs);
+  peffect->reqs_program = NULL;
 
   /* Now add the effect to the ruleset cache. */
   effect_list_append(ruleset_cache.tracker, peffect);
   effect_list_append(get_effects(type), peffect);
+  effect_type_changed(type);
 
   /* Only relevant for ruledit and other rulesave users. */
   peffect->rulesave.do_not_save = FALSE;
@@ -216,6 +304,9 @@ struct effect *effect_new(enum effect_type type, int value,
 void effect_free(struct effect *peffect)
 {
   requirement_vector_free(&peffect->reqs);
+  if (peffect->reqs_program != NULL) {
+    req_program_destroy(peffect->reqs_program);
+  }
   if (peffect->rulesave.comment != NULL) {
     free(peffect->rulesave.comment);
   }
@@ -231,6 +322,7 @@ void effect_remove(struct effect *peffect)
 {
   effect_list_remove(ruleset_cache.tracker, peffect);
   effect_list_remove(get_effects(peffect->type), peffect);
+  effect_type_changed(peffect->type);
 }
 
 /**********************************************************************//**
@@ -268,6 +360,7 @@ void effect_req_append(struct effect *peffect, struct requirement req)
   struct effect_list *eff_list = get_req_source_effects(&req.source);
 
   requirement_vector_append(&peffect->reqs, req);
+  effect_type_changed(peffect->type);
 
   if (eff_list != NULL) {
     effect_list_append(eff_list, peffect);
@@ -322,6 +415,404 @@ void ruleset_cache_init(void)
   }
 }
 
+/**********************************************************************//**
+  Whether the requirement can only change through the events tracked by
+  the effect cache, when evaluated for a city or a player.
+**************************************************************************/
+static bool effect_cache_req_tracked(const struct requirement *preq,
+                                     bool obsolete_by)
+{
+  if (preq->range == REQ_RANGE_TRADE_ROUTE) {
+    /* Trade partners come and go untracked. */
+    return FALSE;
+  }
+
+  switch (preq->source.kind) {
+  case VUT_NONE:
+  case VUT_ADVANCE:
+  case VUT_TECHFLAG:
+  case VUT_GOVERNMENT:
+  case VUT_NATION:
+  case VUT_NATIONGROUP:
+  case VUT_MINSIZE:
+  case VUT_MINYEAR:
+  case VUT_MINCALFRAG:
+  case VUT_AGE:
+  case VUT_TOPO:
+  case VUT_WRAP:
+  case VUT_IMPR_GENUS:
+  case VUT_IMPR_FLAG:
+  /* Those only check the context itself, which is the same for every
+   * lookup of an entry. */
+  case VUT_OTYPE:
+  case VUT_SPECIALIST:
+  case VUT_UTYPE:
+  case VUT_UTFLAG:
+  case VUT_UCLASS:
+  case VUT_UCFLAG:
+  case VUT_UNITSTATE:
+  case VUT_ACTIVITY:
+  case VUT_MINMOVES:
+  case VUT_MINVETERAN:
+  case VUT_MINHP:
+  case VUT_FORM_AGE:
+  case VUT_ACTION:
+    return TRUE;
+  case VUT_IMPROVEMENT:
+    if (obsolete_by) {
+      return FALSE;
+    }
+    requirement_vector_iterate(&preq->source.value.building->obsolete_by,
+                               pobs) {
+      if (!effect_cache_req_tracked(pobs, TRUE)) {
+        return FALSE;
+      }
+    } requirement_vector_iterate_end;
+    return TRUE;
+  case VUT_TERRAIN:
+  case VUT_TERRAINCLASS:
+  case VUT_TERRFLAG:
+  case VUT_TERRAINALTER:
+  case VUT_EXTRA:
+  case VUT_EXTRAFLAG:
+  case VUT_ROADFLAG:
+  case VUT_MINLATITUDE:
+  case VUT_MAXLATITUDE:
+    /* Within the radius of effect_cache_tile_changed(). */
+    return (preq->range == REQ_RANGE_LOCAL
+            || preq->range == REQ_RANGE_TILE
+            || preq->range == REQ_RANGE_CADJACENT
+            || preq->range == REQ_RANGE_ADJACENT
+            || preq->range == REQ_RANGE_CITY);
+  default:
+    return FALSE;
+  }
+}
+
+/**********************************************************************//**
+  Find out which effect types the effect cache can keep, and forget
+  everything it has.
+**************************************************************************/
+static void effect_cache_compile(void)
+{
+  int i;
+
+  effect_cache_invalidate();
+  value_cache.enabled = FALSE;
+
+  for (i = 0; i < EFT_COUNT; i++) {
+    bool cacheable = is_server();
+
+    effect_list_iterate(ruleset_cache.effects[i], peffect) {
+      if (!cacheable) {
+        break;
+      }
+      if (peffect->multiplier != NULL) {
+        /* Multiplier values are changed by the players. */
+        cacheable = FALSE;
+        break;
+      }
+      requirement_vector_iterate(&peffect->reqs, preq) {
+        if (!effect_cache_req_tracked(preq, FALSE)) {
+          cacheable = FALSE;
+          break;
+        }
+      } requirement_vector_iterate_end;
+    } effect_list_iterate_end;
+
+    value_cache.cacheable[i] = cacheable;
+    value_cache.enabled = value_cache.enabled || cacheable;
+  }
+}
+
+/**********************************************************************//**
+  Forget all the values in the effect cache, and the requirement
+  snapshots of the players.
+**************************************************************************/
+void effect_cache_invalidate(void)
+{
+  if (!value_cache.bypassed) {
+    value_cache.epoch++;
+    req_snapshot_invalidate();
+  }
+}
+
+/**********************************************************************//**
+  Forget the values of the city, after a change of its size or radius.
+**************************************************************************/
+void effect_cache_city_changed(struct city *pcity)
+{
+  if (pcity->effect_cache != NULL && !value_cache.bypassed) {
+    pcity->effect_cache->epoch++;
+  }
+}
+
+/**********************************************************************//**
+  Forget the values of the cities which may see the tile, after its
+  terrain or its extras changed. Virtual tiles, and tiles of other maps,
+  are ignored.
+**************************************************************************/
+void effect_cache_tile_changed(const struct tile *ptile)
+{
+  const struct civ_map *nmap = &(wld.map);
+
+  if (!value_cache.enabled || value_cache.bypassed || nmap->tiles == NULL
+      || ptile < nmap->tiles
+      || ptile >= nmap->tiles + nmap->xsize * nmap->ysize) {
+    return;
+  }
+
+  /* Adjacent requirements reach the diagonal neighbours of the center. */
+  city_tile_iterate(MAX(rs_max_city_radius_sq(), 2), ptile, ctile) {
+    struct city *pcity = tile_city(ctile);
+
+    if (pcity != NULL) {
+      effect_cache_city_changed(pcity);
+    }
+  } city_tile_iterate_end;
+}
+
+/**********************************************************************//**
+  Free the effect cache of the city.
+**************************************************************************/
+void effect_cache_city_free(struct city *pcity)
+{
+  free(pcity->effect_cache);
+  pcity->effect_cache = NULL;
+}
+
+/**********************************************************************//**
+  Stop (or resume) writing to the effect caches and the requirement
+  snapshots, while other threads query effects. Returns the previous
+  state.
+**************************************************************************/
+bool effect_cache_freeze(bool freeze)
+{
+  bool was_frozen = value_cache.frozen;
+
+  value_cache.frozen = freeze;
+  req_snapshot_freeze(freeze);
+
+  return was_frozen;
+}
+
+/**********************************************************************//**
+  Stop (or resume) using the effect caches and the requirement
+  snapshots, around a hypothetical change of the game state which is
+  undone before the caches are used again. Meanwhile effects are
+  evaluated directly and the caches are not invalidated, so that they
+  are still good afterwards. Returns the previous state.
+**************************************************************************/
+bool effect_cache_bypass(bool bypass)
+{
+  bool was_bypassed = value_cache.bypassed;
+
+  value_cache.bypassed = bypass;
+  req_snapshot_bypass(bypass);
+
+  return was_bypassed;
+}
+
+/**********************************************************************//**
+  Returns the effect bonus of the context, through the cache in *pcache.
+  The context player must be given, and all the lookups through the
+  same cache must have the same context but for the output type.
+**************************************************************************/
+static int get_cached_bonus(struct effect_cache **pcache,
+                            const struct req_context *context,
+                            enum effect_type effect_type)
+{
+  struct effect_cache *pec = *pcache;
+  const struct government *gov = government_of_player(context->player);
+  int slot, bonus;
+
+  if (!value_cache.cacheable[effect_type] || value_cache.bypassed) {
+    return get_target_bonus_effects(NULL, context, NULL, effect_type);
+  }
+
+  if (pec == NULL || pec->global_epoch != value_cache.epoch
+      || pec->owner != context->player || pec->government != gov) {
+    if (value_cache.frozen) {
+      return get_target_bonus_effects(NULL, context, NULL, effect_type);
+    }
+    if (pec == NULL) {
+      pec = fc_calloc(1, sizeof(*pec));
+      *pcache = pec;
+    }
+    pec->epoch++;
+    pec->global_epoch = value_cache.epoch;
+    pec->owner = context->player;
+    pec->government = gov;
+  }
+
+  slot = effect_type * (O_LAST + 1)
+         + (context->output != NULL ? context->output->index + 1 : 0);
+  if (pec->entries[slot].epoch == pec->epoch) {
+#ifdef EFFECT_CACHE_CHECK
+    bonus = get_target_bonus_effects(NULL, context, NULL, effect_type);
+    fc_assert_msg(bonus == pec->entries[slot].value,
+                  "Cached %s is %d, evaluated %d.",
+                  effect_type_name(effect_type),
+                  pec->entries[slot].value, bonus);
+    return bonus;
+#else  /* EFFECT_CACHE_CHECK */
+    return pec->entries[slot].value;
+#endif /* EFFECT_CACHE_CHECK */
+  }
+
+  bonus = get_target_bonus_effects(NULL, context, NULL, effect_type);
+  if (!value_cache.frozen) {
+    pec->entries[slot].value = bonus;
+    pec->entries[slot].epoch = pec->epoch;
+  }
+
+  return bonus;
+}
+
+/**********************************************************************//**
+  Returns how selective the requirement is as the gate of an effect,
+  lower being more selective, or -1 if it can't be a gate. Gates must
+  hold for the effect to be active, and be quick to test.
+**************************************************************************/
+static int effect_gate_rank(const struct requirement *preq)
+{
+  if (!preq->present || preq->survives) {
+    return -1;
+  }
+
+  switch (preq->source.kind) {
+  case VUT_NATION:
+    return preq->range == REQ_RANGE_PLAYER ? 0 : -1;
+  case VUT_IMPROVEMENT:
+    return preq->range == REQ_RANGE_CITY ? 1 : -1;
+  case VUT_GOVERNMENT:
+    return 2;
+  case VUT_ADVANCE:
+    return preq->range == REQ_RANGE_PLAYER ? 3 : -1;
+  default:
+    return -1;
+  }
+}
+
+/**********************************************************************//**
+  Returns whether the target of the context has the gate. Mirrors the
+  requirement evaluation: a gate the context can't tell about is closed.
+**************************************************************************/
+static bool effect_gate_open(const struct universal *gate,
+                             const struct req_context *context)
+{
+  switch (gate->kind) {
+  case VUT_NATION:
+    return (context->player != NULL
+            && nation_of_player(context->player) == gate->value.nation);
+  case VUT_IMPROVEMENT:
+    return (context->city != NULL
+            && city_has_building(context->city, gate->value.building));
+  case VUT_GOVERNMENT:
+    return (context->player != NULL
+            && government_of_player(context->player) == gate->value.govern);
+  case VUT_ADVANCE:
+    return (context->player != NULL
+            && TECH_KNOWN == research_invention_state
+                               (research_get(context->player),
+                                advance_number(gate->value.advance)));
+  default:
+    break;
+  }
+
+  fc_assert_msg(FALSE, "Unexpected effect gate %d.", gate->kind);
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Free the effect index.
+**************************************************************************/
+static void effect_index_free(void)
+{
+  int i, j;
+
+  for (i = 0; i < EFT_COUNT; i++) {
+    if (effect_index[i].ungated != NULL) {
+      effect_list_destroy(effect_index[i].ungated);
+    }
+    for (j = 0; j < effect_index[i].num_buckets; j++) {
+      effect_list_destroy(effect_index[i].buckets[j].effects);
+    }
+    free(effect_index[i].buckets);
+  }
+
+  memset(effect_index, 0, sizeof(effect_index));
+}
+
+/**********************************************************************//**
+  Bucket the effects of every type by their gate.
+**************************************************************************/
+static void effect_index_compile(void)
+{
+  int i, j;
+
+  effect_index_free();
+
+  for (i = 0; i < EFT_COUNT; i++) {
+    effect_index[i].ungated = effect_list_new();
+
+    effect_list_iterate(ruleset_cache.effects[i], peffect) {
+      const struct requirement *gate = NULL;
+      int best = -1;
+
+      requirement_vector_iterate(&peffect->reqs, preq) {
+        int rank = effect_gate_rank(preq);
+
+        if (rank >= 0 && (best < 0 || rank < best)) {
+          gate = preq;
+          best = rank;
+        }
+      } requirement_vector_iterate_end;
+
+      if (gate == NULL) {
+        effect_list_append(effect_index[i].ungated, peffect);
+        continue;
+      }
+
+      for (j = 0; j < effect_index[i].num_buckets; j++) {
+        if (are_universals_equal(&effect_index[i].buckets[j].gate,
+                                 &gate->source)) {
+          break;
+        }
+      }
+      if (j == effect_index[i].num_buckets) {
+        effect_index[i].buckets
+          = fc_realloc(effect_index[i].buckets,
+                       (j + 1) * sizeof(*effect_index[i].buckets));
+        effect_index[i].buckets[j].gate = gate->source;
+        effect_index[i].buckets[j].effects = effect_list_new();
+        effect_index[i].num_buckets++;
+      }
+      effect_list_append(effect_index[i].buckets[j].effects, peffect);
+    } effect_list_iterate_end;
+
+    effect_index[i].valid = TRUE;
+  }
+}
+
+/**********************************************************************//**
+  Compile the requirements of all the effects, once the ruleset is fully
+  loaded. Effects changed afterwards must be compiled again.
+**************************************************************************/
+void ruleset_cache_compile(void)
+{
+  effect_list_iterate(ruleset_cache.tracker, peffect) {
+    if (peffect->reqs_program != NULL) {
+      req_program_destroy(peffect->reqs_program);
+    }
+    peffect->reqs_program = req_program_new(&peffect->reqs);
+  } effect_list_iterate_end;
+
+  effect_index_compile();
+  effect_cache_compile();
+}
+
 /**********************************************************************//**
   Free the ruleset cache. This should be called at the end of the game or
   when the client disconnects from the server. See ruleset_cache_init().
@@ -375,6 +866,16 @@ void ruleset_cache_free(void)
     }
   }
 
+  for (i = 0; i < ARRAY_SIZE(value_cache.players); i++) {
+    free(value_cache.players[i]);
+    value_cache.players[i] = NULL;
+  }
+  effect_index_free();
+  req_snapshot_free();
+  memset(value_cache.cacheable, 0, sizeof(value_cache.cacheable));
+  value_cache.enabled = FALSE;
+  effect_cache_invalidate();
+
   initialized = FALSE;
 }
 
@@ -733,34 +1234,20 @@ bool is_building_replaced(const struct city *pcity,
 }
 
 /**********************************************************************//**
-  Returns the effect bonus of a given type for any target.
-
-  context gives the target (or targets) to evaluate requirements against
-  effect_type gives the effect type to be considered
-
-  context may be NULL. This is equivalent to passing an empty context.
-
-  Returns the effect sources of this type _currently active_.
-
-  The returned vector must be freed (building_vector_free) when the caller
-  is done with it.
+  Returns the sum of the values of the active effects in the list, and
+  appends them to plist if it's not NULL.
 **************************************************************************/
-int get_target_bonus_effects(struct effect_list *plist,
-                             const struct req_context *context,
-                             const struct player *other_player,
-                             enum effect_type effect_type)
+static int get_effect_list_bonus(const struct effect_list *effects,
+                                 const struct req_context *context,
+                                 const struct player *other_player,
+                                 struct effect_list *plist)
 {
   int bonus = 0;
 
-  if (context == NULL) {
-    context = req_context_empty();
-  }
-
-  /* Loop over all effects of this type. */
-  effect_list_iterate(get_effects(effect_type), peffect) {
+  effect_list_iterate(effects, peffect) {
     /* For each effect, see if it is active. */
-    if (are_reqs_active(context, other_player,
-                        &peffect->reqs, RPT_CERTAIN)) {
+    if (are_reqs_active_program(context, other_player, &peffect->reqs,
+                                peffect->reqs_program, RPT_CERTAIN)) {
       /* This code will add value of effect. If there's multiplier for 
        * effect and target_player aren't null, then value is multiplied
        * by player's multiplier factor. */
@@ -783,6 +1270,77 @@ int get_target_bonus_effects(struct effect_list *plist,
   return bonus;
 }
 
+/**********************************************************************//**
+  Returns the effect bonus of a given type for the context, see
+  get_target_bonus_effects().
+**************************************************************************/
+static int target_bonus_effects(struct effect_list *plist,
+                                const struct req_context *context,
+                                const struct player *other_player,
+                                enum effect_type effect_type)
+{
+  int bonus = 0;
+  int i;
+
+  if (context == NULL) {
+    context = req_context_empty();
+  }
+
+  if (plist == NULL && effect_index[effect_type].valid) {
+    /* Only the effects whose gate the target has can be active. */
+    bonus = get_effect_list_bonus(effect_index[effect_type].ungated,
+                                  context, other_player, NULL);
+    for (i = 0; i < effect_index[effect_type].num_buckets; i++) {
+      const struct effect_bucket *bucket
+        = &effect_index[effect_type].buckets[i];
+
+      if (effect_gate_open(&bucket->gate, context)) {
+        bonus += get_effect_list_bonus(bucket->effects,
+                                       context, other_player, NULL);
+      }
+    }
+
+    return bonus;
+  }
+
+  /* Loop over all effects of this type. The returned list keeps the
+   * ruleset order. */
+  return get_effect_list_bonus(get_effects(effect_type), context,
+                               other_player, plist);
+}
+
+/**********************************************************************//**
+  Returns the effect bonus of a given type for any target.
+
+  context gives the target (or targets) to evaluate requirements against
+  effect_type gives the effect type to be considered
+
+  context may be NULL. This is equivalent to passing an empty context.
+
+  Returns the effect sources of this type _currently active_.
+
+  The returned vector must be freed (building_vector_free) when the caller
+  is done with it.
+**************************************************************************/
+int get_target_bonus_effects(struct effect_list *plist,
+                             const struct req_context *context,
+                             const struct player *other_player,
+                             enum effect_type effect_type)
+{
+  double start;
+  int bonus;
+
+  if (!req_profile_enabled()) {
+    return target_bonus_effects(plist, context, other_player, effect_type);
+  }
+
+  start = req_profile_effect_begin();
+  bonus = target_bonus_effects(plist, context, other_player, effect_type);
+  req_profile_effect_end(effect_type, start);
+
+  return bonus;
+}
+
 /**********************************************************************//**
   Returns the expected value of the effect of given type for given context,
   calculating value weighted with probability for each individual effect
@@ -832,12 +1390,15 @@ int get_player_bonus(const struct player *pplayer,
     return 0;
   }
 
-  return get_target_bonus_effects(NULL,
-                                  &(const struct req_context) {
-                                    .player = pplayer,
-                                  },
-                                  NULL,
-                                  effect_type);
+  if (pplayer == NULL) {
+    return get_target_bonus_effects(NULL, NULL, NULL, effect_type);
+  }
+
+  return get_cached_bonus(&value_cache.players[player_index(pplayer)],
+                          &(const struct req_context) {
+                            .player = pplayer,
+                          },
+                          effect_type);
 }
 
 /**********************************************************************//**
@@ -845,17 +1406,23 @@ int get_player_bonus(const struct player *pplayer,
 **************************************************************************/
 int get_city_bonus(const struct city *pcity, enum effect_type effect_type)
 {
+  const struct req_context context = {
+    .player = city_owner(pcity),
+    .city = pcity,
+    .tile = city_tile(pcity),
+  };
+
   if (!initialized) {
     return 0;
   }
 
-  return get_target_bonus_effects(NULL,
-                                  &(const struct req_context) {
-                                    .player = city_owner(pcity),
-                                    .city = pcity,
-                                    .tile = city_tile(pcity),
-                                  },
-                                  NULL, effect_type);
+  if (IDENTITY_NUMBER_ZERO == pcity->id) {
+    /* Virtual cities are not kept up to date. */
+    return get_target_bonus_effects(NULL, &context, NULL, effect_type);
+  }
+
+  return get_cached_bonus(&((struct city *) pcity)->effect_cache,
+                          &context, effect_type);
 }
 
 /**********************************************************************//**
@@ -969,13 +1536,12 @@ int get_player_output_bonus(const struct player *pplayer,
   fc_assert_ret_val(pplayer != NULL, 0);
   fc_assert_ret_val(poutput != NULL, 0);
   fc_assert_ret_val(effect_type != EFT_COUNT, 0);
-  return get_target_bonus_effects(NULL,
-                                  &(const struct req_context) {
-                                    .player = pplayer,
-                                    .output= poutput,
-                                  },
-                                  NULL,
-                                  effect_type);
+  return get_cached_bonus(&value_cache.players[player_index(pplayer)],
+                          &(const struct req_context) {
+                            .player = pplayer,
+                            .output = poutput,
+                          },
+                          effect_type);
 }
 
 /**********************************************************************//**
@@ -992,14 +1558,25 @@ int get_city_output_bonus(const struct city *pcity,
   fc_assert_ret_val(pcity != NULL, 0);
   fc_assert_ret_val(poutput != NULL, 0);
   fc_assert_ret_val(effect_type != EFT_COUNT, 0);
-  return get_target_bonus_effects(NULL,
-                                  &(const struct req_context) {
-                                    .player = city_owner(pcity),
-                                    .city = pcity,
-                                    .output = poutput,
-                                  },
-                                  NULL,
-                                  effect_type);
+
+  if (IDENTITY_NUMBER_ZERO == pcity->id) {
+    return get_target_bonus_effects(NULL,
+                                    &(const struct req_context) {
+                                      .player = city_owner(pcity),
+                                      .city = pcity,
+                                      .output = poutput,
+                                    },
+                                    NULL,
+                                    effect_type);
+  }
+
+  return get_cached_bonus(&((struct city *) pcity)->effect_cache,
+                          &(const struct req_context) {
+                            .player = city_owner(pcity),
+                            .city = pcity,
+                            .output = poutput,
+                          },
+                          effect_type);
 }
 
 /**********************************************************************//**
@@ -375,6 +375,9 @@ struct effect {
    * active if all of these requirement are met. */
   struct requirement_vector reqs;
 
+  /* The requirements compiled by ruleset_cache_compile(), or NULL. */
+  struct req_program *reqs_program;
+
   /* Only relevant for ruledit and other rulesave users. */
   struct {
     /* Indicates that this effect is deleted and shouldn't be saved. */
@@ -422,6 +425,7 @@ struct packet_ruleset_effect;
 
 void ruleset_cache_init(void);
 void ruleset_cache_free(void);
+void ruleset_cache_compile(void);
 void recv_ruleset_effect(const struct packet_ruleset_effect *packet);
 void send_ruleset_cache(struct conn_list *dest);
 
@@ -514,6 +518,14 @@ int get_potential_improvement_bonus(const struct impr_type *pimprove,
 
 struct effect_list *get_effects(enum effect_type effect_type);
 
+/* Cache of the effect totals of cities and players, see effects.c */
+void effect_cache_invalidate(void);
+void effect_cache_city_changed(struct city *pcity);
+void effect_cache_tile_changed(const struct tile *ptile);
+void effect_cache_city_free(struct city *pcity);
+bool effect_cache_freeze(bool freeze);
+bool effect_cache_bypass(bool bypass);
+
 typedef bool (*iec_cb)(struct effect*, void *data);
 bool iterate_effect_cache(iec_cb cb, void *data);
 
@@ -63,6 +63,8 @@ extern "C" {
 #define MAX_NUM_STARTPOS_NATIONS 1024 /* Used in the network protocol. */
 #define MAX_CALENDAR_FRAGMENTS 52     /* Used in the network protocol. */
 #define MAX_NUM_TECH_CLASSES   16     /* Used in the network protocol. */
+/* Tiles in one PACKET_TILE_INFO_BATCH. Used in the network protocol. */
+#define TILE_INFO_BATCH_MAX    64
 
 /* Changing these will probably break network compatibility. */
 #define MAX_LEN_NAME        48
@@ -25,6 +25,7 @@
 
 /* aicore */
 #include "cm.h"
+#include "path_finding.h"
 
 /* common */
 #include "ai.h"
@@ -412,6 +413,7 @@ static void game_defaults(bool keep_ruleset_value)
     game.server.scoreloglevel     = GAME_DEFAULT_SCORELOGLEVEL;
     game.server.scoreturn         = GAME_DEFAULT_SCORETURN - 1;
     game.server.seed              = GAME_DEFAULT_SEED;
+    game.server.sendqueue         = GAME_DEFAULT_SENDQUEUE;
     sz_strlcpy(game.server.start_units, GAME_DEFAULT_START_UNITS);
     game.server.spaceship_travel_pct = GAME_DEFAULT_SPACESHIP_TRAVEL_PCT;
     game.server.start_year        = GAME_DEFAULT_START_YEAR;
@@ -450,6 +452,7 @@ void game_init(bool keep_ruleset_value)
   game_ruleset_init();
   idex_init(&wld);
   cm_init();
+  pf_init();
   researches_init();
   universal_found_functions_init();
   treaties_init();
@@ -482,6 +485,7 @@ void game_free(void)
   team_slots_free();
   game_ruleset_free();
   researches_free();
+  pf_free();
   cm_free();
   modpacks_free();
 }
@@ -193,6 +193,7 @@ struct civ_game {
       int techlost_donor;
       int techlost_recv;
       int tcptimeout;
+      int sendqueue;      /* In KiB */
       int techpenalty;
       bool turnblock;
       int unitwaittime;   /* Minimal time between two movements of a unit */
@@ -617,6 +618,10 @@ static inline bool is_ruleset_compat_mode(void)
 #define GAME_MIN_TCPTIMEOUT          0
 #define GAME_MAX_TCPTIMEOUT          120
 
+#define GAME_DEFAULT_SENDQUEUE       512
+#define GAME_MIN_SENDQUEUE           256
+#define GAME_MAX_SENDQUEUE           16384
+
 #define GAME_DEFAULT_NETWAIT         4
 #define GAME_MIN_NETWAIT             0
 #define GAME_MAX_NETWAIT             20
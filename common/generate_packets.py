@@ -410,6 +410,9 @@ class FieldFlags:
     diff: bool = False
     """Whether the field should be deep-diffed for transmission"""
 
+    dense: bool = False
+    """Whether the field is a key indexing a dense cache"""
+
     add_caps: "set[str]"
     """The capabilities required to enable the field"""
 
@@ -438,6 +441,9 @@ class FieldFlags:
             if flag == "diff":
                 self.diff = True
                 continue
+            if flag == "dense":
+                self.dense = True
+                continue
             mo = __class__.ADD_CAP_PATTERN.fullmatch(flag)
             if mo is not None:
                 self.add_caps.add(mo.group(1))
@@ -451,6 +457,8 @@ class FieldFlags:
         contradictions = self.add_caps & self.remove_caps
         if contradictions:
             raise ValueError("cannot have same capabilities as both add-cap and remove-cap: " + ", ".join(contradictions))
+        if self.dense and not self.is_key:
+            raise ValueError("dense flag without key flag")
 
 
 class SizeInfo:
@@ -1481,6 +1489,11 @@ class Field:
         as part of a delta packet"""
         return self.flags.diff
 
+    @property
+    def dense(self) -> bool:
+        """Whether this key field indexes a dense cache"""
+        return self.flags.dense
+
     @property
     def all_caps(self) -> "typing.AbstractSet[str]":
         """Set of all capabilities affecting this field"""
@@ -1841,6 +1854,13 @@ class Variant:
         See Packet.cancel"""
         return self.packet.cancel
 
+    @property
+    def dense(self) -> bool:
+        """Whether the delta cache of this packet is a dense cache
+
+        See Packet.dense"""
+        return self.packet.dense
+
     @property
     def differ_used(self) -> bool:
         """Whether the send function needs a `differ` boolean.
@@ -1858,6 +1878,27 @@ class Variant:
             )
         )
 
+    @property
+    def reuse_encoding(self) -> bool:
+        """Whether the send function keeps the wire bytes of the last packet
+        it encoded, to send them as they are to the next connection which
+        would get the exact same bytes.
+
+        Only done for packets sent to lists of connections. Array-diff
+        fields are encoded against each connection's own delta state, and
+        pre-send hooks can change the packet per connection, so variants
+        using either always encode.
+
+        See get_encoding_cache()"""
+        return (
+            self.packet.want_lsend
+            and self.delta
+            and bool(self.fields)
+            and not self.no_packet
+            and not self.packet.want_pre_send
+            and not any(field.diff for field in self.fields)
+        )
+
     @property
     def condition(self) -> str:
         """The condition determining whether this variant should be used,
@@ -1969,6 +2010,41 @@ memset(stats_{self.name}_counters, 0,
        sizeof(stats_{self.name}_counters));
 """
 
+    def get_cache_declar(self, phs: str) -> str:
+        """Generate the declaration of the variable pointing to this
+        packet type's delta cache in pc->phs.<phs>: `cache` for a dense
+        cache, `hash` for a hash table"""
+        if self.dense:
+            return f"""\
+  struct dense_cache **cache = &pc->phs.{phs}[{self.type}].dense;
+"""
+        return f"""\
+  struct genhash **hash = &pc->phs.{phs}[{self.type}].hash;
+"""
+
+    def get_cancel(self, phs: str) -> str:
+        """Generate the code dropping the packets listed in self.cancel
+        with the same key as the real packet from pc->phs.<phs>"""
+        result = ""
+        for cancel_type in self.cancel:
+            target = self.packet.resolve_packet(cancel_type)
+            if target.dense:
+                result += f"""\
+
+if (nullptr != pc->phs.{phs}[{cancel_type}].dense) {{
+  dense_cache_remove(pc->phs.{phs}[{cancel_type}].dense,
+                     real_packet->{self.packet.first_field.name});
+}}
+"""
+            else:
+                result += f"""\
+
+if (nullptr != pc->phs.{phs}[{cancel_type}].hash) {{
+  genhash_remove(pc->phs.{phs}[{cancel_type}].hash, real_packet);
+}}
+"""
+        return result
+
     def get_hash(self) -> str:
         """Generate the key hash function for this variant"""
         if not self.key_fields:
@@ -2032,6 +2108,50 @@ static bool cmp_{self.name}(const void *vkey1, const void *vkey2)
 
   return !differ;
 }
+"""
+
+        return intro + body + extro
+
+    def get_encoding_cache(self) -> str:
+        """Generate the cache of the last encoded packet for this variant,
+        and the function comparing a packet against the cached one"""
+        if not self.reuse_encoding:
+            return ""
+
+        align = " " * len(f"static bool equal_{self.name}(")
+
+        # note: the names `old` and `real_packet` allow reusing
+        # field-specific cmp code
+        intro = f"""\
+#ifndef FREECIV_JSON_CONNECTION
+static struct {{
+  struct packet_encoding enc;
+  {self.name}_fields fields;
+  struct {self.packet_name} packet;
+}} encoded_{self.name};
+
+static bool equal_{self.name}(const struct {self.packet_name} *old,
+{align}const struct {self.packet_name} *real_packet)
+{{
+  bool differ;
+
+"""
+
+        body = """\
+  if (differ) {
+    return FALSE;
+  }
+
+""".join(prefix("  ", field.get_cmp()) for field in self.fields)
+
+        extro = """\
+  if (differ) {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+#endif /* FREECIV_JSON_CONNECTION */
 """
 
         return intro + body + extro
@@ -2099,9 +2219,7 @@ static bool cmp_{self.name}(const void *vkey1, const void *vkey2)
                     delta_header += """\
   bool differ;
 """
-                delta_header += f"""\
-  struct genhash **hash = pc->phs.sent + {self.type};
-"""
+                delta_header += self.get_cache_declar("sent")
                 if self.is_info != "no":
                     delta_header += f"""\
   int different = {diff};
@@ -2141,6 +2259,23 @@ static bool cmp_{self.name}(const void *vkey1, const void *vkey2)
         else:
             post=""
 
+        if self.reuse_encoding:
+            end = f"""\
+#if defined(FREECIV_DELTA_PROTOCOL) && !defined(FREECIV_JSON_CONNECTION)
+  SEND_PACKET_END_ENCODED({self.type}, &encoded_{self.name}.enc);
+#else
+  SEND_PACKET_END({self.type});
+#endif
+}}
+
+"""
+        else:
+            end = f"""\
+  SEND_PACKET_END({self.type});
+}}
+
+"""
+
         if self.fields:
             faddr = """\
 #ifdef FREECIV_JSON_CONNECTION
@@ -2171,18 +2306,30 @@ static bool cmp_{self.name}(const void *vkey1, const void *vkey2)
             pre,
             body,
             post,
-            f"""\
-  SEND_PACKET_END({self.type});
-}}
-
-""",
+            end,
         ))
 
     def get_delta_send_body(self, before_return: str = "") -> str:
         """Helper for get_send(). Generate the part of the send function
         that computes and transmits the delta between the real packet and
         the last cached packet."""
-        intro = f"""\
+        if self.dense:
+            key = self.packet.dense_key.name
+            intro = f"""\
+
+#ifdef FREECIV_DELTA_PROTOCOL
+if (nullptr == *cache) {{
+  *cache = dense_cache_new(sizeof(*old));
+}}
+BV_CLR_ALL(fields);
+
+old = dense_cache_lookup(*cache, real_packet->{key});
+if (nullptr == old) {{
+  old = dense_cache_insert(*cache, real_packet->{key});
+  fc_assert_ret_val(nullptr != old, -1);
+"""
+        else:
+            intro = f"""\
 
 #ifdef FREECIV_DELTA_PROTOCOL
 if (nullptr == *hash) {{
@@ -2229,6 +2376,34 @@ if (different == 0) {{
 {before_return}\
   return 0;
 }}
+"""
+
+        # Cancel some is-info packets.
+        cancel = self.get_cancel("sent")
+
+        if self.reuse_encoding:
+            # Same fields with the same values make the same bytes
+            if self.packet.want_post_send:
+                post = f"""\
+  post_send_{self.packet_name}(pc, real_packet);
+"""
+            else:
+                post = ""
+            body += f"""\
+
+#ifndef FREECIV_JSON_CONNECTION
+if (packet_encoding_matches(&encoded_{self.name}.enc, pc)
+    && BV_ARE_EQUAL(encoded_{self.name}.fields, fields)
+    && equal_{self.name}(&encoded_{self.name}.packet, real_packet)) {{
+  *old = *real_packet;
+{prefix("  ", cancel)}\
+{post}\
+  return packet_encoding_send(&encoded_{self.name}.enc, pc, {self.type});
+}}
+encoded_{self.name}.enc.valid = FALSE;
+encoded_{self.name}.fields = fields;
+encoded_{self.name}.packet = *real_packet;
+#endif /* FREECIV_JSON_CONNECTION */
 """
 
         body += """\
@@ -2258,15 +2433,7 @@ if (e) {
 *old = *real_packet;
 """
 
-        # Cancel some is-info packets.
-        for i in self.cancel:
-            body += f"""\
-
-hash = pc->phs.sent + {i};
-if (nullptr != *hash) {{
-  genhash_remove(*hash, real_packet);
-}}
-"""
+        body += cancel
         body += """\
 #endif /* FREECIV_DELTA_PROTOCOL */
 """
@@ -2280,7 +2447,7 @@ if (nullptr != *hash) {{
 #ifdef FREECIV_DELTA_PROTOCOL
   {self.name}_fields fields;
   struct {self.packet_name} *old;
-  struct genhash **hash = pc->phs.received + {self.type};
+{self.get_cache_declar("received")}\
 #endif /* FREECIV_DELTA_PROTOCOL */
 """
             delta_body1 = """\
@@ -2398,7 +2565,20 @@ if (nullptr != *hash) {{
 """
         else:
             fl=""
-        body = f"""\
+        if self.dense:
+            body = f"""\
+
+#ifdef FREECIV_DELTA_PROTOCOL
+if (nullptr == *cache) {{
+  *cache = dense_cache_new(sizeof(*old));
+}}
+
+old = dense_cache_lookup(*cache, real_packet->{self.packet.dense_key.name});
+if (nullptr != old) {{
+  *real_packet = *old;
+"""
+        else:
+            body = f"""\
 
 #ifdef FREECIV_DELTA_PROTOCOL
 if (nullptr == *hash) {{
@@ -2408,6 +2588,8 @@ if (nullptr == *hash) {{
 
 if (genhash_lookup(*hash, real_packet, (void **) &old)) {{
   *real_packet = *old;
+"""
+        body += f"""\
 }} else {{
 {backup_key}\
 {fl}\
@@ -2421,7 +2603,20 @@ if (genhash_lookup(*hash, real_packet, (void **) &old)) {{
             for i, field in enumerate(self.other_fields)
         )
 
-        extro = """\
+        if self.dense:
+            key = self.packet.dense_key.name
+            extro = f"""\
+
+if (nullptr == old) {{
+  old = dense_cache_insert(*cache, real_packet->{key});
+  if (nullptr == old) {{
+    RECEIVE_PACKET_FIELD_ERROR({key}, ": out of range");
+  }}
+}}
+*old = *real_packet;
+"""
+        else:
+            extro = """\
 
 if (nullptr == old) {
   old = fc_malloc(sizeof(*old));
@@ -2433,16 +2628,7 @@ if (nullptr == old) {
 """
 
         # Cancel some is-info packets.
-        extro += "".join(
-            f"""\
-
-hash = pc->phs.received + {cancel_pack};
-if (nullptr != *hash) {{
-  genhash_remove(*hash, real_packet);
-}}
-"""
-            for cancel_pack in self.cancel
-        )
+        extro += self.get_cancel("received")
 
         return body + extro + """\
 
@@ -2556,11 +2742,17 @@ class Packet:
     variants: "list[Variant]"
     """List of all variants of this packet"""
 
+    resolve_packet: "typing.Callable[[str], Packet]"
+    """Look up another packet by its type, e.g. one named in self.cancel.
+    Only valid once all packets are defined."""
+
     def __init__(self, cfg: ScriptConfig, packet_type: str, packet_number: int, flags_text: str,
-                       lines: typing.Iterable[str], resolve_type: typing.Callable[[str], RawFieldType]):
+                       lines: typing.Iterable[str], resolve_type: typing.Callable[[str], RawFieldType],
+                       resolve_packet: "typing.Callable[[str], Packet]"):
         self.cfg = cfg
         self.type = packet_type
         self.type_number = packet_number
+        self.resolve_packet = resolve_packet
 
         self.cancel = []
         dirs = set()
@@ -2637,6 +2829,14 @@ class Packet:
             if self.want_dsend:
                 raise ValueError(f"requested dsend for {self.name} without fields isn't useful")
 
+        if any(field.dense for field in self.fields):
+            if len(self.key_fields) != 1 or not self.key_fields[0].dense:
+                raise ValueError(f"dense key of {self.name} must be its only key field")
+            if (not isinstance(self.key_fields[0].type_info, IntType)
+                or isinstance(self.key_fields[0].type_info, BoolType)
+                or self.key_fields[0].all_caps):
+                raise ValueError(f"dense key of {self.name} must be a plain integer field")
+
         # create cap variants
         all_caps = self.all_caps    # valid, since self.fields is already set
         self.variants = [
@@ -2655,6 +2855,27 @@ class Packet:
         argument. This is the case iff this packet has no fields."""
         return not self.fields
 
+    @property
+    def dense_key(self) -> "Field | None":
+        """The key field indexing this packet's dense delta cache, or None
+        if the delta cache is a hash table"""
+        if self.delta and self.key_fields and self.key_fields[0].dense:
+            return self.key_fields[0]
+        return None
+
+    @property
+    def dense(self) -> bool:
+        """Whether this packet's delta cache is a dense cache
+
+        See self.dense_key"""
+        return self.dense_key is not None
+
+    @property
+    def first_field(self) -> Field:
+        """The field at the start of this packet's struct. Packets
+        cancelling others pass theirs as the key of the cancelled one."""
+        return next(chain(self.key_fields, self.other_fields))
+
     @property
     def extra_send_args(self) -> str:
         """Arguments for the regular send function"""
@@ -2810,9 +3031,11 @@ struct {self.name} {{
                 result += """\
 #ifdef FREECIV_DELTA_PROTOCOL
 """
-                result += v.get_hash()
-                result += v.get_cmp()
+                if not v.dense:
+                    result += v.get_hash()
+                    result += v.get_cmp()
                 result += v.get_bitvector()
+                result += v.get_encoding_cache()
                 result += """\
 #endif /* FREECIV_DELTA_PROTOCOL */
 
@@ -3038,6 +3261,7 @@ class PacketsDefinition(typing.Iterable[Packet]):
                         lines_iter, # advance the iterator used by this for loop
                     ),
                     self.resolve_type,
+                    self.packets_by_type.__getitem__,
                 )
 
                 self.packets.append(packet)
@@ -3206,6 +3430,33 @@ bool packet_has_game_info_flag(enum packet_type type)
   return (type < PACKET_LAST ? flag[type] : FALSE);
 }
 
+"""
+        return intro + body + extro
+
+    @property
+    def code_packet_has_dense_cache(self) -> str:
+        """Code fragment implementing the packet_has_dense_cache()
+        function"""
+        intro = """\
+bool packet_has_dense_cache(enum packet_type type)
+{
+  static const bool flag[PACKET_LAST] = {
+"""
+        body = ""
+        for _, packet, skipped in self.iter_by_number():
+            body += """\
+    FALSE,
+""" * skipped
+            body += f"""\
+    {"TRUE" if packet.dense else "FALSE"}, /* {packet.type} */
+"""
+
+        extro = """\
+  };
+
+  return (type < PACKET_LAST ? flag[type] : FALSE);
+}
+
 """
         return intro + body + extro
 
@@ -3446,6 +3697,7 @@ def write_common_impl(path: "str | Path | None", packets: PacketsDefinition):
 /* utility */
 #include "bitvector.h"
 #include "capability.h"
+#include "densecache.h"
 #include "genhash.h"
 #include "log.h"
 #include "mem.h"
@@ -3490,6 +3742,7 @@ static int stats_total_sent;
 
         output_c.write(packets.code_packet_name)
         output_c.write(packets.code_packet_has_game_info_flag)
+        output_c.write(packets.code_packet_has_dense_cache)
 
         # write hash, cmp, send, receive
         for p in packets:
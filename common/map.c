@@ -15,6 +15,8 @@
 #include <fc_config.h>
 #endif
 
+#include <string.h>
+
 /* utility */
 #include "fcintl.h"
 #include "iterator.h"
@@ -94,6 +96,17 @@ static bool is_cardinal_dir_calculate(enum direction8 dir);
 static bool restrict_infra(const struct player *pplayer, const struct tile *t1,
                            const struct tile *t2);
 
+/* Move costs of the unit classes with the UCF_TERRAIN_SPEED flag, indexed
+ * by tile_index(src) * 8 + dir, see map_move_cost_dir(). */
+struct move_cost_tables {
+  unsigned short *classes[UCL_LAST];
+};
+
+/* The entry is not computed yet. */
+#define MOVE_COST_UNKNOWN 0xFFFF
+/* Set when roads lower the cost, which restrictinfra may forbid. */
+#define MOVE_COST_ROAD 0x8000
+
 /*******************************************************************//**
   Return a bitfield of the extras on the tile that are infrastructure.
 ***********************************************************************/
@@ -162,6 +175,7 @@ void map_init(struct civ_map *imap, bool server_side)
   imap->num_oceans = 0;
   imap->tiles = nullptr;
   imap->startpos_table = nullptr;
+  imap->move_costs = nullptr;
   imap->iterate_outwards_indices = nullptr;
 
   /* The [xy]size values are set in map_init_topology. It is initialized
@@ -517,6 +531,9 @@ void map_allocate(struct civ_map *amap)
     startpos_hash_destroy(amap->startpos_table);
   }
   amap->startpos_table = startpos_hash_new();
+
+  fc_assert(amap->move_costs == nullptr);
+  amap->move_costs = fc_calloc(1, sizeof(*amap->move_costs));
 }
 
 /*******************************************************************//**
@@ -552,6 +569,15 @@ void map_free(struct civ_map *fmap)
 
     FC_FREE(fmap->iterate_outwards_indices);
   }
+
+  if (fmap->move_costs != nullptr) {
+    int i;
+
+    for (i = 0; i < UCL_LAST; i++) {
+      free(fmap->move_costs->classes[i]);
+    }
+    FC_FREE(fmap->move_costs);
+  }
 }
 
 /*******************************************************************//**
@@ -775,63 +801,16 @@ bool terrain_surroundings_allow_change(const struct civ_map *nmap,
 }
 
 /*******************************************************************//**
-  The basic cost to move punit from tile t1 to tile t2.
-  That is, tile_move_cost(), with pre-calculated tile pointers;
-  the tiles are assumed to be adjacent, and the (x, y)
-  values are used only to get the river bonus correct.
-
-  May also be used with punit == nullptr, in which case punit
-  tests are not done (for unit-independent results).
+  The cost for a unit of the class to move from tile t1 to the adjacent
+  tile t2, both native, considering the roads it may use. 'ri' tells
+  whether the restrictinfra rules apply to the move.
 ***********************************************************************/
-int tile_move_cost_ptrs(const struct civ_map *nmap,
-                        const struct unit *punit,
-                        const struct unit_type *punittype,
-                        const struct player *pplayer,
-                        const struct tile *t1, const struct tile *t2)
+static int tile_move_cost_roads(const struct civ_map *nmap,
+                                const struct unit_class *pclass, bool ri,
+                                const struct tile *t1, const struct tile *t2,
+                                signed char *cardinal_move)
 {
-  const struct unit_class *pclass = utype_class(punittype);
-  int cost;
-  signed char cardinal_move = -1;
-  bool ri;
-
-  /* Try to exit early for detectable conditions */
-  if (!uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
-    /* Units without UCF_TERRAIN_SPEED have a constant cost. */
-    return SINGLE_MOVE;
-
-  } else if (!is_native_tile_to_class(pclass, t2)) {
-    if (tile_city(t2) == nullptr) {
-      /* Loading to transport. */
-
-      /* UTYF_IGTER units get move benefit. */
-      return (utype_has_flag(punittype, UTYF_IGTER)
-              ? MOVE_COST_IGTER : SINGLE_MOVE);
-    } else {
-      /* Entering port. (Could be "Conquer City") */
-
-      /* UTYF_IGTER units get move benefit. */
-      return (utype_has_flag(punittype, UTYF_IGTER)
-              ? MOVE_COST_IGTER : SINGLE_MOVE);
-    }
-
-  } else if (!is_native_tile_to_class(pclass, t1)) {
-    if (tile_city(t1) == nullptr) {
-      /* Disembarking from transport. */
-
-      /* UTYF_IGTER units get move benefit. */
-      return (utype_has_flag(punittype, UTYF_IGTER)
-              ? MOVE_COST_IGTER : SINGLE_MOVE);
-    } else {
-      /* Leaving port. */
-
-      /* UTYF_IGTER units get move benefit. */
-      return (utype_has_flag(punittype, UTYF_IGTER)
-              ? MOVE_COST_IGTER : SINGLE_MOVE);
-    }
-  }
-
-  cost = tile_terrain(t2)->movement_cost * SINGLE_MOVE;
-  ri = restrict_infra(pplayer, t1, t2);
+  int cost = tile_terrain(t2)->movement_cost * SINGLE_MOVE;
 
   extra_type_list_iterate(pclass->cache.bonus_roads, pextra) {
     struct road_type *proad = extra_road_get(pextra);
@@ -852,11 +831,11 @@ int tile_move_cost_ptrs(const struct civ_map *nmap,
           if (proad->move_mode == RMM_FAST_ALWAYS) {
             cost = proad->move_cost;
           } else {
-            if (cardinal_move < 0) {
-              cardinal_move = (ALL_DIRECTIONS_CARDINAL()
-                               || is_move_cardinal(nmap, t1, t2)) ? 1 : 0;
+            if (*cardinal_move < 0) {
+              *cardinal_move = (ALL_DIRECTIONS_CARDINAL()
+                                || is_move_cardinal(nmap, t1, t2)) ? 1 : 0;
             }
-            if (cardinal_move > 0) {
+            if (*cardinal_move > 0) {
               cost = proad->move_cost;
             } else {
               switch (proad->move_mode) {
@@ -894,11 +873,17 @@ int tile_move_cost_ptrs(const struct civ_map *nmap,
     }
   } extra_type_list_iterate_end;
 
-  /* UTYF_IGTER units have a maximum move cost per step. */
-  if (utype_has_flag(punittype, UTYF_IGTER) && MOVE_COST_IGTER < cost) {
-    cost = MOVE_COST_IGTER;
-  }
+  return cost;
+}
 
+/*******************************************************************//**
+  Apply the pythagorean_diagonal rule to the cost of a move from t1 to t2.
+***********************************************************************/
+static inline int tile_move_cost_diagonal(const struct civ_map *nmap,
+                                          const struct tile *t1,
+                                          const struct tile *t2, int cost,
+                                          signed char cardinal_move)
+{
   if (terrain_control.pythagorean_diagonal) {
     if (cardinal_move < 0) {
       cardinal_move = (ALL_DIRECTIONS_CARDINAL()
@@ -912,6 +897,204 @@ int tile_move_cost_ptrs(const struct civ_map *nmap,
   return cost;
 }
 
+/*******************************************************************//**
+  The basic cost to move punit from tile t1 to tile t2.
+  That is, tile_move_cost(), with pre-calculated tile pointers;
+  the tiles are assumed to be adjacent, and the (x, y)
+  values are used only to get the river bonus correct.
+
+  May also be used with punit == nullptr, in which case punit
+  tests are not done (for unit-independent results).
+***********************************************************************/
+int tile_move_cost_ptrs(const struct civ_map *nmap,
+                        const struct unit *punit,
+                        const struct unit_type *punittype,
+                        const struct player *pplayer,
+                        const struct tile *t1, const struct tile *t2)
+{
+  const struct unit_class *pclass = utype_class(punittype);
+  int cost;
+  signed char cardinal_move = -1;
+
+  /* Try to exit early for detectable conditions */
+  if (!uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+    /* Units without UCF_TERRAIN_SPEED have a constant cost. */
+    return SINGLE_MOVE;
+
+  } else if (!is_native_tile_to_class(pclass, t2)) {
+    if (tile_city(t2) == nullptr) {
+      /* Loading to transport. */
+
+      /* UTYF_IGTER units get move benefit. */
+      return (utype_has_flag(punittype, UTYF_IGTER)
+              ? MOVE_COST_IGTER : SINGLE_MOVE);
+    } else {
+      /* Entering port. (Could be "Conquer City") */
+
+      /* UTYF_IGTER units get move benefit. */
+      return (utype_has_flag(punittype, UTYF_IGTER)
+              ? MOVE_COST_IGTER : SINGLE_MOVE);
+    }
+
+  } else if (!is_native_tile_to_class(pclass, t1)) {
+    if (tile_city(t1) == nullptr) {
+      /* Disembarking from transport. */
+
+      /* UTYF_IGTER units get move benefit. */
+      return (utype_has_flag(punittype, UTYF_IGTER)
+              ? MOVE_COST_IGTER : SINGLE_MOVE);
+    } else {
+      /* Leaving port. */
+
+      /* UTYF_IGTER units get move benefit. */
+      return (utype_has_flag(punittype, UTYF_IGTER)
+              ? MOVE_COST_IGTER : SINGLE_MOVE);
+    }
+  }
+
+  cost = tile_move_cost_roads(nmap, pclass, restrict_infra(pplayer, t1, t2),
+                              t1, t2, &cardinal_move);
+
+  /* UTYF_IGTER units have a maximum move cost per step. */
+  if (utype_has_flag(punittype, UTYF_IGTER) && MOVE_COST_IGTER < cost) {
+    cost = MOVE_COST_IGTER;
+  }
+
+  return tile_move_cost_diagonal(nmap, t1, t2, cost, cardinal_move);
+}
+
+/*******************************************************************//**
+  Compute the move cost table entry for a move of a unit of the class
+  from t1 to t2, without the restrictinfra rules.
+***********************************************************************/
+static unsigned short move_cost_entry(const struct civ_map *nmap,
+                                      const struct unit_class *pclass,
+                                      const struct tile *t1,
+                                      const struct tile *t2)
+{
+  signed char cardinal_move = -1;
+  int cost;
+
+  if (!is_native_tile_to_class(pclass, t2)
+      || !is_native_tile_to_class(pclass, t1)) {
+    /* Loading to or disembarking from transport, or moving to or from a
+     * port. */
+    return SINGLE_MOVE;
+  }
+
+  cost = tile_move_cost_roads(nmap, pclass, FALSE, t1, t2, &cardinal_move);
+  if (cost < tile_terrain(t2)->movement_cost * SINGLE_MOVE) {
+    return tile_move_cost_diagonal(nmap, t1, t2, cost, cardinal_move)
+           | MOVE_COST_ROAD;
+  }
+
+  return tile_move_cost_diagonal(nmap, t1, t2, cost, cardinal_move);
+}
+
+/*******************************************************************//**
+  Same as map_move_cost(), for the move from the tile t1 of the map to its
+  adjacent tile in the direction 'dir', t2. The costs of the unit classes
+  are kept in tables, filled as the moves are asked for and invalidated by
+  map_move_costs_tile_changed().
+
+  The table entries may be filled concurrently by several threads, which
+  then write the same value; see map_move_costs_prepare() for the
+  allocation of the tables.
+***********************************************************************/
+int map_move_cost_dir(const struct civ_map *nmap,
+                      const struct player *pplayer,
+                      const struct unit_type *punittype,
+                      const struct tile *t1, const struct tile *t2,
+                      enum direction8 dir)
+{
+  const struct unit_class *pclass = utype_class(punittype);
+  unsigned short *table;
+  unsigned short entry;
+
+  if (!uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+    /* Units without UCF_TERRAIN_SPEED have a constant cost. */
+    return SINGLE_MOVE;
+  }
+
+  if (nmap->move_costs == nullptr
+      || utype_has_flag(punittype, UTYF_IGTER)) {
+    return tile_move_cost_ptrs(nmap, nullptr, punittype, pplayer, t1, t2);
+  }
+
+  table = nmap->move_costs->classes[uclass_index(pclass)];
+  if (table == nullptr) {
+    map_move_costs_prepare(nmap);
+    table = nmap->move_costs->classes[uclass_index(pclass)];
+  }
+
+  entry = table[tile_index(t1) * 8 + dir];
+  if (entry == MOVE_COST_UNKNOWN) {
+    entry = move_cost_entry(nmap, pclass, t1, t2);
+    table[tile_index(t1) * 8 + dir] = entry;
+  }
+
+  if ((entry & MOVE_COST_ROAD) && restrict_infra(pplayer, t1, t2)) {
+    /* Some of the roads may not be usable. */
+    return tile_move_cost_ptrs(nmap, nullptr, punittype, pplayer, t1, t2);
+  }
+
+  return entry & ~MOVE_COST_ROAD;
+}
+
+/*******************************************************************//**
+  Allocate the move cost tables of all the unit classes which need one.
+  They are else allocated on demand, which must not happen while several
+  threads use map_move_cost_dir().
+***********************************************************************/
+void map_move_costs_prepare(const struct civ_map *nmap)
+{
+  size_t size = nmap->xsize * nmap->ysize * 8 * sizeof(unsigned short);
+
+  if (nmap->move_costs == nullptr || nmap->tiles == nullptr) {
+    return;
+  }
+
+  unit_class_iterate(pclass) {
+    unsigned short **table = &nmap->move_costs->classes[uclass_index(pclass)];
+
+    if (*table == nullptr && uclass_has_flag(pclass, UCF_TERRAIN_SPEED)) {
+      *table = fc_malloc(size);
+      memset(*table, 0xFF, size);
+    }
+  } unit_class_iterate_end;
+}
+
+/*******************************************************************//**
+  Forget the move costs from and through the tile, after its terrain or
+  its extras changed. Virtual tiles, and tiles of other maps, are ignored.
+***********************************************************************/
+void map_move_costs_tile_changed(const struct civ_map *nmap,
+                                 const struct tile *ptile)
+{
+  int i;
+
+  if (nmap->move_costs == nullptr || nmap->tiles == nullptr
+      || ptile < nmap->tiles
+      || ptile >= nmap->tiles + nmap->xsize * nmap->ysize) {
+    return;
+  }
+
+  for (i = 0; i < UCL_LAST; i++) {
+    unsigned short *table = nmap->move_costs->classes[i];
+
+    if (table == nullptr) {
+      continue;
+    }
+
+    /* The moves from the tile and to it, and the diagonal moves between
+     * its neighbours, which may use a road on it with RMM_RELAXED. */
+    memset(table + tile_index(ptile) * 8, 0xFF, 8 * sizeof(*table));
+    adjc_iterate(nmap, ptile, adjc_tile) {
+      memset(table + tile_index(adjc_tile) * 8, 0xFF, 8 * sizeof(*table));
+    } adjc_iterate_end;
+  }
+}
+
 /*******************************************************************//**
   Returns TRUE if there is a restriction with regard to the infrastructure,
   i.e. at least one of the tiles t1 and t2 is claimed by a unfriendly
@@ -271,6 +271,14 @@ int tile_move_cost_ptrs(const struct civ_map *nmap,
                         const struct unit_type *punittype,
                         const struct player *pplayer,
                         const struct tile *t1, const struct tile *t2);
+int map_move_cost_dir(const struct civ_map *nmap,
+                      const struct player *pplayer,
+                      const struct unit_type *punittype,
+                      const struct tile *t1, const struct tile *t2,
+                      enum direction8 dir);
+void map_move_costs_prepare(const struct civ_map *nmap);
+void map_move_costs_tile_changed(const struct civ_map *nmap,
+                                 const struct tile *ptile);
 
 /***************************************************************
   The cost to move punit from where it is to tile x,y.
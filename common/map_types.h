@@ -29,6 +29,7 @@ extern "C" {
 #define terrain_misc packet_ruleset_terrain_control
 
 /* Some types used below. */
+struct move_cost_tables;
 struct nation_hash;
 struct nation_type;
 struct packet_edit_startpos_full;
@@ -83,6 +84,7 @@ struct civ_map {
   int num_oceans;     /* Not updated at the client */
   struct tile *tiles;
   struct startpos_hash *startpos_table;
+  struct move_cost_tables *move_costs; /* See map_move_cost_dir(). */
 
   union {
     struct {
@@ -32,6 +32,8 @@ extern "C" {
 #define MAX_LEN_CONTENT  (MAX_LEN_PACKET - 20)
 
 #define MAX_LEN_BUFFER   (MAX_LEN_PACKET * 128)
+/* Cap of the urgent send lane of a connection; see connection.h. */
+#define MAX_LEN_URGENT_BUFFER (MAX_LEN_PACKET * 32)
 
 /* Used in network protocol. */
 #define MAX_LEN_MSG             1536
@@ -33,11 +33,14 @@
 #endif
 
 /* utility */
+#include "capability.h"
+#include "densecache.h"
 #include "fcintl.h"
 #include "genhash.h"
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "netpoll.h"
 #include "support.h"            /* fc_str(n)casecmp */
 
 /* common */
@@ -99,25 +102,33 @@ void connection_close(struct connection *pconn, const char *reason)
 
 /**********************************************************************//**
   Make sure that there is at least extra_space bytes free space in buffer,
-  allocating more memory if needed.
+  allocating more memory if needed. Fails if the buffer would grow past
+  limit bytes.
 **************************************************************************/
 static bool buffer_ensure_free_extra_space(struct socket_packet_buffer *buf,
-                                           int extra_space)
+                                           int extra_space, int limit)
 {
   /* room for more? */
   if (buf->nsize - buf->ndata < extra_space) {
-    buf->nsize = buf->ndata + extra_space;
-
     /* added this check so we don't gobble up too much mem */
-    if (buf->nsize > MAX_LEN_BUFFER) {
+    if (buf->ndata + extra_space > limit) {
       return FALSE;
     }
+    buf->nsize = buf->ndata + extra_space;
     buf->data = (unsigned char *) fc_realloc(buf->data, buf->nsize);
   }
 
   return TRUE;
 }
 
+/**********************************************************************//**
+  How many bytes may wait in the send_buffer of a connection.
+**************************************************************************/
+static int send_queue_limit(void)
+{
+  return (is_server() ? game.server.sendqueue * 1024 : MAX_LEN_BUFFER);
+}
+
 /**********************************************************************//**
   Read data from socket, and check if a packet is ready.
   Returns:
@@ -130,7 +141,8 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer)
 {
   int didget;
 
-  if (!buffer_ensure_free_extra_space(buffer, MAX_LEN_PACKET)) {
+  if (!buffer_ensure_free_extra_space(buffer, MAX_LEN_PACKET,
+                                      MAX_LEN_BUFFER)) {
     log_error("can't grow buffer");
     return -1;
   }
@@ -158,30 +170,51 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer)
   return -1;
 }
 
+/**********************************************************************//**
+  Note that nput bytes were written from the send_buffer of pc, from
+  offset start, and find out how much of the packet or compressed block
+  they end in is still to be written.
+**************************************************************************/
+static void send_unit_advance(struct connection *pc, int start, int nput)
+{
+#ifndef FREECIV_JSON_CONNECTION
+  struct socket_packet_buffer *buf = pc->send_buffer;
+  int pos = start + pc->send_unit_left;
+  int end = start + nput;
+
+  while (pos < end) {
+    pos += packet_wire_length(pc, buf->data + pos, buf->ndata - pos);
+  }
+  pc->send_unit_left = pos - end;
+#endif /* FREECIV_JSON_CONNECTION */
+}
+
 /**********************************************************************//**
   Write wrapper function -vasc
+  Writes the urgent lane first, but never in the middle of a packet or
+  compressed block of the send_buffer. Stops when limit bytes or less
+  are left.
 **************************************************************************/
-static int write_socket_data(struct connection *pc,
-                             struct socket_packet_buffer *buf, int limit)
+static int write_socket_data(struct connection *pc, int limit)
 {
-  int start, nput, nblock;
+  struct socket_packet_buffer *buf = pc->send_buffer;
+  struct socket_packet_buffer *urgent = pc->urgent_buffer;
+  int start, ustart, nput, nblock;
 
   if (is_server() && pc->server.is_closing) {
     return 0;
   }
 
-  for (start = 0; buf->ndata-start > limit;) {
-    fd_set writefs, exceptfs;
-    fc_timeval tv;
-
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-    FD_SET(pc->sock, &writefs);
-    FD_SET(pc->sock, &exceptfs);
+  for (start = 0, ustart = 0;
+       buf->ndata - start + (NULL != urgent ? urgent->ndata - ustart : 0)
+       > limit;) {
+    struct netpoll_event ready;
 
-    tv.tv_sec = 0; tv.tv_usec = 0;
+    /* Not select(), the socket may be above FD_SETSIZE. */
+    ready.fd = pc->sock;
+    ready.events = NETPOLL_WRITE | NETPOLL_ERROR;
 
-    if (fc_select(pc->sock + 1, NULL, &writefs, &exceptfs, &tv) <= 0) {
+    if (netpoll_wait_fds(&ready, 1, 0) <= 0) {
       if (errno != EINTR) {
         break;
       } else {
@@ -191,16 +224,27 @@ static int write_socket_data(struct connection *pc,
       }
     }
 
-    if (FD_ISSET(pc->sock, &exceptfs)) {
+    if (ready.events & NETPOLL_ERROR) {
       connection_close(pc, _("network exception"));
       return -1;
     }
 
-    if (FD_ISSET(pc->sock, &writefs)) {
-      nblock = MIN(buf->ndata-start, MAX_LEN_PACKET);
-      log_debug("trying to write %d limit=%d", nblock, limit);
-      if ((nput = fc_writesocket(pc->sock, 
-                                 (const char *)buf->data+start, nblock)) == -1) {
+    if (ready.events & NETPOLL_WRITE) {
+      bool use_urgent = (NULL != urgent && urgent->ndata > ustart
+                         && 0 == pc->send_unit_left);
+      struct socket_packet_buffer *lane = (use_urgent ? urgent : buf);
+      int from = (use_urgent ? ustart : start);
+
+      if (lane->ndata == from) {
+        /* Only the start of a compressed block was added yet. */
+        break;
+      }
+
+      nblock = MIN(lane->ndata - from, MAX_LEN_PACKET);
+      log_debug("trying to write %d limit=%d%s", nblock, limit,
+                use_urgent ? " (urgent)" : "");
+      if ((nput = fc_writesocket(pc->sock,
+                                 (const char *)lane->data+from, nblock)) == -1) {
 #ifdef NONBLOCKING_SOCKETS
         if (errno == EWOULDBLOCK || errno == EAGAIN) {
           break;
@@ -209,13 +253,24 @@ static int write_socket_data(struct connection *pc,
         connection_close(pc, _("lagging connection"));
         return -1;
       }
-      start += nput;
+      if (use_urgent) {
+        ustart += nput;
+      } else {
+        send_unit_advance(pc, start, nput);
+        start += nput;
+      }
     }
   }
 
+  if (ustart > 0) {
+    urgent->ndata -= ustart;
+    memmove(urgent->data, urgent->data + ustart, urgent->ndata);
+  }
   if (start > 0) {
     buf->ndata -= start;
     memmove(buf->data, buf->data+start, buf->ndata);
+  }
+  if (start > 0 || ustart > 0) {
     pc->last_write = timer_renew(pc->last_write, TIMER_USER, TIMER_ACTIVE,
                                  pc->last_write != NULL ? NULL : "socket write");
     timer_start(pc->last_write);
@@ -229,11 +284,10 @@ static int write_socket_data(struct connection *pc,
 **************************************************************************/
 void flush_connection_send_buffer_all(struct connection *pc)
 {
-  if (pc && pc->used && pc->send_buffer->ndata > 0) {
-    write_socket_data(pc, pc->send_buffer, 0);
+  if (pc && pc->used && connection_send_queued(pc) > 0) {
+    write_socket_data(pc, 0);
     if (pc->notify_of_writable_data) {
-      pc->notify_of_writable_data(pc, pc->send_buffer
-                                  && pc->send_buffer->ndata > 0);
+      pc->notify_of_writable_data(pc, connection_send_queued(pc) > 0);
     }
   }
 }
@@ -244,23 +298,24 @@ void flush_connection_send_buffer_all(struct connection *pc)
 #ifndef FREECIV_JSON_CONNECTION
 static void flush_connection_send_buffer_packets(struct connection *pc)
 {
-  if (pc && pc->used && pc->send_buffer->ndata >= MAX_LEN_PACKET) {
-    write_socket_data(pc, pc->send_buffer, MAX_LEN_PACKET-1);
+  if (pc && pc->used && connection_send_queued(pc) >= MAX_LEN_PACKET) {
+    write_socket_data(pc, MAX_LEN_PACKET-1);
     if (pc->notify_of_writable_data) {
-      pc->notify_of_writable_data(pc, pc->send_buffer
-                                  && pc->send_buffer->ndata > 0);
+      pc->notify_of_writable_data(pc, connection_send_queued(pc) > 0);
     }
   }
 }
 #endif /* FREECIV_JSON_CONNECTION */
 
 /**********************************************************************//**
-  Add data to send to the connection.
+  Add data to send to the connection, in the lane buf which may hold
+  limit bytes.
 **************************************************************************/
 static bool add_connection_data(struct connection *pconn,
+                                struct socket_packet_buffer *buf, int limit,
                                 const unsigned char *data, int len)
 {
-  struct socket_packet_buffer *buf;
+  int queued;
 
   if (NULL == pconn
       || !pconn->used
@@ -268,9 +323,13 @@ static bool add_connection_data(struct connection *pconn,
     return TRUE;
   }
 
-  buf = pconn->send_buffer;
   log_debug("add %d bytes to %d (space =%d)", len, buf->ndata, buf->nsize);
-  if (!buffer_ensure_free_extra_space(buf, len)) {
+  if (!buffer_ensure_free_extra_space(buf, len, limit)) {
+    log_normal("Send queue of %s is full: %d bytes waiting "
+               "(%d urgent), %d more to add.",
+               conn_description(pconn), connection_send_queued(pconn),
+               NULL != pconn->urgent_buffer
+               ? pconn->urgent_buffer->ndata : 0, len);
     connection_close(pconn, _("buffer overflow"));
     return FALSE;
   }
@@ -278,6 +337,16 @@ static bool add_connection_data(struct connection *pconn,
   memcpy(buf->data + buf->ndata, data, len);
   buf->ndata += len;
 
+  queued = connection_send_queued(pconn);
+  if (queued > pconn->statistics.send_queue_peak) {
+    pconn->statistics.send_queue_peak = queued;
+  }
+
+  if (queued == len && 0 < len && pconn->notify_of_writable_data) {
+    /* The buffer was empty, there is something to write now. */
+    pconn->notify_of_writable_data(pconn, TRUE);
+  }
+
   return TRUE;
 }
 
@@ -298,7 +367,8 @@ bool connection_send_data(struct connection *pconn,
 #ifndef FREECIV_JSON_CONNECTION
   if (0 < pconn->send_buffer->do_buffer_sends) {
     flush_connection_send_buffer_packets(pconn);
-    if (!add_connection_data(pconn, data, len)) {
+    if (!add_connection_data(pconn, pconn->send_buffer, send_queue_limit(),
+                             data, len)) {
       log_verbose("cut connection %s due to huge send buffer (1)",
                   conn_description(pconn));
       return FALSE;
@@ -308,7 +378,8 @@ bool connection_send_data(struct connection *pconn,
 #endif /* FREECIV_JSON_CONNECTION */
   {
     flush_connection_send_buffer_all(pconn);
-    if (!add_connection_data(pconn, data, len)) {
+    if (!add_connection_data(pconn, pconn->send_buffer, send_queue_limit(),
+                             data, len)) {
       log_verbose("cut connection %s due to huge send buffer (2)",
                   conn_description(pconn));
       return FALSE;
@@ -318,6 +389,71 @@ bool connection_send_data(struct connection *pconn,
   return TRUE;
 }
 
+/**********************************************************************//**
+  Write data to socket ahead of what waits in the send buffer. Only for
+  whole packets that the other end can handle out of order; see
+  packet_is_urgent(). Return TRUE on success.
+**************************************************************************/
+bool connection_send_urgent_data(struct connection *pconn,
+                                 const unsigned char *data, int len)
+{
+  if (NULL == pconn
+      || !pconn->used
+      || (is_server() && pconn->server.is_closing)) {
+    return TRUE;
+  }
+
+  fc_assert_ret_val(NULL != pconn->urgent_buffer, FALSE);
+
+  pconn->statistics.bytes_send += len;
+  pconn->statistics.urgent_bytes_send += len;
+
+  if (!add_connection_data(pconn, pconn->urgent_buffer,
+                           MAX_LEN_URGENT_BUFFER, data, len)) {
+    log_verbose("cut connection %s due to huge urgent send buffer",
+                conn_description(pconn));
+    return FALSE;
+  }
+
+#ifndef FREECIV_JSON_CONNECTION
+  if (0 < pconn->send_buffer->do_buffer_sends) {
+    flush_connection_send_buffer_packets(pconn);
+  } else
+#endif /* FREECIV_JSON_CONNECTION */
+  {
+    flush_connection_send_buffer_all(pconn);
+  }
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Return how many bytes wait to be written to the connection.
+**************************************************************************/
+int connection_send_queued(const struct connection *pconn)
+{
+  int queued = 0;
+
+  if (NULL != pconn->send_buffer) {
+    queued += pconn->send_buffer->ndata;
+  }
+  if (NULL != pconn->urgent_buffer) {
+    queued += pconn->urgent_buffer->ndata;
+  }
+
+  return queued;
+}
+
+/**********************************************************************//**
+  Return TRUE if so much waits in the send buffer of the connection that
+  updates superseding each other should rather be held back.
+**************************************************************************/
+bool connection_send_congested(const struct connection *pconn)
+{
+  return (NULL != pconn->send_buffer
+          && pconn->send_buffer->ndata > send_queue_limit() / 4);
+}
+
 /**********************************************************************//**
   Turn on buffering, using a counter so that calls may be nested.
 **************************************************************************/
@@ -346,6 +482,7 @@ void connection_do_unbuffer(struct connection *pc)
   }
 
   if (0 == pc->send_buffer->do_buffer_sends) {
+    tile_info_batch_flush(pc);
     flush_connection_send_buffer_all(pc);
   }
 }
@@ -561,10 +698,43 @@ static void init_packet_hashs(struct connection *pc)
   pc->phs.sent = fc_malloc(sizeof(*pc->phs.sent) * PACKET_LAST);
   pc->phs.received = fc_malloc(sizeof(*pc->phs.received) * PACKET_LAST);
   pc->phs.handlers = packet_handlers_initial();
+  pc->phs.tile_batch = NULL;
 
   for (i = 0; i < PACKET_LAST; i++) {
-    pc->phs.sent[i] = NULL;
-    pc->phs.received[i] = NULL;
+    pc->phs.sent[i].hash = NULL;
+    pc->phs.received[i].hash = NULL;
+  }
+}
+
+/**********************************************************************//**
+  Free the delta cache of one packet type.
+**************************************************************************/
+static void packet_delta_cache_destroy(union packet_delta_cache *pcache,
+                                       enum packet_type type)
+{
+  if (packet_has_dense_cache(type)) {
+    if (NULL != pcache->dense) {
+      dense_cache_destroy(pcache->dense);
+      pcache->dense = NULL;
+    }
+  } else if (NULL != pcache->hash) {
+    genhash_destroy(pcache->hash);
+    pcache->hash = NULL;
+  }
+}
+
+/**********************************************************************//**
+  Drop all packets from the delta cache of one packet type.
+**************************************************************************/
+static void packet_delta_cache_clear(union packet_delta_cache *pcache,
+                                     enum packet_type type)
+{
+  if (packet_has_dense_cache(type)) {
+    if (NULL != pcache->dense) {
+      dense_cache_clear(pcache->dense);
+    }
+  } else if (NULL != pcache->hash) {
+    genhash_clear(pcache->hash);
   }
 }
 
@@ -577,9 +747,7 @@ static void free_packet_hashes(struct connection *pc)
 
   if (pc->phs.sent) {
     for (i = 0; i < PACKET_LAST; i++) {
-      if (pc->phs.sent[i] != NULL) {
-        genhash_destroy(pc->phs.sent[i]);
-      }
+      packet_delta_cache_destroy(pc->phs.sent + i, i);
     }
     free(pc->phs.sent);
     pc->phs.sent = NULL;
@@ -587,13 +755,16 @@ static void free_packet_hashes(struct connection *pc)
 
   if (pc->phs.received) {
     for (i = 0; i < PACKET_LAST; i++) {
-      if (pc->phs.received[i] != NULL) {
-        genhash_destroy(pc->phs.received[i]);
-      }
+      packet_delta_cache_destroy(pc->phs.received + i, i);
     }
     free(pc->phs.received);
     pc->phs.received = NULL;
   }
+
+  if (NULL != pc->phs.tile_batch) {
+    free(pc->phs.tile_batch);
+    pc->phs.tile_batch = NULL;
+  }
 }
 
 /**********************************************************************//**
@@ -609,7 +780,12 @@ void connection_common_init(struct connection *pconn)
   pconn->last_write = NULL;
   pconn->buffer = new_socket_packet_buffer();
   pconn->send_buffer = new_socket_packet_buffer();
+  pconn->urgent_buffer = NULL;
+  pconn->send_unit_left = 0;
   pconn->statistics.bytes_send = 0;
+  pconn->statistics.urgent_bytes_send = 0;
+  pconn->statistics.send_queue_peak = 0;
+  pconn->statistics.coalesced = 0;
 #ifdef FREECIV_JSON_CONNECTION
   pconn->json_mode = TRUE;
 #endif /* FREECIV_JSON_CONNECTION */
@@ -645,6 +821,9 @@ void connection_common_close(struct connection *pconn)
     free_socket_packet_buffer(pconn->send_buffer);
     pconn->send_buffer = NULL;
 
+    free_socket_packet_buffer(pconn->urgent_buffer);
+    pconn->urgent_buffer = NULL;
+
     if (pconn->last_write) {
       timer_destroy(pconn->last_write);
       pconn->last_write = NULL;
@@ -664,6 +843,11 @@ void conn_set_capability(struct connection *pconn, const char *capability)
 
   sz_strlcpy(pconn->capability, capability);
   pconn->phs.handlers = packet_handlers_get(capability);
+
+  if (is_server() && NULL == pconn->phs.tile_batch
+      && has_capability(TILE_INFO_BATCH_CAPABILITY, capability)) {
+    pconn->phs.tile_batch = fc_calloc(1, sizeof(*pconn->phs.tile_batch));
+  }
 }
 
 /**********************************************************************//**
@@ -676,11 +860,11 @@ void conn_reset_delta_state(struct connection *pc)
 
   for (i = 0; i < PACKET_LAST; i++) {
     if (packet_has_game_info_flag(i)) {
-      if (NULL != pc->phs.sent && NULL != pc->phs.sent[i]) {
-        genhash_clear(pc->phs.sent[i]);
+      if (NULL != pc->phs.sent) {
+        packet_delta_cache_clear(pc->phs.sent + i, i);
       }
-      if (NULL != pc->phs.received && NULL != pc->phs.received[i]) {
-        genhash_clear(pc->phs.received[i]);
+      if (NULL != pc->phs.received) {
+        packet_delta_cache_clear(pc->phs.received + i, i);
       }
     }
   }
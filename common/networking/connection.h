@@ -50,9 +50,12 @@ extern "C" {
 /* common/networking */
 #include "conn_types.h"
 
+struct city_hash;
 struct conn_pattern_list;
+struct dense_cache;
 struct genhash;
 struct packet_handlers;
+struct packet_tile_info_batch;
 struct timer_list;
 
 /****************************************************************************
@@ -125,6 +128,15 @@ struct packet_header {
   unsigned int type : 4;        /* Actually 'enum data_type' */
 };
 
+/* The last packets of one type sent or received, for the delta
+ * protocol. Packets keyed by a tile index, a unit id or a city id
+ * use the dense cache, the others the hash; see
+ * packet_has_dense_cache(). */
+union packet_delta_cache {
+  struct genhash *hash;
+  struct dense_cache *dense;
+};
+
 #define SPECVEC_TAG byte
 #define SPECVEC_TYPE unsigned char
 #include "specvec.h"
@@ -151,7 +163,17 @@ struct connection {
   struct player *playing;
 
   struct socket_packet_buffer *buffer;
+
+  /* Data waiting to be written, in two lanes. A few small self-contained
+   * packets (see packet_is_urgent()) go to urgent_buffer, which is
+   * written ahead of send_buffer, the lane of all the others. The lanes
+   * only take turns between whole packets or compressed blocks:
+   * send_unit_left counts what must still be written of the one at the
+   * head of send_buffer first. urgent_buffer is NULL until the urgent
+   * lane opens; see send_packet_data(). */
   struct socket_packet_buffer *send_buffer;
+  struct socket_packet_buffer *urgent_buffer;
+  int send_unit_left;
   struct timer *last_write;
 #ifdef FREECIV_JSON_CONNECTION
   bool json_mode;
@@ -240,6 +262,15 @@ struct connection {
         struct player *playing;
         bool observer;
       } delegation;
+
+      /* The part of the map still to send after joining a running game,
+       * or NULL. See server/maphand.c. */
+      struct map_stream *map_stream;
+
+      /* Cities whose info was held back while the send queue was
+       * congested, to be sent once it drains, or NULL. See
+       * server/citytools.c. */
+      struct city_hash *coalesced_cities;
     } server;
   };
 
@@ -260,9 +291,13 @@ struct connection {
 				  int packet_type, int size,
 				  int request_id);
   struct {
-    struct genhash **sent;
-    struct genhash **received;
+    union packet_delta_cache *sent;
+    union packet_delta_cache *received;
     const struct packet_handlers *handlers;
+
+    /* Tiles waiting to go out together; NULL unless the server talks
+     * to a client with the "tile-batch" capability. */
+    struct packet_tile_info_batch *tile_batch;
   } phs;
 
 #ifdef USE_COMPRESSION
@@ -274,6 +309,9 @@ struct connection {
 #endif
   struct {
     int bytes_send;
+    int urgent_bytes_send;      /* Part of bytes_send in the urgent lane */
+    int send_queue_peak;        /* Most bytes ever waiting to be written */
+    int coalesced;              /* Superseded updates never sent */
   } statistics;
 };
 
@@ -286,6 +324,10 @@ int read_socket_data(int sock, struct socket_packet_buffer *buffer);
 void flush_connection_send_buffer_all(struct connection *pc);
 bool connection_send_data(struct connection *pconn,
                           const unsigned char *data, int len);
+bool connection_send_urgent_data(struct connection *pconn,
+                                 const unsigned char *data, int len);
+int connection_send_queued(const struct connection *pconn);
+bool connection_send_congested(const struct connection *pconn);
 
 void connection_do_buffer(struct connection *pc);
 void connection_do_unbuffer(struct connection *pc);
@@ -310,6 +352,7 @@ bool conn_compression_thaw(struct connection *pconn);
 bool conn_compression_frozen(const struct connection *pconn);
 void conn_list_compression_freeze(const struct conn_list *pconn_list);
 void conn_list_compression_thaw(const struct conn_list *pconn_list);
+const char *conn_compression_capability(void);
 
 const char *conn_description(const struct connection *pconn);
 bool conn_controls_player(const struct connection *pconn);
@@ -31,10 +31,12 @@
 
 /* utility */
 #include "capability.h"
+#include "densecache.h"
 #include "fc_cmdline.h"
 #include "fcintl.h"
 #include "log.h"
 #include "mem.h"
+#include "shared.h"
 #include "support.h"
 
 /* commmon */
@@ -47,6 +49,9 @@
 
 #ifdef USE_COMPRESSION
 #include <zlib.h>
+#ifdef FREECIV_HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 /*
  * Value for the 16bit size to indicate a jumbo packet
  */
@@ -67,6 +72,22 @@
 
 #define MAX_DECOMPRESSION 400
 
+#ifdef FREECIV_HAVE_LIBZSTD
+/*
+ * zstd is used instead of zlib when the peer has this capability. The
+ * receiver tells the two apart by the zstd magic number, which can't
+ * start a zlib stream.
+ */
+#define ZSTD_CAPABILITY "zstd"
+
+/*
+ * Optional dictionary, looked up from the data path. Both ends must
+ * have the same one for the sender to use it; its id is part of the
+ * capability string.
+ */
+#define ZSTD_DICT_FILENAME "network.zdict"
+#endif /* FREECIV_HAVE_LIBZSTD */
+
 #endif /* USE_COMPRESSION */
 
 /*
@@ -109,26 +130,232 @@ static inline int get_compression_level(void)
   return level;
 }
 
+#ifdef FREECIV_HAVE_LIBZSTD
+static bool zstd_initialized = FALSE;
+static ZSTD_CCtx *zstd_cctx = NULL;
+static ZSTD_DCtx *zstd_dctx = NULL;
+static ZSTD_CDict *zstd_cdict = NULL;
+static ZSTD_DDict *zstd_ddict = NULL;
+static unsigned zstd_dict_id = 0;
+static char zstd_dict_capability[32] = "";
+
+/**********************************************************************//**
+  Returns the zstd compression level. FREECIV_COMPRESSION_LEVEL applies
+  too, but its default of -1 maps to the fastest of the regular levels,
+  and 0 to zstd's own default.
+**************************************************************************/
+static inline int get_zstd_compression_level(void)
+{
+  int level = get_compression_level();
+
+  return (-1 == level ? 1 : level);
+}
+
+/**********************************************************************//**
+  Load the compression dictionary from the data path, if there is one.
+**************************************************************************/
+static void zstd_dictionary_load(void)
+{
+  const char *filename = fileinfoname(get_data_dirs(), ZSTD_DICT_FILENAME);
+  FILE *fp;
+  long size;
+  void *dict;
+
+  if (NULL == filename || NULL == (fp = fc_fopen(filename, "rb"))) {
+    log_verbose("No network compression dictionary.");
+    return;
+  }
+
+  if (0 != fseek(fp, 0, SEEK_END) || 0 >= (size = ftell(fp))
+      || 0 != fseek(fp, 0, SEEK_SET)) {
+    log_error("Can't read the network compression dictionary %s.",
+              filename);
+    fclose(fp);
+    return;
+  }
+
+  dict = fc_malloc(size);
+  if (1 != fread(dict, size, 1, fp)) {
+    log_error("Can't read the network compression dictionary %s.",
+              filename);
+  } else if (0 == (zstd_dict_id = ZSTD_getDictID_fromDict(dict, size))) {
+    log_error("%s is not a zstd dictionary.", filename);
+  } else {
+    zstd_cdict = ZSTD_createCDict(dict, size, get_zstd_compression_level());
+    zstd_ddict = ZSTD_createDDict(dict, size);
+    fc_snprintf(zstd_dict_capability, sizeof(zstd_dict_capability),
+                "zstd-dict-%u", zstd_dict_id);
+    log_verbose("Network compression dictionary %s loaded (id %u).",
+                filename, zstd_dict_id);
+  }
+
+  free(dict);
+  fclose(fp);
+}
+
+/**********************************************************************//**
+  Create the zstd contexts and load the dictionary on first use.
+**************************************************************************/
+static void zstd_init(void)
+{
+  if (zstd_initialized) {
+    return;
+  }
+  zstd_initialized = TRUE;
+
+  zstd_cctx = ZSTD_createCCtx();
+  zstd_dctx = ZSTD_createDCtx();
+  fc_assert(NULL != zstd_cctx && NULL != zstd_dctx);
+
+  zstd_dictionary_load();
+}
+
+/**********************************************************************//**
+  Free the zstd contexts and the dictionary.
+**************************************************************************/
+static void zstd_free(void)
+{
+  ZSTD_freeCCtx(zstd_cctx);
+  zstd_cctx = NULL;
+  ZSTD_freeDCtx(zstd_dctx);
+  zstd_dctx = NULL;
+  ZSTD_freeCDict(zstd_cdict);
+  zstd_cdict = NULL;
+  ZSTD_freeDDict(zstd_ddict);
+  zstd_ddict = NULL;
+  zstd_dict_id = 0;
+  zstd_dict_capability[0] = '\0';
+  zstd_initialized = FALSE;
+}
+
+/**********************************************************************//**
+  Compress the waiting data of the connection into one zstd frame, with
+  the dictionary if the peer has it too. Returns the size of the frame,
+  or 0 on failure.
+**************************************************************************/
+static size_t zstd_compress_queue(const struct connection *pconn,
+                                  void *compressed, size_t capacity)
+{
+  size_t size;
+
+  zstd_init();
+
+  if (NULL != zstd_cdict
+      && has_capability(zstd_dict_capability, pconn->capability)) {
+    size = ZSTD_compress_usingCDict(zstd_cctx, compressed, capacity,
+                                    pconn->compression.queue.p,
+                                    pconn->compression.queue.size,
+                                    zstd_cdict);
+  } else {
+    size = ZSTD_compressCCtx(zstd_cctx, compressed, capacity,
+                             pconn->compression.queue.p,
+                             pconn->compression.queue.size,
+                             get_zstd_compression_level());
+  }
+
+  if (ZSTD_isError(size)) {
+    log_error("zstd compression failed: %s", ZSTD_getErrorName(size));
+    return 0;
+  }
+
+  return size;
+}
+
+/**********************************************************************//**
+  Whether the compressed data starts with a zstd frame.
+**************************************************************************/
+static inline bool zstd_is_frame(const unsigned char *data, size_t size)
+{
+  return (4 <= size
+          && ZSTD_MAGICNUMBER == (data[0] | (data[1] << 8) | (data[2] << 16)
+                                  | ((unsigned) data[3] << 24)));
+}
+
+/**********************************************************************//**
+  Decompress a zstd frame. Returns the decompressed data, to be freed by
+  the caller, or NULL if the frame is corrupt or uses a dictionary we
+  don't have.
+**************************************************************************/
+static void *zstd_decompress_frame(const void *data, size_t size,
+                                   unsigned long *decompressed_size)
+{
+  unsigned long long content_size = ZSTD_getFrameContentSize(data, size);
+  unsigned dict_id = ZSTD_getDictID_fromFrame(data, size);
+  void *decompressed;
+  size_t result;
+
+  zstd_init();
+
+  if (ZSTD_CONTENTSIZE_UNKNOWN == content_size
+      || ZSTD_CONTENTSIZE_ERROR == content_size
+      || 0 == content_size
+      || content_size > (unsigned long long) MAX_DECOMPRESSION * size) {
+    return NULL;
+  }
+
+  if (0 != dict_id && (NULL == zstd_ddict || dict_id != zstd_dict_id)) {
+    log_verbose("The packet stream uses the unknown compression "
+                "dictionary %u.", dict_id);
+    return NULL;
+  }
+
+  decompressed = fc_malloc(content_size);
+  if (0 != dict_id) {
+    result = ZSTD_decompress_usingDDict(zstd_dctx, decompressed,
+                                        content_size, data, size,
+                                        zstd_ddict);
+  } else {
+    result = ZSTD_decompressDCtx(zstd_dctx, decompressed, content_size,
+                                 data, size);
+  }
+
+  if (ZSTD_isError(result) || result != content_size) {
+    free(decompressed);
+    return NULL;
+  }
+
+  *decompressed_size = result;
+
+  return decompressed;
+}
+#endif /* FREECIV_HAVE_LIBZSTD */
+
 /**********************************************************************//**
   Send all waiting data. Return TRUE on success.
 **************************************************************************/
 static bool conn_compression_flush(struct connection *pconn)
 {
   int compression_level = get_compression_level();
+#ifdef FREECIV_HAVE_LIBZSTD
+  bool use_zstd = has_capability(ZSTD_CAPABILITY, pconn->capability);
+  uLongf compressed_size =
+    (use_zstd ? ZSTD_compressBound(pconn->compression.queue.size)
+     : 12 + 1.001 * pconn->compression.queue.size);
+#else  /* FREECIV_HAVE_LIBZSTD */
   uLongf compressed_size = 12 + 1.001 * pconn->compression.queue.size;
+#endif /* FREECIV_HAVE_LIBZSTD */
   Bytef compressed[compressed_size];
   bool jumbo;
   unsigned long compressed_packet_len;
 
+#ifdef FREECIV_HAVE_LIBZSTD
+  if (use_zstd) {
+    compressed_size = zstd_compress_queue(pconn, compressed,
+                                          compressed_size);
+    fc_assert_ret_val(0 < compressed_size, FALSE);
+  } else
+#endif /* FREECIV_HAVE_LIBZSTD */
+  {
 #ifndef FREECIV_NDEBUG
-  int error =
+    int error =
 #endif
-  compress2(compressed, &compressed_size,
-            pconn->compression.queue.p,
-            pconn->compression.queue.size,
-            compression_level);
+    compress2(compressed, &compressed_size,
+              pconn->compression.queue.p,
+              pconn->compression.queue.size,
+              compression_level);
 
-  fc_assert_ret_val(error == Z_OK, FALSE);
+    fc_assert_ret_val(error == Z_OK, FALSE);
+  }
 
   /* Compression signalling currently assumes a 2-byte packet length; if that
    * changes, the protocol should probably be changed */
@@ -207,6 +434,147 @@ bool conn_compression_thaw(struct connection *pconn)
   return pconn->used;
 }
 
+/**********************************************************************//**
+  Returns the capabilities of the optional compression methods this
+  executable supports, for our capability string. Empty if there are
+  none.
+**************************************************************************/
+const char *conn_compression_capability(void)
+{
+#if defined(USE_COMPRESSION) && defined(FREECIV_HAVE_LIBZSTD)
+  static char capability[64];
+
+  zstd_init();
+  if ('\0' != zstd_dict_capability[0]) {
+    fc_snprintf(capability, sizeof(capability), "%s %s",
+                ZSTD_CAPABILITY, zstd_dict_capability);
+  } else {
+    sz_strlcpy(capability, ZSTD_CAPABILITY);
+  }
+
+  return capability;
+#else  /* USE_COMPRESSION && FREECIV_HAVE_LIBZSTD */
+  return "";
+#endif /* USE_COMPRESSION && FREECIV_HAVE_LIBZSTD */
+}
+
+/**********************************************************************//**
+  Whether the encoding cached in penc was made for a connection using
+  the same packet header as pc.
+**************************************************************************/
+bool packet_encoding_matches(const struct packet_encoding *penc,
+                             const struct connection *pc)
+{
+  return (penc->valid
+          && penc->header.length == pc->packet_header.length
+          && penc->header.type == pc->packet_header.type);
+}
+
+/**********************************************************************//**
+  Keep the wire bytes of a packet just encoded for pc, so that they can
+  be sent to the next connections as they are.
+**************************************************************************/
+void packet_encoding_store(struct packet_encoding *penc,
+                           const struct connection *pc,
+                           const unsigned char *data, int size)
+{
+  fc_assert_ret(size <= MAX_LEN_PACKET);
+
+  memcpy(penc->data, data, size);
+  penc->size = size;
+  penc->header = pc->packet_header;
+  penc->valid = TRUE;
+}
+
+/**********************************************************************//**
+  Send the cached encoding of a packet to pc. The caller has checked
+  with packet_encoding_matches() that it is valid for pc.
+**************************************************************************/
+int packet_encoding_send(struct packet_encoding *penc,
+                         struct connection *pc,
+                         enum packet_type packet_type)
+{
+  fc_assert(packet_encoding_matches(penc, pc));
+
+  return send_packet_data(pc, penc->data, penc->size, packet_type);
+}
+
+/**********************************************************************//**
+  Whether packets of this type are written to pc ahead of the others
+  waiting in its send buffer. These are small packets the client handles
+  the same whatever arrived before them. Once the urgent lane is open, a
+  packet type always takes the same lane, so the delta state of the type
+  stays in step; the types must not be 'is-game-info', whose delta state
+  is reset on the way.
+**************************************************************************/
+bool packet_is_urgent(const struct connection *pc, enum packet_type type)
+{
+#ifndef FREECIV_JSON_CONNECTION
+  if (NULL == pc->urgent_buffer) {
+    return FALSE;
+  }
+
+  switch (type) {
+  case PACKET_CHAT_MSG:
+  case PACKET_CONN_PING:
+  case PACKET_CONN_PING_INFO:
+    return TRUE;
+  default:
+    break;
+  }
+#endif /* FREECIV_JSON_CONNECTION */
+
+  return FALSE;
+}
+
+/**********************************************************************//**
+  Return the size of the packet, or of the compressed block of packets,
+  starting the size bytes of data written to pc.
+**************************************************************************/
+int packet_wire_length(const struct connection *pc,
+                       const unsigned char *data, int size)
+{
+  struct data_in din;
+  int len;
+
+  dio_input_init(&din, data, size);
+  if (!dio_get_type_raw(&din, pc->packet_header.length, &len)) {
+    return size;
+  }
+
+#ifdef USE_COMPRESSION
+  if (len == JUMBO_SIZE) {
+    if (!dio_get_uint32_raw(&din, &len)) {
+      return size;
+    }
+  } else if (len >= COMPRESSION_BORDER) {
+    len -= COMPRESSION_BORDER;
+  }
+#endif /* USE_COMPRESSION */
+
+  fc_assert_ret_val(0 < len, size);
+
+  return len;
+}
+
+/**********************************************************************//**
+  Whether the delta state of pc remembers a packet of the type sent for
+  key, that is the other end has one. Only for types with a dense cache.
+**************************************************************************/
+bool packet_dense_key_sent(const struct connection *pc,
+                           enum packet_type type, int key)
+{
+#ifdef FREECIV_DELTA_PROTOCOL
+  fc_assert_ret_val(packet_has_dense_cache(type), FALSE);
+
+  return (NULL != pc->phs.sent
+          && NULL != pc->phs.sent[type].dense
+          && NULL != dense_cache_lookup(pc->phs.sent[type].dense, key));
+#else  /* FREECIV_DELTA_PROTOCOL */
+  return FALSE;
+#endif /* FREECIV_DELTA_PROTOCOL */
+}
+
 /**********************************************************************//**
   It returns the request id of the outgoing packet (or 0 if is_server()).
 **************************************************************************/
@@ -215,6 +583,31 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
 {
   /* default for the server */
   int result = 0;
+  bool urgent;
+
+#ifndef FREECIV_JSON_CONNECTION
+  if (NULL == pc->urgent_buffer
+      && is_server()
+      && pc->established
+      && 0 == connection_send_queued(pc)
+#ifdef USE_COMPRESSION
+      && 0 == byte_vector_size(&pc->compression.queue)
+#endif /* USE_COMPRESSION */
+      ) {
+    /* Open the urgent lane once all that was sent before the join is
+     * out; the packet header and handlers change with the join reply.
+     * Not for the client: the server counts request ids in the order it
+     * receives packets. */
+    pc->urgent_buffer = new_socket_packet_buffer();
+  }
+#endif /* FREECIV_JSON_CONNECTION */
+
+  urgent = packet_is_urgent(pc, packet_type);
+
+  if (PACKET_TILE_INFO_BATCH != packet_type && !urgent) {
+    /* Tiles waiting for a batch were sent before this packet */
+    tile_info_batch_flush(pc);
+  }
 
   log_packet("sending packet type=%s(%d) len=%d to %s",
              packet_name(packet_type), packet_type, len,
@@ -231,8 +624,13 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
     pc->outgoing_packet_notify(pc, packet_type, len, result);
   }
 
+  if (urgent) {
+    /* Not queued for compression either, where it would wait for the
+     * packets before it. */
+    connection_send_urgent_data(pc, data, len);
+  }
 #ifdef USE_COMPRESSION
-  if (TRUE) {
+  else {
     int size = len;
 
     if (conn_compression_frozen(pc)) {
@@ -277,7 +675,9 @@ int send_packet_data(struct connection *pc, unsigned char *data, int len,
                   stat_size_uncompressed, stat_size_compressed);
   }
 #else  /* USE_COMPRESSION */
-  connection_send_data(pc, data, len);
+  else {
+    connection_send_data(pc, data, len);
+  }
 #endif /* USE_COMPRESSION */
 
 #if PACKET_SIZE_STATISTICS
@@ -441,34 +841,55 @@ void *get_packet_from_connection_raw(struct connection *pc,
 
   if (compressed_packet) {
     uLong compressed_size = whole_packet_len - header_size;
-    int decompress_factor = 80;
-    unsigned long int decompressed_size = decompress_factor * compressed_size;
-    int error = Z_BUF_ERROR;
+    unsigned long int decompressed_size;
     struct socket_packet_buffer *buffer = pc->buffer;
-    void *decompressed = fc_malloc(decompressed_size);
-
-    do {
-      error =
-        uncompress(decompressed, &decompressed_size,
-                   ADD_TO_POINTER(buffer->data, header_size),
-                   compressed_size);
-
-      if (error == Z_BUF_ERROR) {
-        decompress_factor += 50;
-        decompressed_size = decompress_factor * compressed_size;
-        decompressed = fc_realloc(decompressed, decompressed_size);
+    void *decompressed;
+
+#ifdef FREECIV_HAVE_LIBZSTD
+    if (zstd_is_frame(ADD_TO_POINTER(buffer->data, header_size),
+                      compressed_size)) {
+      decompressed =
+        zstd_decompress_frame(ADD_TO_POINTER(buffer->data, header_size),
+                              compressed_size, &decompressed_size);
+      if (NULL == decompressed) {
+        log_verbose("Uncompressing of the packet stream failed. "
+                    "The connection will be closed now.");
+        connection_close(pc, _("decoding error"));
+        return NULL;
       }
+    } else
+#endif /* FREECIV_HAVE_LIBZSTD */
+    {
+      int decompress_factor = 80;
+      int error = Z_BUF_ERROR;
+
+      decompressed_size = decompress_factor * compressed_size;
+      decompressed = fc_malloc(decompressed_size);
+
+      do {
+        error =
+          uncompress(decompressed, &decompressed_size,
+                     ADD_TO_POINTER(buffer->data, header_size),
+                     compressed_size);
+
+        if (error == Z_BUF_ERROR) {
+          decompress_factor += 50;
+          decompressed_size = decompress_factor * compressed_size;
+          decompressed = fc_realloc(decompressed, decompressed_size);
+        }
 
-      if (error != Z_OK) {
-        if (error != Z_BUF_ERROR || decompress_factor > MAX_DECOMPRESSION ) {
-          log_verbose("Uncompressing of the packet stream failed. "
-                      "The connection will be closed now.");
-          connection_close(pc, _("decoding error"));
-          return NULL;
+        if (error != Z_OK) {
+          if (error != Z_BUF_ERROR || decompress_factor > MAX_DECOMPRESSION ) {
+            log_verbose("Uncompressing of the packet stream failed. "
+                        "The connection will be closed now.");
+            free(decompressed);
+            connection_close(pc, _("decoding error"));
+            return NULL;
+          }
         }
-      }
 
-    } while (error != Z_OK);
+      } while (error != Z_OK);
+    }
 
     buffer->ndata -= whole_packet_len;
     /* 
@@ -658,6 +1079,157 @@ void post_receive_packet_server_join_reply(struct connection *pconn,
   }
 }
 
+/**********************************************************************//**
+  Copy the information about the i-th tile of the batch to a tile info
+  packet.
+**************************************************************************/
+void tile_info_batch_get(const struct packet_tile_info_batch *packet,
+                         int i, struct packet_tile_info *info)
+{
+  fc_assert_ret(0 <= i && i < packet->count);
+
+  info->tile = packet->tile + i;
+  info->continent = packet->continent[i];
+  info->known = packet->known[i];
+  info->owner = packet->owner[i];
+  info->extras_owner = packet->extras_owner[i];
+  info->worked = packet->worked[i];
+  info->terrain = packet->terrain[i];
+  info->resource = packet->resource[i];
+  info->extras = packet->extras[i];
+  info->placing = packet->placing[i];
+  info->place_turn = packet->place_turn[i];
+  info->altitude = packet->altitude[i];
+  info->spec_sprite[0] = '\0';
+  info->label[0] = '\0';
+}
+
+/**********************************************************************//**
+  Append the tile info to the batch.
+**************************************************************************/
+static void tile_info_batch_add(struct packet_tile_info_batch *packet,
+                                const struct packet_tile_info *info)
+{
+  int i = packet->count++;
+
+  if (0 == i) {
+    packet->tile = info->tile;
+  }
+  fc_assert(packet->tile + i == info->tile);
+
+  packet->continent[i] = info->continent;
+  packet->known[i] = info->known;
+  packet->owner[i] = info->owner;
+  packet->extras_owner[i] = info->extras_owner;
+  packet->worked[i] = info->worked;
+  packet->terrain[i] = info->terrain;
+  packet->resource[i] = info->resource;
+  packet->extras[i] = info->extras;
+  packet->placing[i] = info->placing;
+  packet->place_turn[i] = info->place_turn;
+  packet->altitude[i] = info->altitude;
+}
+
+/**********************************************************************//**
+  Send the tiles waiting for a batch to the connection, if any.
+**************************************************************************/
+void tile_info_batch_flush(struct connection *pc)
+{
+  struct packet_tile_info_batch *batch = pc->phs.tile_batch;
+
+  if (NULL != batch && 0 < batch->count) {
+    send_packet_tile_info_batch(pc, batch);
+    batch->count = 0;
+  }
+}
+
+/**********************************************************************//**
+  Send the tile info to the connection. While the connection buffers,
+  tiles the client has not been told about yet are collected and sent
+  as one PACKET_TILE_INFO_BATCH for each run of consecutive tiles, if
+  the client has the capability for it. Tiles the client already knows
+  something about go alone, as the delta to the last info, and so does
+  anything else.
+**************************************************************************/
+int send_packet_tile_info_batched(struct connection *pc,
+                                  const struct packet_tile_info *packet)
+{
+  struct packet_tile_info_batch *batch = pc->phs.tile_batch;
+
+  if (NULL == batch) {
+    return send_packet_tile_info(pc, packet);
+  }
+
+  if (0 < batch->count
+      && (TILE_INFO_BATCH_MAX <= batch->count
+          || batch->tile + batch->count != packet->tile)) {
+    tile_info_batch_flush(pc);
+  }
+
+  if (0 == pc->send_buffer->do_buffer_sends
+      || '\0' != packet->spec_sprite[0]
+      || '\0' != packet->label[0]
+#ifdef FREECIV_DELTA_PROTOCOL
+      || (NULL != pc->phs.sent[PACKET_TILE_INFO].dense
+          && NULL != dense_cache_lookup(pc->phs.sent[PACKET_TILE_INFO].dense,
+                                        packet->tile))
+#endif /* FREECIV_DELTA_PROTOCOL */
+      ) {
+    tile_info_batch_flush(pc);
+    return send_packet_tile_info(pc, packet);
+  }
+
+  tile_info_batch_add(batch, packet);
+
+  return 0;
+}
+
+/**********************************************************************//**
+  Record the tiles of the batch in the delta state of PACKET_TILE_INFO,
+  as if they had been sent one by one. Both ends do this, so later tile
+  infos are deltas to the batch.
+**************************************************************************/
+static void tile_info_batch_cache(union packet_delta_cache *cache,
+                                  const struct packet_tile_info_batch *packet)
+{
+#ifdef FREECIV_DELTA_PROTOCOL
+  int i;
+
+  if (NULL == cache->dense) {
+    cache->dense = dense_cache_new(sizeof(struct packet_tile_info));
+  }
+
+  for (i = 0; i < packet->count; i++) {
+    struct packet_tile_info *old = dense_cache_insert(cache->dense,
+                                                      packet->tile + i);
+
+    if (NULL != old) {
+      tile_info_batch_get(packet, i, old);
+    }
+  }
+#endif /* FREECIV_DELTA_PROTOCOL */
+}
+
+/**********************************************************************//**
+  Update the delta state of tile infos sent to the client.
+**************************************************************************/
+void post_send_packet_tile_info_batch(struct connection *pconn,
+                                      const struct packet_tile_info_batch
+                                      *packet)
+{
+  tile_info_batch_cache(pconn->phs.sent + PACKET_TILE_INFO, packet);
+}
+
+/**********************************************************************//**
+  Update the delta state of tile infos received from the server.
+**************************************************************************/
+void post_receive_packet_tile_info_batch(struct connection *pconn,
+                                         const struct packet_tile_info_batch
+                                         *packet)
+{
+  tile_info_batch_cache(pconn->phs.received + PACKET_TILE_INFO, packet);
+}
+
 
 /**********************************************************************//**
   Sanity check packet
@@ -900,4 +1472,7 @@ const struct packet_handlers *packet_handlers_get(const char *capability)
 void packets_deinit(void)
 {
   packet_handlers_free();
+#if defined(USE_COMPRESSION) && defined(FREECIV_HAVE_LIBZSTD)
+  zstd_free();
+#endif
 }
@@ -69,6 +69,17 @@ enum unit_info_use {
   UNIT_INFO_CITY_PRESENT
 };
 
+/* A tile takes 16 bytes plus its extras in PACKET_TILE_INFO_BATCH. */
+FC_STATIC_ASSERT(TILE_INFO_BATCH_MAX * (16 + sizeof(bv_extras))
+                 < MAX_LEN_PACKET - 64, tile_info_batch_too_big);
+
+/* Optional capability of clients accepting PACKET_TILE_INFO_BATCH. */
+#define TILE_INFO_BATCH_CAPABILITY "tile-batch"
+
+/* Optional capability of clients which can take the map in chunks
+ * while they are already playing. */
+#define MAP_STREAM_CAPABILITY "map-stream"
+
 #include "packets_gen.h"
 
 struct packet_handlers {
@@ -103,6 +114,7 @@ void packet_handlers_fill_capability(struct packet_handlers *phandlers,
                                      const char *capability);
 const char *packet_name(enum packet_type type);
 bool packet_has_game_info_flag(enum packet_type type);
+bool packet_has_dense_cache(enum packet_type type);
 
 void packet_header_init(struct packet_header *packet_header);
 void post_send_packet_server_join_reply(struct connection *pconn,
@@ -112,6 +124,18 @@ void post_receive_packet_server_join_reply(struct connection *pconn,
                                            const struct
                                            packet_server_join_reply *packet);
 
+int send_packet_tile_info_batched(struct connection *pc,
+                                  const struct packet_tile_info *packet);
+void tile_info_batch_flush(struct connection *pc);
+void tile_info_batch_get(const struct packet_tile_info_batch *packet,
+                         int i, struct packet_tile_info *info);
+void post_send_packet_tile_info_batch(struct connection *pconn,
+                                      const struct packet_tile_info_batch
+                                      *packet);
+void post_receive_packet_tile_info_batch(struct connection *pconn,
+                                         const struct packet_tile_info_batch
+                                         *packet);
+
 void pre_send_packet_player_attribute_chunk(struct connection *pc,
 					    struct packet_player_attribute_chunk
 					    *packet);
@@ -143,6 +167,19 @@ void packets_deinit(void);
     return send_packet_data(pc, buffer, size, packet_type); \
   }
 
+#define SEND_PACKET_END_ENCODED(packet_type, penc) \
+  { \
+    size_t size = dio_output_used(&dout); \
+    \
+    dio_output_rewind(&dout); \
+    dio_put_type_raw(&dout, pc->packet_header.length, size); \
+    fc_assert(!dout.too_short); \
+    if (!dout.too_short) { \
+      packet_encoding_store(penc, pc, buffer, size); \
+    } \
+    return send_packet_data(pc, buffer, size, packet_type); \
+  }
+
 #define RECEIVE_PACKET_START(packet_type, result) \
   struct data_in din; \
   struct packet_type packet_buf, *result = &packet_buf; \
@@ -175,6 +212,30 @@ void packets_deinit(void);
 
 int send_packet_data(struct connection *pc, unsigned char *data, int len,
                      enum packet_type packet_type);
+bool packet_is_urgent(const struct connection *pc, enum packet_type type);
+int packet_wire_length(const struct connection *pc,
+                       const unsigned char *data, int size);
+bool packet_dense_key_sent(const struct connection *pc,
+                           enum packet_type type, int key);
+
+/* Wire bytes of the last packet a send function encoded. Sending the
+ * same fields with the same values to another connection with the same
+ * packet header reuses them instead of encoding the packet again. */
+struct packet_encoding {
+  bool valid;
+  struct packet_header header;
+  int size;
+  unsigned char data[MAX_LEN_PACKET];
+};
+
+bool packet_encoding_matches(const struct packet_encoding *penc,
+                             const struct connection *pc);
+void packet_encoding_store(struct packet_encoding *penc,
+                           const struct connection *pc,
+                           const unsigned char *data, int size);
+int packet_encoding_send(struct packet_encoding *penc,
+                         struct connection *pc,
+                         enum packet_type packet_type);
 bool packet_check(struct data_in *din, struct connection *pc);
 
 /* Utilities to exchange strings and string vectors. */
@@ -25,6 +25,7 @@
 /* common */
 #include "ai.h"
 #include "city.h"
+#include "effects.h"
 #include "fc_interface.h"
 #include "featured_text.h"
 #include "game.h"
@@ -541,6 +542,9 @@ struct player *player_new(struct player_slot *pslot)
   /* Increase number of players. */
   player_slots.used_slots++;
 
+  /* The player may get the cached effects of an earlier one. */
+  effect_cache_invalidate();
+
   return pplayer;
 }
 
@@ -751,6 +755,7 @@ void player_destroy(struct player *pplayer)
 
   /* Remove all that is game-dependent in the player structure. */
   player_clear(pplayer, TRUE);
+  effect_cache_invalidate();
 
   fc_assert(0 == unit_list_size(pplayer->units));
   unit_list_destroy(pplayer->units);
@@ -857,6 +862,7 @@ bool player_set_nation(struct player *pplayer, struct nation_type *pnation)
       pnation->player = pplayer;
     }
     pplayer->nation = pnation;
+    effect_cache_invalidate();
     return TRUE;
   }
   return FALSE;
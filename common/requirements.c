@@ -18,9 +18,12 @@
 
 /* utility */
 #include "astring.h"
+#include "bitvector.h"
 #include "fcintl.h"
 #include "log.h"
+#include "mem.h"
 #include "support.h"
+#include "timing.h"
 
 /* common */
 #include "achievements.h"
@@ -28,6 +31,7 @@
 #include "citizens.h"
 #include "counters.h"
 #include "culture.h"
+#include "effects.h"
 #include "game.h"
 #include "government.h"
 #include "improvement.h"
@@ -44,6 +48,12 @@
 
 #include "requirements.h"
 
+/* Check every evaluation of a compiled requirement vector against the
+ * interpreted one. */
+#ifdef FREECIV_DEBUG
+#define REQ_PROGRAM_CHECK
+#endif
+
 /************************************************************************
   Container for req_item_found functions
 ************************************************************************/
@@ -5439,6 +5449,218 @@ static struct req_def req_definitions[VUT_COUNT] = {
   [VUT_UTYPE] = {is_unittype_req_active, REQUCH_YES}
 };
 
+/* Profile of the requirement and effect evaluations, see
+ * req_profile_enable(). */
+struct req_profile_entry {
+  unsigned long count;
+  double seconds;
+};
+
+static struct {
+  bool enabled;
+  /* Nothing is counted while other threads may evaluate requirements. */
+  bool frozen;
+  enum req_profile_caller caller;
+  /* Nesting of the evaluations, only the outermost one is timed. */
+  int req_depth;
+  int effect_depth;
+  struct timer *clock;
+  struct req_profile_entry reqs[RPC_COUNT][VUT_COUNT];
+  struct req_profile_entry effects[RPC_COUNT][EFT_COUNT];
+} req_profile = { .caller = RPC_OTHER };
+
+/**********************************************************************//**
+  Start profiling an evaluation. Returns the time it starts at, or a
+  negative value if it is not to be timed.
+**************************************************************************/
+static double req_profile_begin(int *depth)
+{
+  if (req_profile.frozen || 0 < (*depth)++) {
+    return -1.0;
+  }
+
+  return timer_read_seconds(req_profile.clock);
+}
+
+/**********************************************************************//**
+  Finish profiling an evaluation started at 'start', into 'entry'.
+**************************************************************************/
+static void req_profile_end(int *depth, struct req_profile_entry *entry,
+                            double start)
+{
+  if (req_profile.frozen) {
+    return;
+  }
+
+  (*depth)--;
+  entry->count++;
+  if (0.0 <= start) {
+    entry->seconds += timer_read_seconds(req_profile.clock) - start;
+  }
+}
+
+/**********************************************************************//**
+  Like tri_req_present(), profiling the evaluation.
+**************************************************************************/
+static enum fc_tristate
+tri_req_present_profiled(const struct req_context *context,
+                         const struct player *other_player,
+                         const struct requirement *req)
+{
+  double start = req_profile_begin(&req_profile.req_depth);
+  enum fc_tristate eval = tri_req_present(context, other_player, req);
+
+  req_profile_end(&req_profile.req_depth,
+                  &req_profile.reqs[req_profile.caller][req->source.kind],
+                  start);
+
+  return eval;
+}
+
+/**********************************************************************//**
+  Start (or stop) profiling the requirement and effect evaluations. The
+  counts are kept until req_profile_reset().
+**************************************************************************/
+void req_profile_enable(bool enable)
+{
+  if (enable && NULL == req_profile.clock) {
+    req_profile.clock = timer_new(TIMER_USER, TIMER_ACTIVE, "reqprofile");
+    timer_start(req_profile.clock);
+  } else if (!enable && NULL != req_profile.clock) {
+    timer_destroy(req_profile.clock);
+    req_profile.clock = NULL;
+  }
+  req_profile.req_depth = 0;
+  req_profile.effect_depth = 0;
+  req_profile.enabled = enable;
+}
+
+/**********************************************************************//**
+  Returns whether the evaluations are profiled.
+**************************************************************************/
+bool req_profile_enabled(void)
+{
+  return req_profile.enabled;
+}
+
+/**********************************************************************//**
+  Set the subsystem the following evaluations are counted for. Returns
+  the previous one.
+**************************************************************************/
+enum req_profile_caller req_profile_set_caller(enum req_profile_caller caller)
+{
+  enum req_profile_caller previous = req_profile.caller;
+
+  req_profile.caller = caller;
+
+  return previous;
+}
+
+/**********************************************************************//**
+  Forget the profile so far.
+**************************************************************************/
+void req_profile_reset(void)
+{
+  memset(req_profile.reqs, 0, sizeof(req_profile.reqs));
+  memset(req_profile.effects, 0, sizeof(req_profile.effects));
+}
+
+/**********************************************************************//**
+  Start profiling the evaluation of an effect. Returns what to pass to
+  req_profile_effect_end().
+**************************************************************************/
+double req_profile_effect_begin(void)
+{
+  return req_profile_begin(&req_profile.effect_depth);
+}
+
+/**********************************************************************//**
+  Finish profiling the evaluation of an effect of the type.
+**************************************************************************/
+void req_profile_effect_end(int effect_type, double start)
+{
+  req_profile_end(&req_profile.effect_depth,
+                  &req_profile.effects[req_profile.caller][effect_type],
+                  start);
+}
+
+/**********************************************************************//**
+  Compare two profile rows, the most expensive first, for qsort().
+**************************************************************************/
+static int req_profile_row_cmp(const void *a, const void *b)
+{
+  const struct req_profile_row *row1 = (const struct req_profile_row *) a;
+  const struct req_profile_row *row2 = (const struct req_profile_row *) b;
+
+  if (row1->seconds != row2->seconds) {
+    return row1->seconds < row2->seconds ? 1 : -1;
+  }
+  if (row1->count != row2->count) {
+    return row1->count < row2->count ? 1 : -1;
+  }
+
+  return 0;
+}
+
+/**********************************************************************//**
+  Fill 'rows' with the most expensive requirement kinds and effect types
+  of each subsystem, the most expensive first. Returns the number of
+  rows filled, at most max_rows.
+**************************************************************************/
+int req_profile_report(struct req_profile_row *rows, int max_rows)
+{
+  struct req_profile_row *all
+    = fc_malloc(RPC_COUNT * (VUT_COUNT + EFT_COUNT) * sizeof(*all));
+  int caller, i, num = 0;
+
+  for (caller = 0; caller < RPC_COUNT; caller++) {
+    for (i = 0; i < VUT_COUNT + EFT_COUNT; i++) {
+      bool effect = (i >= VUT_COUNT);
+      const struct req_profile_entry *entry
+        = (effect ? &req_profile.effects[caller][i - VUT_COUNT]
+           : &req_profile.reqs[caller][i]);
+
+      if (0 == entry->count) {
+        continue;
+      }
+      all[num].caller = caller;
+      all[num].effect = effect;
+      all[num].index = effect ? i - VUT_COUNT : i;
+      all[num].count = entry->count;
+      all[num].seconds = entry->seconds;
+      num++;
+    }
+  }
+
+  qsort(all, num, sizeof(*all), req_profile_row_cmp);
+  num = MIN(num, max_rows);
+  memcpy(rows, all, num * sizeof(*rows));
+  free(all);
+
+  return num;
+}
+
+/**********************************************************************//**
+  Log the most expensive requirement kinds and effect types.
+**************************************************************************/
+void req_profile_log(int max_rows)
+{
+  struct req_profile_row *rows = fc_malloc(max_rows * sizeof(*rows));
+  int num = req_profile_report(rows, max_rows);
+  int i;
+
+  log_normal("Requirement and effect evaluation profile:");
+  for (i = 0; i < num; i++) {
+    log_normal("  %-8s %-8s %-28s %12lu %10.3fs",
+               req_profile_caller_name(rows[i].caller),
+               rows[i].effect ? "effect" : "req",
+               rows[i].effect ? effect_type_name(rows[i].index)
+                              : universals_n_name(rows[i].index),
+               rows[i].count, rows[i].seconds);
+  }
+  free(rows);
+}
+
 /**********************************************************************//**
   Checks the requirement to see if it is active on the given target.
 
@@ -5456,7 +5678,10 @@ bool is_req_active(const struct req_context *context,
                    const struct requirement *req,
                    const enum   req_problem_type prob_type)
 {
-  enum fc_tristate eval = tri_req_present(context, other_player, req);
+  enum fc_tristate eval = (req_profile.enabled
+                           ? tri_req_present_profiled(context, other_player,
+                                                      req)
+                           : tri_req_present(context, other_player, req));
 
   if (eval == TRI_MAYBE) {
     if (prob_type == RPT_POSSIBLE) {
@@ -5573,6 +5798,514 @@ bool are_reqs_active_ranges(const enum req_range min_range,
   return TRUE;
 }
 
+/* A requirement vector compiled by req_program_new(). The government and
+ * output type requirements are fused into sets of allowed values, tested
+ * first. The other requirements follow, the cheapest first. */
+BV_DEFINE(bv_req_govs, G_LAST + 1);     /* G_LAST for no government. */
+
+enum req_op_code {
+  REQ_OP_TECH,          /* Not surviving Player range advance. */
+  REQ_OP_BUILDING,      /* Not surviving City or Local range building. */
+  REQ_OP_SNAPSHOT,      /* Only depends on the player, see below. */
+  REQ_OP_GENERIC        /* Through req_definitions[]. */
+};
+
+struct req_op {
+  enum req_op_code code;
+  int cost;
+  int order;            /* Position in the vector, to keep it on ties. */
+  int slot;             /* Of REQ_OP_SNAPSHOT. */
+  struct requirement req;
+};
+
+/* Requirements on advances, buildings and nations at Player range or
+ * wider only depend on the player and on the state of the world, which
+ * only changes at a few points: techs learned or lost, buildings built
+ * or destroyed, players created, killed or changing nation, teams and
+ * diplomatic states changing, and turns and phases beginning. The value
+ * of each such requirement of a compiled program, taken to be present,
+ * is kept per player in a slot of a snapshot, until the next of these
+ * events invalidates all the snapshots (effect_cache_invalidate()).
+ * The server only has them. */
+#define REQ_SNAPSHOT_SLOTS 256
+
+BV_DEFINE(bv_req_snapshot, REQ_SNAPSHOT_SLOTS);
+
+struct req_snapshot {
+  unsigned int epoch;
+  bv_req_snapshot known;
+  bv_req_snapshot present;
+};
+
+static struct {
+  int num_slots;
+  struct requirement slots[REQ_SNAPSHOT_SLOTS];
+  /* Snapshots are not written while other threads may read them. */
+  bool frozen;
+  /* Snapshots are not used during hypothetical changes. */
+  bool bypassed;
+  unsigned int epoch;
+  struct req_snapshot *players[MAX_NUM_PLAYER_SLOTS];
+} req_snapshots = { .epoch = 1 };
+
+struct req_program {
+  int num_reqs;         /* Size of the vector compiled. */
+  bool never;           /* A requirement is never active. */
+
+  bool has_govs;
+  bv_req_govs govs;
+
+  bool has_outputs;
+  unsigned int outputs; /* Bit O_LAST for no output type. */
+
+  int num_ops;
+  struct req_op *ops;
+};
+
+FC_STATIC_ASSERT(O_LAST < sizeof(unsigned int) * 8,
+                 req_program_outputs_too_small);
+
+/**********************************************************************//**
+  Returns whether a requirement evaluating to 'eval' is active, the way
+  is_req_active() does.
+**************************************************************************/
+static inline bool req_eval_is_active(enum fc_tristate eval, bool present,
+                                      enum req_problem_type prob_type)
+{
+  if (TRI_MAYBE == eval) {
+    return RPT_POSSIBLE == prob_type;
+  }
+
+  return present ? (TRI_NO != eval) : (TRI_YES != eval);
+}
+
+/**********************************************************************//**
+  Returns the relative cost of evaluating the requirement through
+  req_definitions[]. The requirements looking beyond the target are the
+  most expensive ones.
+**************************************************************************/
+static int req_generic_cost(const struct requirement *req)
+{
+  switch (req->range) {
+  case REQ_RANGE_LOCAL:
+  case REQ_RANGE_TILE:
+  case REQ_RANGE_CITY:
+  case REQ_RANGE_PLAYER:
+    return 2;
+  case REQ_RANGE_CADJACENT:
+  case REQ_RANGE_ADJACENT:
+  case REQ_RANGE_TRADE_ROUTE:
+  case REQ_RANGE_CONTINENT:
+  case REQ_RANGE_TEAM:
+  case REQ_RANGE_ALLIANCE:
+  case REQ_RANGE_WORLD:
+  case REQ_RANGE_COUNT:
+    break;
+  }
+
+  return 3;
+}
+
+/**********************************************************************//**
+  Returns whether the requirement only depends on the player and on the
+  state of the world tracked by the snapshots. Buildings must not become
+  obsolete any other way.
+**************************************************************************/
+static bool req_snapshot_tracked(const struct requirement *req, int depth)
+{
+  switch (req->range) {
+  case REQ_RANGE_PLAYER:
+  case REQ_RANGE_TEAM:
+  case REQ_RANGE_ALLIANCE:
+  case REQ_RANGE_WORLD:
+    break;
+  default:
+    return FALSE;
+  }
+
+  switch (req->source.kind) {
+  case VUT_ADVANCE:
+  case VUT_NATION:
+    return TRUE;
+  case VUT_IMPROVEMENT:
+    if (depth > 1) {
+      return FALSE;
+    }
+    requirement_vector_iterate(&req->source.value.building->obsolete_by,
+                               preq) {
+      if (!req_snapshot_tracked(preq, depth + 1)) {
+        return FALSE;
+      }
+    } requirement_vector_iterate_end;
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/**********************************************************************//**
+  Returns the snapshot slot of the requirement, allocating one if needed,
+  or -1 if the slots ran out.
+**************************************************************************/
+static int req_snapshot_slot(const struct requirement *req)
+{
+  struct requirement key = *req;
+  int i;
+
+  key.present = TRUE;
+  key.quiet = FALSE;
+
+  for (i = 0; i < req_snapshots.num_slots; i++) {
+    if (are_requirements_equal(&req_snapshots.slots[i], &key)) {
+      return i;
+    }
+  }
+
+  if (req_snapshots.num_slots >= REQ_SNAPSHOT_SLOTS) {
+    return -1;
+  }
+  req_snapshots.slots[req_snapshots.num_slots] = key;
+
+  return req_snapshots.num_slots++;
+}
+
+/**********************************************************************//**
+  Evaluate the snapshot operation, ignoring req->present.
+**************************************************************************/
+static enum fc_tristate
+req_snapshot_present(const struct req_op *op,
+                     const struct req_context *context,
+                     const struct player *other_player)
+{
+  struct req_snapshot *snap;
+  enum fc_tristate eval;
+
+  if (NULL == context->player || req_snapshots.bypassed) {
+    return tri_req_present(context, other_player, &op->req);
+  }
+
+  snap = req_snapshots.players[player_index(context->player)];
+  if (NULL != snap && snap->epoch == req_snapshots.epoch
+      && BV_ISSET(snap->known, op->slot)) {
+    return BOOL_TO_TRISTATE(BV_ISSET(snap->present, op->slot));
+  }
+
+  eval = tri_req_present(context, other_player, &op->req);
+  if (TRI_MAYBE == eval || req_snapshots.frozen) {
+    return eval;
+  }
+
+  if (NULL == snap) {
+    snap = fc_calloc(1, sizeof(*snap));
+    req_snapshots.players[player_index(context->player)] = snap;
+  }
+  if (snap->epoch != req_snapshots.epoch) {
+    BV_CLR_ALL(snap->known);
+    snap->epoch = req_snapshots.epoch;
+  }
+  BV_SET(snap->known, op->slot);
+  BV_SET_VAL(snap->present, op->slot, TRI_YES == eval);
+
+  return eval;
+}
+
+/**********************************************************************//**
+  Forget the values of all the snapshots.
+**************************************************************************/
+void req_snapshot_invalidate(void)
+{
+  req_snapshots.epoch++;
+}
+
+/**********************************************************************//**
+  Stop (or resume) writing to the snapshots, and profiling, while other
+  threads evaluate requirements. Returns the previous state.
+**************************************************************************/
+bool req_snapshot_freeze(bool freeze)
+{
+  bool was_frozen = req_snapshots.frozen;
+
+  req_snapshots.frozen = freeze;
+  req_profile.frozen = freeze;
+
+  return was_frozen;
+}
+
+/**********************************************************************//**
+  Stop (or resume) using the snapshots, around a hypothetical change of
+  the game state. Returns the previous state.
+**************************************************************************/
+bool req_snapshot_bypass(bool bypass)
+{
+  bool was_bypassed = req_snapshots.bypassed;
+
+  req_snapshots.bypassed = bypass;
+
+  return was_bypassed;
+}
+
+/**********************************************************************//**
+  Free the snapshots and their slots. No compiled program may be left.
+**************************************************************************/
+void req_snapshot_free(void)
+{
+  int i;
+
+  for (i = 0; i < ARRAY_SIZE(req_snapshots.players); i++) {
+    free(req_snapshots.players[i]);
+    req_snapshots.players[i] = NULL;
+  }
+  req_snapshots.num_slots = 0;
+  req_snapshot_invalidate();
+}
+
+/**********************************************************************//**
+  Compare two operations by cost, for qsort().
+**************************************************************************/
+static int req_op_cmp(const void *a, const void *b)
+{
+  const struct req_op *op1 = (const struct req_op *) a;
+  const struct req_op *op2 = (const struct req_op *) b;
+
+  if (op1->cost != op2->cost) {
+    return op1->cost - op2->cost;
+  }
+
+  return op1->order - op2->order;
+}
+
+/**********************************************************************//**
+  Compile the requirement vector for are_reqs_active_program(). The
+  program doesn't refer to the vector, but must be compiled again if the
+  requirements, or the obsolescence of the buildings they refer to,
+  change.
+**************************************************************************/
+struct req_program *req_program_new(const struct requirement_vector *reqs)
+{
+  struct req_program *prog = fc_calloc(1, sizeof(*prog));
+  int i, j;
+
+  prog->num_reqs = requirement_vector_size(reqs);
+  prog->ops = fc_malloc(MAX(prog->num_reqs, 1) * sizeof(*prog->ops));
+  BV_SET_ALL(prog->govs);
+  prog->outputs = (1u << (O_LAST + 1)) - 1;
+
+  for (i = 0; i < prog->num_reqs; i++) {
+    const struct requirement *preq = requirement_vector_get(reqs, i);
+    struct req_op *op;
+    bool duplicate = FALSE;
+
+    for (j = 0; j < i; j++) {
+      if (are_requirements_equal(preq, requirement_vector_get(reqs, j))) {
+        duplicate = TRUE;
+        break;
+      }
+    }
+    if (duplicate) {
+      continue;
+    }
+
+    switch (preq->source.kind) {
+    case VUT_NONE:
+      /* Always present. */
+      if (!preq->present) {
+        prog->never = TRUE;
+      }
+      continue;
+    case VUT_GOVERNMENT:
+      /* Only depends on the government of the player, whatever the
+       * range, and is unknown for all of them without a player. */
+      {
+        int gov = government_index(preq->source.value.govern);
+
+        prog->has_govs = TRUE;
+        if (preq->present) {
+          bool allowed = BV_ISSET(prog->govs, gov);
+
+          BV_CLR_ALL(prog->govs);
+          if (allowed) {
+            BV_SET(prog->govs, gov);
+          }
+        } else {
+          BV_CLR(prog->govs, gov);
+        }
+      }
+      continue;
+    case VUT_OTYPE:
+      /* Only depends on the output type, never unknown. */
+      prog->has_outputs = TRUE;
+      if (preq->present) {
+        prog->outputs &= 1u << preq->source.value.outputtype;
+      } else {
+        prog->outputs &= ~(1u << preq->source.value.outputtype);
+      }
+      continue;
+    default:
+      break;
+    }
+
+    op = &prog->ops[prog->num_ops++];
+    op->req = *preq;
+    op->order = i;
+    if (VUT_ADVANCE == preq->source.kind && !preq->survives
+        && REQ_RANGE_PLAYER == preq->range) {
+      op->code = REQ_OP_TECH;
+      op->cost = 1;
+    } else if (VUT_IMPROVEMENT == preq->source.kind && !preq->survives
+               && (REQ_RANGE_CITY == preq->range
+                   || REQ_RANGE_LOCAL == preq->range)) {
+      op->code = REQ_OP_BUILDING;
+      op->cost = 1;
+    } else if (is_server() && req_snapshot_tracked(preq, 0)
+               && 0 <= (op->slot = req_snapshot_slot(preq))) {
+      op->code = REQ_OP_SNAPSHOT;
+      op->cost = 1;
+    } else {
+      op->code = REQ_OP_GENERIC;
+      op->cost = req_generic_cost(preq);
+    }
+  }
+
+  qsort(prog->ops, prog->num_ops, sizeof(*prog->ops), req_op_cmp);
+
+  return prog;
+}
+
+/**********************************************************************//**
+  Free a program made by req_program_new().
+**************************************************************************/
+void req_program_destroy(struct req_program *prog)
+{
+  free(prog->ops);
+  free(prog);
+}
+
+/**********************************************************************//**
+  Evaluate an operation of a requirement program, ignoring req->present.
+**************************************************************************/
+static inline enum fc_tristate
+req_op_present(const struct req_op *op, const struct req_context *context,
+               const struct player *other_player)
+{
+  const struct impr_type *building;
+
+  switch (op->code) {
+  case REQ_OP_TECH:
+    if (NULL == context->player) {
+      return TRI_MAYBE;
+    }
+    return BOOL_TO_TRISTATE(TECH_KNOWN == research_invention_state
+                              (research_get(context->player),
+                               advance_number(op->req.source.value.advance)));
+  case REQ_OP_BUILDING:
+    building = op->req.source.value.building;
+    if (0 < requirement_vector_size(&building->obsolete_by)) {
+      /* Obsolescence depends on the target. */
+      break;
+    }
+    if (REQ_RANGE_CITY == op->req.range) {
+      if (NULL == context->city) {
+        return TRI_MAYBE;
+      }
+      return BOOL_TO_TRISTATE(city_has_building(context->city, building));
+    }
+    if (NULL == context->building) {
+      return TRI_MAYBE;
+    }
+    return BOOL_TO_TRISTATE(context->building == building);
+  case REQ_OP_SNAPSHOT:
+    return req_snapshot_present(op, context, other_player);
+  case REQ_OP_GENERIC:
+    break;
+  }
+
+  return tri_req_present(context, other_player, &op->req);
+}
+
+/**********************************************************************//**
+  Like req_op_present(), profiling the evaluation.
+**************************************************************************/
+static enum fc_tristate
+req_op_present_profiled(const struct req_op *op,
+                        const struct req_context *context,
+                        const struct player *other_player)
+{
+  double start = req_profile_begin(&req_profile.req_depth);
+  enum fc_tristate eval = req_op_present(op, context, other_player);
+
+  req_profile_end(&req_profile.req_depth,
+                  &req_profile.reqs[req_profile.caller]
+                                   [op->req.source.kind],
+                  start);
+
+  return eval;
+}
+
+/**********************************************************************//**
+  Like are_reqs_active(), for the requirement vector compiled into 'prog'
+  by req_program_new(). Falls back to are_reqs_active() when 'prog' is
+  NULL or was compiled from a vector of another size.
+**************************************************************************/
+bool are_reqs_active_program(const struct req_context *context,
+                             const struct player *other_player,
+                             const struct requirement_vector *reqs,
+                             const struct req_program *prog,
+                             const enum   req_problem_type prob_type)
+{
+  bool active = TRUE;
+  int i;
+
+  if (NULL == prog || prog->num_reqs != requirement_vector_size(reqs)) {
+    return are_reqs_active(context, other_player, reqs, prob_type);
+  }
+
+  if (context == NULL) {
+    context = req_context_empty();
+  }
+
+  if (prog->never) {
+    active = FALSE;
+  } else if (prog->has_outputs
+             && !(prog->outputs
+                  & (1u << (NULL != context->output
+                            ? context->output->index : O_LAST)))) {
+    active = FALSE;
+  } else if (prog->has_govs) {
+    if (NULL == context->player) {
+      active = (RPT_POSSIBLE == prob_type);
+    } else {
+      const struct government *gov = government_of_player(context->player);
+
+      active = BV_ISSET(prog->govs,
+                        NULL != gov ? government_index(gov) : G_LAST);
+    }
+  }
+
+  for (i = 0; active && i < prog->num_ops; i++) {
+    const struct req_op *op = &prog->ops[i];
+
+    active = req_eval_is_active(req_profile.enabled
+                                ? req_op_present_profiled(op, context,
+                                                          other_player)
+                                : req_op_present(op, context, other_player),
+                                op->req.present, prob_type);
+  }
+
+#ifdef REQ_PROGRAM_CHECK
+  {
+    bool interpreted = are_reqs_active(context, other_player, reqs,
+                                       prob_type);
+
+    fc_assert_msg(active == interpreted,
+                  "Compiled requirements give %d, interpreted ones %d.",
+                  active, interpreted);
+    active = interpreted;
+  }
+#endif /* REQ_PROGRAM_CHECK */
+
+  return active;
+}
+
 /**********************************************************************//**
   For requirements changing with time, will they be active for the target
   after pass in period turns if nothing else changes?
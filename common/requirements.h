@@ -179,6 +179,64 @@ bool are_reqs_active_ranges(const enum req_range min_range,
                             const struct player *other_player,
                             const struct requirement_vector *reqs,
                             const enum   req_problem_type prob_type);
+
+/* A requirement vector compiled for faster evaluation. */
+struct req_program;
+
+struct req_program *req_program_new(const struct requirement_vector *reqs);
+void req_program_destroy(struct req_program *prog);
+bool are_reqs_active_program(const struct req_context *context,
+                             const struct player *other_player,
+                             const struct requirement_vector *reqs,
+                             const struct req_program *prog,
+                             const enum   req_problem_type prob_type);
+
+void req_snapshot_invalidate(void);
+bool req_snapshot_freeze(bool freeze);
+bool req_snapshot_bypass(bool bypass);
+void req_snapshot_free(void);
+
+/*
+ * Profiling of the requirement and effect evaluations, off unless
+ * enabled with req_profile_enable(). The evaluations are counted by
+ * requirement kind and by effect type, for the subsystem set with
+ * req_profile_set_caller(), which returns the previous one to restore.
+ * The time of an evaluation includes the ones nested in it, which are
+ * counted but not timed again.
+ */
+#define SPECENUM_NAME req_profile_caller
+#define SPECENUM_VALUE0 RPC_OTHER
+#define SPECENUM_VALUE0NAME "other"
+#define SPECENUM_VALUE1 RPC_CITY
+#define SPECENUM_VALUE1NAME "city"
+#define SPECENUM_VALUE2 RPC_AI
+#define SPECENUM_VALUE2NAME "ai"
+#define SPECENUM_VALUE3 RPC_ACTIONS
+#define SPECENUM_VALUE3NAME "actions"
+#define SPECENUM_VALUE4 RPC_HELP
+#define SPECENUM_VALUE4NAME "help"
+#define SPECENUM_COUNT RPC_COUNT
+#include "specenum_gen.h"
+
+struct req_profile_row {
+  enum req_profile_caller caller;
+  bool effect;                  /* index is an effect type, not a
+                                 * requirement kind. */
+  int index;
+  unsigned long count;
+  double seconds;
+};
+
+void req_profile_enable(bool enable);
+bool req_profile_enabled(void);
+enum req_profile_caller req_profile_set_caller(enum req_profile_caller caller);
+void req_profile_reset(void);
+int req_profile_report(struct req_profile_row *rows, int max_rows);
+void req_profile_log(int max_rows);
+
+double req_profile_effect_begin(void);
+void req_profile_effect_end(int effect_type, double start);
+
 enum fc_tristate
 tri_req_active_turns(int pass, int period,
                      const struct req_context *context,
@@ -22,6 +22,7 @@
 #include "support.h"
 
 /* common */
+#include "effects.h"
 #include "fc_types.h"
 #include "game.h"
 #include "nation.h"
@@ -647,6 +648,9 @@ enum tech_state research_invention_set(struct research *presearch,
     return old;
   }
   presearch->inventions[tech].state = value;
+  if (old == TECH_KNOWN || value == TECH_KNOWN) {
+    effect_cache_invalidate();
+  }
 
   if (value == TECH_KNOWN) {
     if (!game.info.global_advances[tech]) {
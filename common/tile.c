@@ -21,6 +21,7 @@
 #include "support.h"
 
 /* common */
+#include "effects.h"
 #include "fc_interface.h"
 #include "game.h"
 #include "map.h"
@@ -158,6 +159,8 @@ void tile_set_terrain(struct tile *ptile, struct terrain *pterrain)
       BV_CLR(ptile->extras, extra_index(ptile->resource));
     }
   }
+  map_move_costs_tile_changed(&(wld.map), ptile);
+  effect_cache_tile_changed(ptile);
 }
 
 /************************************************************************//**
@@ -381,7 +384,11 @@ Continent_id tile_continent(const struct tile *ptile)
 ****************************************************************************/
 void tile_set_continent(struct tile *ptile, Continent_id val)
 {
-  ptile->continent = val;
+  if (ptile->continent != val) {
+    ptile->continent = val;
+    /* Continent ranged requirements. */
+    effect_cache_invalidate();
+  }
 }
 
 /************************************************************************//**
@@ -956,6 +963,8 @@ void tile_add_extra(struct tile *ptile, const struct extra_type *pextra)
 {
   if (pextra != NULL) {
     BV_SET(ptile->extras, extra_index(pextra));
+    map_move_costs_tile_changed(&(wld.map), ptile);
+    effect_cache_tile_changed(ptile);
   }
 }
 
@@ -969,6 +978,8 @@ void tile_remove_extra(struct tile *ptile, const struct extra_type *pextra)
     if (ptile->resource == pextra) {
       ptile->resource = NULL;
     }
+    map_move_costs_tile_changed(&(wld.map), ptile);
+    effect_cache_tile_changed(ptile);
   }
 }
 
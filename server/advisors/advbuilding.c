@@ -16,6 +16,7 @@
 #endif
 
 /* utility */
+#include "mem.h"
 #include "rand.h"
 
 /* common */
@@ -59,13 +60,20 @@ static void calculate_city_clusters(struct player *pplayer)
 {
   struct unit_type *punittype;
   struct unit *ghost;
-  int range;
+  struct pf_parameter *parameters;
+  struct pf_map **maps;
+  int range, num, i;
   const struct civ_map *nmap = &(wld.map);
 
   city_list_iterate(pplayer->cities, pcity) {
     pcity->server.adv->downtown = 0;
   } city_list_iterate_end;
 
+  num = city_list_size(pplayer->cities);
+  if (num == 0) {
+    return;
+  }
+
   if (num_role_units(action_id_get_role(ACTION_HELP_WONDER)) == 0) {
     return; /* Ruleset has no help wonder unit */
   }
@@ -84,15 +92,22 @@ static void calculate_city_clusters(struct player *pplayer)
   ghost = unit_virtual_create(pplayer, NULL, punittype, 0);
   range = unit_move_rate(ghost) * 4;
 
+  /* The maps of all the cities are independent, compute them at once. */
+  parameters = fc_malloc(num * sizeof(*parameters));
+  maps = fc_malloc(num * sizeof(*maps));
+  i = 0;
   city_list_iterate(pplayer->cities, pcity) {
-    struct pf_parameter parameter;
-    struct pf_map *pfm;
-    struct adv_city *city_data = pcity->server.adv;
-
     unit_tile_set(ghost, pcity->tile);
-    pft_fill_unit_parameter(&parameter, nmap, ghost);
-    parameter.omniscience = !has_handicap(pplayer, H_MAP);
-    pfm = pf_map_new(&parameter);
+    pft_fill_unit_parameter(&parameters[i], nmap, ghost);
+    parameters[i].omniscience = !has_handicap(pplayer, H_MAP);
+    i++;
+  } city_list_iterate_end;
+  pf_map_batch_new(parameters, num, range, maps);
+
+  i = 0;
+  city_list_iterate(pplayer->cities, pcity) {
+    struct pf_map *pfm = maps[i++];
+    struct adv_city *city_data = pcity->server.adv;
 
     pf_map_move_costs_iterate(pfm, ptile, move_cost, FALSE) {
       struct city *acity = tile_city(ptile);
@@ -111,6 +126,8 @@ static void calculate_city_clusters(struct player *pplayer)
     pf_map_destroy(pfm);
   } city_list_iterate_end;
 
+  free(maps);
+  free(parameters);
   unit_virtual_destroy(ghost);
 }
 
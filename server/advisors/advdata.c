@@ -34,6 +34,7 @@
 
 /* common/aicore */
 #include "aisupport.h"
+#include "cm.h"
 #include "path_finding.h"
 #include "pf_tools.h"
 
@@ -993,6 +994,7 @@ void adv_best_government(struct player *pplayer)
 
   if (adv->govt_reeval == 0) {
     const struct research *presearch = research_get(pplayer);
+    enum cm_caller cmcaller = cm_set_caller(CM_CALLER_AI);
 
     governments_iterate(gov) {
       adv_want val = 0;
@@ -1017,9 +1019,7 @@ void adv_best_government(struct player *pplayer)
         /* Ideally we should change tax rates here, but since
          * this is a rather big CPU operation, we'd rather not. */
         check_player_max_rates(pplayer);
-        city_list_iterate(pplayer->cities, acity) {
-          auto_arrange_workers(acity);
-        } city_list_iterate_end;
+        auto_arrange_workers_list(pplayer->cities);
         city_list_iterate(pplayer->cities, pcity) {
           val += adv_eval_calc_city(pcity, adv);
         } city_list_iterate_end;
@@ -1051,9 +1051,8 @@ void adv_best_government(struct player *pplayer)
     } governments_iterate_end;
     /* Now reset our gov to it's real state. */
     pplayer->government = current_gov;
-    city_list_iterate(pplayer->cities, acity) {
-      auto_arrange_workers(acity);
-    } city_list_iterate_end;
+    auto_arrange_workers_list(pplayer->cities);
+    cm_set_caller(cmcaller);
     if (player_is_cpuhog(pplayer)) {
       adv->govt_reeval = 1;
     } else {
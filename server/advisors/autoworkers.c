@@ -466,7 +466,7 @@ adv_want worker_evaluate_improvements(const struct civ_map *nmap,
   pft_fill_unit_parameter(&parameter, nmap, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   parameter.get_TB = autoworker_tile_behavior;
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_new_cached(&parameter);
 
   city_list_iterate(pplayer->cities, pcity) {
     struct tile *pcenter = city_tile(pcity);
@@ -850,7 +850,7 @@ struct city *worker_evaluate_city_requests(struct unit *punit,
   pft_fill_unit_parameter(&parameter, nmap, punit);
   parameter.omniscience = !has_handicap(pplayer, H_MAP);
   parameter.get_TB = autoworker_tile_behavior;
-  pfm = pf_map_new(&parameter);
+  pfm = pf_map_new_cached(&parameter);
 
   /* Have nearby cities requests? */
   city_list_iterate(pplayer->cities, pcity) {
@@ -106,6 +106,7 @@ struct player *create_barbarian_player(enum barbarian_type type)
       if (!old_barbs->is_alive) {
         old_barbs->economic.gold = 0;
         old_barbs->is_alive = TRUE;
+        effect_cache_invalidate();
         player_status_reset(old_barbs);
 
         /* Free old name so pick_random_player_name() can select it again.
@@ -35,6 +35,7 @@
 #include "city.h"
 #include "counters.h"
 #include "culture.h"
+#include "effects.h"
 #include "events.h"
 #include "game.h"
 #include "government.h"
@@ -56,6 +57,8 @@
 
 /* common/aicore */
 #include "cm.h"
+#include "path_finding.h"
+#include "pf_cluster.h"
 
 /* common/scriptcore */
 #include "luascript_types.h"
@@ -100,6 +103,9 @@ static struct city_list *arrange_workers_queue = nullptr;
 /* Suppress sending cities during game_load() and end_phase() */
 static bool send_city_suppressed = FALSE;
 
+/* Sending the city info held back by city_info_coalesce() */
+static bool send_city_coalesced = FALSE;
+
 static bool city_workers_queue_remove(struct city *pcity);
 
 static void announce_trade_route_removal(struct city *pc1, struct city *pc2,
@@ -194,6 +200,22 @@ void city_thaw_workers_queue(void)
     return;
   }
 
+  if (0 < cm_get_batch_threads()) {
+    struct city **cities
+      = fc_malloc(city_list_size(arrange_workers_queue) * sizeof(*cities));
+    int num = 0;
+
+    /* The cities thawing with a pending arrangement. */
+    city_list_iterate(arrange_workers_queue, pcity) {
+      if (pcity->server.workers_frozen == 1
+          && pcity->server.needs_arrange != CNA_NOT) {
+        cities[num++] = pcity;
+      }
+    } city_list_iterate_end;
+    auto_arrange_workers_prefetch(cities, num);
+    free(cities);
+  }
+
   city_list_iterate(arrange_workers_queue, pcity) {
     city_thaw_workers(pcity);
   } city_list_iterate_end;
@@ -1680,6 +1702,7 @@ bool create_city_for_player(struct player *pplayer, struct tile *ptile,
 
   if (!pplayer->is_alive) {
     pplayer->is_alive = TRUE;
+    effect_cache_invalidate();
     send_player_info_c(pplayer, nullptr);
   }
 
@@ -1891,6 +1914,8 @@ void remove_city(struct city *pcity)
   fc_mutex_allocate(&game.server.mutexes.city_list);
   game_remove_city(&wld, pcity);
   fc_mutex_release(&game.server.mutexes.city_list);
+  pf_clusters_tile_changed(pcenter);
+  pf_map_cache_invalidate();
 
   /* Remove any extras that were only there because the city was there. */
   extra_type_iterate(pextra) {
@@ -2156,6 +2181,110 @@ bool send_city_suppression(bool now)
   return formerly;
 }
 
+/************************************************************************//**
+  Whether to hold back the info about pcity from pconn, as its send queue
+  is congested. Only observers, which don't wait for replies to requests,
+  and only for cities they already have the full info about. They get
+  the info as it is by then once the queue has drained; see
+  send_coalesced_city_info().
+****************************************************************************/
+static bool city_info_coalesce(struct connection *pconn,
+                               const struct city *pcity)
+{
+  if (send_city_coalesced
+      || !pconn->observer
+      || !connection_send_congested(pconn)
+      || !packet_dense_key_sent(pconn, PACKET_CITY_INFO, pcity->id)) {
+    return FALSE;
+  }
+
+  if (pconn->server.coalesced_cities == nullptr) {
+    pconn->server.coalesced_cities = city_hash_new();
+  }
+  if (!city_hash_insert(pconn->server.coalesced_cities, pcity->id,
+                        nullptr)) {
+    /* The update held back before is superseded. */
+    pconn->statistics.coalesced++;
+  }
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Return the connections of dest to send the info about pcity to now.
+  That is dest itself, or a new list for the caller to destroy if some
+  connections have it held back.
+****************************************************************************/
+static struct conn_list *city_info_receivers(struct conn_list *dest,
+                                             const struct city *pcity)
+{
+  struct conn_list *receivers = nullptr;
+
+  conn_list_iterate(dest, pconn) {
+    if (city_info_coalesce(pconn, pcity)) {
+      if (receivers == nullptr) {
+        receivers = conn_list_new();
+        conn_list_iterate(dest, pbefore) {
+          if (pbefore == pconn) {
+            break;
+          }
+          conn_list_append(receivers, pbefore);
+        } conn_list_iterate_end;
+      }
+    } else if (receivers != nullptr) {
+      conn_list_append(receivers, pconn);
+    }
+  } conn_list_iterate_end;
+
+  return receivers != nullptr ? receivers : dest;
+}
+
+/************************************************************************//**
+  Send the city info held back by city_info_coalesce() to the connections
+  whose send queue is no longer congested.
+****************************************************************************/
+void send_coalesced_city_info(void)
+{
+  conn_list_iterate(game.est_connections, pconn) {
+    struct city_hash *pending = pconn->server.coalesced_cities;
+
+    if (pending == nullptr
+        || pconn->server.is_closing
+        || connection_send_congested(pconn)) {
+      continue;
+    }
+
+    pconn->server.coalesced_cities = nullptr;
+
+    send_city_coalesced = TRUE;
+    connection_do_buffer(pconn);
+    TYPED_HASH_KEYS_ITERATE(intptr_t, pending, id) {
+      struct city *pcity = game_city_by_number(id);
+
+      if (pcity != nullptr) {
+        send_city_info_at_tile(pconn->playing, pconn->self, pcity,
+                               pcity->tile);
+      }
+    } HASH_KEYS_ITERATE_END;
+    connection_do_unbuffer(pconn);
+    send_city_coalesced = FALSE;
+
+    city_hash_destroy(pending);
+  } conn_list_iterate_end;
+}
+
+/************************************************************************//**
+  Forget about the city info held back from the connection. To be called
+  when it is detached or closed, or the cities go away.
+****************************************************************************/
+void cancel_coalesced_city_info(struct connection *pconn)
+{
+  if (pconn->server.coalesced_cities != nullptr) {
+    city_hash_destroy(pconn->server.coalesced_cities);
+    pconn->server.coalesced_cities = nullptr;
+  }
+}
+
 /************************************************************************//**
   This fills out a package from a player's vision_site.
 ****************************************************************************/
@@ -2256,16 +2385,21 @@ void broadcast_city_info(struct city *pcity)
   players_iterate(pplayer) {
     if (!send_city_suppressed || pplayer != powner) {
       if (can_player_see_city_internals(pplayer, pcity)) {
+        struct conn_list *dest = city_info_receivers(pplayer->connections,
+                                                     pcity);
+
         update_dumb_city(pplayer, pcity);
         packet.original = city_original_owner(pcity, pplayer);
-        lsend_packet_city_info(pplayer->connections, &packet, FALSE);
-        lsend_packet_city_nationalities(pplayer->connections, &nat_packet, FALSE);
-        lsend_packet_city_rally_point(pplayer->connections, &rally_packet, FALSE);
-        web_lsend_packet(city_info_addition, pplayer->connections,
-                         webp_ptr, FALSE);
+        lsend_packet_city_info(dest, &packet, FALSE);
+        lsend_packet_city_nationalities(dest, &nat_packet, FALSE);
+        lsend_packet_city_rally_point(dest, &rally_packet, FALSE);
+        web_lsend_packet(city_info_addition, dest, webp_ptr, FALSE);
         trade_route_packet_list_iterate(routes, route_packet) {
-          lsend_packet_trade_route_info(pplayer->connections, route_packet);
+          lsend_packet_trade_route_info(dest, route_packet);
         } trade_route_packet_list_iterate_end;
+        if (dest != pplayer->connections) {
+          conn_list_destroy(dest);
+        }
       } else if (player_can_see_city_externals(pplayer, pcity)) {
         reality_check_city(pplayer, pcity->tile);
         update_dumb_city(pplayer, pcity);
@@ -2278,7 +2412,8 @@ void broadcast_city_info(struct city *pcity)
   /* Send to global observers. */
   packet.original = city_original_owner(pcity, nullptr);
   conn_list_iterate(game.est_connections, pconn) {
-    if (conn_is_global_observer(pconn)) {
+    if (conn_is_global_observer(pconn)
+        && !city_info_coalesce(pconn, pcity)) {
       send_packet_city_info(pconn, &packet, FALSE);
       send_packet_city_nationalities(pconn, &nat_packet, FALSE);
       send_packet_city_rally_point(pconn, &rally_packet, FALSE);
@@ -2403,6 +2538,7 @@ void send_city_info_at_tile(struct player *pviewer, struct conn_list *dest,
   struct player *powner = nullptr;
   struct trade_route_packet_list *routes = nullptr;
   struct packet_web_city_info_addition *webp_ptr;
+  struct conn_list *receivers = dest;
 
   if (!pcity) {
     pcity = tile_city(ptile);
@@ -2432,22 +2568,24 @@ void send_city_info_at_tile(struct player *pviewer, struct conn_list *dest,
       routes = trade_route_packet_list_new();
 
       /* Send all info to the owner */
+      receivers = city_info_receivers(dest, pcity);
       update_dumb_city(powner, pcity);
       package_city(pcity, &packet, &nat_packet, &rally_packet,
                    webp_ptr, routes, FALSE);
       packet.original = city_original_owner(pcity, pviewer);
-      lsend_packet_city_info(dest, &packet, FALSE);
-      lsend_packet_city_nationalities(dest, &nat_packet, FALSE);
-      lsend_packet_city_rally_point(dest, &rally_packet, FALSE);
-      web_lsend_packet(city_info_addition, dest, webp_ptr, FALSE);
+      lsend_packet_city_info(receivers, &packet, FALSE);
+      lsend_packet_city_nationalities(receivers, &nat_packet, FALSE);
+      lsend_packet_city_rally_point(receivers, &rally_packet, FALSE);
+      web_lsend_packet(city_info_addition, receivers, webp_ptr, FALSE);
       trade_route_packet_list_iterate(routes, route_packet) {
-        lsend_packet_trade_route_info(dest, route_packet);
+        lsend_packet_trade_route_info(receivers, route_packet);
       } trade_route_packet_list_iterate_end;
       if (dest == powner->connections) {
         /* HACK: send also a copy to global observers. */
         packet.original = city_original_owner(pcity, nullptr);
         conn_list_iterate(game.est_connections, pconn) {
-          if (conn_is_global_observer(pconn)) {
+          if (conn_is_global_observer(pconn)
+              && !city_info_coalesce(pconn, pcity)) {
             send_packet_city_info(pconn, &packet, FALSE);
             trade_route_packet_list_iterate(routes, route_packet) {
               send_packet_trade_route_info(pconn, route_packet);
@@ -2461,16 +2599,17 @@ void send_city_info_at_tile(struct player *pviewer, struct conn_list *dest,
     if (!pviewer) {  /* Observer */
       if (pcity) {
         routes = trade_route_packet_list_new();
+        receivers = city_info_receivers(dest, pcity);
 
         /* Should be dumb_city info? */
         package_city(pcity, &packet, &nat_packet, &rally_packet,
                      webp_ptr, routes, FALSE);
-        lsend_packet_city_info(dest, &packet, FALSE);
-        lsend_packet_city_nationalities(dest, &nat_packet, FALSE);
-        lsend_packet_city_rally_point(dest, &rally_packet, FALSE);
-        web_lsend_packet(city_info_addition, dest, webp_ptr, FALSE);
+        lsend_packet_city_info(receivers, &packet, FALSE);
+        lsend_packet_city_nationalities(receivers, &nat_packet, FALSE);
+        lsend_packet_city_rally_point(receivers, &rally_packet, FALSE);
+        web_lsend_packet(city_info_addition, receivers, webp_ptr, FALSE);
         trade_route_packet_list_iterate(routes, route_packet) {
-          lsend_packet_trade_route_info(dest, route_packet);
+          lsend_packet_trade_route_info(receivers, route_packet);
         } trade_route_packet_list_iterate_end;
       }
     } else {
@@ -2496,6 +2635,9 @@ void send_city_info_at_tile(struct player *pviewer, struct conn_list *dest,
     } trade_route_packet_list_iterate_end;
     trade_route_packet_list_destroy(routes);
   }
+  if (receivers != dest) {
+    conn_list_destroy(receivers);
+  }
 }
 
 /************************************************************************//**
@@ -52,6 +52,8 @@ void send_city_info_at_tile(struct player *pviewer, struct conn_list *dest,
 void send_all_known_cities(struct conn_list *dest);
 void send_player_cities(struct player *pplayer);
 void broadcast_city_info(struct city *pcity);
+void send_coalesced_city_info(void);
+void cancel_coalesced_city_info(struct connection *pconn);
 void package_city(struct city *pcity, struct packet_city_info *packet,
                   struct packet_city_nationalities *nat_packet,
                   struct packet_city_rally_point *rally_packet,
@@ -157,6 +157,7 @@ static bool check_city_migrations_player(const struct player *pplayer);
 **************************************************************************/
 bool city_refresh(struct city *pcity)
 {
+  enum req_profile_caller caller = req_profile_set_caller(RPC_CITY);
   bool retval;
 
   pcity->server.needs_refresh = FALSE;
@@ -170,6 +171,7 @@ bool city_refresh(struct city *pcity)
     /* Force a sync of the city after the change. */
     send_city_info(city_owner(pcity), pcity);
   }
+  req_profile_set_caller(caller);
 
   return retval;
 }
@@ -211,18 +213,44 @@ void city_refresh_queue_add(struct city *pcity)
 **************************************************************************/
 void city_refresh_queue_processing(void)
 {
+  struct city **arrange = NULL;
+  int num_arrange = 0, next = 0;
+
   if (NULL == city_refresh_queue) {
     return;
   }
 
+  if (0 < cm_get_batch_threads()) {
+    /* Find the cities to rearrange first, so that their searches run
+     * together. They are all refreshed again below, in order. */
+    arrange = fc_malloc(city_list_size(city_refresh_queue)
+                        * sizeof(*arrange));
+    city_list_iterate(city_refresh_queue, pcity) {
+      if (pcity->server.needs_refresh) {
+        if (city_refresh(pcity)) {
+          arrange[num_arrange++] = pcity;
+        }
+        pcity->server.needs_refresh = TRUE;
+      }
+    } city_list_iterate_end;
+    auto_arrange_workers_prefetch(arrange, num_arrange);
+  }
+
   city_list_iterate(city_refresh_queue, pcity) {
-    if (pcity->server.needs_refresh) {
-      if (city_refresh(pcity)) {
+    /* Its radius already changed above. */
+    bool radius_changed = (next < num_arrange && arrange[next] == pcity);
+
+    if (radius_changed) {
+      next++;
+    }
+    if (pcity->server.needs_refresh || radius_changed) {
+      if (city_refresh(pcity) || radius_changed) {
         auto_arrange_workers(pcity);
       }
       send_city_info(city_owner(pcity), pcity);
     }
   } city_list_iterate_end;
+  free(arrange);
 
   city_list_destroy(city_refresh_queue);
   city_refresh_queue = NULL;
@@ -395,7 +423,6 @@ void auto_arrange_workers(struct city *pcity)
   city_refresh(pcity);
 
   sanity_check_city(pcity);
-  cm_clear_cache(pcity);
 
   if (pcity->cm_parameter) {
     pcmp = pcity->cm_parameter;
@@ -481,6 +508,62 @@ void auto_arrange_workers(struct city *pcity)
   TIMING_LOG(AIT_CITIZEN_ARRANGE, TIMER_STOP);
 }
 
+/**********************************************************************//**
+  Run the searches of auto_arrange_workers() for all the cities at once,
+  on the CM worker threads, and keep their results in the CM result
+  cache. The auto_arrange_workers() calls that follow, in the caller's
+  order, apply them. The cities whose tiles or other inputs were changed
+  by the previous arrangements miss the cache, so only they are searched
+  again. Does nothing without CM worker threads.
+**************************************************************************/
+void auto_arrange_workers_prefetch(struct city **cities, int num)
+{
+  struct cm_parameter *params;
+  int i;
+
+  if (2 > num || 0 == cm_get_batch_threads() || !cm_get_result_cache()) {
+    return;
+  }
+
+  params = fc_malloc(num * sizeof(*params));
+  for (i = 0; i < num; i++) {
+    if (cities[i]->cm_parameter) {
+      cm_copy_parameter(&params[i], cities[i]->cm_parameter);
+    } else {
+      cm_init_parameter(&params[i]);
+      set_default_city_manager(&params[i], cities[i]);
+    }
+  }
+
+  cm_query_result_batch(cities, params, NULL, num, FALSE);
+  free(params);
+}
+
+/**********************************************************************//**
+  Call auto_arrange_workers() for all the cities of the list, in order.
+  Their searches are run at once first, see
+  auto_arrange_workers_prefetch().
+**************************************************************************/
+void auto_arrange_workers_list(struct city_list *cities)
+{
+  if (0 < cm_get_batch_threads() && 1 < city_list_size(cities)) {
+    struct city **batch = fc_malloc(city_list_size(cities) * sizeof(*batch));
+    int num = 0;
+
+    city_list_iterate(cities, pcity) {
+      if (0 == pcity->server.workers_frozen) {
+        batch[num++] = pcity;
+      }
+    } city_list_iterate_end;
+    auto_arrange_workers_prefetch(batch, num);
+    free(batch);
+  }
+
+  city_list_iterate(cities, pcity) {
+    auto_arrange_workers(pcity);
+  } city_list_iterate_end;
+}
+
 /**********************************************************************//**
   Notices about cities that should be sent to all players.
 **************************************************************************/
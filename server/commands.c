@@ -700,6 +700,33 @@ static struct command commands[] = {
    NULL, mapimg_help,
    CMD_ECHO_ADMINS, VCF_NONE, 50
   },
+  {"cmstats",   ALLOW_ADMIN,
+   /* TRANS: translate text between <> only */
+   N_("cmstats\n"
+      "cmstats reset"),
+   N_("Show the statistics of the city governor."),
+   N_("Shows, for this turn and for the whole game, how many worker "
+      "arrangements the city governor computed for the server, the AI "
+      "and the clients, how many of them came from its cache, and the "
+      "time its searches took. 'cmstats reset' restarts the counting."),
+   NULL,
+   CMD_ECHO_NONE, VCF_NONE, 50
+  },
+  {"reqstats",   ALLOW_ADMIN,
+   /* TRANS: translate text between <> only */
+   N_("reqstats\n"
+      "reqstats on|off\n"
+      "reqstats reset"),
+   N_("Profile the requirement and effect evaluations."),
+   N_("'reqstats on' starts counting how many requirements of each kind "
+      "and effects of each type are evaluated, and the time it takes, "
+      "for the city refresh, the AI, the actions and the rest. "
+      "'reqstats' shows the most expensive ones, which are also logged "
+      "at the end of the game, 'reqstats off' stops the counting and "
+      "'reqstats reset' restarts it."),
+   NULL,
+   CMD_ECHO_ADMINS, VCF_NONE, 50
+  },
   {"lock",   ALLOW_HACK,
    /* TRANS: translate text between <> only */
    N_("lock <setting>"),
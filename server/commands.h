@@ -97,6 +97,8 @@ enum command_id {
   CMD_AICMD,
   CMD_FCDB,
   CMD_MAPIMG,
+  CMD_CMSTATS,
+  CMD_REQSTATS,
 
   CMD_LOCK,
   CMD_UNLOCK,
@@ -36,6 +36,7 @@
 /* server */
 #include "aiiface.h"
 #include "auth.h"
+#include "citytools.h"
 #include "diplhand.h"
 #include "edithand.h"
 #include "gamehand.h"
@@ -812,6 +813,9 @@ void connection_detach(struct connection *pconn, bool remove_unused_player)
 
   fc_assert_ret(pconn != NULL);
 
+  map_stream_cancel(pconn);
+  cancel_coalesced_city_info(pconn);
+
   if (NULL != (pplayer = pconn->playing)) {
     bool was_connected = pplayer->is_connected;
 
@@ -27,6 +27,7 @@
 /* common */
 #include "ai.h"
 #include "diptreaty.h"
+#include "effects.h"
 #include "events.h"
 #include "game.h"
 #include "map.h"
@@ -35,6 +36,9 @@
 #include "research.h"
 #include "unit.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* common/scriptcore */
 #include "luascript_types.h"
 
@@ -137,6 +141,10 @@ void set_diplstate_type(struct player_diplstate *state1,
   state2->type = type;
   state1->max_state = max;
   state2->max_state = max;
+
+  /* Path-finding depends on alliances and wars, effects on alliances. */
+  pf_map_cache_invalidate();
+  effect_cache_invalidate();
 }
 
 /**********************************************************************//**
@@ -17,6 +17,7 @@
 
 /* utility */
 #include "bitvector.h"
+#include "capability.h"
 #include "fcintl.h"
 #include "log.h"
 #include "mem.h"
@@ -40,6 +41,10 @@
 #include "unitlist.h"
 #include "vision.h"
 
+/* common/aicore */
+#include "path_finding.h"
+#include "pf_cluster.h"
+
 /* server */
 #include "citytools.h"
 #include "cityturn.h"
@@ -64,6 +69,20 @@
 /* Suppress send_tile_info() during game_load() */
 static bool send_tile_suppressed = FALSE;
 
+/* Tiles sent at most at a time to a client which joined a running
+ * game, once it has the ones it needs first. */
+#define MAP_STREAM_CHUNK_TILES 256
+
+/* No more of the map is sent while more than this many bytes wait in
+ * the send buffer of the connection. */
+#define MAP_STREAM_LOW_WATER MAX_LEN_PACKET
+
+struct map_stream {
+  struct dbv sent;      /* Tiles already sent */
+  int next_index;       /* Where to look for the next tile to send */
+  int tiles_sent;
+};
+
 static void player_tile_init(struct tile *ptile, struct player *pplayer);
 static void player_tile_free(struct tile *ptile, struct player *pplayer);
 static bool give_tile_info_from_player_to_player(struct player *pfrom,
@@ -468,6 +487,186 @@ void send_all_known_tiles(struct conn_list *dest)
   flush_packets();
 }
 
+/**********************************************************************//**
+  Send the tiles the client must have before it can be used, and record
+  the rest of the map as still to be sent to it. See map_stream_start().
+**************************************************************************/
+static void map_stream_send_urgent(struct connection *pconn,
+                                   struct map_stream *pstream)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct player *pplayer = conn_get_player(pconn);
+  int tiles_sent = 0;
+
+  /* Units and cities may be sent about any tile the player sees, and
+   * the client expects to know the tile by then. The city dialogs need
+   * the whole city map. */
+  whole_map_iterate(nmap, ptile) {
+    if (map_is_known_and_seen(ptile, pplayer, V_MAIN)
+        || NULL != map_get_player_city(ptile, pplayer)) {
+      dbv_set(&pstream->sent, tile_index(ptile));
+    }
+  } whole_map_iterate_end;
+
+  city_list_iterate(pplayer->cities, pcity) {
+    city_tile_iterate(city_map_radius_sq_get(pcity), city_tile(pcity),
+                      ptile) {
+      dbv_set(&pstream->sent, tile_index(ptile));
+    } city_tile_iterate_end;
+  } city_list_iterate_end;
+
+  connection_do_buffer(pconn);
+  whole_map_iterate(nmap, ptile) {
+    if (!dbv_isset(&pstream->sent, tile_index(ptile))) {
+      continue;
+    }
+
+    tiles_sent++;
+    if ((tiles_sent % MAP_NATIVE_WIDTH) == 0) {
+      connection_do_unbuffer(pconn);
+      flush_packets();
+      connection_do_buffer(pconn);
+    }
+
+    send_tile_info(pconn->self, ptile, FALSE);
+  } whole_map_iterate_end;
+  connection_do_unbuffer(pconn);
+
+  pstream->tiles_sent = tiles_sent;
+}
+
+/**********************************************************************//**
+  Tell the client how much of the map it has got.
+**************************************************************************/
+static void map_stream_send_progress(struct connection *pconn,
+                                     const struct map_stream *pstream)
+{
+  struct packet_map_stream_progress packet;
+
+  packet.tiles_sent = pstream->tiles_sent;
+  packet.tiles_total = MAP_INDEX_SIZE;
+  send_packet_map_stream_progress(pconn, &packet);
+}
+
+/**********************************************************************//**
+  Send the map to connections which get the whole game state, at game
+  start or when they join a running game. Clients with the "map-stream"
+  capability which play or observe a player get the tiles the player
+  sees, and those of the cities it knows, right away. The rest of the
+  map follows in chunks from map_streams_continue(), between whatever
+  else the server has to do, so the client can be used before it has
+  the whole map and the send buffer never holds all of it at once.
+  Other clients get the whole map now, as from send_all_known_tiles().
+
+  The units and cities the client may see must be sent after this.
+**************************************************************************/
+void map_stream_start(struct conn_list *dest)
+{
+  struct conn_list *whole = conn_list_new();
+
+  conn_list_iterate(dest, pconn) {
+    struct map_stream *pstream;
+
+    map_stream_cancel(pconn);
+
+    /* Global observers see units move anywhere, so they need the whole
+     * map first. */
+    if (NULL == conn_get_player(pconn)
+        || !has_capability(MAP_STREAM_CAPABILITY, pconn->capability)) {
+      conn_list_append(whole, pconn);
+      continue;
+    }
+
+    pstream = fc_malloc(sizeof(*pstream));
+    dbv_init(&pstream->sent, MAP_INDEX_SIZE);
+    pstream->next_index = 0;
+
+    map_stream_send_urgent(pconn, pstream);
+    map_stream_send_progress(pconn, pstream);
+
+    if (pstream->tiles_sent < MAP_INDEX_SIZE) {
+      pconn->server.map_stream = pstream;
+    } else {
+      dbv_free(&pstream->sent);
+      free(pstream);
+    }
+  } conn_list_iterate_end;
+
+  if (0 < conn_list_size(whole)) {
+    send_all_known_tiles(whole);
+  }
+  conn_list_destroy(whole);
+}
+
+/**********************************************************************//**
+  Forget about the part of the map not yet sent to the connection. To
+  be called when the connection is detached or closed, or the map goes
+  away.
+**************************************************************************/
+void map_stream_cancel(struct connection *pconn)
+{
+  struct map_stream *pstream = pconn->server.map_stream;
+
+  if (NULL != pstream) {
+    dbv_free(&pstream->sent);
+    free(pstream);
+    pconn->server.map_stream = NULL;
+  }
+}
+
+/**********************************************************************//**
+  Send the next chunk of the map to every connection still waiting for
+  some and which has not much data left to write. Returns TRUE if more
+  could be sent right away.
+**************************************************************************/
+bool map_streams_continue(void)
+{
+  const struct civ_map *nmap = &(wld.map);
+  bool more = FALSE;
+
+  if (S_S_RUNNING != server_state() && S_S_OVER != server_state()) {
+    return FALSE;
+  }
+
+  conn_list_iterate(game.est_connections, pconn) {
+    struct map_stream *pstream = pconn->server.map_stream;
+    int chunk = 0;
+
+    if (NULL == pstream
+        || pconn->server.is_closing
+        || MAP_STREAM_LOW_WATER < pconn->send_buffer->ndata) {
+      continue;
+    }
+
+    conn_compression_freeze(pconn);
+    connection_do_buffer(pconn);
+    while (pstream->next_index < MAP_INDEX_SIZE
+           && chunk < MAP_STREAM_CHUNK_TILES) {
+      int idx = pstream->next_index++;
+
+      if (!dbv_isset(&pstream->sent, idx)) {
+        dbv_set(&pstream->sent, idx);
+        send_tile_info(pconn->self, index_to_tile(nmap, idx), FALSE);
+        pstream->tiles_sent++;
+        chunk++;
+      }
+    }
+    map_stream_send_progress(pconn, pstream);
+    connection_do_unbuffer(pconn);
+    conn_compression_thaw(pconn);
+
+    if (pstream->next_index >= MAP_INDEX_SIZE) {
+      log_verbose("Map stream to %s finished.", conn_description(pconn));
+      map_stream_cancel(pconn);
+    } else if (!pconn->server.is_closing
+               && MAP_STREAM_LOW_WATER >= pconn->send_buffer->ndata) {
+      more = TRUE;
+    }
+  } conn_list_iterate_end;
+
+  return more;
+}
+
 /**********************************************************************//**
   Suppress send_tile_info() during game_load()
 **************************************************************************/
@@ -565,7 +764,7 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
 
       info.altitude = ptile->altitude;
 
-      send_packet_tile_info(pconn, &info);
+      send_packet_tile_info_batched(pconn, &info);
     } else if (pplayer != NULL && known) {
       struct player_tile *plrtile = map_get_player_tile(ptile, pplayer);
       struct vision_site *psite = map_get_playermap_site(plrtile);
@@ -602,7 +801,7 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
 
       info.altitude = ptile->altitude;
 
-      send_packet_tile_info(pconn, &info);
+      send_packet_tile_info_batched(pconn, &info);
     } else if (send_unknown) {
       info.known = TILE_UNKNOWN;
       info.continent = 0;
@@ -621,7 +820,7 @@ void send_tile_info(struct conn_list *dest, struct tile *ptile,
 
       info.altitude = 0;
 
-      send_packet_tile_info(pconn, &info);
+      send_packet_tile_info_batched(pconn, &info);
     }
   }
   conn_list_iterate_end;
@@ -1172,6 +1371,7 @@ void change_playertile_site(struct player_tile *ptile,
 void map_set_known(struct tile *ptile, struct player *pplayer)
 {
   dbv_set(&pplayer->tile_known, tile_index(ptile));
+  pf_map_cache_invalidate();
 }
 
 /**********************************************************************//**
@@ -1180,6 +1380,7 @@ void map_set_known(struct tile *ptile, struct player *pplayer)
 void map_clear_known(struct tile *ptile, struct player *pplayer)
 {
   dbv_clr(&pplayer->tile_known, tile_index(ptile));
+  pf_map_cache_invalidate();
 }
 
 /**********************************************************************//**
@@ -1427,6 +1628,9 @@ bool update_player_tile_knowledge(struct player *pplayer, struct tile *ptile)
 **************************************************************************/
 void update_tile_knowledge(struct tile *ptile)
 {
+  pf_clusters_tile_changed(ptile);
+  pf_map_cache_invalidate();
+
   if (server_state() == S_S_INITIAL) {
     return;
   }
@@ -1976,6 +2180,9 @@ void check_terrain_change(struct tile *ptile, struct terrain *oldter)
   struct tile *claimer;
   bool cont_reassigned = FALSE;
 
+  pf_clusters_tile_changed(ptile);
+  pf_map_cache_invalidate();
+
   /* Check if new terrain is a freshwater terrain next to non-freshwater.
    * In that case, the new terrain is *changed*. */
   if (is_ocean(newter) && terrain_has_flag(newter, TER_FRESHWATER)) {
@@ -2539,6 +2746,8 @@ void create_extra(struct tile *ptile, struct extra_type *pextra,
   }
 
   tile_add_extra(ptile, pextra);
+  pf_clusters_tile_changed(ptile);
+  pf_map_cache_invalidate();
 
   /* Watchtower might become effective. */
   unit_list_refresh_vision(ptile->units);
@@ -2617,6 +2826,9 @@ void destroy_extra(struct tile *ptile, struct extra_type *pextra)
   tile_remove_extra(ptile, pextra);
 
   if (real) {
+    pf_clusters_tile_changed(ptile);
+    pf_map_cache_invalidate();
+
     /* Remove base from vision of players which were able to see the base. */
     players_iterate(pplayer) {
       if (BV_ISSET(base_seen, player_index(pplayer))
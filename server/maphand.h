@@ -56,6 +56,10 @@ void give_citymap_from_player_to_player(struct city *pcity,
 					struct player *pfrom, struct player *pdest);
 void send_all_known_tiles(struct conn_list *dest);
 
+void map_stream_start(struct conn_list *dest);
+void map_stream_cancel(struct connection *pconn);
+bool map_streams_continue(void);
+
 bool send_tile_suppression(bool now);
 void send_tile_info(struct conn_list *dest, struct tile *ptile,
                     bool send_unknown);
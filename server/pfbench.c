@@ -0,0 +1,504 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* freeciv-pfbench: path-finding benchmark.
+ *
+ * Loads a savegame, without opening any network connection, then builds
+ * and fully iterates the path-finding maps of every unit on the map:
+ * a normal map, a danger map, and a fuel map for the units which need
+ * fuel. The number of maps, the number of expanded nodes, the wall time
+ * and the peak memory of a single map are reported for every map type,
+ * as CSV or JSON. */
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "fc_cmdline.h"
+#include "fciconv.h"
+#include "fcintl.h"
+#include "log.h"
+#include "mem.h"
+#include "registry.h"
+#include "support.h"
+#include "timing.h"
+
+/* common */
+#include "fc_cmdhelp.h"
+#include "game.h"
+#include "map.h"
+#include "player.h"
+#include "unit.h"
+#include "version.h"
+
+/* common/aicore */
+#include "path_finding.h"
+#include "pf_tools.h"
+
+/* server */
+#include "sernet.h"
+#include "settings.h"
+#include "srv_main.h"
+#include "stdinhand.h"
+
+/* server/savegame */
+#include "savemain.h"
+
+enum pfbench_map_type {
+  PFB_NORMAL,
+  PFB_DANGER,
+  PFB_FUEL,
+  PFB_COUNT
+};
+
+static const char *pfbench_map_type_names[PFB_COUNT] = {
+  "normal", "danger", "fuel"
+};
+
+struct pfbench_result {
+  unsigned int maps;
+  unsigned long expanded;
+  double wall_time;
+  size_t peak_memory;
+};
+
+static char *savegame = NULL;
+static char *output = NULL;
+static bool json = FALSE;
+static int repeat = 1;
+static int threads = -1;        /* -1 when not using pf_map_batch_new(). */
+static int fatal_assertions = -1;
+static enum log_level loglevel = LOG_NORMAL;
+
+/**********************************************************************//**
+  Parse freeciv-pfbench commandline parameters.
+**************************************************************************/
+static void pfb_parse_cmdline(int argc, char *argv[])
+{
+  int i = 1;
+
+  while (i < argc) {
+    char *option = NULL;
+
+    if (is_option("--help", argv[i])) {
+      struct cmdhelp *help = cmdhelp_new(argv[0]);
+
+      cmdhelp_add(help, "h", "help",
+                  _("Print a summary of the options"));
+#ifdef FREECIV_DEBUG
+      cmdhelp_add(help, "d",
+                  /* TRANS: "debug" is exactly what user must type, do not translate. */
+                  _("debug LEVEL"),
+                  _("Set debug log level (one of f,e,w,n,v,d, or "
+                    "d:file1,min,max:...)"));
+#else  /* FREECIV_DEBUG */
+      cmdhelp_add(help, "d",
+                  /* TRANS: "debug" is exactly what user must type, do not translate. */
+                  _("debug LEVEL"),
+                  _("Set debug log level (one of f,e,w,n,v)"));
+#endif /* FREECIV_DEBUG */
+#ifndef FREECIV_NDEBUG
+      cmdhelp_add(help, "F",
+                  /* TRANS: "Fatal" is exactly what user must type, do not translate. */
+                  _("Fatal [SIGNAL]"),
+                  _("Raise a signal on failed assertion or broken data"));
+#endif /* FREECIV_NDEBUG */
+      cmdhelp_add(help, "f",
+                  /* TRANS: "file" is exactly what user must type, do not translate. */
+                  _("file FILE"),
+                  _("Load saved game FILE"));
+      cmdhelp_add(help, "j", "json",
+                  _("Write the results as JSON instead of CSV"));
+      cmdhelp_add(help, "o",
+                  /* TRANS: "output" is exactly what user must type, do not translate. */
+                  _("output FILE"),
+                  _("Write the results to FILE instead of the standard "
+                    "output"));
+      cmdhelp_add(help, "r",
+                  /* TRANS: "repeat" is exactly what user must type, do not translate. */
+                  _("repeat NUM"),
+                  _("Build the maps of every unit NUM times"));
+      cmdhelp_add(help, "t",
+                  /* TRANS: "threads" is exactly what user must type, do not translate. */
+                  _("threads NUM"),
+                  _("Build the maps of all the units at once with NUM "
+                    "worker threads"));
+
+      /* The function below prints a header and footer for the options.
+       * Furthermore, the options are sorted. */
+      cmdhelp_display(help, TRUE, FALSE, TRUE);
+      cmdhelp_destroy(help);
+
+      cmdline_option_values_free();
+
+      exit(EXIT_SUCCESS);
+    } else if ((option = get_option_malloc("--debug", argv, &i, argc,
+                                           FALSE))) {
+      if (!log_parse_level_str(option, &loglevel)) {
+        fc_fprintf(stderr, _("Invalid debug level \"%s\".\n"), option);
+        exit(EXIT_FAILURE);
+      }
+      free(option);
+    } else if ((option = get_option_malloc("--file", argv, &i, argc,
+                                           TRUE))) {
+      savegame = option;
+    } else if ((option = get_option_malloc("--output", argv, &i, argc,
+                                           TRUE))) {
+      output = option;
+    } else if ((option = get_option_malloc("--repeat", argv, &i, argc,
+                                           FALSE))) {
+      if (!str_to_int(option, &repeat) || 1 > repeat) {
+        fc_fprintf(stderr, _("Invalid repeat count \"%s\".\n"), option);
+        exit(EXIT_FAILURE);
+      }
+      free(option);
+    } else if ((option = get_option_malloc("--threads", argv, &i, argc,
+                                           FALSE))) {
+      if (!str_to_int(option, &threads) || 0 > threads) {
+        fc_fprintf(stderr, _("Invalid number of threads \"%s\".\n"),
+                   option);
+        exit(EXIT_FAILURE);
+      }
+      free(option);
+    } else if (is_option("--json", argv[i])) {
+      json = TRUE;
+#ifndef FREECIV_NDEBUG
+    } else if (is_option("--Fatal", argv[i])) {
+      if (i + 1 >= argc || '-' == argv[i + 1][0]) {
+        fatal_assertions = SIGABRT;
+      } else if (str_to_int(argv[i + 1], &fatal_assertions)) {
+        i++;
+      } else {
+        fc_fprintf(stderr, _("Invalid signal number \"%s\".\n"),
+                   argv[i + 1]);
+        fc_fprintf(stderr, _("Try using --help.\n"));
+        exit(EXIT_FAILURE);
+      }
+#endif /* FREECIV_NDEBUG */
+    } else {
+      fc_fprintf(stderr, _("Unrecognized option: \"%s\"\n"), argv[i]);
+      cmdline_option_values_free();
+      exit(EXIT_FAILURE);
+    }
+
+    i++;
+  }
+
+  if (NULL == savegame) {
+    fc_fprintf(stderr, _("No savegame given, use --file.\n"));
+    cmdline_option_values_free();
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**********************************************************************//**
+  Danger callback of the benchmark: the unknown tiles and the tiles next
+  to units at war with the owner are considered as dangerous, except the
+  cities.
+**************************************************************************/
+static bool pfb_is_pos_dangerous(const struct tile *ptile,
+                                 enum known_type known,
+                                 const struct pf_parameter *param)
+{
+  if (TILE_UNKNOWN == known) {
+    return TRUE;
+  }
+  if (NULL != tile_city(ptile)) {
+    return FALSE;
+  }
+
+  adjc_iterate(param->map, ptile, ptile1) {
+    unit_list_iterate(ptile1->units, penemy) {
+      if (pplayers_at_war(unit_owner(penemy), param->owner)) {
+        return TRUE;
+      }
+    } unit_list_iterate_end;
+  } adjc_iterate_end;
+
+  return FALSE;
+}
+
+/**********************************************************************//**
+  Build and fully iterate one map, accounting its wall time in 'result'.
+**************************************************************************/
+static void pfb_run_map(const struct pf_parameter *param,
+                        struct pfbench_result *result, struct timer *timer)
+{
+  struct pf_map *pfm;
+
+  timer_clear(timer);
+  timer_start(timer);
+  pfm = pf_map_new(param);
+  while (pf_map_iterate(pfm)) {
+    /* Nothing. */
+  }
+  pf_map_destroy(pfm);
+  timer_stop(timer);
+
+  result->wall_time += timer_read_seconds(timer);
+}
+
+/**********************************************************************//**
+  Build and fully iterate the maps of all the parameters at once with
+  pf_map_batch_new(), accounting the wall time in 'result'.
+**************************************************************************/
+static void pfb_run_batch(const struct pf_parameter *params, int num,
+                          struct pfbench_result *result, struct timer *timer)
+{
+  struct pf_map **maps = fc_malloc(MAX(num, 1) * sizeof(*maps));
+  int i;
+
+  timer_clear(timer);
+  timer_start(timer);
+  pf_map_batch_new(params, num, -1, maps);
+  for (i = 0; i < num; i++) {
+    pf_map_destroy(maps[i]);
+  }
+  timer_stop(timer);
+
+  result->wall_time += timer_read_seconds(timer);
+  free(maps);
+}
+
+/**********************************************************************//**
+  Build the maps of every unit.
+**************************************************************************/
+static int pfb_run(struct pfbench_result *results)
+{
+  const struct civ_map *nmap = &(wld.map);
+  struct timer *timer = timer_new(TIMER_USER, TIMER_ACTIVE, "pfbench");
+  struct pf_parameter *batch[PFB_COUNT];
+  int batch_num[PFB_COUNT] = { 0, };
+  struct pf_stats stats;
+  int units = 0;
+  int i;
+
+  pf_stats_reset();
+
+  if (0 <= threads) {
+    int max = 0;
+
+    players_iterate(pplayer) {
+      max += unit_list_size(pplayer->units);
+    } players_iterate_end;
+    for (i = 0; i < PFB_COUNT; i++) {
+      batch[i] = fc_malloc(MAX(max, 1) * sizeof(*batch[i]));
+    }
+  }
+
+  players_iterate(pplayer) {
+    unit_list_iterate(pplayer->units, punit) {
+      struct pf_parameter param;
+
+      units++;
+
+      /* Normal map. */
+      pft_fill_unit_parameter(&param, nmap, punit);
+      param.get_moves_left_req = NULL;
+      if (0 <= threads) {
+        batch[PFB_NORMAL][batch_num[PFB_NORMAL]++] = param;
+      } else {
+        pfb_run_map(&param, results + PFB_NORMAL, timer);
+      }
+
+      /* Danger map. */
+      param.is_pos_dangerous = pfb_is_pos_dangerous;
+      if (0 <= threads) {
+        batch[PFB_DANGER][batch_num[PFB_DANGER]++] = param;
+      } else {
+        pfb_run_map(&param, results + PFB_DANGER, timer);
+      }
+
+      /* Fuel map. */
+      if (utype_fuel(unit_type_get(punit))) {
+        pft_fill_unit_parameter(&param, nmap, punit);
+        fc_assert(NULL != param.get_moves_left_req);
+        if (0 <= threads) {
+          batch[PFB_FUEL][batch_num[PFB_FUEL]++] = param;
+        } else {
+          pfb_run_map(&param, results + PFB_FUEL, timer);
+        }
+      }
+    } unit_list_iterate_end;
+  } players_iterate_end;
+
+  if (0 <= threads) {
+    pf_set_batch_threads(threads);
+    for (i = 0; i < PFB_COUNT; i++) {
+      pfb_run_batch(batch[i], batch_num[i], results + i, timer);
+      free(batch[i]);
+    }
+  }
+
+  timer_destroy(timer);
+
+  pf_stats_get(&stats);
+  results[PFB_NORMAL].maps += stats.normal.maps;
+  results[PFB_NORMAL].expanded += stats.normal.expanded;
+  results[PFB_NORMAL].peak_memory = MAX(results[PFB_NORMAL].peak_memory,
+                                        stats.normal.peak_memory);
+  results[PFB_DANGER].maps += stats.danger.maps;
+  results[PFB_DANGER].expanded += stats.danger.expanded;
+  results[PFB_DANGER].peak_memory = MAX(results[PFB_DANGER].peak_memory,
+                                        stats.danger.peak_memory);
+  results[PFB_FUEL].maps += stats.fuel.maps;
+  results[PFB_FUEL].expanded += stats.fuel.expanded;
+  results[PFB_FUEL].peak_memory = MAX(results[PFB_FUEL].peak_memory,
+                                      stats.fuel.peak_memory);
+
+  return units;
+}
+
+/**********************************************************************//**
+  Write the results as CSV, one line per map type.
+**************************************************************************/
+static void pfb_write_csv(FILE *out, const struct pfbench_result *results)
+{
+  int i;
+
+  fprintf(out, "version,ruleset,turn,map_type,maps,nodes_expanded,"
+          "wall_time_s,peak_memory_bytes\n");
+  for (i = 0; i < PFB_COUNT; i++) {
+    fprintf(out, "%s,%s,%d,%s,%u,%lu,%.6f,%lu\n",
+            freeciv_datafile_version(), game.control.name, game.info.turn,
+            pfbench_map_type_names[i], results[i].maps, results[i].expanded,
+            results[i].wall_time, (unsigned long) results[i].peak_memory);
+  }
+}
+
+/**********************************************************************//**
+  Write 'str' as a JSON string.
+**************************************************************************/
+static void pfb_write_json_string(FILE *out, const char *str)
+{
+  fputc('"', out);
+  for (; '\0' != *str; str++) {
+    if ('"' == *str || '\\' == *str) {
+      fputc('\\', out);
+      fputc(*str, out);
+    } else if ((unsigned char) *str < 0x20) {
+      fprintf(out, "\\u%04x", (unsigned char) *str);
+    } else {
+      fputc(*str, out);
+    }
+  }
+  fputc('"', out);
+}
+
+/**********************************************************************//**
+  Write the results as a JSON object.
+**************************************************************************/
+static void pfb_write_json(FILE *out, const struct pfbench_result *results,
+                           int units)
+{
+  int i;
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"version\": \"%s\",\n", freeciv_datafile_version());
+  fprintf(out, "  \"savegame\": ");
+  pfb_write_json_string(out, savegame);
+  fprintf(out, ",\n");
+  fprintf(out, "  \"ruleset\": ");
+  pfb_write_json_string(out, game.control.name);
+  fprintf(out, ",\n");
+  fprintf(out, "  \"turn\": %d,\n", game.info.turn);
+  fprintf(out, "  \"units\": %d,\n", units);
+  fprintf(out, "  \"repeat\": %d,\n", repeat);
+  fprintf(out, "  \"threads\": %d,\n", threads);
+  fprintf(out, "  \"maps\": {\n");
+  for (i = 0; i < PFB_COUNT; i++) {
+    fprintf(out, "    \"%s\": {\n", pfbench_map_type_names[i]);
+    fprintf(out, "      \"maps\": %u,\n", results[i].maps);
+    fprintf(out, "      \"nodes_expanded\": %lu,\n", results[i].expanded);
+    fprintf(out, "      \"wall_time_s\": %.6f,\n", results[i].wall_time);
+    fprintf(out, "      \"peak_memory_bytes\": %lu\n",
+            (unsigned long) results[i].peak_memory);
+    fprintf(out, "    }%s\n", PFB_COUNT - 1 > i ? "," : "");
+  }
+  fprintf(out, "  }\n");
+  fprintf(out, "}\n");
+}
+
+/**********************************************************************//**
+  Main entry point for freeciv-pfbench
+**************************************************************************/
+int main(int argc, char **argv)
+{
+  struct pfbench_result results[PFB_COUNT];
+  struct section_file *file;
+  FILE *out = stdout;
+  int exit_status = EXIT_SUCCESS;
+  int units = 0;
+  int i;
+
+  /* Same initialization as the server, without the network. */
+  srv_init();
+
+  pfb_parse_cmdline(argc, argv);
+
+  log_init(NULL, loglevel, NULL, NULL, fatal_assertions);
+
+  init_connections();
+  settings_init(TRUE);
+  stdinhand_init();
+  server_game_init(FALSE);
+
+  file = secfile_load(savegame, FALSE);
+  if (NULL == file) {
+    log_error(_("Could not load savefile: %s"), secfile_error());
+    exit_status = EXIT_FAILURE;
+  } else {
+    sz_strlcpy(srvarg.load_filename, savegame);
+    savegame_load(file);
+    secfile_destroy(file);
+
+    if (NULL != output) {
+      out = fc_fopen(output, "w");
+      if (NULL == out) {
+        log_error(_("Could not open %s for writing."), output);
+        exit_status = EXIT_FAILURE;
+      }
+    }
+  }
+
+  if (EXIT_SUCCESS == exit_status) {
+    memset(results, 0, sizeof(results));
+    for (i = 0; i < repeat; i++) {
+      units = pfb_run(results);
+    }
+
+    if (json) {
+      pfb_write_json(out, results, units);
+    } else {
+      pfb_write_csv(out, results);
+    }
+    if (stdout != out) {
+      fclose(out);
+    }
+  }
+
+  server_game_free();
+  stdinhand_free();
+  settings_free();
+  registry_module_close();
+  log_close();
+  cmdline_option_values_free();
+
+  return exit_status;
+}
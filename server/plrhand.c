@@ -30,6 +30,7 @@
 #include "citizens.h"
 #include "culture.h"
 #include "diptreaty.h"
+#include "effects.h"
 #include "government.h"
 #include "map.h"
 #include "movement.h"
@@ -43,6 +44,9 @@
 #include "tech.h"
 #include "unitlist.h"
 
+/* common/aicore */
+#include "path_finding.h"
+
 /* common/scriptcore */
 #include "luascript_types.h"
 
@@ -128,6 +132,7 @@ void kill_player(struct player *pplayer)
   struct player *barbarians = nullptr;
 
   pplayer->is_alive = FALSE;
+  effect_cache_invalidate();
 
   /* Reset player status */
   player_status_reset(pplayer);
@@ -193,6 +198,7 @@ void kill_player(struct player *pplayer)
       /* Out of sheer cruelty we reanimate the player
        * so they can behold what happens to their empire */
       pplayer->is_alive = TRUE;
+      effect_cache_invalidate();
       (void) civil_war(pplayer);
     } else {
       log_verbose("The empire of %s is too small for civil war.",
@@ -200,6 +206,7 @@ void kill_player(struct player *pplayer)
     }
   }
   pplayer->is_alive = FALSE;
+  effect_cache_invalidate();
 
   if (game.info.gameloss_style & GAMELOSS_STYLE_BARB) {
     /* If parameter, create a barbarian, if possible */
@@ -967,6 +974,8 @@ void handle_diplomacy_cancel_pact(struct player *pplayer,
   /* Do the change */
   ds_plrplr2->type = ds_plr2plr->type = new_type;
   ds_plrplr2->turns_left = ds_plr2plr->turns_left = 16;
+  pf_map_cache_invalidate();
+  effect_cache_invalidate();
 
   if (new_type == DS_WAR) {
     player_update_last_war_action(pplayer);
@@ -9490,6 +9490,10 @@ static bool load_rulesetdir(const char *rsdir, bool compat_mode,
     } unit_type_iterate_end;
     city_production_caravan_shields_init();
 
+    /* Compile the requirements evaluated the most often. */
+    ruleset_cache_compile();
+    action_enablers_compile();
+
     /* Build advisors unit class cache corresponding to loaded rulesets */
     adv_units_ruleset_init();
     CALL_FUNC_EACH_AI(units_ruleset_init);
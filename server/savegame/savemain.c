@@ -23,6 +23,7 @@
 /* common */
 #include "ai.h"
 #include "capability.h"
+#include "effects.h"
 #include "game.h"
 
 /* server */
@@ -71,6 +72,9 @@ void savegame_load(struct section_file *sfile)
     return;
   }
 
+  /* The game state was loaded behind the back of the caches. */
+  effect_cache_invalidate();
+
   players_iterate(pplayer) {
     unit_list_iterate(pplayer->units, punit) {
       CALL_FUNC_EACH_AI(unit_created, punit);
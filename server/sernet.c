@@ -65,6 +65,7 @@
 #include "log.h"
 #include "mem.h"
 #include "netintf.h"
+#include "netpoll.h"
 #include "shared.h"
 #include "support.h"
 #include "timing.h"
@@ -81,8 +82,10 @@
 /* server */
 #include "aiiface.h"
 #include "auth.h"
+#include "citytools.h"
 #include "connecthand.h"
 #include "console.h"
+#include "maphand.h"
 #include "meta.h"
 #include "plrhand.h"
 #include "srv_main.h"
@@ -97,6 +100,24 @@ static int *listen_socks;
 static int listen_count;
 static int socklan;
 
+/* netpoll handles of the connections, -1 when not registered */
+static int conn_poll_handle[MAX_NUM_CONNECTIONS];
+
+/* Connections with data in their send buffer. Only these have write
+ * interest registered, and only these are checked for lagging. */
+static struct connection *write_pending[MAX_NUM_CONNECTIONS];
+static int write_pending_pos[MAX_NUM_CONNECTIONS];
+static int num_write_pending = 0;
+
+/* Connections marked 'is_closing', to be closed by
+ * really_close_connections() */
+static struct connection *closing_conns[MAX_NUM_CONNECTIONS];
+static int num_closing_conns = 0;
+
+/* Readiness events handled per wake-up; level-triggered, so the rest
+ * are reported again by the next wait. */
+#define SNIFF_MAX_EVENTS 64
+
 #if defined(__VMS)
 #  if defined(_VAX_)
 #    define lib$stop LIB$STOP
@@ -123,11 +144,15 @@ static void start_processing_request(struct connection *pconn,
 static void finish_processing_request(struct connection *pconn);
 static void connection_ping(struct connection *pconn);
 static void send_ping_times_to_all(void);
+static void set_write_pending(struct connection *pconn, bool pending);
 
 static void get_lanserver_announcement(void);
 static void send_lanserver_response(void);
 
 static bool no_input = FALSE;
+#ifndef FREECIV_SOCKET_ZERO_NOT_STDIN
+static int stdin_poll_handle = -1;
+#endif
 
 /* Avoid compiler warning about defined, but unused function
  * by defining it only when needed */
@@ -144,6 +169,10 @@ static void handle_stdin_close(void)
 #ifndef FREECIV_SOCKET_ZERO_NOT_STDIN
   log_normal(_("Server cannot read standard input. Ignoring input."));
   no_input = TRUE;
+  if (stdin_poll_handle >= 0) {
+    netpoll_remove(stdin_poll_handle);
+    stdin_poll_handle = -1;
+  }
 #endif /* FREECIV_SOCKET_ZERO_NOT_STDIN */
 }
 
@@ -222,10 +251,21 @@ void readline_atexit(void)
 *****************************************************************************/
 static void close_connection(struct connection *pconn)
 {
+  int idx;
+
   if (!pconn) {
     return;
   }
 
+  idx = pconn - connections;
+  if (0 <= write_pending_pos[idx]) {
+    set_write_pending(pconn, FALSE);
+  }
+  if (0 <= conn_poll_handle[idx]) {
+    netpoll_remove(conn_poll_handle[idx]);
+    conn_poll_handle[idx] = -1;
+  }
+
   if (pconn->server.ping_timers != NULL) {
     timer_list_destroy(pconn->server.ping_timers);
     pconn->server.ping_timers = NULL;
@@ -234,6 +274,9 @@ static void close_connection(struct connection *pconn)
   conn_pattern_list_destroy(pconn->server.ignore_list);
   pconn->server.ignore_list = NULL;
 
+  map_stream_cancel(pconn);
+  cancel_coalesced_city_info(pconn);
+
   /* safe to do these even if not in lists: */
   conn_list_remove(game.web_client_connections, pconn);
   conn_list_remove(game.glob_observers, pconn);
@@ -271,6 +314,9 @@ void close_connections_and_socket(void)
   conn_list_destroy(game.all_connections);
   conn_list_destroy(game.est_connections);
 
+  num_closing_conns = 0;
+  netpoll_free();
+
   for (i = 0; i < listen_count; i++) {
     fc_closesocket(listen_socks[i]);
   }
@@ -310,8 +356,8 @@ static void really_close_connections(void)
   do {
     num = 0;
 
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      pconn = connections + i;
+    for (i = 0; i < num_closing_conns; i++) {
+      pconn = closing_conns[i];
       if (pconn->used && pconn->server.is_closing) {
         closing[num++] = pconn;
         /* Remove closing connections from the lists (hard detach)
@@ -325,6 +371,7 @@ static void really_close_connections(void)
         }
       }
     }
+    num_closing_conns = 0;
 
     for (i = 0; i < num; i++) {
       /* Now really close them. */
@@ -342,9 +389,53 @@ static void really_close_connections(void)
 static void server_conn_close_callback(struct connection *pconn)
 {
   /* Do as little as possible here to avoid recursive evil. */
+  if (!pconn->server.is_closing) {
+    closing_conns[num_closing_conns++] = pconn;
+  }
   pconn->server.is_closing = TRUE;
 }
 
+/*************************************************************************//**
+  Add the connection to, or remove it from, the connections with data
+  waiting to be written, and register write interest accordingly.
+*****************************************************************************/
+static void set_write_pending(struct connection *pconn, bool pending)
+{
+  int idx = pconn - connections;
+  int pos = write_pending_pos[idx];
+
+  if (pending == (0 <= pos)) {
+    return;
+  }
+
+  if (pending) {
+    write_pending_pos[idx] = num_write_pending;
+    write_pending[num_write_pending++] = pconn;
+  } else {
+    struct connection *plast = write_pending[--num_write_pending];
+
+    write_pending[pos] = plast;
+    write_pending_pos[plast - connections] = pos;
+    write_pending_pos[idx] = -1;
+  }
+
+  if (0 <= conn_poll_handle[idx]) {
+    netpoll_modify(conn_poll_handle[idx],
+                   NETPOLL_READ | NETPOLL_ERROR
+                   | (pending ? NETPOLL_WRITE : 0));
+  }
+}
+
+/*************************************************************************//**
+  Called by the connection code when the send buffer of the connection
+  becomes empty or non-empty.
+*****************************************************************************/
+static void server_conn_notify_writable(struct connection *pconn,
+                                        bool data_available)
+{
+  set_write_pending(pconn, data_available);
+}
+
 /*************************************************************************//**
   If a connection lags too much this function is called and we try to cut it.
 *****************************************************************************/
@@ -369,66 +460,71 @@ static void cut_lagging_connection(struct connection *pconn)
   }
 }
 
+/*************************************************************************//**
+  Whether the event is about the standard input of the server.
+*****************************************************************************/
+static inline bool is_stdin_event(const struct netpoll_event *pevent)
+{
+#ifndef FREECIV_SOCKET_ZERO_NOT_STDIN
+  return (NULL == pevent->data && 0 == pevent->fd
+          && 0 <= stdin_poll_handle);
+#else  /* FREECIV_SOCKET_ZERO_NOT_STDIN */
+  return FALSE;
+#endif /* FREECIV_SOCKET_ZERO_NOT_STDIN */
+}
+
 /*************************************************************************//**
   Attempt to flush all information in the send buffers for upto 'netwait'
   seconds.
 *****************************************************************************/
 void flush_packets(void)
 {
-  int i;
-  int max_desc;
-  fd_set writefs, exceptfs;
-  fc_timeval tv;
+  struct connection *pending[MAX_NUM_CONNECTIONS];
+  struct netpoll_event ready[MAX_NUM_CONNECTIONS];
+  int i, num;
   time_t start;
 
   (void) time(&start);
 
   for (;;) {
-    /* Can't assign to tv.tv_sec directly on systems where it's unsigned */
     signed signsecs = (game.server.netwait - (time(NULL) - start));
 
     if (signsecs < 0) {
       return;
     }
 
-    tv.tv_usec = 0;
-    tv.tv_sec = signsecs;
-
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
-    max_desc = -1;
-
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = &connections[i];
-
-      if (pconn->used
-          && !pconn->server.is_closing
-          && 0 < pconn->send_buffer->ndata) {
-        FD_SET(pconn->sock, &writefs);
-        FD_SET(pconn->sock, &exceptfs);
-        max_desc = MAX(pconn->sock, max_desc);
+    num = 0;
+    for (i = 0; i < num_write_pending; i++) {
+      struct connection *pconn = write_pending[i];
+
+      if (!pconn->server.is_closing) {
+        pending[num] = pconn;
+        ready[num].fd = pconn->sock;
+        ready[num].events = NETPOLL_WRITE | NETPOLL_ERROR;
+        ready[num].data = pconn;
+        num++;
       }
     }
 
-    if (max_desc == -1) {
+    if (num == 0) {
       return;
     }
 
-    if (fc_select(max_desc + 1, NULL, &writefs, &exceptfs, &tv) <= 0) {
+    if (netpoll_wait_fds(ready, num, signsecs * 1000) <= 0) {
       return;
     }
 
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {   /* check for freaky players */
-      struct connection *pconn = &connections[i];
+    for (i = 0; i < num; i++) {   /* check for freaky players */
+      struct connection *pconn = pending[i];
 
       if (pconn->used && !pconn->server.is_closing) {
-        if (FD_ISSET(pconn->sock, &exceptfs)) {
+        if (ready[i].events & NETPOLL_ERROR) {
           log_verbose("connection (%s) cut due to exception data",
                       conn_description(pconn));
           connection_close_server(pconn, _("network exception"));
         } else {
-          if (pconn->send_buffer && pconn->send_buffer->ndata > 0) {
-            if (FD_ISSET(pconn->sock, &writefs)) {
+          if (connection_send_queued(pconn) > 0) {
+            if (ready[i].events & NETPOLL_WRITE) {
               flush_connection_send_buffer_all(pconn);
             } else {
               cut_lagging_connection(pconn);
@@ -521,11 +617,10 @@ static void incoming_client_packets(struct connection *pconn)
 *****************************************************************************/
 enum server_events server_sniff_all_input(void)
 {
-  int i, s;
-  int max_desc;
-  bool excepting;
-  fd_set readfs, writefs, exceptfs;
-  fc_timeval tv;
+  int i;
+  bool excepting, stdin_ready, map_stream_ready;
+  struct netpoll_event events[SNIFF_MAX_EVENTS];
+  int nevents;
 #ifdef FREECIV_SOCKET_ZERO_NOT_STDIN
   char *bufptr;
 #endif
@@ -572,8 +667,6 @@ enum server_events server_sniff_all_input(void)
 #endif /* FREECIV_HAVE_LIBREADLINE */
 
   while (TRUE) {
-    int selret;
-
     con_prompt_on();   /* accepting new input */
 
     if (force_end_of_sniff) {
@@ -671,62 +764,56 @@ enum server_events server_sniff_all_input(void)
     }
 
     /* if we've waited long enough after a failure, respond to the client */
-    conn_list_iterate(game.all_connections, pconn) {
-      if (srvarg.auth_enabled
-          && !pconn->server.is_closing
-          && pconn->server.status != AS_ESTABLISHED) {
-        auth_process_status(pconn);
-      }
-    } conn_list_iterate_end
+    if (srvarg.auth_enabled) {
+      conn_list_iterate(game.all_connections, pconn) {
+        if (!pconn->server.is_closing
+            && pconn->server.status != AS_ESTABLISHED) {
+          auth_process_status(pconn);
+        }
+      } conn_list_iterate_end;
+    }
+
+    /* Send what was held back from clients which had too much to read,
+     * and more of the map to clients which joined a running game. */
+    send_coalesced_city_info();
+    map_stream_ready = map_streams_continue();
 
     /* Don't wait if timeout == -1 (i.e. on auto games) */
     if (S_S_RUNNING == server_state() && game.info.timeout == -1) {
+      while (map_stream_ready) {
+        map_stream_ready = map_streams_continue();
+      }
       call_ai_refresh();
       script_server_signal_emit("pulse");
       (void) send_server_info_to_metaserver(META_REFRESH);
       return S_E_END_OF_TURN_TIMEOUT;
     }
 
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
-
-    FC_FD_ZERO(&readfs);
-    FC_FD_ZERO(&writefs);
-    FC_FD_ZERO(&exceptfs);
+    stdin_ready = FALSE;
 
     if (!no_input) {
 #ifdef FREECIV_SOCKET_ZERO_NOT_STDIN
       fc_init_console();
 #else /* FREECIV_SOCKET_ZERO_NOT_STDIN */
 #   if !defined(__VMS)
-      FD_SET(0, &readfs);
+      if (stdin_poll_handle < 0) {
+        stdin_poll_handle = netpoll_add(0, NETPOLL_READ, NULL);
+      }
 #   endif /* VMS */
 #endif /* FREECIV_SOCKET_ZERO_NOT_STDIN */
     }
 
-    max_desc = 0;
-    for (i = 0; i < listen_count; i++) {
-      FD_SET(listen_socks[i], &readfs);
-      FD_SET(listen_socks[i], &exceptfs);
-      max_desc = MAX(max_desc, listen_socks[i]);
-    }
-
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-      struct connection *pconn = connections + i;
-
-      if (pconn->used && !pconn->server.is_closing) {
-        FD_SET(pconn->sock, &readfs);
-        if (0 < pconn->send_buffer->ndata) {
-          FD_SET(pconn->sock, &writefs);
-        }
-        FD_SET(pconn->sock, &exceptfs);
-        max_desc = MAX(pconn->sock, max_desc);
-      }
-    }
+    /* The listening sockets and the connections are registered to the
+     * poller as they are opened; connections have write interest only
+     * while their send buffer is not empty. */
     con_prompt_off();    /* output doesn't generate a new prompt */
 
-    selret = fc_select(max_desc + 1, &readfs, &writefs, &exceptfs, &tv);
-    if (selret == 0) {
+    nevents = netpoll_wait(events, ARRAY_SIZE(events),
+                           map_stream_ready ? 0 : 1000);
+    if (nevents == 0 && map_stream_ready) {
+      /* Nothing happened meanwhile; go on with the map streams. */
+      continue;
+    } else if (nevents == 0) {
       /* timeout */
       call_ai_refresh();
       script_server_signal_emit("pulse");
@@ -771,7 +858,7 @@ enum server_events server_sniff_all_input(void)
             lib$stop(status);
           }
           if (ttchar.numchars) {
-            FD_SET(0, &readfs);
+            stdin_ready = TRUE;
           } else {
             continue;
           }
@@ -783,25 +870,33 @@ enum server_events server_sniff_all_input(void)
 #endif /* FREECIV_SOCKET_ZERO_NOT_STDIN */
 #endif /* !__VMS */
       }
-    } else if (selret < 0) {
-      log_error("fc_select() failed: %s", fc_strerror(fc_get_errno()));
+    } else if (nevents < 0) {
+      log_error("netpoll_wait() failed: %s", fc_strerror(fc_get_errno()));
+      nevents = 0;
     }
 
+    /* Events with no connection are from stdin or the listening
+     * sockets. */
     excepting = FALSE;
-    for (i = 0; i < listen_count; i++) {
-      if (FD_ISSET(listen_socks[i], &exceptfs)) {
+    for (i = 0; i < nevents; i++) {
+      if (NULL != events[i].data) {
+        continue;
+      }
+      if (is_stdin_event(events + i)) {
+        stdin_ready = (0 != (events[i].events & NETPOLL_READ));
+      } else if (events[i].events & NETPOLL_ERROR) {
         excepting = TRUE;
-        break;
       }
     }
     if (excepting) {                  /* handle Ctrl-Z suspend/resume */
       continue;
     }
-    for (i = 0; i < listen_count; i++) {
-      s = listen_socks[i];
-      if (FD_ISSET(s, &readfs)) {     /* new players connects */
+    for (i = 0; i < nevents; i++) {
+      if (NULL == events[i].data
+          && !is_stdin_event(events + i)
+          && (events[i].events & NETPOLL_READ)) { /* new players connects */
         log_verbose("got new connection");
-        if (-1 == server_accept_connection(s)) {
+        if (-1 == server_accept_connection(events[i].fd)) {
           /* There will be a log_error() message from
            * server_accept_connection() if something
            * goes wrong, so no need to make another
@@ -810,13 +905,14 @@ enum server_events server_sniff_all_input(void)
         }
       }
     }
-    for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
+    for (i = 0; i < nevents; i++) {
       /* check for freaky players */
-      struct connection *pconn = &connections[i];
+      struct connection *pconn = events[i].data;
 
-      if (pconn->used
+      if (NULL != pconn
+          && pconn->used
           && !pconn->server.is_closing
-          && FD_ISSET(pconn->sock, &exceptfs)) {
+          && (events[i].events & NETPOLL_ERROR)) {
         log_verbose("connection (%s) cut due to exception data",
                     conn_description(pconn));
         connection_close_server(pconn, _("network exception"));
@@ -831,7 +927,7 @@ enum server_events server_sniff_all_input(void)
       current_internal = NULL;
     }
 #else  /* !FREECIV_SOCKET_ZERO_NOT_STDIN */
-    if (!no_input && FD_ISSET(0, &readfs)) {    /* input from server operator */
+    if (!no_input && stdin_ready) {    /* input from server operator */
 #ifdef FREECIV_HAVE_LIBREADLINE
       rl_callback_read_char();
       if (readline_handled_input) {
@@ -880,13 +976,17 @@ enum server_events server_sniff_all_input(void)
 #endif /* !FREECIV_SOCKET_ZERO_NOT_STDIN */
 
     {                             /* Input from a player */
-      for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = connections + i;
+      struct connection *pending[MAX_NUM_CONNECTIONS];
+      int num_pending;
+
+      for (i = 0; i < nevents; i++) {
+        struct connection *pconn = events[i].data;
         int nb;
 
-        if (!pconn->used
+        if (NULL == pconn
+            || !pconn->used
             || pconn->server.is_closing
-            || !FD_ISSET(pconn->sock, &readfs)) {
+            || !(events[i].events & NETPOLL_READ)) {
           continue;
         }
 
@@ -902,18 +1002,27 @@ enum server_events server_sniff_all_input(void)
         }
       }
 
-      for (i = 0; i < MAX_NUM_CONNECTIONS; i++) {
-        struct connection *pconn = &connections[i];
+      /* Only connections that had data waiting have write interest. */
+      for (i = 0; i < nevents; i++) {
+        struct connection *pconn = events[i].data;
 
-        if (pconn->used
+        if (NULL != pconn
+            && pconn->used
             && !pconn->server.is_closing
-            && pconn->send_buffer
-            && pconn->send_buffer->ndata > 0) {
-          if (FD_ISSET(pconn->sock, &writefs)) {
-            flush_connection_send_buffer_all(pconn);
-          } else {
-            cut_lagging_connection(pconn);
-          }
+            && (events[i].events & NETPOLL_WRITE)) {
+          flush_connection_send_buffer_all(pconn);
+        }
+      }
+
+      /* What could not be written yet may be a lagging client. Cutting
+       * it may send to others, so work on a copy of the list. */
+      num_pending = num_write_pending;
+      memcpy(pending, write_pending, num_pending * sizeof(*pending));
+      for (i = 0; i < num_pending; i++) {
+        if (pending[i]->used
+            && !pending[i]->server.is_closing
+            && connection_send_queued(pending[i]) > 0) {
+          cut_lagging_connection(pending[i]);
         }
       }
       really_close_connections();
@@ -1080,13 +1189,22 @@ int server_make_connection(int new_sock, const char *client_addr,
     struct connection *pconn = &connections[i];
 
     if (!pconn->used) {
+      conn_poll_handle[i] = netpoll_add(new_sock,
+                                        NETPOLL_READ | NETPOLL_ERROR, pconn);
+      if (0 > conn_poll_handle[i]) {
+        log_error("can't watch the new connection");
+        fc_closesocket(new_sock);
+
+        return -1;
+      }
+
       connection_common_init(pconn);
       pconn->sock = new_sock;
       pconn->observer = FALSE;
       pconn->playing = NULL;
       pconn->capability[0] = '\0';
       pconn->access_level = access_level_for_next_connection();
-      pconn->notify_of_writable_data = NULL;
+      pconn->notify_of_writable_data = server_conn_notify_writable;
       pconn->server.currently_processed_request_id = 0;
       pconn->server.last_request_id_seen = 0;
       pconn->server.auth_tries = 0;
@@ -1097,6 +1215,8 @@ int server_make_connection(int new_sock, const char *client_addr,
       pconn->server.ignore_list =
           conn_pattern_list_new_full(conn_pattern_destroy);
       pconn->server.is_closing = FALSE;
+      pconn->server.map_stream = NULL;
+      pconn->server.coalesced_cities = NULL;
       pconn->ping_time = -1.0;
       pconn->incoming_packet_notify = NULL;
       pconn->outgoing_packet_notify = NULL;
@@ -1264,6 +1384,17 @@ int server_open_socket(void)
 
   fc_sockaddr_list_destroy(list);
 
+  netpoll_init();
+  log_verbose("Server polling the network with %s",
+              netpoll_backend_name());
+  for (j = 0; j < listen_count; j++) {
+    if (0 > netpoll_add(listen_socks[j], NETPOLL_READ | NETPOLL_ERROR,
+                        NULL)) {
+      log_fatal("Can't watch the listening socket.");
+      exit(EXIT_FAILURE);
+    }
+  }
+
   connections_set_close_callback(server_conn_close_callback);
 
   if (srvarg.announce == ANNOUNCE_NONE) {
@@ -1374,6 +1505,8 @@ void init_connections(void)
     pconn->used = FALSE;
     pconn->self = conn_list_new();
     conn_list_prepend(pconn->self, pconn);
+    conn_poll_handle[i] = -1;
+    write_pending_pos[i] = -1;
   }
 #if defined(__VMS)
   {
@@ -1492,8 +1625,7 @@ static void send_ping_times_to_all(void)
 *****************************************************************************/
 static void get_lanserver_announcement(void)
 {
-  fd_set readfs, exceptfs;
-  fc_timeval tv;
+  struct netpoll_event ready;
   char msgbuf[128];
   struct data_in din;
   int type;
@@ -1502,25 +1634,21 @@ static void get_lanserver_announcement(void)
     return;
   }
 
-  FD_ZERO(&readfs);
-  FD_ZERO(&exceptfs);
-  FD_SET(socklan, &exceptfs);
-  FD_SET(socklan, &readfs);
-
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
+  ready.fd = socklan;
+  ready.events = NETPOLL_READ | NETPOLL_ERROR;
 
-  while (fc_select(socklan + 1, &readfs, NULL, &exceptfs, &tv) == -1) {
+  while (netpoll_wait_fds(&ready, 1, 0) == -1) {
     if (errno != EINTR) {
-      log_error("select failed: %s", fc_strerror(fc_get_errno()));
+      log_error("poll failed: %s", fc_strerror(fc_get_errno()));
       return;
     }
     /* EINTR can happen sometimes, especially when compiling with -pg.
-     * Generally we just want to run select again. */
+     * Generally we just want to run poll again. */
+    ready.events = NETPOLL_READ | NETPOLL_ERROR;
   }
 
   /* We would need a raw network connection for broadcast messages */
-  if (FD_ISSET(socklan, &readfs)) {
+  if (ready.events & NETPOLL_READ) {
     if (0 < recvfrom(socklan, msgbuf, sizeof(msgbuf), 0, NULL, NULL)) {
       dio_input_init(&din, msgbuf, 1);
       dio_get_uint8_raw(&din, &type);
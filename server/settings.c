@@ -3007,6 +3007,15 @@ static struct setting settings[] = {
           NULL, NULL, NULL,
           GAME_MIN_TCPTIMEOUT, GAME_MAX_TCPTIMEOUT, GAME_DEFAULT_TCPTIMEOUT)
 
+  GEN_INT("sendqueue", game.server.sendqueue,
+          SSET_META, SSET_NETWORK, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
+          N_("Max kilobytes waiting to be sent to a client"),
+          N_("If more data than this is waiting to be sent to a client, "
+             "its connection is closed. Before that, when a quarter of "
+             "it is used, observers are sent city updates only once "
+             "the queue has drained."), NULL, NULL, NULL,
+          GAME_MIN_SENDQUEUE, GAME_MAX_SENDQUEUE, GAME_DEFAULT_SENDQUEUE)
+
   GEN_INT("netwait", game.server.netwait,
           SSET_META, SSET_NETWORK, SSET_RARE, ALLOW_NONE, ALLOW_BASIC,
           N_("Max seconds for network buffers to drain"),
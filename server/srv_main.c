@@ -64,6 +64,8 @@
 
 /* common/aicore */
 #include "citymap.h"
+#include "cm.h"
+#include "path_finding.h"
 
 /* common */
 #include "achievements.h"
@@ -82,6 +84,7 @@
 #include "nation.h"
 #include "packets.h"
 #include "player.h"
+#include "requirements.h"
 #include "research.h"
 #include "tech.h"
 #include "unitlist.h"
@@ -705,7 +708,7 @@ void send_all_info(struct conn_list *dest)
     send_research_info(presearch, dest);
   } researches_iterate_end;
   send_map_info(dest);
-  send_all_known_tiles(dest);
+  map_stream_start(dest);
   send_all_known_cities(dest);
   send_all_known_units(dest);
   send_spaceship_info(NULL, dest);
@@ -935,6 +938,7 @@ static void update_diplomatics(void)
           if (state->turns_left <= 0) {
             state->type = DS_PEACE;
             state2->type = DS_PEACE;
+            effect_cache_invalidate();
             state->turns_left = 0;
             state2->turns_left = 0;
             remove_illegal_armistice_units(plr1, plr2);
@@ -968,6 +972,7 @@ static void update_diplomatics(void)
                           nation_plural_for_player(plr1));
             state->type = DS_WAR;
             state2->type = DS_WAR;
+            effect_cache_invalidate();
             state->turns_left = 0;
             state2->turns_left = 0;
 
@@ -1225,6 +1230,9 @@ static void begin_phase(bool is_new_phase)
 {
   log_debug("Begin phase");
 
+  pf_map_cache_invalidate();
+  effect_cache_invalidate();
+
   conn_list_do_buffer(game.est_connections);
 
   phase_players_iterate(pplayer) {
@@ -1401,8 +1409,15 @@ static void begin_phase(bool is_new_phase)
 **************************************************************************/
 static void end_phase(void)
 {
+  struct pf_stats pfstats;
+
   log_debug("Endphase");
 
+  pf_stats_get(&pfstats);
+  log_verbose("Path-finding map cache: %u hits, %u misses.",
+              pfstats.cache_hits, pfstats.cache_misses);
+  pf_map_cache_invalidate();
+
   /*
    * This empties the client Messages window; put this before
    * everything else below, since otherwise any messages from the
@@ -1567,8 +1582,24 @@ static void end_phase(void)
 **************************************************************************/
 static void end_turn(void)
 {
+  enum cm_caller caller;
+
   log_debug("Endturn");
 
+  for (caller = 0; caller < CM_CALLER_COUNT; caller++) {
+    struct cm_stats cmstats;
+
+    cm_stats_get(caller, TRUE, &cmstats);
+    if (0 < cmstats.queries || 0 < cmstats.searches) {
+      log_verbose("CM %s: %lu queries, %lu cache hits, %lu searches "
+                  "(%lu aborted), %lu nodes, %lu applies, %.3fs this turn.",
+                  cm_caller_name(caller), cmstats.queries, cmstats.hits,
+                  cmstats.searches, cmstats.aborted, cmstats.nodes,
+                  cmstats.applies, cmstats.seconds);
+    }
+  }
+  cm_stats_turn_reset();
+
   /* Hack: because observer players never get an end-phase packet we send
    * one here. */
   conn_list_iterate(game.est_connections, pconn) {
@@ -1776,6 +1807,7 @@ static void end_turn(void)
   players_iterate_alive(pplayer) {
     pplayer->turns_alive++;
   } players_iterate_alive_end;
+  effect_cache_invalidate();
 
   log_debug("Updatetimeout");
   update_timeout();
@@ -3011,6 +3043,10 @@ static void srv_running(void)
     }
   }
 
+  if (req_profile_enabled()) {
+    req_profile_log(30);
+  }
+
   /* This will thaw the reports and agents at the client.  */
   lsend_packet_thaw_client(game.est_connections);
 
@@ -3486,6 +3522,13 @@ void server_game_free(void)
   /* Free all the treaties that were left open when game finished. */
   free_treaties();
 
+  /* The map streams and held back city info refer to the game about
+   * to be freed. */
+  conn_list_iterate(game.all_connections, pconn) {
+    map_stream_cancel(pconn);
+    cancel_coalesced_city_info(pconn);
+  } conn_list_iterate_end;
+
   /* Free the vision data, without sending updates. */
   players_iterate(pplayer) {
     unit_list_iterate(pplayer->units, punit) {
@@ -43,6 +43,7 @@
 
 /* common */
 #include "capability.h"
+#include "effects.h"
 #include "events.h"
 #include "fc_types.h" /* LINE_BREAK */
 #include "featured_text.h"
@@ -52,12 +53,16 @@
 #include "modpack.h"
 #include "packets.h"
 #include "player.h"
+#include "requirements.h"
 #include "research.h"
 #include "rgbcolor.h"
 #include "srvdefs.h"
 #include "unitlist.h"
 #include "version.h"
 
+/* common/aicore */
+#include "cm.h"
+
 /* server */
 #include "aiiface.h"
 #include "citytools.h"
@@ -665,6 +670,137 @@ static bool show_serverid(struct connection *caller, char *arg)
   return TRUE;
 }
 
+/**********************************************************************//**
+  Show one line of the city governor statistics.
+**************************************************************************/
+static void show_cmstats_line(struct connection *caller, const char *name,
+                              const struct cm_stats *pstats)
+{
+  struct city *pcity = game_city_by_number(pstats->slowest_city);
+
+  cmd_reply(CMD_CMSTATS, caller, C_COMMENT,
+            "%-14s %8lu %6lu %8lu %7lu %10lu %4lu/%-4d %9.1f %7.2f %s",
+            name, pstats->queries, pstats->hits, pstats->searches,
+            pstats->aborted, pstats->nodes,
+            0 < pstats->searches ? pstats->lattice / pstats->searches : 0,
+            pstats->lattice_max, 1000.0 * pstats->seconds,
+            1000.0 * pstats->slowest_seconds,
+            NULL != pcity ? city_name_get(pcity) : "-");
+}
+
+/**********************************************************************//**
+  Handle cmstats command: show or reset the city governor statistics.
+**************************************************************************/
+static bool cmstats_command(struct connection *caller, char *arg, bool check)
+{
+  enum cm_caller cmcaller;
+
+  remove_leading_trailing_spaces(arg);
+  if ('\0' != arg[0] && 0 != fc_strcasecmp(arg, "reset")) {
+    cmd_reply(CMD_CMSTATS, caller, C_SYNTAX, _("Usage:\n%s"),
+              command_synopsis(command_by_number(CMD_CMSTATS)));
+    return FALSE;
+  }
+  if (check) {
+    return TRUE;
+  }
+
+  if ('\0' != arg[0]) {
+    cm_stats_reset();
+    cmd_reply(CMD_CMSTATS, caller, C_OK,
+              _("City governor statistics reset."));
+    return TRUE;
+  }
+
+  cmd_reply(CMD_CMSTATS, caller, C_COMMENT,
+            _("City governor statistics (times in ms):"));
+  cmd_reply(CMD_CMSTATS, caller, C_COMMENT,
+            "%-14s %8s %6s %8s %7s %10s %9s %9s %7s %s",
+            "", "queries", "hits", "searches", "aborted", "nodes",
+            "lattice", "time", "slowest", "city");
+  cmd_reply(CMD_CMSTATS, caller, C_COMMENT, horiz_line);
+  for (cmcaller = 0; cmcaller < CM_CALLER_COUNT; cmcaller++) {
+    struct cm_stats turn, game_stats;
+    char name[64];
+
+    cm_stats_get(cmcaller, TRUE, &turn);
+    cm_stats_get(cmcaller, FALSE, &game_stats);
+    if (0 == game_stats.queries && 0 == game_stats.searches) {
+      continue;
+    }
+    fc_snprintf(name, sizeof(name), "%s/turn", cm_caller_name(cmcaller));
+    show_cmstats_line(caller, name, &turn);
+    fc_snprintf(name, sizeof(name), "%s/game", cm_caller_name(cmcaller));
+    show_cmstats_line(caller, name, &game_stats);
+  }
+  cmd_reply(CMD_CMSTATS, caller, C_COMMENT, horiz_line);
+
+  return TRUE;
+}
+
+/**********************************************************************//**
+  Handle reqstats command: profile the requirement and effect
+  evaluations, or show the profile.
+**************************************************************************/
+static bool reqstats_command(struct connection *caller, char *arg,
+                             bool check)
+{
+  struct req_profile_row rows[40];
+  int num, i;
+
+  remove_leading_trailing_spaces(arg);
+  if ('\0' != arg[0] && 0 != fc_strcasecmp(arg, "on")
+      && 0 != fc_strcasecmp(arg, "off")
+      && 0 != fc_strcasecmp(arg, "reset")) {
+    cmd_reply(CMD_REQSTATS, caller, C_SYNTAX, _("Usage:\n%s"),
+              command_synopsis(command_by_number(CMD_REQSTATS)));
+    return FALSE;
+  }
+  if (check) {
+    return TRUE;
+  }
+
+  if (0 == fc_strcasecmp(arg, "on")) {
+    req_profile_enable(TRUE);
+    cmd_reply(CMD_REQSTATS, caller, C_OK,
+              _("Requirement evaluation profiling started."));
+    return TRUE;
+  } else if (0 == fc_strcasecmp(arg, "off")) {
+    req_profile_enable(FALSE);
+    cmd_reply(CMD_REQSTATS, caller, C_OK,
+              _("Requirement evaluation profiling stopped."));
+    return TRUE;
+  } else if (0 == fc_strcasecmp(arg, "reset")) {
+    req_profile_reset();
+    cmd_reply(CMD_REQSTATS, caller, C_OK,
+              _("Requirement evaluation profile reset."));
+    return TRUE;
+  }
+
+  if (!req_profile_enabled()) {
+    cmd_reply(CMD_REQSTATS, caller, C_COMMENT,
+              _("Requirement evaluation profiling is off."));
+  }
+  num = req_profile_report(rows, ARRAY_SIZE(rows));
+  cmd_reply(CMD_REQSTATS, caller, C_COMMENT,
+            _("Most expensive evaluations (times in ms):"));
+  cmd_reply(CMD_REQSTATS, caller, C_COMMENT, "%-8s %-7s %-28s %12s %10s",
+            "caller", "kind", "name", "count", "time");
+  cmd_reply(CMD_REQSTATS, caller, C_COMMENT, horiz_line);
+  for (i = 0; i < num; i++) {
+    cmd_reply(CMD_REQSTATS, caller, C_COMMENT,
+              "%-8s %-7s %-28s %12lu %10.1f",
+              req_profile_caller_name(rows[i].caller),
+              rows[i].effect ? "effect" : "req",
+              rows[i].effect ? effect_type_name(rows[i].index)
+                             : universals_n_name(rows[i].index),
+              rows[i].count, 1000.0 * rows[i].seconds);
+  }
+  cmd_reply(CMD_REQSTATS, caller, C_COMMENT, horiz_line);
+
+  return TRUE;
+}
+
 /**********************************************************************//**
   For command "save foo";
   Save the game, with filename=arg, provided server state is ok.
@@ -4714,6 +4850,10 @@ static bool handle_stdin_input_real(struct connection *caller, char *str,
     return fcdb_command(caller, arg, check);
   case CMD_MAPIMG:
     return mapimg_command(caller, arg, check);
+  case CMD_CMSTATS:
+    return cmstats_command(caller, arg, check);
+  case CMD_REQSTATS:
+    return reqstats_command(caller, arg, check);
   case CMD_LOCK:
     return lock_command(caller, arg, check);
   case CMD_UNLOCK:
@@ -6829,9 +6969,13 @@ void show_players(struct connection *caller)
       conn_list_iterate(pplayer->connections, pconn) {
         fc_snprintf(buf, sizeof(buf),
                     _("%s from %s (command access level %s), "
-                      "bufsize=%dkb"), pconn->username, pconn->addr,
+                      "bufsize=%dkb, queued=%dkb (peak %dkb), "
+                      "coalesced=%d"), pconn->username, pconn->addr,
                     cmdlevel_name(pconn->access_level),
-                    (pconn->send_buffer->nsize >> 10));
+                    (pconn->send_buffer->nsize >> 10),
+                    (connection_send_queued(pconn) >> 10),
+                    (pconn->statistics.send_queue_peak >> 10),
+                    pconn->statistics.coalesced);
         if (pconn->observer) {
           /* TRANS: preserve leading space */
           sz_strlcat(buf, _(" (observer mode)"));
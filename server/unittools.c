@@ -1744,6 +1744,8 @@ bool place_unit(struct unit *punit, struct player *pplayer,
   ptile = punit->tile;
   fc_assert_ret_val(ptile, FALSE);
 
+  pf_map_cache_invalidate();
+
   /* Register unit */
   punit->id = identity_number();
   idex_register_unit(&wld, punit);
@@ -1827,6 +1829,7 @@ static void server_remove_unit_full(struct unit *punit, bool transported,
 
   /* The unit is doomed. */
   punit->server.dying = TRUE;
+  pf_map_cache_invalidate();
 
 #if defined(FREECIV_DEBUG) && !defined(FREECIV_NDEBUG)
   unit_list_iterate(ptile->units, pcargo) {
@@ -4145,6 +4148,9 @@ bool unit_move(struct unit *punit, struct tile *pdesttile, int move_cost,
 
   plist = construct_move_data_list(punit, psrctile, pdesttile, adj);
 
+  /* The shared path-finding maps are outdated. */
+  pf_map_cache_invalidate();
+
   /* Move magic. */
   punit->moved = TRUE;
   punit->moves_left = MAX(0, punit->moves_left - move_cost);
@@ -0,0 +1,423 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* Micro-benchmark comparing the binary heap of specpq.h with the bucket
+ * queue of specbq.h on path-finding like workloads.
+ *
+ * A grid of random move costs is generated from a fixed seed. A search
+ * using the same cost rules and priorities as the pf_normal maps is run
+ * from several start positions, once with each queue: the heap uses
+ * replace to improve the priorities, the bucket queue uses lazy
+ * deletion, like the path-finding code does. The insert and remove
+ * operations made on the bucket queue are recorded, then replayed alone
+ * on both queues to compare the raw cost of the structures. */
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* utility */
+#include "fciconv.h"
+#include "log.h"
+#include "mem.h"
+#include "rand.h"
+#include "shared.h"
+#include "support.h"
+#include "timing.h"
+
+#define SPECPQ_TAG bench
+#define SPECPQ_DATA_TYPE int
+#define SPECPQ_PRIORITY_TYPE int
+#include "specpq.h"
+
+#define SPECBQ_TAG bench
+#define SPECBQ_DATA_TYPE int
+#include "specbq.h"
+
+/* Same scale as in the path-finding code. */
+#define BENCH_TURN_FACTOR 65536
+#define BENCH_MOVE_RATE 9
+#define BENCH_INITIAL_QUEUE_SIZE 100
+
+struct bench_grid {
+  int xsize, ysize;
+  int *move_cost;               /* -1 if impassable. */
+  int *extra;
+};
+
+struct bench_op {
+  int priority;                 /* Only for insertions. */
+  bool insert;
+};
+
+struct bench_trace {
+  int num, max;
+  struct bench_op *ops;
+};
+
+/**********************************************************************//**
+  Generate a grid with random move costs.
+**************************************************************************/
+static void bench_grid_init(struct bench_grid *grid, int xsize, int ysize)
+{
+  int i;
+
+  grid->xsize = xsize;
+  grid->ysize = ysize;
+  grid->move_cost = fc_malloc(sizeof(*grid->move_cost) * xsize * ysize);
+  grid->extra = fc_malloc(sizeof(*grid->extra) * xsize * ysize);
+
+  for (i = 0; i < xsize * ysize; i++) {
+    int r = fc_rand(16);
+
+    if (r < 2) {
+      grid->move_cost[i] = -1;
+    } else if (r < 9) {
+      /* Roads, rivers. */
+      grid->move_cost[i] = 1;
+    } else if (r < 14) {
+      grid->move_cost[i] = 3;
+    } else {
+      grid->move_cost[i] = 6;
+    }
+    grid->extra[i] = (fc_rand(4) == 0 ? fc_rand(8) : 0);
+  }
+}
+
+/**********************************************************************//**
+  Free the grid.
+**************************************************************************/
+static void bench_grid_free(struct bench_grid *grid)
+{
+  free(grid->move_cost);
+  free(grid->extra);
+}
+
+/**********************************************************************//**
+  Record an operation in the trace.
+**************************************************************************/
+static void bench_trace_add(struct bench_trace *trace, bool insert,
+                            int priority)
+{
+  if (trace->num >= trace->max) {
+    trace->max = MAX(2 * trace->max, 1024);
+    trace->ops = fc_realloc(trace->ops, sizeof(*trace->ops) * trace->max);
+  }
+  trace->ops[trace->num].insert = insert;
+  trace->ops[trace->num].priority = priority;
+  trace->num++;
+}
+
+/**********************************************************************//**
+  Cost of moving to 'tindex' with 'cost' spent already, like
+  pf_normal_map_adjust_cost().
+**************************************************************************/
+static inline int bench_step_cost(const struct bench_grid *grid, int tindex,
+                                  int cost)
+{
+  int moves_left = BENCH_MOVE_RATE - cost % BENCH_MOVE_RATE;
+
+  return cost + MIN(grid->move_cost[tindex], moves_left);
+}
+
+/**********************************************************************//**
+  Priority of a node like pf_total_CC().
+**************************************************************************/
+static inline int bench_total_CC(int cost, int extra)
+{
+  return BENCH_TURN_FACTOR * cost + extra;
+}
+
+#define bench_adjc_iterate(_grid, _index, _index1)                          \
+{                                                                           \
+  int _x = (_index) % (_grid)->xsize, _y = (_index) / (_grid)->xsize;       \
+  int _dx, _dy;                                                             \
+                                                                            \
+  for (_dy = -1; _dy <= 1; _dy++) {                                         \
+    for (_dx = -1; _dx <= 1; _dx++) {                                       \
+      int _index1;                                                          \
+                                                                            \
+      if ((0 == _dx && 0 == _dy)                                            \
+          || 0 > _x + _dx || (_grid)->xsize <= _x + _dx                     \
+          || 0 > _y + _dy || (_grid)->ysize <= _y + _dy) {                  \
+        continue;                                                           \
+      }                                                                     \
+      _index1 = (_y + _dy) * (_grid)->xsize + _x + _dx;                     \
+      if (0 > (_grid)->move_cost[_index1]) {                                \
+        continue;                                                           \
+      }
+
+#define bench_adjc_iterate_end                                              \
+    }                                                                       \
+  }                                                                         \
+}
+
+/**********************************************************************//**
+  Search from 'start' using the binary heap. Returns the sum of the
+  priorities of all the reached nodes.
+**************************************************************************/
+static long long bench_search_pq(const struct bench_grid *grid, int start,
+                                 int *cost, int *extra, char *status)
+{
+  struct bench_pq *pq = bench_pq_new(BENCH_INITIAL_QUEUE_SIZE);
+  long long sum = 0;
+  int tindex = start;
+
+  memset(status, 0, grid->xsize * grid->ysize);
+  cost[tindex] = 0;
+  extra[tindex] = 0;
+  status[tindex] = 2;
+
+  do {
+    sum += bench_total_CC(cost[tindex], extra[tindex]);
+
+    bench_adjc_iterate(grid, tindex, tindex1) {
+      int cost1, extra1;
+
+      if (2 == status[tindex1]) {
+        continue;
+      }
+      cost1 = bench_step_cost(grid, tindex1, cost[tindex]);
+      extra1 = extra[tindex] + grid->extra[tindex1];
+      if (0 == status[tindex1]) {
+        status[tindex1] = 1;
+        cost[tindex1] = cost1;
+        extra[tindex1] = extra1;
+        bench_pq_insert(pq, tindex1, -bench_total_CC(cost1, extra1));
+      } else if (bench_total_CC(cost1, extra1)
+                 < bench_total_CC(cost[tindex1], extra[tindex1])) {
+        cost[tindex1] = cost1;
+        extra[tindex1] = extra1;
+        bench_pq_replace(pq, tindex1, -bench_total_CC(cost1, extra1));
+      }
+    } bench_adjc_iterate_end;
+
+    if (!bench_pq_remove(pq, &tindex)) {
+      break;
+    }
+    status[tindex] = 2;
+  } while (TRUE);
+
+  bench_pq_destroy(pq);
+
+  return sum;
+}
+
+/**********************************************************************//**
+  Search from 'start' using the bucket queue, recording the queue
+  operations in 'trace'. Returns the sum of the priorities of all the
+  reached nodes.
+**************************************************************************/
+static long long bench_search_bq(const struct bench_grid *grid, int start,
+                                 int *cost, int *extra, char *status,
+                                 struct bench_trace *trace)
+{
+  struct bench_bq *bq = bench_bq_new(BENCH_INITIAL_QUEUE_SIZE);
+  long long sum = 0;
+  int tindex = start;
+  int priority;
+
+  memset(status, 0, grid->xsize * grid->ysize);
+  cost[tindex] = 0;
+  extra[tindex] = 0;
+  status[tindex] = 2;
+
+  do {
+    sum += bench_total_CC(cost[tindex], extra[tindex]);
+
+    bench_adjc_iterate(grid, tindex, tindex1) {
+      int cost1, extra1;
+
+      if (2 == status[tindex1]) {
+        continue;
+      }
+      cost1 = bench_step_cost(grid, tindex1, cost[tindex]);
+      extra1 = extra[tindex] + grid->extra[tindex1];
+      if (0 == status[tindex1]
+          || bench_total_CC(cost1, extra1)
+             < bench_total_CC(cost[tindex1], extra[tindex1])) {
+        status[tindex1] = 1;
+        cost[tindex1] = cost1;
+        extra[tindex1] = extra1;
+        bench_bq_insert(bq, tindex1, bench_total_CC(cost1, extra1));
+        if (NULL != trace) {
+          bench_trace_add(trace, TRUE, bench_total_CC(cost1, extra1));
+        }
+      }
+    } bench_adjc_iterate_end;
+
+    do {
+      if (!bench_bq_remove(bq, &tindex, &priority)) {
+        bench_bq_destroy(bq);
+        return sum;
+      }
+      if (NULL != trace) {
+        bench_trace_add(trace, FALSE, 0);
+      }
+    } while (2 == status[tindex]
+             || priority != bench_total_CC(cost[tindex], extra[tindex]));
+    status[tindex] = 2;
+  } while (TRUE);
+}
+
+/**********************************************************************//**
+  Replay the recorded operations on the binary heap.
+**************************************************************************/
+static long long bench_replay_pq(const struct bench_trace *trace)
+{
+  struct bench_pq *pq = bench_pq_new(BENCH_INITIAL_QUEUE_SIZE);
+  long long sum = 0;
+  int i, data;
+
+  for (i = 0; i < trace->num; i++) {
+    if (trace->ops[i].insert) {
+      bench_pq_insert(pq, i, -trace->ops[i].priority);
+    } else if (bench_pq_remove(pq, &data)) {
+      sum += trace->ops[data].priority;
+    }
+  }
+  bench_pq_destroy(pq);
+
+  return sum;
+}
+
+/**********************************************************************//**
+  Replay the recorded operations on the bucket queue.
+**************************************************************************/
+static long long bench_replay_bq(const struct bench_trace *trace)
+{
+  struct bench_bq *bq = bench_bq_new(BENCH_INITIAL_QUEUE_SIZE);
+  long long sum = 0;
+  int i, data;
+
+  for (i = 0; i < trace->num; i++) {
+    if (trace->ops[i].insert) {
+      bench_bq_insert(bq, i, trace->ops[i].priority);
+    } else if (bench_bq_remove(bq, &data, NULL)) {
+      sum += trace->ops[data].priority;
+    }
+  }
+  bench_bq_destroy(bq);
+
+  return sum;
+}
+
+/**********************************************************************//**
+  Print the usage of the program.
+**************************************************************************/
+static void bench_usage(const char *name)
+{
+  fc_fprintf(stderr, "Usage: %s [size [searches [seed]]]\n", name);
+}
+
+/**********************************************************************//**
+  Entry point of freeciv-pqbench.
+**************************************************************************/
+int main(int argc, char **argv)
+{
+  struct bench_grid grid;
+  struct bench_trace trace = { 0, 0, NULL };
+  struct timer *timer;
+  int size = 200, searches = 20, seed = 4242;
+  int *cost, *extra;
+  char *status;
+  long long sum_pq = 0, sum_bq = 0;
+  double time_pq, time_bq;
+  bool same = TRUE;
+  int i;
+
+  fc_support_init();
+  log_init(NULL, LOG_NORMAL, NULL, NULL, -1);
+
+  if ((1 < argc && (!str_to_int(argv[1], &size) || 3 > size))
+      || (2 < argc && (!str_to_int(argv[2], &searches) || 1 > searches))
+      || (3 < argc && !str_to_int(argv[3], &seed))
+      || 4 < argc) {
+    bench_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  fc_srand(seed);
+  bench_grid_init(&grid, size, size);
+  cost = fc_malloc(sizeof(*cost) * size * size);
+  extra = fc_malloc(sizeof(*extra) * size * size);
+  status = fc_malloc(size * size);
+  timer = timer_new(TIMER_CPU, TIMER_ACTIVE, "pqbench");
+
+  /* Full searches, with the usage patterns of the path-finding code. */
+  timer_start(timer);
+  for (i = 0; i < searches; i++) {
+    sum_pq += bench_search_pq(&grid, (i * 7919) % (size * size),
+                              cost, extra, status);
+  }
+  timer_stop(timer);
+  time_pq = timer_read_seconds(timer);
+
+  timer_clear(timer);
+  timer_start(timer);
+  for (i = 0; i < searches; i++) {
+    sum_bq += bench_search_bq(&grid, (i * 7919) % (size * size),
+                              cost, extra, status, NULL);
+  }
+  timer_stop(timer);
+  time_bq = timer_read_seconds(timer);
+
+  fc_printf("search: %d x %d grid, %d searches\n", size, size, searches);
+  fc_printf("  specpq: %.3f s\n", time_pq);
+  fc_printf("  specbq: %.3f s\n", time_bq);
+  if (sum_pq != sum_bq) {
+    log_error("Different search results: %lld != %lld.", sum_pq, sum_bq);
+    same = FALSE;
+  }
+
+  /* Recorded sequences alone. */
+  for (i = 0; i < searches; i++) {
+    bench_search_bq(&grid, (i * 7919) % (size * size),
+                    cost, extra, status, &trace);
+  }
+
+  timer_clear(timer);
+  timer_start(timer);
+  sum_pq = bench_replay_pq(&trace);
+  timer_stop(timer);
+  time_pq = timer_read_seconds(timer);
+
+  timer_clear(timer);
+  timer_start(timer);
+  sum_bq = bench_replay_bq(&trace);
+  timer_stop(timer);
+  time_bq = timer_read_seconds(timer);
+
+  fc_printf("replay: %d operations\n", trace.num);
+  fc_printf("  specpq: %.3f s\n", time_pq);
+  fc_printf("  specbq: %.3f s\n", time_bq);
+  if (sum_pq != sum_bq) {
+    log_error("Different replay results: %lld != %lld.", sum_pq, sum_bq);
+    same = FALSE;
+  }
+
+  free(trace.ops);
+  timer_destroy(timer);
+  free(status);
+  free(extra);
+  free(cost);
+  bench_grid_free(&grid);
+  log_close();
+  fc_support_free();
+
+  return (same ? EXIT_SUCCESS : EXIT_FAILURE);
+}
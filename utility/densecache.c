@@ -0,0 +1,219 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/***********************************************************************
+  A dense cache keeps one pointer slot per index, from 0 up to the
+  highest index inserted so far. The slot array grows geometrically and
+  never shrinks until the cache is cleared, so it suits keys which are
+  allocated from a compact range and reused, like tile indices and the
+  identity numbers of units and cities. For sparse keys use genhash.
+
+  Records live in slabs of DENSE_CACHE_SLAB_RECORDS records each. A
+  removed record goes to a free list, whose link is stored in the
+  record itself, and is handed out again by the next insertion. The
+  slabs are only released when the cache is cleared or destroyed.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include <string.h>
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "shared.h"            /* MAX(), MIN() */
+
+#include "densecache.h"
+
+/* Records per slab. */
+#define DENSE_CACHE_SLAB_RECORDS 64
+
+/* Records are aligned like malloc() would align them on common
+ * platforms. */
+#define DENSE_CACHE_ALIGN (2 * sizeof(void *))
+#define DENSE_CACHE_ROUND(_size_) \
+  (((_size_) + DENSE_CACHE_ALIGN - 1) / DENSE_CACHE_ALIGN * DENSE_CACHE_ALIGN)
+
+/* Smallest slot array allocated. */
+#define DENSE_CACHE_MIN_SLOTS 64
+
+struct dense_cache_slab {
+  struct dense_cache_slab *next;
+  int used;             /* Records handed out from this slab */
+};
+
+struct dense_cache {
+  size_t record_size;   /* Rounded up to DENSE_CACHE_ALIGN */
+  void **slots;
+  int num_slots;
+  size_t count;         /* Number of records stored */
+  struct dense_cache_slab *slabs;       /* Newest first */
+  void *free_records;   /* Removed records, linked through their first
+                         * pointer */
+};
+
+/**********************************************************************//**
+  Create a new dense cache for records of the given size.
+**************************************************************************/
+struct dense_cache *dense_cache_new(size_t record_size)
+{
+  struct dense_cache *pcache = fc_calloc(1, sizeof(*pcache));
+
+  fc_assert(0 < record_size);
+
+  if (record_size < sizeof(void *)) {
+    record_size = sizeof(void *);
+  }
+  pcache->record_size = DENSE_CACHE_ROUND(record_size);
+
+  return pcache;
+}
+
+/**********************************************************************//**
+  Free all records and slots of the cache.
+**************************************************************************/
+void dense_cache_clear(struct dense_cache *pcache)
+{
+  fc_assert_ret(NULL != pcache);
+
+  while (NULL != pcache->slabs) {
+    struct dense_cache_slab *next = pcache->slabs->next;
+
+    free(pcache->slabs);
+    pcache->slabs = next;
+  }
+
+  free(pcache->slots);
+  pcache->slots = NULL;
+  pcache->num_slots = 0;
+  pcache->count = 0;
+  pcache->free_records = NULL;
+}
+
+/**********************************************************************//**
+  Destroy the cache and all the records in it.
+**************************************************************************/
+void dense_cache_destroy(struct dense_cache *pcache)
+{
+  fc_assert_ret(NULL != pcache);
+
+  dense_cache_clear(pcache);
+  free(pcache);
+}
+
+/**********************************************************************//**
+  Return the number of records stored in the cache.
+**************************************************************************/
+size_t dense_cache_size(const struct dense_cache *pcache)
+{
+  fc_assert_ret_val(NULL != pcache, 0);
+
+  return pcache->count;
+}
+
+/**********************************************************************//**
+  Return the record stored at the index, or NULL if there is none.
+**************************************************************************/
+void *dense_cache_lookup(const struct dense_cache *pcache, int index)
+{
+  if (0 > index || index >= pcache->num_slots) {
+    return NULL;
+  }
+
+  return pcache->slots[index];
+}
+
+/**********************************************************************//**
+  Return memory for one more record.
+**************************************************************************/
+static void *dense_cache_record_new(struct dense_cache *pcache)
+{
+  struct dense_cache_slab *slab = pcache->slabs;
+  size_t header = DENSE_CACHE_ROUND(sizeof(*slab));
+
+  if (NULL != pcache->free_records) {
+    void *record = pcache->free_records;
+
+    pcache->free_records = *(void **) record;
+    return record;
+  }
+
+  if (NULL == slab || DENSE_CACHE_SLAB_RECORDS <= slab->used) {
+    slab = fc_malloc(header + DENSE_CACHE_SLAB_RECORDS * pcache->record_size);
+    slab->next = pcache->slabs;
+    slab->used = 0;
+    pcache->slabs = slab;
+  }
+
+  return (char *) slab + header + pcache->record_size * slab->used++;
+}
+
+/**********************************************************************//**
+  Return the record stored at the index, creating a zeroed one if there
+  is none yet. Returns NULL if the index is outside
+  [0, DENSE_CACHE_MAX_INDEX).
+**************************************************************************/
+void *dense_cache_insert(struct dense_cache *pcache, int index)
+{
+  void *record;
+
+  if (0 > index || DENSE_CACHE_MAX_INDEX <= index) {
+    log_error("Index %d out of range for a dense cache.", index);
+    return NULL;
+  }
+
+  if (index >= pcache->num_slots) {
+    int num_slots = MAX(pcache->num_slots * 2, DENSE_CACHE_MIN_SLOTS);
+
+    if (num_slots <= index) {
+      num_slots = index + 1;
+    }
+    num_slots = MIN(num_slots, DENSE_CACHE_MAX_INDEX);
+
+    pcache->slots = fc_realloc(pcache->slots,
+                               num_slots * sizeof(*pcache->slots));
+    memset(pcache->slots + pcache->num_slots, 0,
+           (num_slots - pcache->num_slots) * sizeof(*pcache->slots));
+    pcache->num_slots = num_slots;
+  } else if (NULL != pcache->slots[index]) {
+    return pcache->slots[index];
+  }
+
+  record = dense_cache_record_new(pcache);
+  memset(record, 0, pcache->record_size);
+  pcache->slots[index] = record;
+  pcache->count++;
+
+  return record;
+}
+
+/**********************************************************************//**
+  Remove the record stored at the index. Returns TRUE if there was one.
+**************************************************************************/
+bool dense_cache_remove(struct dense_cache *pcache, int index)
+{
+  void *record = dense_cache_lookup(pcache, index);
+
+  if (NULL == record) {
+    return FALSE;
+  }
+
+  *(void **) record = pcache->free_records;
+  pcache->free_records = record;
+  pcache->slots[index] = NULL;
+  pcache->count--;
+
+  return TRUE;
+}
@@ -0,0 +1,52 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__DENSECACHE_H
+#define FC__DENSECACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/***********************************************************************
+  A table of fixed size records addressed directly by a small
+  non-negative index, like a tile index or a unit or city id. Lookups
+  are a bounds check and an array access. Records are carved out of
+  slabs holding many of them, so there is no per-record allocation.
+  See comments in "densecache.c".
+***********************************************************************/
+
+/* utility */
+#include "support.h"            /* bool type */
+
+/* Indices from 0 up to, but not including, this one can be stored. */
+#define DENSE_CACHE_MAX_INDEX (1 << 22)
+
+struct dense_cache;             /* opaque */
+
+struct dense_cache *dense_cache_new(size_t record_size)
+                    fc__warn_unused_result;
+void dense_cache_destroy(struct dense_cache *pcache);
+void dense_cache_clear(struct dense_cache *pcache);
+
+size_t dense_cache_size(const struct dense_cache *pcache);
+
+void *dense_cache_lookup(const struct dense_cache *pcache, int index);
+void *dense_cache_insert(struct dense_cache *pcache, int index);
+bool dense_cache_remove(struct dense_cache *pcache, int index);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__DENSECACHE_H */
@@ -0,0 +1,192 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+/* utility */
+#include "fcthread.h"
+#include "log.h"
+#include "mem.h"
+#include "shared.h"
+#include "support.h"
+
+#include "fcthreadpool.h"
+
+struct fc_threadpool {
+  int num_threads;
+  fc_thread *threads;
+
+  fc_mutex mutex;               /* Protects all the fields below. */
+  fc_thread_cond work_cond;     /* Signaled when a batch starts. */
+  fc_thread_cond done_cond;     /* Signaled when a batch is done. */
+  bool quit;
+
+  /* The current batch. */
+  unsigned int generation;      /* Incremented at every batch. */
+  fc_threadpool_func_t func;
+  void *data;
+  int num_tasks;
+  int next_task;                /* First task not started yet. */
+  int done_tasks;
+};
+
+/*******************************************************************//**
+  Run the tasks of the current batch until none is left. Must be called
+  with the mutex held, which is released while the tasks run.
+***********************************************************************/
+static void fc_threadpool_work(struct fc_threadpool *pool)
+{
+  while (pool->next_task < pool->num_tasks) {
+    fc_threadpool_func_t func = pool->func;
+    void *data = pool->data;
+    int task = pool->next_task++;
+
+    fc_mutex_release(&pool->mutex);
+    func(task, data);
+    fc_mutex_allocate(&pool->mutex);
+
+    if (++pool->done_tasks == pool->num_tasks) {
+      fc_thread_cond_signal(&pool->done_cond);
+    }
+  }
+}
+
+/*******************************************************************//**
+  Main function of the worker threads.
+***********************************************************************/
+static void fc_threadpool_thread(void *arg)
+{
+  struct fc_threadpool *pool = (struct fc_threadpool *) arg;
+  unsigned int seen;
+
+  fc_mutex_allocate(&pool->mutex);
+  seen = pool->generation;
+  while (!pool->quit) {
+    if (seen == pool->generation) {
+      fc_thread_cond_wait(&pool->work_cond, &pool->mutex);
+      continue;
+    }
+    seen = pool->generation;
+    fc_threadpool_work(pool);
+  }
+  fc_mutex_release(&pool->mutex);
+}
+
+/*******************************************************************//**
+  Create a pool of 'threads' worker threads. With 0 threads, or when
+  condition variables are not available, the batches are run by the
+  calling thread only.
+***********************************************************************/
+struct fc_threadpool *fc_threadpool_new(int threads)
+{
+  struct fc_threadpool *pool = fc_calloc(1, sizeof(*pool));
+  int i;
+
+  if (!has_thread_cond_impl()) {
+    threads = 0;
+  }
+
+  fc_mutex_init(&pool->mutex);
+  if (0 < threads) {
+    fc_thread_cond_init(&pool->work_cond);
+    fc_thread_cond_init(&pool->done_cond);
+    pool->threads = fc_malloc(threads * sizeof(*pool->threads));
+  }
+
+  for (i = 0; i < threads; i++) {
+    if (0 != fc_thread_start(&pool->threads[i], fc_threadpool_thread,
+                             pool)) {
+      log_error("Could only start %d of %d worker threads.", i, threads);
+      break;
+    }
+  }
+  pool->num_threads = i;
+
+  return pool;
+}
+
+/*******************************************************************//**
+  Stop the worker threads and free the pool. No batch may be running.
+***********************************************************************/
+void fc_threadpool_destroy(struct fc_threadpool *pool)
+{
+  int i;
+
+  if (NULL != pool->threads) {
+    fc_mutex_allocate(&pool->mutex);
+    pool->quit = TRUE;
+    for (i = 0; i < pool->num_threads; i++) {
+      fc_thread_cond_signal(&pool->work_cond);
+    }
+    fc_mutex_release(&pool->mutex);
+
+    for (i = 0; i < pool->num_threads; i++) {
+      fc_thread_wait(&pool->threads[i]);
+    }
+    free(pool->threads);
+    fc_thread_cond_destroy(&pool->work_cond);
+    fc_thread_cond_destroy(&pool->done_cond);
+  }
+
+  fc_mutex_destroy(&pool->mutex);
+  free(pool);
+}
+
+/*******************************************************************//**
+  Return the number of worker threads of the pool, not counting the
+  thread calling fc_threadpool_run().
+***********************************************************************/
+int fc_threadpool_size(const struct fc_threadpool *pool)
+{
+  return pool->num_threads;
+}
+
+/*******************************************************************//**
+  Call func(task, data) for all the tasks from 0 to num_tasks - 1, in any
+  order and from any thread of the pool, including the calling one.
+  Returns when all of them are done. Must not be called from a task.
+***********************************************************************/
+void fc_threadpool_run(struct fc_threadpool *pool, int num_tasks,
+                       fc_threadpool_func_t func, void *data)
+{
+  int i;
+
+  if (0 == pool->num_threads || 1 >= num_tasks) {
+    for (i = 0; i < num_tasks; i++) {
+      func(i, data);
+    }
+    return;
+  }
+
+  fc_mutex_allocate(&pool->mutex);
+  pool->generation++;
+  pool->func = func;
+  pool->data = data;
+  pool->num_tasks = num_tasks;
+  pool->next_task = 0;
+  pool->done_tasks = 0;
+
+  /* There is no broadcast, wake up the threads one by one. The extra
+   * signals are harmless, a thread only works once per generation. */
+  for (i = 0; i < MIN(pool->num_threads, num_tasks - 1); i++) {
+    fc_thread_cond_signal(&pool->work_cond);
+  }
+
+  fc_threadpool_work(pool);
+  while (pool->done_tasks < pool->num_tasks) {
+    fc_thread_cond_wait(&pool->done_cond, &pool->mutex);
+  }
+  fc_mutex_release(&pool->mutex);
+}
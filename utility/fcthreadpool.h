@@ -0,0 +1,46 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__FCTHREADPOOL_H
+#define FC__FCTHREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* utility */
+#include "support.h" /* bool */
+
+/* A set of worker threads running batches of independent tasks. The
+ * thread calling fc_threadpool_run() works on the tasks too, and the call
+ * only returns once all of them are done, so the tasks may use data on
+ * its stack. Without condition variables (see has_thread_cond_impl()),
+ * the tasks are simply run one after the other by the caller. */
+struct fc_threadpool;
+
+/* A task of a batch. 'task' is its index, from 0 to the number of tasks
+ * minus one. */
+typedef void (*fc_threadpool_func_t) (int task, void *data);
+
+struct fc_threadpool *fc_threadpool_new(int threads);
+void fc_threadpool_destroy(struct fc_threadpool *pool);
+int fc_threadpool_size(const struct fc_threadpool *pool);
+
+void fc_threadpool_run(struct fc_threadpool *pool, int num_tasks,
+                       fc_threadpool_func_t func, void *data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__FCTHREADPOOL_H */
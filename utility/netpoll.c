@@ -0,0 +1,638 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <fc_config.h>
+#endif
+
+#include "fc_prehdrs.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "netintf.h"
+#include "support.h"
+
+#include "netpoll.h"
+
+enum netpoll_backend {
+  NETPOLL_SELECT,
+  NETPOLL_POLL,
+  NETPOLL_EPOLL
+};
+
+struct netpoll_slot {
+  int fd;               /* -1 for a free slot */
+  int events;
+  void *data;
+  bool always_ready;    /* epoll refused the fd, e.g. a regular file */
+};
+
+static struct {
+  bool initialized;
+  enum netpoll_backend backend;
+  struct netpoll_slot *slots;
+  int num_slots;        /* Allocated */
+  int used_slots;       /* One past the highest slot in use */
+  int *always_ready;    /* Handles of the slots with 'always_ready' */
+  int num_always_ready;
+#ifdef HAVE_POLL_H
+  struct pollfd *pollfds;       /* Parallel to 'slots' */
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+  int epfd;
+  struct epoll_event *epoll_events;
+  int num_epoll_events;
+#endif
+} netpoll = { .initialized = FALSE };
+
+#ifdef HAVE_POLL_H
+/*********************************************************************//**
+  Translate netpoll interest flags to poll() events.
+*************************************************************************/
+static short netpoll_to_poll(int events)
+{
+  short pevents = 0;
+
+  if (events & NETPOLL_READ) {
+    pevents |= POLLIN;
+  }
+  if (events & NETPOLL_WRITE) {
+    pevents |= POLLOUT;
+  }
+  if (events & NETPOLL_ERROR) {
+    pevents |= POLLPRI;
+  }
+
+  return pevents;
+}
+
+/*********************************************************************//**
+  Translate poll() results to netpoll flags, as select() would have
+  reported them: hangups and errors make the fd readable and writable
+  so that the following read or write sees the condition.
+*************************************************************************/
+static int netpoll_from_poll(short revents, int interest)
+{
+  int events = 0;
+
+  if (revents & (POLLIN | POLLHUP | POLLERR)) {
+    events |= NETPOLL_READ;
+  }
+  if (revents & (POLLOUT | POLLHUP | POLLERR)) {
+    events |= NETPOLL_WRITE;
+  }
+  if (revents & (POLLPRI | POLLNVAL)) {
+    events |= NETPOLL_ERROR;
+  }
+
+  return events & interest;
+}
+#endif /* HAVE_POLL_H */
+
+#ifdef HAVE_SYS_EPOLL_H
+/*********************************************************************//**
+  Translate netpoll interest flags to epoll events.
+*************************************************************************/
+static unsigned netpoll_to_epoll(int events)
+{
+  unsigned eevents = 0;
+
+  if (events & NETPOLL_READ) {
+    eevents |= EPOLLIN;
+  }
+  if (events & NETPOLL_WRITE) {
+    eevents |= EPOLLOUT;
+  }
+  if (events & NETPOLL_ERROR) {
+    eevents |= EPOLLPRI;
+  }
+  if (events & NETPOLL_EDGE) {
+    eevents |= EPOLLET;
+  }
+
+  return eevents;
+}
+
+/*********************************************************************//**
+  Translate epoll results to netpoll flags. See netpoll_from_poll().
+*************************************************************************/
+static int netpoll_from_epoll(unsigned eevents, int interest)
+{
+  int events = 0;
+
+  if (eevents & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    events |= NETPOLL_READ;
+  }
+  if (eevents & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+    events |= NETPOLL_WRITE;
+  }
+  if (eevents & EPOLLPRI) {
+    events |= NETPOLL_ERROR;
+  }
+
+  return events & interest;
+}
+
+/*********************************************************************//**
+  Register or update the fd of the slot in the epoll set. Returns 0 on
+  success, or the errno of the failure; EPERM means that epoll can't
+  watch the fd at all.
+*************************************************************************/
+static int netpoll_epoll_ctl(int op, int handle)
+{
+  struct epoll_event ev;
+  int err;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = netpoll_to_epoll(netpoll.slots[handle].events);
+  ev.data.u32 = handle;
+
+  if (epoll_ctl(netpoll.epfd, op, netpoll.slots[handle].fd, &ev) == 0) {
+    return 0;
+  }
+  err = errno;
+  if (err != EPERM) {
+    log_error("epoll_ctl() failed for fd %d: %s",
+              netpoll.slots[handle].fd, fc_strerror(err));
+  }
+
+  return err;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*********************************************************************//**
+  Set up the poller, selecting the best backend available.
+*************************************************************************/
+void netpoll_init(void)
+{
+  if (netpoll.initialized) {
+    return;
+  }
+
+  netpoll.backend = NETPOLL_SELECT;
+  netpoll.slots = NULL;
+  netpoll.num_slots = 0;
+  netpoll.used_slots = 0;
+  netpoll.always_ready = NULL;
+  netpoll.num_always_ready = 0;
+
+#ifdef HAVE_POLL_H
+  netpoll.pollfds = NULL;
+  netpoll.backend = NETPOLL_POLL;
+#endif /* HAVE_POLL_H */
+
+#ifdef HAVE_SYS_EPOLL_H
+  netpoll.epoll_events = NULL;
+  netpoll.num_epoll_events = 0;
+  netpoll.epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (netpoll.epfd >= 0) {
+    netpoll.backend = NETPOLL_EPOLL;
+  } else {
+    log_error("epoll_create1() failed: %s", fc_strerror(fc_get_errno()));
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  netpoll.initialized = TRUE;
+}
+
+/*********************************************************************//**
+  Free the poller. The registered fds are not closed.
+*************************************************************************/
+void netpoll_free(void)
+{
+  if (!netpoll.initialized) {
+    return;
+  }
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll.epfd >= 0) {
+    close(netpoll.epfd);
+    netpoll.epfd = -1;
+  }
+  FC_FREE(netpoll.epoll_events);
+  netpoll.num_epoll_events = 0;
+#endif /* HAVE_SYS_EPOLL_H */
+#ifdef HAVE_POLL_H
+  FC_FREE(netpoll.pollfds);
+#endif /* HAVE_POLL_H */
+
+  FC_FREE(netpoll.slots);
+  FC_FREE(netpoll.always_ready);
+  netpoll.num_slots = 0;
+  netpoll.used_slots = 0;
+  netpoll.num_always_ready = 0;
+  netpoll.initialized = FALSE;
+}
+
+/*********************************************************************//**
+  Name of the backend in use, for the logs.
+*************************************************************************/
+const char *netpoll_backend_name(void)
+{
+  switch (netpoll.backend) {
+  case NETPOLL_EPOLL:
+    return "epoll";
+  case NETPOLL_POLL:
+    return "poll";
+  case NETPOLL_SELECT:
+    return "select";
+  }
+
+  return "?";
+}
+
+/*********************************************************************//**
+  Start watching fd for the given NETPOLL_* events. 'data' is passed
+  back with the events of the fd. Returns the handle of the fd, or -1
+  on failure.
+*************************************************************************/
+int netpoll_add(int fd, int events, void *data)
+{
+  int handle;
+#ifdef HAVE_SYS_EPOLL_H
+  int err;
+#endif
+
+  fc_assert_ret_val(netpoll.initialized, -1);
+
+  for (handle = 0; handle < netpoll.used_slots; handle++) {
+    if (netpoll.slots[handle].fd < 0) {
+      break;
+    }
+  }
+
+  if (handle >= netpoll.num_slots) {
+    netpoll.num_slots = MAX(16, 2 * netpoll.num_slots);
+    netpoll.slots = fc_realloc(netpoll.slots,
+                               netpoll.num_slots * sizeof(*netpoll.slots));
+#ifdef HAVE_POLL_H
+    netpoll.pollfds = fc_realloc(netpoll.pollfds,
+                                 netpoll.num_slots
+                                 * sizeof(*netpoll.pollfds));
+#endif /* HAVE_POLL_H */
+  }
+
+  netpoll.slots[handle].fd = fd;
+  netpoll.slots[handle].events = events;
+  netpoll.slots[handle].data = data;
+  netpoll.slots[handle].always_ready = FALSE;
+
+#ifdef HAVE_POLL_H
+  netpoll.pollfds[handle].fd = fd;
+  netpoll.pollfds[handle].events = netpoll_to_poll(events);
+  netpoll.pollfds[handle].revents = 0;
+#endif /* HAVE_POLL_H */
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll.backend == NETPOLL_EPOLL
+      && 0 != (err = netpoll_epoll_ctl(EPOLL_CTL_ADD, handle))) {
+    if (err != EPERM) {
+      netpoll.slots[handle].fd = -1;
+      return -1;
+    }
+
+    /* Regular files can't be polled, but are always ready, as select()
+     * and poll() would report them. */
+    netpoll.slots[handle].always_ready = TRUE;
+    netpoll.always_ready
+      = fc_realloc(netpoll.always_ready,
+                   (netpoll.num_always_ready + 1)
+                   * sizeof(*netpoll.always_ready));
+    netpoll.always_ready[netpoll.num_always_ready++] = handle;
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  netpoll.used_slots = MAX(netpoll.used_slots, handle + 1);
+
+  return handle;
+}
+
+/*********************************************************************//**
+  Change the events watched for the fd of the handle.
+*************************************************************************/
+void netpoll_modify(int handle, int events)
+{
+  fc_assert_ret(0 <= handle && handle < netpoll.used_slots);
+  fc_assert_ret(netpoll.slots[handle].fd >= 0);
+
+  if (netpoll.slots[handle].events == events) {
+    return;
+  }
+  netpoll.slots[handle].events = events;
+
+#ifdef HAVE_POLL_H
+  netpoll.pollfds[handle].events = netpoll_to_poll(events);
+#endif /* HAVE_POLL_H */
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll.backend == NETPOLL_EPOLL
+      && !netpoll.slots[handle].always_ready) {
+    (void) netpoll_epoll_ctl(EPOLL_CTL_MOD, handle);
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+/*********************************************************************//**
+  Stop watching the fd of the handle. Call this before closing the fd.
+*************************************************************************/
+void netpoll_remove(int handle)
+{
+  int i;
+
+  fc_assert_ret(0 <= handle && handle < netpoll.used_slots);
+  fc_assert_ret(netpoll.slots[handle].fd >= 0);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (netpoll.backend == NETPOLL_EPOLL
+      && !netpoll.slots[handle].always_ready) {
+    struct epoll_event ev;
+
+    /* Non-NULL event for pre-2.6.9 kernels. */
+    (void) epoll_ctl(netpoll.epfd, EPOLL_CTL_DEL,
+                     netpoll.slots[handle].fd, &ev);
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+
+  if (netpoll.slots[handle].always_ready) {
+    for (i = 0; i < netpoll.num_always_ready; i++) {
+      if (netpoll.always_ready[i] == handle) {
+        netpoll.always_ready[i]
+          = netpoll.always_ready[--netpoll.num_always_ready];
+        break;
+      }
+    }
+  }
+
+  netpoll.slots[handle].fd = -1;
+#ifdef HAVE_POLL_H
+  /* poll() ignores negative fds. */
+  netpoll.pollfds[handle].fd = -1;
+#endif /* HAVE_POLL_H */
+
+  while (netpoll.used_slots > 0
+         && netpoll.slots[netpoll.used_slots - 1].fd < 0) {
+    netpoll.used_slots--;
+  }
+}
+
+/*********************************************************************//**
+  Wait with select() for the events of the fds. 'ready' receives the
+  NETPOLL_* events found for each fd. Returns the number of ready fds,
+  0 on timeout or -1 on error.
+*************************************************************************/
+static int netpoll_select(const struct netpoll_slot *slots, int num_slots,
+                          int *ready, int timeout_ms)
+{
+  fd_set readfs, writefs, exceptfs;
+  fc_timeval tv;
+  int max_desc = -1;
+  int i, ret, num = 0;
+
+  FC_FD_ZERO(&readfs);
+  FC_FD_ZERO(&writefs);
+  FC_FD_ZERO(&exceptfs);
+
+  for (i = 0; i < num_slots; i++) {
+    if (slots[i].fd < 0) {
+      continue;
+    }
+    if (slots[i].events & NETPOLL_READ) {
+      FD_SET(slots[i].fd, &readfs);
+    }
+    if (slots[i].events & NETPOLL_WRITE) {
+      FD_SET(slots[i].fd, &writefs);
+    }
+    if (slots[i].events & NETPOLL_ERROR) {
+      FD_SET(slots[i].fd, &exceptfs);
+    }
+    max_desc = MAX(max_desc, slots[i].fd);
+  }
+
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+  ret = fc_select(max_desc + 1, &readfs, &writefs, &exceptfs,
+                  timeout_ms < 0 ? NULL : &tv);
+  if (ret <= 0) {
+    return ret;
+  }
+
+  for (i = 0; i < num_slots; i++) {
+    ready[i] = 0;
+    if (slots[i].fd < 0) {
+      continue;
+    }
+    if (FD_ISSET(slots[i].fd, &readfs)) {
+      ready[i] |= NETPOLL_READ;
+    }
+    if (FD_ISSET(slots[i].fd, &writefs)) {
+      ready[i] |= NETPOLL_WRITE;
+    }
+    if (FD_ISSET(slots[i].fd, &exceptfs)) {
+      ready[i] |= NETPOLL_ERROR;
+    }
+    if (ready[i] != 0) {
+      num++;
+    }
+  }
+
+  return num;
+}
+
+/*********************************************************************//**
+  Wait up to timeout_ms milliseconds (forever if negative) for events
+  on the registered fds. Fills at most max_events entries of 'events',
+  the rest are reported by the next call. Returns the number of
+  entries filled, 0 on timeout or -1 on error (see fc_get_errno()).
+*************************************************************************/
+int netpoll_wait(struct netpoll_event *events, int max_events,
+                 int timeout_ms)
+{
+  int i, num = 0;
+
+  fc_assert_ret_val(netpoll.initialized, -1);
+  fc_assert_ret_val(max_events > 0, -1);
+
+  switch (netpoll.backend) {
+  case NETPOLL_EPOLL:
+#ifdef HAVE_SYS_EPOLL_H
+    {
+      int ret;
+
+      if (netpoll.num_epoll_events < max_events) {
+        netpoll.num_epoll_events = max_events;
+        netpoll.epoll_events
+          = fc_realloc(netpoll.epoll_events,
+                       max_events * sizeof(*netpoll.epoll_events));
+      }
+
+      ret = epoll_wait(netpoll.epfd, netpoll.epoll_events,
+                       max_events - MIN(netpoll.num_always_ready,
+                                        max_events - 1),
+                       netpoll.num_always_ready > 0 ? 0 : timeout_ms);
+      if (ret < 0) {
+        return -1;
+      }
+
+      for (i = 0; i < ret; i++) {
+        int handle = netpoll.epoll_events[i].data.u32;
+        const struct netpoll_slot *slot = netpoll.slots + handle;
+
+        events[num].events
+          = netpoll_from_epoll(netpoll.epoll_events[i].events,
+                               slot->events);
+        if (events[num].events != 0) {
+          events[num].fd = slot->fd;
+          events[num].data = slot->data;
+          num++;
+        }
+      }
+
+      for (i = 0; i < netpoll.num_always_ready && num < max_events; i++) {
+        const struct netpoll_slot *slot
+          = netpoll.slots + netpoll.always_ready[i];
+
+        events[num].events
+          = slot->events & (NETPOLL_READ | NETPOLL_WRITE);
+        if (events[num].events != 0) {
+          events[num].fd = slot->fd;
+          events[num].data = slot->data;
+          num++;
+        }
+      }
+    }
+#endif /* HAVE_SYS_EPOLL_H */
+    break;
+
+  case NETPOLL_POLL:
+#ifdef HAVE_POLL_H
+    {
+      int ret = poll(netpoll.pollfds, netpoll.used_slots, timeout_ms);
+
+      if (ret < 0) {
+        return -1;
+      }
+
+      for (i = 0; i < netpoll.used_slots && ret > 0 && num < max_events;
+           i++) {
+        if (netpoll.pollfds[i].revents == 0) {
+          continue;
+        }
+        ret--;
+        events[num].events
+          = netpoll_from_poll(netpoll.pollfds[i].revents,
+                              netpoll.slots[i].events);
+        if (events[num].events != 0) {
+          events[num].fd = netpoll.slots[i].fd;
+          events[num].data = netpoll.slots[i].data;
+          num++;
+        }
+      }
+    }
+#endif /* HAVE_POLL_H */
+    break;
+
+  case NETPOLL_SELECT:
+    {
+      int *ready = fc_malloc(MAX(1, netpoll.used_slots) * sizeof(*ready));
+      int ret = netpoll_select(netpoll.slots, netpoll.used_slots, ready,
+                               timeout_ms);
+
+      if (ret < 0) {
+        free(ready);
+        return -1;
+      }
+
+      for (i = 0; i < netpoll.used_slots && ret > 0 && num < max_events;
+           i++) {
+        if (netpoll.slots[i].fd >= 0 && ready[i] != 0) {
+          events[num].fd = netpoll.slots[i].fd;
+          events[num].events = ready[i];
+          events[num].data = netpoll.slots[i].data;
+          num++;
+        }
+      }
+      free(ready);
+    }
+    break;
+  }
+
+  return num;
+}
+
+/*********************************************************************//**
+  Wait up to timeout_ms milliseconds for the events of a short list of
+  fds that need not be registered. On entry the 'events' field of each
+  entry holds the interest, on return the ready events. Returns the
+  number of ready fds, 0 on timeout or -1 on error.
+*************************************************************************/
+int netpoll_wait_fds(struct netpoll_event *fds, int num_fds,
+                     int timeout_ms)
+{
+  int i, ret;
+
+#ifdef HAVE_POLL_H
+  struct pollfd one, *pfds = (num_fds == 1 ? &one
+                              : fc_malloc(num_fds * sizeof(*pfds)));
+
+  for (i = 0; i < num_fds; i++) {
+    pfds[i].fd = fds[i].fd;
+    pfds[i].events = netpoll_to_poll(fds[i].events);
+    pfds[i].revents = 0;
+  }
+
+  ret = poll(pfds, num_fds, timeout_ms);
+  for (i = 0; i < num_fds; i++) {
+    fds[i].events = (ret > 0
+                     ? netpoll_from_poll(pfds[i].revents, fds[i].events)
+                     : 0);
+  }
+
+  if (pfds != &one) {
+    free(pfds);
+  }
+#else  /* HAVE_POLL_H */
+  struct netpoll_slot *slots = fc_malloc(num_fds * sizeof(*slots));
+  int *ready = fc_malloc(num_fds * sizeof(*ready));
+
+  for (i = 0; i < num_fds; i++) {
+    slots[i].fd = fds[i].fd;
+    slots[i].events = fds[i].events;
+  }
+
+  ret = netpoll_select(slots, num_fds, ready, timeout_ms);
+  for (i = 0; i < num_fds; i++) {
+    fds[i].events = (ret > 0 ? ready[i] : 0);
+  }
+
+  free(slots);
+  free(ready);
+#endif /* HAVE_POLL_H */
+
+  return ret;
+}
@@ -0,0 +1,65 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 1996 - A Kjeldberg, L Gregersen, P Unold
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+#ifndef FC__NETPOLL_H
+#define FC__NETPOLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/***********************************************************************
+  Readiness notification for a set of file descriptors. Uses epoll
+  where available, poll() otherwise and select() as the last resort.
+  Descriptors are registered once and referred to by the handle
+  netpoll_add() returns, so waiting costs are proportional to the
+  number of ready descriptors (epoll) rather than to the number of
+  registered ones.
+***********************************************************************/
+
+/* utility */
+#include "support.h"   /* bool type */
+
+#define NETPOLL_READ  (1 << 0)
+#define NETPOLL_WRITE (1 << 1)
+/* Exceptional condition, like select()'s exceptfds. */
+#define NETPOLL_ERROR (1 << 2)
+/* Report only changes of the readiness. The epoll backend only; the
+ * others are always level-triggered, so the caller must anyway read
+ * or write until the operation would block. */
+#define NETPOLL_EDGE  (1 << 3)
+
+struct netpoll_event {
+  int fd;
+  int events;           /* NETPOLL_READ | NETPOLL_WRITE | NETPOLL_ERROR */
+  void *data;
+};
+
+void netpoll_init(void);
+void netpoll_free(void);
+const char *netpoll_backend_name(void);
+
+int netpoll_add(int fd, int events, void *data);
+void netpoll_modify(int handle, int events);
+void netpoll_remove(int handle);
+
+int netpoll_wait(struct netpoll_event *events, int max_events,
+                 int timeout_ms);
+int netpoll_wait_fds(struct netpoll_event *fds, int num_fds,
+                     int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* FC__NETPOLL_H */
@@ -0,0 +1,415 @@
+/***********************************************************************
+ Freeciv - Copyright (C) 2002 - The Freeciv Project
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+***********************************************************************/
+
+/* specbqs: "specific bucket queues".
+ *
+ * This file is used to implement "specific" monotone priority queues,
+ * in the same way as specpq.h. Unlike the heap of specpq.h, the queue
+ * returns the item with the LOWEST priority first, and the priority is
+ * always an int.
+ *
+ * The queue is a radix heap: the items are stored in 33 buckets, chosen
+ * after the highest bit which differs between their priority and the
+ * priority of the last removed item. Inserting and removing cost O(1)
+ * amortized as long as the priorities which are inserted are not lower
+ * than the last removed one, which is the case for Dijkstra-like
+ * searches. Inserting a lower priority is allowed, but then all the
+ * items are sorted again in O(n).
+ *
+ * There is no replace function: to improve the priority of some data,
+ * insert it again, and skip the outdated entries when removing them.
+ *
+ * Before including this file, you must define the following:
+ *   SPECBQ_TAG - this tag will be used to form names for functions etc.
+ *   SPECBQ_DATA_TYPE - the type for the data property of the cells.
+ *
+ * Assuming SPECBQ_TAG were 'foo', and SPECBQ_DATA_TYPE were 'data_t'.
+ * including this file would provide a struct definition for:
+ *    struct foo_bq;
+ *
+ * function typedefs:
+ *    typedef void (*foo_bq_data_free_fn_t) (data_t);
+ *
+ * and prototypes for the following functions:
+ *    struct foo_bq *foo_bq_new(int initial_size);
+ *    void foo_bq_destroy(struct foo_bq *bq);
+ *    void foo_bq_destroy_full(struct foo_bq *bq,
+ *                             foo_bq_data_free_fn_t data_free);
+ *    void foo_bq_insert(struct foo_bq *bq, data_t data, int priority);
+ *    bool foo_bq_remove(struct foo_bq *bq, data_t *pdata,
+ *                       int *ppriority);
+ *    bool foo_bq_peek(struct foo_bq *bq, data_t *pdata);
+ *    bool foo_bq_priority(struct foo_bq *bq, int *ppriority);
+ *    int foo_bq_size(const struct foo_bq *bq);
+ *    size_t foo_bq_memory(const struct foo_bq *bq);
+ *
+ * Note this is not protected against multiple inclusions; this is so that
+ * you can have multiple different specbqs. For each specbq, this file
+ * should be included _once_, inside a .h file which _is_ itself protected
+ * against multiple inclusions. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* utility */
+#include "log.h"
+#include "mem.h"
+#include "shared.h"
+#include "support.h"
+
+#ifndef SPECBQ_TAG
+#error Must define a SPECBQ_TAG to use this header
+#endif
+#ifndef SPECBQ_DATA_TYPE
+#error Must define a SPECBQ_DATA_TYPE to use this header
+#endif
+
+#ifndef FC__SPECBQ_COMMON_
+#define FC__SPECBQ_COMMON_
+
+/* Number of buckets: one for the last removed priority, and one for each
+ * bit of the priorities. */
+#define SPECBQ_BUCKET_NUM 33
+
+/************************************************************************//**
+  Map a priority to an unsigned key keeping the order.
+****************************************************************************/
+static inline unsigned int specbq_key(int priority)
+{
+  return (unsigned int) priority ^ 0x80000000U;
+}
+
+/************************************************************************//**
+  Return the priority matching the key.
+****************************************************************************/
+static inline int specbq_priority(unsigned int key)
+{
+  return (int) (key ^ 0x80000000U);
+}
+
+/************************************************************************//**
+  Return the bucket of 'key' when the last removed key is 'last', that is
+  the number of significant bits of (key ^ last).
+****************************************************************************/
+static inline int specbq_bucket(unsigned int key, unsigned int last)
+{
+  unsigned int diff = key ^ last;
+
+#ifdef __GNUC__
+  return (0 == diff ? 0 : 32 - __builtin_clz(diff));
+#else  /* __GNUC__ */
+  int bucket = 0;
+
+  while (0 != diff) {
+    diff >>= 1;
+    bucket++;
+  }
+  return bucket;
+#endif /* __GNUC__ */
+}
+
+#endif /* FC__SPECBQ_COMMON_ */
+
+#define SPECBQ_PASTE_(x, y) x ## y
+#define SPECBQ_PASTE(x, y) SPECBQ_PASTE_(x, y)
+
+#define SPECBQ_BQ struct SPECBQ_PASTE(SPECBQ_TAG, _bq)
+#define SPECBQ_BQ_ struct SPECBQ_PASTE(SPECBQ_TAG, _bq_private_)
+#define SPECBQ_BUCKET_ struct SPECBQ_PASTE(SPECBQ_TAG, _bucket_private_)
+#define SPECBQ_CELL_ struct SPECBQ_PASTE(SPECBQ_TAG, _bcell_private_)
+#define SPECBQ_FOO(suffix) SPECBQ_PASTE(SPECBQ_TAG, suffix)
+
+/* Dummy type. Actually a SPECBQ_BQ_, and not defined anywhere. */
+SPECBQ_BQ;
+
+/* Function related typedefs. */
+typedef void (*SPECBQ_FOO(_bq_data_free_fn_t)) (SPECBQ_DATA_TYPE);
+
+
+/* Private. */
+SPECBQ_CELL_ {
+  SPECBQ_DATA_TYPE data;
+  unsigned int key;
+};
+
+SPECBQ_BUCKET_ {
+  int size;
+  int avail;
+  SPECBQ_CELL_ *cells;
+};
+
+SPECBQ_BQ_ {
+  int size;
+  int step;
+  unsigned int last;
+  SPECBQ_BUCKET_ buckets[SPECBQ_BUCKET_NUM];
+};
+
+/************************************************************************//**
+  Build a new queue.
+  'initial_size' is the number of items for which memory is preallocated
+  in every bucket the first time it is used.
+****************************************************************************/
+static inline SPECBQ_BQ *SPECBQ_FOO(_bq_new)(int initial_size)
+{
+  SPECBQ_BQ_ *bq = fc_calloc(1, sizeof(*bq));
+
+  bq->step = MAX(initial_size, 1);
+  return (SPECBQ_BQ *) bq;
+}
+
+/************************************************************************//**
+  Destructor for queue structure.
+****************************************************************************/
+static inline void SPECBQ_FOO(_bq_destroy)(SPECBQ_BQ *_bq)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+  int i;
+
+  for (i = 0; i < SPECBQ_BUCKET_NUM; i++) {
+    free(bq->buckets[i].cells);
+  }
+  free(bq);
+}
+
+/************************************************************************//**
+  Alternative destructor for queue structure.
+****************************************************************************/
+static inline void
+SPECBQ_FOO(_bq_destroy_full)(SPECBQ_BQ *_bq,
+                             SPECBQ_FOO(_bq_data_free_fn_t) data_free)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+  int i, j;
+
+  if (data_free != NULL) {
+    for (i = 0; i < SPECBQ_BUCKET_NUM; i++) {
+      for (j = 0; j < bq->buckets[i].size; j++) {
+        data_free(bq->buckets[i].cells[j].data);
+      }
+    }
+  }
+  SPECBQ_FOO(_bq_destroy)(_bq);
+}
+
+/************************************************************************//**
+  Append a cell to a bucket.
+****************************************************************************/
+static inline void SPECBQ_FOO(_bq_bucket_push)(SPECBQ_BQ_ *bq,
+                                               SPECBQ_BUCKET_ *bucket,
+                                               SPECBQ_DATA_TYPE data,
+                                               unsigned int key)
+{
+  if (bucket->size >= bucket->avail) {
+    bucket->avail = (0 == bucket->avail ? bq->step : 2 * bucket->avail);
+    bucket->cells = fc_realloc(bucket->cells,
+                               sizeof(*bucket->cells) * bucket->avail);
+  }
+  bucket->cells[bucket->size].data = data;
+  bucket->cells[bucket->size].key = key;
+  bucket->size++;
+}
+
+/************************************************************************//**
+  Sort again all the items after 'bq->last' changed to a lower key.
+****************************************************************************/
+static inline void SPECBQ_FOO(_bq_rebucket)(SPECBQ_BQ_ *bq)
+{
+  int i, j;
+
+  /* Items can only move to higher buckets, so walk down. */
+  for (i = SPECBQ_BUCKET_NUM - 1; i >= 0; i--) {
+    SPECBQ_BUCKET_ *bucket = bq->buckets + i;
+
+    for (j = 0; j < bucket->size;) {
+      SPECBQ_CELL_ cell = bucket->cells[j];
+      int b = specbq_bucket(cell.key, bq->last);
+
+      if (b == i) {
+        j++;
+      } else {
+        bucket->cells[j] = bucket->cells[--bucket->size];
+        SPECBQ_FOO(_bq_bucket_push)(bq, bq->buckets + b, cell.data,
+                                    cell.key);
+      }
+    }
+  }
+}
+
+/************************************************************************//**
+  Insert an item into the queue.
+****************************************************************************/
+static inline void SPECBQ_FOO(_bq_insert)(SPECBQ_BQ *_bq,
+                                          SPECBQ_DATA_TYPE data,
+                                          int priority)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+  unsigned int key = specbq_key(priority);
+
+  if (0 == bq->size) {
+    /* Keep the keys close to the last one. */
+    bq->last = key;
+  } else if (key < bq->last) {
+    /* Not monotone. */
+    bq->last = key;
+    SPECBQ_FOO(_bq_rebucket)(bq);
+  }
+
+  SPECBQ_FOO(_bq_bucket_push)(bq, bq->buckets
+                              + specbq_bucket(key, bq->last), data, key);
+  bq->size++;
+}
+
+/************************************************************************//**
+  Make sure the first bucket contains the items of lowest priority.
+  Return FALSE iff the queue is empty.
+****************************************************************************/
+static inline bool SPECBQ_FOO(_bq_settle)(SPECBQ_BQ_ *bq)
+{
+  SPECBQ_BUCKET_ *bucket;
+  unsigned int min;
+  int i;
+
+  if (0 == bq->size) {
+    return FALSE;
+  }
+
+  if (0 < bq->buckets[0].size) {
+    return TRUE;
+  }
+
+  for (i = 1; 0 == bq->buckets[i].size; i++) {
+    fc_assert_ret_val(i < SPECBQ_BUCKET_NUM - 1, FALSE);
+  }
+
+  /* Every item of this bucket go to lower buckets when 'last' becomes
+   * their lowest key. */
+  bucket = bq->buckets + i;
+  min = bucket->cells[0].key;
+  for (i = 1; i < bucket->size; i++) {
+    if (bucket->cells[i].key < min) {
+      min = bucket->cells[i].key;
+    }
+  }
+  bq->last = min;
+  for (i = 0; i < bucket->size; i++) {
+    SPECBQ_FOO(_bq_bucket_push)(bq, bq->buckets
+                                + specbq_bucket(bucket->cells[i].key, min),
+                                bucket->cells[i].data,
+                                bucket->cells[i].key);
+  }
+  bucket->size = 0;
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Remove the lowest-ranking item from the queue and store it in 'pdata'
+  and its priority in 'ppriority'. 'pdata' and 'ppriority' may be NULL.
+  Return FALSE iff no item could be removed, because the queue was empty.
+****************************************************************************/
+static inline bool SPECBQ_FOO(_bq_remove)(SPECBQ_BQ *_bq,
+                                          SPECBQ_DATA_TYPE *pdata,
+                                          int *ppriority)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+  SPECBQ_BUCKET_ *bucket = bq->buckets;
+
+  if (!SPECBQ_FOO(_bq_settle)(bq)) {
+    return FALSE;
+  }
+
+  bucket->size--;
+  bq->size--;
+  if (pdata != NULL) {
+    *pdata = bucket->cells[bucket->size].data;
+  }
+  if (ppriority != NULL) {
+    *ppriority = specbq_priority(bucket->cells[bucket->size].key);
+  }
+
+  return TRUE;
+}
+
+/************************************************************************//**
+  Store the lowest-ranking item in 'pdata' without removing it. Return
+  FALSE if the queue is empty, in case 'pdata' is not set.
+****************************************************************************/
+static inline bool SPECBQ_FOO(_bq_peek)(SPECBQ_BQ *_bq,
+                                        SPECBQ_DATA_TYPE *pdata)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+
+  if (!SPECBQ_FOO(_bq_settle)(bq)) {
+    return FALSE;
+  }
+
+  *pdata = bq->buckets[0].cells[bq->buckets[0].size - 1].data;
+  return TRUE;
+}
+
+/************************************************************************//**
+  Set the lowest priority of the queue in 'ppriority'. Return FALSE iff
+  the queue is empty.
+****************************************************************************/
+static inline bool SPECBQ_FOO(_bq_priority)(SPECBQ_BQ *_bq,
+                                            int *ppriority)
+{
+  SPECBQ_BQ_ *bq = (SPECBQ_BQ_ *) _bq;
+
+  if (!SPECBQ_FOO(_bq_settle)(bq)) {
+    return FALSE;
+  }
+
+  *ppriority = specbq_priority(bq->last);
+  return TRUE;
+}
+
+/************************************************************************//**
+  Return the number of items in the queue, outdated entries included.
+****************************************************************************/
+static inline int SPECBQ_FOO(_bq_size)(const SPECBQ_BQ *_bq)
+{
+  return ((const SPECBQ_BQ_ *) _bq)->size;
+}
+
+/************************************************************************//**
+  Return the number of bytes allocated for the queue.
+****************************************************************************/
+static inline size_t SPECBQ_FOO(_bq_memory)(const SPECBQ_BQ *_bq)
+{
+  const SPECBQ_BQ_ *bq = (const SPECBQ_BQ_ *) _bq;
+  size_t memory = sizeof(*bq);
+  int i;
+
+  for (i = 0; i < SPECBQ_BUCKET_NUM; i++) {
+    memory += bq->buckets[i].avail * sizeof(*bq->buckets[i].cells);
+  }
+
+  return memory;
+}
+
+#undef SPECBQ_TAG
+#undef SPECBQ_DATA_TYPE
+#undef SPECBQ_PASTE_
+#undef SPECBQ_PASTE
+#undef SPECBQ_BQ
+#undef SPECBQ_BQ_
+#undef SPECBQ_BUCKET_
+#undef SPECBQ_CELL_
+#undef SPECBQ_FOO
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */